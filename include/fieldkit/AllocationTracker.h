@@ -0,0 +1,119 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+/*
+ * Opt-in heap allocation instrumentation.
+ *
+ * Define ENABLE_ALLOCATION_TRACKING when building FieldKit to replace the global
+ * operator new/delete with versions that count allocations per subsystem.
+ * Without it all scopes compile to nothing and no counting takes place.
+ *
+ * Usage:
+ *		void Physics::update(float dt) {
+ *			ALLOCATION_SCOPE("physics");
+ *			...
+ *		}
+ *
+ *		// once per frame in the application
+ *		AllocationTracker::beginFrame();
+ *		...
+ *		AllocationTracker::endFrame();
+ *		AllocationTracker::report(std::cout);
+ *
+ * NOTE: scopes are tracked per thread, allocations on OpenMP worker threads are 
+ * counted towards the unscoped subsystem.
+ */
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+	#define ALLOCATION_SCOPE_CONCAT_(A, B) A ## B
+	#define ALLOCATION_SCOPE_CONCAT(A, B) ALLOCATION_SCOPE_CONCAT_(A, B)
+	#define ALLOCATION_SCOPE(NAME) \
+		static int ALLOCATION_SCOPE_CONCAT(allocationSubsystem, __LINE__) = fieldkit::AllocationTracker::registerSubsystem(NAME); \
+		fieldkit::AllocationScope ALLOCATION_SCOPE_CONCAT(allocationScope, __LINE__)(ALLOCATION_SCOPE_CONCAT(allocationSubsystem, __LINE__));
+#else
+	#define ALLOCATION_SCOPE(NAME)
+#endif
+
+namespace fieldkit {
+
+	//! Counts heap allocations per subsystem and frame
+	class AllocationTracker {
+	public:
+		static const int MAX_SUBSYSTEMS = 64;
+
+		//! id of the subsystem allocations outside of any scope count towards
+		static const int UNSCOPED = 0;
+
+		struct Stats {
+			const char* name;
+			long allocations;
+			long bytes;
+		};
+
+		//! returns the id for the given subsystem name, registers it when its used for the first time
+		static int registerSubsystem(const char* name);
+
+		//! number of registered subsystems, including the unscoped subsystem
+		static int getNumSubsystems();
+
+		//! counts a single allocation towards the subsystem of the calling thread
+		static void record(size_t bytes);
+
+		//! resets the per frame counters
+		static void beginFrame();
+
+		//! stores the counters of the frame that just ended
+		static void endFrame();
+
+		//! allocations of the given subsystem during the last completed frame
+		static Stats getFrameStats(int subsystem);
+
+		//! allocations of the given subsystem since the program started
+		static Stats getTotalStats(int subsystem);
+
+		//! writes the last frames allocations for every subsystem that allocated
+		static void report(std::ostream& out);
+
+		//! Test mode: when enabled every allocation inside a scope is counted as violation
+		//! and if failOnAllocation is set the program is aborted right away.
+		static void setStrict(bool enabled, bool failOnAllocation=false);
+		static bool getStrict();
+		static long getNumViolations();
+		static void resetViolations();
+
+		// Thread state
+		static int getCurrentSubsystem();
+		static void setCurrentSubsystem(int subsystem);
+
+		//! true when FieldKit was built with ENABLE_ALLOCATION_TRACKING
+		static bool isEnabled();
+	};
+
+	//! Counts all allocations made by the current thread during its lifetime towards the given subsystem
+	class AllocationScope {
+	public:
+		AllocationScope(int subsystem) 
+		{
+			previous = AllocationTracker::getCurrentSubsystem();
+			AllocationTracker::setCurrentSubsystem(subsystem);
+		}
+
+		~AllocationScope() 
+		{
+			AllocationTracker::setCurrentSubsystem(previous);
+		}
+
+	private:
+		int previous;
+	};
+	
+} // namespace fieldkit
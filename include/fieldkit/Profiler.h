@@ -0,0 +1,129 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <vector>
+#include <ostream>
+#include <typeinfo>
+#include <boost/cstdint.hpp>
+
+/*
+ * Lightweight scoped timer instrumentation.
+ *
+ * Define ENABLE_PROFILER when building FieldKit to record how long each 
+ * PROFILE_SCOPE takes. Every thread writes into its own ring buffer, so statistics 
+ * always cover the most recent Profiler::EVENTS_PER_THREAD events of each thread.
+ * When a thread exits its buffer, events included, is handed on to the next new thread.
+ * Without the define all scopes compile to nothing.
+ *
+ * Usage:
+ *		void Physics::update(float dt) {
+ *			PROFILE_SCOPE("physics.update");
+ *			...
+ *		}
+ *
+ *		Profiler::report(std::cout);
+ *		
+ *		// open in chrome://tracing
+ *		std::ofstream trace("trace.json");
+ *		Profiler::writeChromeTrace(trace);
+ */
+
+#ifdef ENABLE_PROFILER
+	#define PROFILE_SCOPE_CONCAT_(A, B) A ## B
+	#define PROFILE_SCOPE_CONCAT(A, B) PROFILE_SCOPE_CONCAT_(A, B)
+	#define PROFILE_SCOPE(NAME) \
+		static int PROFILE_SCOPE_CONCAT(profileName, __LINE__) = fieldkit::Profiler::registerName(NAME); \
+		fieldkit::ProfileScope PROFILE_SCOPE_CONCAT(profileScope, __LINE__)(PROFILE_SCOPE_CONCAT(profileName, __LINE__));
+	#define PROFILE_SCOPE_ID(ID) \
+		fieldkit::ProfileScope PROFILE_SCOPE_CONCAT(profileScope, __LINE__)(ID);
+#else
+	#define PROFILE_SCOPE(NAME)
+	#define PROFILE_SCOPE_ID(ID)
+#endif
+
+namespace fieldkit {
+
+	class Profiler {
+	public:
+		typedef boost::uint64_t Ticks;
+
+		//! number of events each thread keeps before overwriting the oldest ones
+		static const int EVENTS_PER_THREAD = 16384;
+
+		//! timing statistics in milliseconds
+		struct Stats {
+			const char* name;
+			int count;
+			double average;
+			double min;
+			double max;
+			double p50;
+			double p90;
+			double p99;
+		};
+
+		//! returns the id for the given scope name, the string must stay valid for the lifetime of the program
+		static int registerName(const char* name);
+
+		//! returns an id named after the given type e.g. to profile individual behaviours,
+		//! takes a lock so callers should keep the id around instead of asking every time
+		static int registerType(std::type_info const& type);
+
+		//! stores a single timed event for the calling thread
+		static void record(int id, Ticks start, Ticks end);
+
+		//! statistics for all events with the given id still held in the ring buffers
+		static Stats getStats(int id);
+
+		//! looks up an already registered name, returns empty statistics for unknown names
+		static Stats getStats(const char* name);
+
+		//! statistics for every registered scope that has events
+		static void getAllStats(std::vector<Stats>& result);
+
+		//! writes a table with statistics of all scopes
+		static void report(std::ostream& out);
+
+		//! writes all buffered events in the Chrome trace event format (chrome://tracing)
+		static void writeChromeTrace(std::ostream& out);
+
+		//! drops all recorded events
+		static void clear();
+
+		//! allows recording to be paused at runtime
+		static void setEnabled(bool enabled);
+		static bool getEnabled();
+
+		// Timing
+		static Ticks getTicks();
+		static double ticksToMilliseconds(Ticks ticks);
+
+		//! true when FieldKit was built with ENABLE_PROFILER
+		static bool isCompiledIn();
+	};
+
+	//! Times its own lifetime and records it under the given id
+	class ProfileScope {
+	public:
+		ProfileScope(int id) : id(id) 
+		{
+			start = Profiler::getTicks();
+		}
+
+		~ProfileScope() 
+		{
+			Profiler::record(id, start, Profiler::getTicks());
+		}
+
+	private:
+		int id;
+		Profiler::Ticks start;
+	};
+
+} // namespace fieldkit
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <vector>
 #include "fieldkit/fbx/FBXKit.h"
 
 namespace fieldkit { namespace fbx {
@@ -51,6 +52,10 @@ namespace fieldkit { namespace fbx {
 
 		KArrayTemplate<Texture*> getTextures() { return textures; }
 
+		//! Appends the triangles of all meshes in world space at the current time, e.g. to bake 
+		//! a physics::DistanceField. Polygons are split into fans, deformers are ignored.
+		void getTriangles(std::vector<ci::Vec3f>& vertices, std::vector<int>& indices);
+
 	protected:	
 		KFbxSdkManager* sdkManager;
 		KFbxScene* fbxScene;
@@ -62,5 +67,7 @@ namespace fieldkit { namespace fbx {
 		KArrayTemplate<Texture*> textures;
 
 		KTime period, start, stop, currentTime;
+
+		void getTrianglesRecursive(KFbxNode* node, std::vector<ci::Vec3f>& vertices, std::vector<int>& indices);
 	};
 } } // namespace fieldkit::fbx
\ No newline at end of file
@@ -98,6 +98,19 @@ namespace fieldkit { namespace gl {
 		
 		//! call this when all data for a single particle was inserted
 		void insert();
+
+		//! the current write position in the mapped buffer, to fill many particles at once
+		GLfloat* getPointer() { return ptr; }
+
+		//! maximum number of particles the buffer can hold
+		int getCapacity() { return capacity; }
+
+		//! number of floats a single particle takes up in the buffer
+		int getFloatsPerParticle() { return bytesPerParticle / sizeof(GLfloat); }
+
+		//! call this when count particles were written at getPointer() e.g. by PhysicsFrame::fill,
+		//! the count is clamped to the remaining capacity
+		void insert(int count);
 		
 		//! draws this cloud to screen
 		void draw();
@@ -26,6 +26,8 @@ namespace fieldkit {
 		
 		// Bounding Volume
 		bool contains(Vec3f const& point);
+		int containsMany(const float* x, const float* y, const float* z, int count, unsigned char* outMask);
+		int intersectsMany(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* outMask);
 		
 		//! Grows / shrinks the box by the given amount
 		void expand(Vec3f const& amount);
@@ -27,6 +27,14 @@ namespace fieldkit {
 		Vec3f position;
 		virtual bool contains(Vec3f const& p) = 0;
 		bool intersects(BoundingVolume* volume);
+
+		//! Tests count points given as separate x, y and z arrays.
+		//! Sets outMask[i] to 1 for every contained point, 0 otherwise and returns the number of hits.
+		virtual int containsMany(const float* x, const float* y, const float* z, int count, unsigned char* outMask);
+
+		//! Tests count spheres given as separate center and radius arrays for intersection with this volume.
+		//! Uses the same rules as intersects, fills outMask like containsMany and returns the number of hits.
+		virtual int intersectsMany(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* outMask);
 		
 		// Accessors
 		Vec3f getPosition() { return position; };
@@ -0,0 +1,64 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <cmath>
+
+#include "fieldkit/math/AABB.h"
+#include "fieldkit/math/SphereBound.h"
+
+namespace fieldkit {
+
+	// Inline point and overlap tests for code that knows the concrete volume types at compile time,
+	// e.g. the AABB and SphereBound overloads of Space::select. BoundingVolume::intersects dispatches to the same tests.
+
+	inline bool isInside(AABB const& box, Vec3f const& p)
+	{
+		return !(p.x < box.min.x || p.x > box.max.x ||
+				 p.y < box.min.y || p.y > box.max.y ||
+				 p.z < box.min.z || p.z > box.max.z);
+	}
+
+	inline bool isInside(SphereBound const& sphere, Vec3f const& p)
+	{
+		float dx = sphere.position.x - p.x;
+		float dy = sphere.position.y - p.y;
+		float dz = sphere.position.z - p.z;
+		return dx * dx + dy * dy + dz * dz <= sphere.radius * sphere.radius;
+	}
+
+	inline bool isOverlapping(AABB const& a, AABB const& b)
+	{
+		return	fabsf(a.position.x - b.position.x) <= (a.extent.x + b.extent.x) &&
+				fabsf(a.position.y - b.position.y) <= (a.extent.y + b.extent.y) &&
+				fabsf(a.position.z - b.position.z) <= (a.extent.z + b.extent.z);
+	}
+
+	//! true when the surfaces of both spheres touch
+	inline bool isOverlapping(SphereBound const& a, SphereBound const& b)
+	{
+		float d = (a.position - b.position).length();
+		return d <= a.radius + b.radius && d >= fabsf(a.radius - b.radius);
+	}
+
+	inline bool isOverlapping(AABB const& a, SphereBound const& b)
+	{
+		// squared distance from the sphere center to the box
+		Vec3f const& c = b.position;
+		float dx = c.x < a.min.x ? c.x - a.min.x : (c.x > a.max.x ? c.x - a.max.x : 0.0f);
+		float dy = c.y < a.min.y ? c.y - a.min.y : (c.y > a.max.y ? c.y - a.max.y : 0.0f);
+		float dz = c.z < a.min.z ? c.z - a.min.z : (c.z > a.max.z ? c.z - a.max.z : 0.0f);
+		return dx * dx + dy * dy + dz * dz <= b.radius * b.radius;
+	}
+
+	inline bool isOverlapping(SphereBound const& a, AABB const& b)
+	{
+		return isOverlapping(b, a);
+	}
+
+} // namespace fieldkit
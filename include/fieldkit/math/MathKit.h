@@ -12,6 +12,15 @@
 //#include "cinder/CinderMath.h"
 #include "fieldkit/math/Vector.h"
 
+// SSE2 code paths are used whenever the compiler targets it, define DISABLE_SSE to always use the plain versions
+#if !defined(DISABLE_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define ENABLE_SSE
+#endif
+
+#ifdef ENABLE_SSE
+	#include <xmmintrin.h>
+#endif
+
 // Global math helper methods
 namespace fieldkit {
     
@@ -20,6 +29,14 @@ namespace fieldkit {
 	// Carmack's inverse square root function
 	float invSqrt(float x);
 	
+	//! when enabled the rand functions below draw from a private generator seeded with seed
+	//! instead of ci::Rand, so the application drawing from ci::Rand doesnt shift their sequence.
+	//! Used by Physics::setDeterministic. The private generator is not thread safe.
+	void setRandDeterministic(bool enabled, unsigned int seed=0);
+
+	//! seeds ci::Rand, or the private generator while deterministic mode is enabled.
+	void randSeed(unsigned int seed);
+	
 	float randFloat();
 	float randFloat(float range);
 	float randFloat(float from, float to);
@@ -40,4 +57,17 @@ namespace fieldkit {
 		return a + (b-a)*t;
 	}
 	
+#ifdef ENABLE_SSE
+	//! expands the 4 lane result of a comparison into the byte mask and returns the number of hits
+	inline int writeMask(__m128 result, unsigned char* outMask)
+	{
+		int bits = _mm_movemask_ps(result);
+		outMask[0] = bits & 1;
+		outMask[1] = (bits >> 1) & 1;
+		outMask[2] = (bits >> 2) & 1;
+		outMask[3] = (bits >> 3) & 1;
+		return outMask[0] + outMask[1] + outMask[2] + outMask[3];
+	}
+#endif
+	
 } // namespace fieldkit
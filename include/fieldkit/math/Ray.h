@@ -11,9 +11,13 @@
 
 #include "fieldkit/math/Vector.h"
 
+#include <cmath>
+
 namespace fieldkit {
 	
 	class Line2f;
+	class AABB;
+	class SphereBound;
 	
 	//! A 2 or 3-dimensional ray
 	class Ray2f {
@@ -43,4 +47,54 @@ namespace fieldkit {
 		Vec2f direction;
 	};
 	
+	//! A 3-dimensional ray, the direction is always kept normalized so distances along the ray are absolute
+	class Ray3f {
+	public:
+		Ray3f() : origin(Vec3f::zero()), direction(Vec3f::zAxis()) {};
+		Ray3f(Vec3f origin_, Vec3f direction_) :
+			origin(origin_), direction(direction_.normalized()) {};
+		
+		~Ray3f() {};
+		
+		Vec3f getPointAtDistance(float length) const {
+			return origin + direction * length;
+		}
+		
+		//! Finds the distance to the first intersection with a sphere, rays starting inside hit at distance 0.
+		bool findIntersection(Vec3f const& center, float radius, float* distance=NULL) const {
+			Vec3f m = origin - center;
+			float b = m.dot(direction);
+			float c = m.dot(m) - radius * radius;
+			
+			// starts outside and points away
+			if(c > 0.0f && b > 0.0f) return false;
+			
+			float discr = b * b - c;
+			if(discr < 0.0f) return false;
+			
+			if(distance != NULL) {
+				float t = -b - sqrtf(discr);
+				*distance = t < 0.0f ? 0.0f : t;
+			}
+			return true;
+		}
+		
+		bool findIntersection(SphereBound const& sphere, float* distance=NULL) const;
+		
+		//! Finds the distances where the ray enters and leaves a box given by its corners.
+		bool findIntersection(Vec3f const& min, Vec3f const& max, float* tNear=NULL, float* tFar=NULL) const;
+		bool findIntersection(AABB const& box, float* tNear=NULL, float* tFar=NULL) const;
+		
+		// Accessors
+		Vec3f getOrigin() const { return origin; }
+		void setOrigin(Vec3f point) { origin = point; }
+		
+		Vec3f getDirection() const { return direction; }
+		void setDirection(Vec3f vector) { direction = vector.normalized(); }
+		
+	protected:
+		Vec3f origin;
+		Vec3f direction;
+	};
+	
 } // namespace fieldkit
\ No newline at end of file
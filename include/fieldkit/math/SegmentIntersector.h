@@ -0,0 +1,79 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "fieldkit/math/Vector.h"
+#include "fieldkit/math/Line.h"
+
+namespace fieldkit {
+
+	//! Finds all intersecting pairs among large numbers of 2D line segments, e.g. the strokes of a drawing.
+	//! Segments are stored as separate coordinate arrays and sorted into a uniform grid by their bounding boxes. 
+	//! Pairs within a cell are tested four at a time with SSE, cells are processed in parallel when OpenMP is enabled.
+	//! Uses the same test as Line2f::findIntersection, so parallel and coincident segments don't intersect.
+	class SegmentIntersector {
+	public:
+		struct Intersection {
+			int a;  // index of the first segment, always smaller than b
+			int b;
+			Vec2f point;
+		};
+
+		SegmentIntersector();
+		~SegmentIntersector() {};
+
+		//! removes all segments
+		void clear();
+
+		//! make sure the intersector can hold a certain amount of segments
+		void reserve(int count);
+
+		//! adds a single segment and returns its index
+		int add(Vec2f const& p1, Vec2f const& p2);
+		int add(Line2f const& line);
+
+		//! replaces all segments with the given coordinate arrays
+		void set(const float* x1, const float* y1, const float* x2, const float* y2, int count);
+
+		//! Finds all intersecting pairs, sorted by segment indices. Returns the number of intersections.
+		int findIntersections(std::vector<Intersection>& result);
+
+		// Accessors
+		int size() { return x1.size(); }
+		Line2f getLine(int index) { return Line2f(Vec2f(x1[index], y1[index]), Vec2f(x2[index], y2[index])); }
+
+		//! Edge length of the grid cells, 0 picks one from the average segment size.
+		//! Sizes that would create more than about 2 cells per segment are raised to that limit.
+		void setCellSize(float value) { cellSize = value; }
+		float getCellSize() { return cellSize; }
+
+	protected:
+		std::vector<float> x1;
+		std::vector<float> y1;
+		std::vector<float> x2;
+		std::vector<float> y2;
+
+		float cellSize;
+
+		// grid of the last query, segment indices per cell are stored in one array
+		struct CellRange {
+			int minX, minY, maxX, maxY;
+		};
+		std::vector<CellRange> ranges;
+		std::vector<int> cellStart;
+		std::vector<int> cellItems;
+		int cellsX;
+		int cellsY;
+
+		void buildGrid();
+		void findInCell(int cell, std::vector<float>& scratch, std::vector<Intersection>& result);
+	};
+
+} // namespace fieldkit
@@ -28,6 +28,8 @@ namespace fieldkit {
 		
 		// Bounding Volume
 		bool contains(Vec3f const& p);
+		int containsMany(const float* x, const float* y, const float* z, int count, unsigned char* outMask);
+		int intersectsMany(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* outMask);
 		
 		// Accessors		
 		void setRadius(float value) { radius = value; };
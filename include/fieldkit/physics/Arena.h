@@ -0,0 +1,60 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace fieldkit { namespace physics {
+
+	//! Hands out fixed size memory blocks from large contiguous chunks.
+	//! Blocks can't be freed individually, instead all chunks are released at once.
+	//! NOTE: the arena only manages raw memory, constructing and destructing objects is up to the user.
+	class Arena {
+	public:
+		Arena();
+		Arena(size_t blockSize, int blocksPerChunk=4096);
+		~Arena();
+
+		//! sets the size of a single block, releases all memory allocated so far
+		void init(size_t blockSize, int blocksPerChunk=4096);
+
+		//! makes sure the next count blocks are allocated from one contiguous chunk
+		void reserve(int count);
+
+		//! returns a new uninitialised memory block
+		void* allocate();
+
+		//! frees all chunks at once
+		void release();
+
+		// Accessors
+		size_t getBlockSize() { return blockSize; }
+		int getNumBlocks() { return numBlocks; }
+		int getNumChunks() { return chunks.size(); }
+
+	protected:
+		struct Chunk {
+			char* data;
+			int capacity;
+			int used;
+		};
+
+		std::vector<Chunk> chunks;
+		size_t blockSize;
+		int blocksPerChunk;
+		int numBlocks;
+
+		void addChunk(int capacity);
+
+	private:
+		Arena(Arena const&);
+		Arena& operator=(Arena const&);
+	};
+
+} } // namespace fieldkit::physics
@@ -11,6 +11,8 @@
 
 #include "fieldkit/physics/Particle.h"
 #include "fieldkit/physics/space/Space.h"
+#include "fieldkit/physics/Snapshot.h"
+#include "fieldkit/Profiler.h"
 
 namespace fieldkit { namespace physics {
 
@@ -19,15 +21,34 @@ namespace fieldkit { namespace physics {
 	public:
 		Space* space;
 		
-		Behaviour() {};
+		Behaviour() : profileID(-1) {};
 		virtual ~Behaviour() {};
 		
-		Behaviour(Space* space) {
+		Behaviour(Space* space) : profileID(-1) {
 			this->space = space;
 		};
 		
 		virtual void prepare(float dt) {};
 		virtual void apply(Particle* p) = 0;
+
+		//! false when apply modifies other particles than p or draws random numbers,
+		//! these behaviours are never run in parallel
+		virtual bool isParallelSafe() { return true; }
+
+		//! saves and restores the parameters of this behaviour in a physics Snapshot
+		virtual void write(SnapshotWriter& out) {}
+		virtual void read(SnapshotReader& in) {}
+
+		//! id this behaviour is profiled under, named after its type and only looked up once
+		int getProfileID()
+		{
+			if(profileID < 0)
+				profileID = Profiler::registerType(typeid(*this));
+			return profileID;
+		}
+
+	private:
+		int profileID;
 	};
 	
 	// A behaviour with a weight field
@@ -39,6 +60,9 @@ namespace fieldkit { namespace physics {
 		
 		void setWeight(float value) { this->weight = value; }
 		float getWeight() { return this->weight; }
+
+		void write(SnapshotWriter& out) { out.write(weight); }
+		void read(SnapshotReader& in) { in.read(weight); }
 		
 	protected:
 		float weight;
@@ -0,0 +1,141 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#pragma once
+
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include "fieldkit/physics/PhysicsKit_Prefix.h"
+
+namespace fieldkit { namespace physics {
+
+	// FWD
+	class Physics;
+	class Behaviour;
+	class Constraint;
+
+	//! A change to the physics that is requested from another thread and applied at the start of Physics::update
+	class PhysicsCommand {
+	public:
+		PhysicsCommand() : next(NULL) {}
+		virtual ~PhysicsCommand() {}
+
+		virtual void apply(Physics* physics) = 0;
+
+	protected:
+		friend class CommandQueue;
+		boost::atomic<PhysicsCommand*> next;
+	};
+
+	/*
+	 * Lock-free multiple producer, single consumer queue of commands 
+	 * (intrusive linked list after Dmitry Vyukov).
+	 *
+	 * push never blocks and can be called from any number of threads, only one 
+	 * thread - the one running Physics::update - may pop. The queue owns the 
+	 * commands until they are popped.
+	 */
+	class CommandQueue {
+	public:
+		CommandQueue();
+		~CommandQueue();
+
+		void push(PhysicsCommand* command);
+
+		//! returns the oldest command or NULL when the queue is empty or a push is still in progress
+		PhysicsCommand* pop();
+
+		//! applies and deletes all queued commands, returns their number
+		int apply(Physics* physics);
+
+	protected:
+		//! end producers push to
+		boost::atomic<PhysicsCommand*> head;
+		//! end the consumer pops from, only touched by the consumer
+		PhysicsCommand* tail;
+
+		class Stub : public PhysicsCommand {
+			void apply(Physics* physics) {}
+		};
+		Stub stub;
+	};
+
+
+	// -- Commands -------------------------------------------------------------
+
+	//! calls a function on the simulation thread e.g. boost::bind(&AttractorPoint::setWeight, attractor, 0.5f)
+	class FunctionCommand : public PhysicsCommand {
+	public:
+		FunctionCommand(boost::function<void ()> const& function) : function(function) {}
+		void apply(Physics* physics) { function(); }
+
+	protected:
+		boost::function<void ()> function;
+	};
+
+	//! emits particles at the given position, through the emitter behaviours when there is an emitter
+	class SpawnParticlesCommand : public PhysicsCommand {
+	public:
+		SpawnParticlesCommand(Vec3f const& position, int count=1) : position(position), count(count) {}
+		void apply(Physics* physics);
+
+	protected:
+		Vec3f position;
+		int count;
+	};
+
+	//! retires all particles with ids in [firstID, lastID]
+	class RetireParticlesCommand : public PhysicsCommand {
+	public:
+		RetireParticlesCommand(int firstID, int lastID) : firstID(firstID), lastID(lastID) {}
+		void apply(Physics* physics);
+
+	protected:
+		int firstID;
+		int lastID;
+	};
+
+	class AddBehaviourCommand : public PhysicsCommand {
+	public:
+		AddBehaviourCommand(Behaviour* behaviour) : behaviour(behaviour) {}
+		void apply(Physics* physics);
+
+	protected:
+		Behaviour* behaviour;
+	};
+
+	//! removes the behaviour and deletes it when the physics owns its behaviours
+	class RemoveBehaviourCommand : public PhysicsCommand {
+	public:
+		RemoveBehaviourCommand(Behaviour* behaviour) : behaviour(behaviour) {}
+		void apply(Physics* physics);
+
+	protected:
+		Behaviour* behaviour;
+	};
+
+	class AddConstraintCommand : public PhysicsCommand {
+	public:
+		AddConstraintCommand(Constraint* constraint) : constraint(constraint) {}
+		void apply(Physics* physics);
+
+	protected:
+		Constraint* constraint;
+	};
+
+	//! removes the constraint and deletes it when the physics owns its constraints
+	class RemoveConstraintCommand : public PhysicsCommand {
+	public:
+		RemoveConstraintCommand(Constraint* constraint) : constraint(constraint) {}
+		void apply(Physics* physics);
+
+	protected:
+		Constraint* constraint;
+	};
+
+} } // namespace fieldkit::physics
@@ -14,6 +14,16 @@
 namespace fieldkit { namespace physics {
 
 	class Constraint : public Behaviour {
+	public:
+		//! applies the constraint to a range of particles, dead ones included.
+		//! Constraints that only affect a few particles override this to skip the others cheaply.
+		virtual void applyBatch(Particle** particles, int count)
+		{
+			for(int i=0; i<count; i++) {
+				if(particles[i]->isAlive)
+					apply(particles[i]);
+			}
+		}
 	};
 	
 } } // namespace fieldkit::physics
\ No newline at end of file
@@ -0,0 +1,118 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include "fieldkit/physics/PhysicsKit_Prefix.h"
+#include "fieldkit/math/AABB.h"
+
+namespace fieldkit { namespace physics {
+
+	// FWD
+	class Physics;
+	class Particle;
+	class HaloLink;
+	class HaloSender;
+
+	/*
+	 * One process of a simulation that is split into slabs across several processes, 
+	 * possibly on different hosts. Works like PartitionedPhysics, but every slab 
+	 * lives in its own process and talks to its two neighbours over TCP.
+	 *
+	 * Every update:
+	 *	1. the local Physics updates its particles
+	 *	2. one message is exchanged with each neighbour holding the particles that 
+	 *	   moved into its slab and the ghosts within haloWidth of the shared boundary
+	 *	3. neighbour lists are rebuilt from the owned particles and the ghosts
+	 *
+	 * The exchange doubles as the step barrier: every message carries the step number 
+	 * and a process can't continue before both neighbours reached the same step.
+	 *
+	 * The halo can't be wider than a slab, particles moving further than one slab per 
+	 * step are passed on over several steps. Springs aren't supported across processes. 
+	 * Particles are sent in their in-memory layout, so all hosts need the same architecture.
+	 *
+	 * Every process runs the same setup code: createParticle is called for all 
+	 * particles on every process and only the process owning the position keeps it, 
+	 * which keeps the particle ids the same everywhere.
+	 *
+	 * Usage:
+	 *		DistributedPhysics physics(bounds, rank, numRanks, 25.0f, createDomain);
+	 *		physics.connect(hosts, 40000);
+	 *		...
+	 *		physics.update(dt);
+	 */
+	class DistributedPhysics {
+	public:
+		//! creates the local Physics, its Space needs to cover the given bounds (the slab including its halo)
+		typedef boost::function<Physics* (AABB const& bounds)> DomainFactory;
+
+		DistributedPhysics(AABB const& bounds, int rank, int numRanks, float haloWidth, DomainFactory const& factory);
+		~DistributedPhysics();
+
+		//! hosts[i] is the address of rank i, which listens on basePort + i - blocks until both neighbours are connected
+		void connect(std::vector<std::string> const& hosts, int basePort, float timeout=10.0f);
+		void disconnect();
+
+		void update(float dt);
+
+		//! returns the new particle or NULL when its position belongs to another process
+		Particle* createParticle(Vec3f const& position);
+
+		Physics* getPhysics() { return physics; }
+		int getNumParticles();
+
+		int getRank() { return rank; }
+		int getNumRanks() { return numRanks; }
+		AABB getDomainBounds();
+
+		boost::uint32_t getStep() { return step; }
+		int getNumGhosts() { return numGhosts; }
+
+		//! number of particles that left this process during the last update
+		int getNumMigrations() { return numMigrations; }
+
+		void setNeighbourRadius(float radius);
+		float getNeighbourRadius() { return neighbourRadius; }
+
+	protected:
+		AABB bounds;
+		int rank;
+		int numRanks;
+		int axis;
+		float slabWidth;
+		float haloWidth;
+		float neighbourRadius;
+
+		Physics* physics;
+		int nextID;
+		boost::uint32_t step;
+		int numMigrations;
+
+		//! connections to the previous and the next slab
+		HaloLink* links[2];
+
+		//! sends the messages of every step to both links
+		HaloSender* sender;
+
+		std::vector<Particle*> ghosts;
+		int numGhosts;
+
+		int getRankIndex(Vec3f const& position);
+		float getSlabMin(int index);
+		float getSlabMax(int index);
+
+		void exchange();
+		void updateNeighbours();
+	};
+
+} } // namespace fieldkit::physics
@@ -18,6 +18,7 @@ namespace fieldkit { namespace physics {
 	class Physics;
 
 	class Emitter : public Behavioural {
+		friend class Snapshot;
 	public:
 		Physics* physics;
 		
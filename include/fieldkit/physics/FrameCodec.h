@@ -0,0 +1,84 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "fieldkit/physics/PhysicsKit_Prefix.h"
+#include "fieldkit/math/AABB.h"
+
+namespace fieldkit { namespace physics {
+
+	// FWD
+	struct ParticleFrame;
+
+	/*
+	 * Compresses a sequence of particle frames.
+	 *
+	 * Positions are quantised to 16 bit fixed point relative to the bounds, ages to 
+	 * milliseconds. Every value is stored as the difference to the same slot in the 
+	 * previous frame, split into byte planes (all low bytes, then all high bytes ...) 
+	 * and every plane is entropy coded on its own. Slowly moving particles give tiny 
+	 * differences, so the high byte planes end up almost empty.
+	 *
+	 * Encoder and decoder keep the values of the previous frame, so frames need to 
+	 * be decoded in the order they were encoded - starting at a keyframe.
+	 *
+	 * Usage:
+	 *		FrameCodec encoder(*physics->space);
+	 *		frame.capture(physics);
+	 *		encoder.encode(frame, isKeyframe, data);
+	 *		...
+	 *		FrameCodec decoder(bounds);
+	 *		decoder.decode(&data[0], data.size(), frame);
+	 */
+	class FrameCodec {
+	public:
+		FrameCodec();
+		FrameCodec(AABB const& bounds);
+
+		//! positions outside of the bounds are clamped to them
+		void setBounds(AABB const& bounds);
+		AABB getBounds() { return bounds; }
+
+		//! forgets the previous frame, the next encoded frame will be a keyframe
+		void reset();
+
+		void encode(ParticleFrame& frame, bool isKeyframe, std::vector<boost::uint8_t>& result);
+
+		//! decodes the frame that follows the previously decoded one
+		void decode(const boost::uint8_t* data, size_t size, ParticleFrame& result);
+
+		//! decodes the positions of alive particles straight into an interleaved array e.g. a mapped 
+		//! PointCloud buffer, stride is the number of floats per particle. Writes at most capacity 
+		//! particles and returns their number.
+		int decodePositions(const boost::uint8_t* data, size_t size, float* result, int stride, int capacity);
+
+		//! lossless compression of an array of elementSize byte values using the same byte plane and entropy coding
+		static void compress(const void* data, size_t size, int elementSize, std::vector<boost::uint8_t>& result);
+		static void decompress(const boost::uint8_t* data, size_t size, void* result, size_t resultSize, int elementSize);
+
+	protected:
+		AABB bounds;
+		bool needsKeyframe;
+
+		// values of the previous frame for every slot
+		std::vector<boost::uint16_t> quantised[3];
+		std::vector<boost::uint32_t> ages;
+
+		// decoded structure of arrays and scratch space reused between frames
+		std::vector<float> values[3];
+		std::vector<float> decodedAges;
+		std::vector<boost::uint8_t> alive;
+		std::vector<boost::uint8_t> planes;
+
+		void prepare(int numSlots, bool isKeyframe);
+		int decodeValues(const boost::uint8_t* data, size_t size);
+	};
+
+} } // namespace fieldkit::physics
@@ -0,0 +1,101 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <vector>
+#include "fieldkit/physics/PhysicsKit_Prefix.h"
+
+namespace fieldkit { namespace physics {
+
+	//! A fixed capacity list of particle indices that several threads can append to at once.
+	//! Appending never blocks or allocates, when the list is full further indices are dropped 
+	//! and the list is flagged as overflown.
+	class LifecycleQueue {
+	public:
+		LifecycleQueue();
+		~LifecycleQueue();
+
+		//! sets the maximum number of indices the queue can hold, must not be called while pushing
+		void reserve(int capacity);
+
+		//! appends a particle index, safe to be called from several threads at once
+		void push(int index);
+
+		//! copies all queued indices into result and empties the queue, returns the number of indices
+		int drain(std::vector<int>& result);
+
+		//! empties the queue
+		void clear();
+
+		// Accessors
+		int size();
+		int getCapacity() { return indices.size(); }
+
+		//! true when more indices were pushed than the queue could hold since it was last emptied
+		bool hasOverflown();
+
+	protected:
+		//! atomic push counter, defined in Lifecycle.cpp to keep boost::atomic out of this header
+		struct Counter;
+
+		std::vector<int> indices;
+		Counter* count;
+
+	private:
+		LifecycleQueue(LifecycleQueue const&);
+		LifecycleQueue& operator=(LifecycleQueue const&);
+	};
+
+
+	//! Keeps track of particle births and deaths so that applications dont have to scan 
+	//! the entire particle pool each frame to find out what changed.
+	//! Both lists contain indices into Physics::particles and accumulate until they're drained.
+	class ParticleLifecycle {
+	public:
+		//! indices of particles that came alive
+		LifecycleQueue born;
+
+		//! indices of particles that died, were killed or retired
+		LifecycleQueue died;
+
+		ParticleLifecycle() {}
+		~ParticleLifecycle() {}
+
+		//! makes sure the lifecycle can track the given number of particles
+		void resize(int numParticles);
+
+		//! forgets about all particles and queued events
+		void clear();
+
+		//! compares the particles current alive flag to the last known state and queues an event if it changed.
+		//! Safe to be called from several threads at once as long as every thread uses different indices.
+		inline void track(int index, bool isAlive)
+		{
+			char wasAlive = states[index];
+			if(wasAlive == (char)isAlive) return;
+
+			states[index] = (char)isAlive;
+			if(isAlive)
+				born.push(index);
+			else
+				died.push(index);
+		}
+
+		//! called when a dead particle is about to be recycled, makes sure its death is reported 
+		//! even when the particle was killed and reused in between two updates.
+		void recycle(int index);
+
+		int drainBorn(std::vector<int>& result) { return born.drain(result); }
+		int drainDied(std::vector<int>& result) { return died.drain(result); }
+		
+	protected:
+		//! alive flag of every particle as it was last reported
+		std::vector<char> states;
+	};
+
+} } // namespace fieldkit::physics
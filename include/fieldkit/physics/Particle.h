@@ -83,9 +83,11 @@ namespace fieldkit { namespace physics {
 
 		virtual void setSize(float radius);
 		inline float const getSize() { return size; }
+		float getRadius() { return size; }
 
 		void setWeight(float value);
 		float const getWeight() { return this->weight; };
+		float getMass() { return this->weight; };
 		float const getInvWeight() { return this->invWeight; };
 
 		Vec3f getVelocity();
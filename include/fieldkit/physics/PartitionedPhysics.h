@@ -0,0 +1,132 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include "fieldkit/physics/PhysicsKit_Prefix.h"
+#include "fieldkit/math/AABB.h"
+
+namespace fieldkit { namespace physics {
+
+	// FWD
+	class Physics;
+	class Particle;
+	class PartitionDomain;
+
+	/*
+	 * Splits a simulation into slabs along the longest axis of its bounds, each 
+	 * simulated by its own Physics so the domains can be updated in parallel.
+	 *
+	 * Every update:
+	 *	1. all domains update their particles (behaviours, integration, constraints)
+	 *	2. particles that left their slab migrate to the domain that now contains them
+	 *	3. every domain receives read-only copies (ghosts) of the particles of other 
+	 *	   domains within haloWidth of its slab
+	 *	4. springs within a slab are applied by its domain, then springs across a boundary 
+	 *	   are applied serially to the particles of both domains
+	 *	5. neighbour lists are rebuilt from the owned particles and the ghosts
+	 *
+	 * A single domain updates exactly like a Physics with the same Space.
+	 *
+	 * Behaviours can only read neighbours, writing to them (e.g. CollisionConstraint) 
+	 * only changes the ghost copy. The halo needs to be at least as wide as the 
+	 * neighbour radius.
+	 *
+	 * Particles and springs are created through this class, particle ids are unique 
+	 * over all domains and stay the same when a particle migrates. The lifecycle 
+	 * of every domain reports migrating particles as died and born.
+	 *
+	 * Usage:
+	 *		Physics* createDomain(AABB const& bounds) {
+	 *			Physics* physics = new Physics(new Octree(bounds.min, bounds.max - bounds.min, 10.0f));
+	 *			physics->addBehaviour(new FlockAttract(world));
+	 *			return physics;
+	 *		}
+	 *		...
+	 *		PartitionedPhysics* physics = new PartitionedPhysics(bounds, 8, 25.0f, createDomain);
+	 *		physics->setNeighbourRadius(25.0f);
+	 *		physics->createParticle(position);
+	 *		physics->update(dt);
+	 */
+	class PartitionedPhysics {
+	public:
+		//! creates the Physics of a domain, its Space needs to cover the given bounds 
+		//! (the slab and the halo on the sides facing other domains)
+		typedef boost::function<Physics* (AABB const& bounds)> DomainFactory;
+
+		PartitionedPhysics(AABB const& bounds, int numDomains, float haloWidth, DomainFactory const& factory);
+		~PartitionedPhysics();
+
+		void update(float dt);
+
+		//! creates a particle in the domain containing the position, the pointer is valid until the next update
+		Particle* createParticle(Vec3f const& position);
+
+		//! connects the particles with the given ids
+		void createSpring(int idA, int idB, float restLength, float strength);
+
+		//! the current particle with the given id or NULL if it isn't alive
+		Particle* getParticle(int id);
+
+		int getNumParticles();
+		int getNumSprings() { return springs.size(); }
+
+		int getNumDomains() { return domains.size(); }
+		Physics* getDomain(int index);
+		AABB getDomainBounds(int index);
+		int getNumGhosts(int index);
+
+		//! number of particles that changed their domain during the last update
+		int getNumMigrations() { return numMigrations; }
+
+		void setNeighbourRadius(float radius);
+		float getNeighbourRadius() { return neighbourRadius; }
+
+	protected:
+		struct Location {
+			int domain;
+			Particle* particle;
+		};
+
+		struct SpringLink {
+			int a, b;
+			float restLength;
+			float strength;
+		};
+
+		AABB bounds;
+		int axis;
+		float slabWidth;
+		float haloWidth;
+		float neighbourRadius;
+		int numMigrations;
+
+		std::vector<PartitionDomain*> domains;
+
+		//! where the particle with a certain id currently lives, indexed by id
+		std::vector<Location> locations;
+		std::vector<SpringLink> springs;
+
+		//! indices of the springs with their ends in different domains
+		std::vector<int> boundarySprings;
+
+		int getDomainIndex(Vec3f const& position);
+		Particle* getCurrent(int id);
+
+		void migrate();
+		void exchangeGhosts();
+		void updateSprings();
+		void applySpring(SpringLink const& s, Particle* a, Particle* b, Physics* physicsA, Physics* physicsB);
+		void refreshGhosts();
+		void updateNeighbours();
+	};
+
+} } // namespace fieldkit::physics
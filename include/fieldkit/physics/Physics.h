@@ -10,8 +10,11 @@
 #pragma once
 
 #include <vector>
+#include <boost/cstdint.hpp>
 #include "fieldkit/physics/PhysicsKit_Prefix.h"
 #include "fieldkit/physics/Behavioural.h"
+#include "fieldkit/physics/Lifecycle.h"
+#include "fieldkit/physics/CommandQueue.h"
 
 namespace fieldkit { namespace physics {
 
@@ -24,9 +27,11 @@ namespace fieldkit { namespace physics {
 	class SpringUpdate;
 	class NeighbourUpdate;
 	class ParticleUpdate;
+	class SharedMemoryExport;
 
 	//! base class for all types of physics systems
 	class Physics : public Behavioural {
+		friend class Snapshot;
 	public:
 		Emitter* emitter;
 		Space* space;
@@ -41,9 +46,35 @@ namespace fieldkit { namespace physics {
 		virtual ~Physics();
 			
 		virtual void update(float dt);
+
+		//! pre-sizes all particle and spring pools, the space and every particles neighbour list
+		//! so that a warmed up simulation doesnt need to allocate any memory during update
+		void reserve(int numParticles, int numSprings, int neighboursPerParticle);
+
+		//! number of times a pool or neighbour list had to grow during update (only tracked when PHYSICS_DEBUG is defined)
+		int getNumPoolGrowths() { return numPoolGrowths; }
+
+		//! when enabled update gives bit-identical results for the same seed independent of the 
+		//! number of threads, the seed is only pinned while enabled
+		void setDeterministic(bool enabled, unsigned int seed=0);
+		bool getDeterministic() { return isDeterministic; }
+
+		//! hash of the state of all particles and springs, used to compare simulation runs
+		boost::uint64_t getStateHash();
+
+		// Commands
+		//! queues a change from any thread without blocking, it is applied at the start of the next update
+		void post(PhysicsCommand* command) { commands.push(command); }
+		void post(boost::function<void ()> const& function) { commands.push(new FunctionCommand(function)); }
+
+		//! applies all queued commands right away, only call this from the thread that runs update
+		int applyCommands() { return commands.apply(this); }
 	
 		// Particles
         std::vector<Particle*> particles;
+
+		//! queues the indices of particles that were born or died since they were last drained
+		ParticleLifecycle lifecycle;
 		
 		void allocParticles(int count);
 		int getNumAllocatedParticles() { return numAllocatedParticles; }
@@ -55,6 +86,12 @@ namespace fieldkit { namespace physics {
 		bool hasParticlesAvailable(int num) { return num <= numAllocatedParticles - numActiveParticles; }
 		void destroyParticles();
 
+		//! copies the indices of all particles born since the last call into result
+		int drainBornParticles(std::vector<int>& result) { return lifecycle.drainBorn(result); }
+
+		//! copies the indices of all particles that died since the last call into result
+		int drainDiedParticles(std::vector<int>& result) { return lifecycle.drainDied(result); }
+
 		// Springs
         std::vector<Spring*> springs;
 
@@ -85,6 +122,10 @@ namespace fieldkit { namespace physics {
 		void setNeighbourUpdate(NeighbourUpdate* strategy);
 		NeighbourUpdate* getNeighbourUpdate() { return neighbourUpdate; };
 
+		//! publishes the alive particles after every update, the export isn't owned by this physics
+		void setSharedMemoryExport(SharedMemoryExport* sharedMemoryExport) { this->sharedMemoryExport = sharedMemoryExport; }
+		SharedMemoryExport* getSharedMemoryExport() { return sharedMemoryExport; }
+
 		// Accessors
 		void setOwnsSpace(bool isOwner) { ownsSpace = isOwner; }
 		bool getOwnsSpace() { return ownsSpace; }
@@ -98,11 +139,25 @@ namespace fieldkit { namespace physics {
 
 		int nextID;
 
+		//! indices createParticle and createSpring start looking for a dead element from
+		int nextFreeParticle;
+		int nextFreeSpring;
+
+		int neighboursPerParticle;
+		int numPoolGrowths;
+		bool isDeterministic;
+
+		//! sums up the capacity of all pools and neighbour lists
+		size_t getPoolCapacity();
+
 		ParticleAllocator* particleAllocator;
 		SpringAllocator* springAllocator;
 		ParticleUpdate* particleUpdate;
 		SpringUpdate* springUpdate;
 		NeighbourUpdate* neighbourUpdate;
+		SharedMemoryExport* sharedMemoryExport;
+
+		CommandQueue commands;
 	};
 
 } } // namespace fieldkit::physics
\ No newline at end of file
@@ -25,10 +25,12 @@
 #include "fieldkit/physics/space/BasicSpace.h"
 #include "fieldkit/physics/space/Octree.h"
 #include "fieldkit/physics/space/SpatialHash.h"
+#include "fieldkit/physics/space/AABBTree.h"
 
 // strategies
 #include "fieldkit/physics/strategy/PhysicsStrategy.h"
 #include "fieldkit/physics/strategy/ParticleAllocator.h"
+#include "fieldkit/physics/strategy/SpringAllocator.h"
 #include "fieldkit/physics/strategy/ParticleUpdate.h"
 #include "fieldkit/physics/strategy/SpringUpdate.h"
 #include "fieldkit/physics/strategy/NeighbourUpdate.h"
@@ -39,9 +41,18 @@
 #include "fieldkit/physics/Behavioural.h"
 
 #include "fieldkit/physics/Particle.h"
+#include "fieldkit/physics/Lifecycle.h"
 #include "fieldkit/physics/Emitter.h"
 #include "fieldkit/physics/Spring.h"
 #include "fieldkit/physics/Physics.h"
+#include "fieldkit/physics/Snapshot.h"
+#include "fieldkit/physics/FrameCodec.h"
+#include "fieldkit/physics/Recorder.h"
+#include "fieldkit/physics/SharedMemoryExport.h"
+#include "fieldkit/physics/CommandQueue.h"
+#include "fieldkit/physics/PhysicsPipeline.h"
+#include "fieldkit/physics/PartitionedPhysics.h"
+#include "fieldkit/physics/DistributedPhysics.h"
 
 // behaviours
 #include "fieldkit/physics/behaviour/Attractor.h"
@@ -49,10 +60,13 @@
 #include "fieldkit/physics/behaviour/Flocking.h"
 #include "fieldkit/physics/behaviour/Force.h"
 #include "fieldkit/physics/behaviour/Initializer.h"
+#include "fieldkit/physics/behaviour/NBody.h"
 #include "fieldkit/physics/behaviour/Random.h"
+#include "fieldkit/physics/behaviour/VectorField.h"
 
 // constraints
 #include "fieldkit/physics/behaviour/PlaneConstraint.h"
 #include "fieldkit/physics/behaviour/SphereConstraint.h"
+#include "fieldkit/physics/behaviour/SDFConstraint.h"
 //#include "fieldkit/physics/behaviour/BoxConstraint.h"
 #include "fieldkit/physics/behaviour/CollisionConstraint.h"
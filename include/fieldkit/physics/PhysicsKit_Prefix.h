@@ -14,6 +14,11 @@
 #include "fieldkit/math/MathKit.h"
 #include <boost/foreach.hpp>
 
+// debug builds keep track of additional statistics e.g. pool reallocations
+#if defined(DEBUG) || defined(_DEBUG)
+	#define PHYSICS_DEBUG
+#endif
+
 namespace fieldkit { namespace physics {
 	using namespace fieldkit;
 } }
\ No newline at end of file
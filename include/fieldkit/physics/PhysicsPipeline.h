@@ -0,0 +1,147 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include "fieldkit/physics/PhysicsKit_Prefix.h"
+
+namespace fieldkit { namespace physics {
+
+	// FWD
+	class Physics;
+
+	/*
+	 * Hands values from one producer to one consumer thread without locks.
+	 *
+	 * The producer fills getBack() and publishes it, the consumer takes the most 
+	 * recently published buffer with acquire() and reads getFront(). Neither side 
+	 * ever waits, frames the consumer didn't pick up in time are overwritten.
+	 */
+	template<typename T>
+	class TripleBuffer {
+	public:
+		TripleBuffer() : back(0), middle(1), front(2) {}
+
+		//! producer: the buffer to write the next value into
+		T& getBack() { return buffers[back]; }
+
+		//! producer: makes the back buffer the latest one
+		void publish() 
+		{
+			back = middle.exchange(back | FRESH, boost::memory_order_acq_rel) & INDEX;
+		}
+
+		//! consumer: switches to the latest published buffer, returns false if there is nothing new
+		bool acquire()
+		{
+			if((middle.load(boost::memory_order_acquire) & FRESH) == 0)
+				return false;
+			front = middle.exchange(front, boost::memory_order_acq_rel) & INDEX;
+			return true;
+		}
+
+		//! consumer: the buffer returned by the last acquire
+		T& getFront() { return buffers[front]; }
+
+	protected:
+		static const int INDEX = 3;
+		static const int FRESH = 4;
+
+		T buffers[3];
+		int back;
+		boost::atomic<int> middle;
+		int front;
+	};
+
+	//! The alive particles of one simulation frame, packed densely
+	struct PhysicsFrame {
+		std::vector<Vec3f> positions;
+		std::vector<float> ages;
+		int numParticles;
+
+		//! number of the simulation step this frame was taken after
+		boost::uint32_t index;
+
+		PhysicsFrame() : numParticles(0), index(0) {}
+
+		void capture(Physics* physics, boost::uint32_t index);
+
+		//! writes the positions into an interleaved array (stride in floats), returns the number written
+		int fill(float* result, int stride, int capacity) const;
+	};
+
+	/*
+	 * Runs a Physics on its own thread, one step ahead of rendering.
+	 *
+	 * Every update() asks the simulation thread for the next step and returns immediately, 
+	 * while the render thread draws the last published frame. Frames are handed over 
+	 * through a TripleBuffer so neither thread blocks the other.
+	 *
+	 * While the pipeline runs only the simulation thread may touch the physics - 
+	 * change it from other threads through Physics::post.
+	 *
+	 * Usage:
+	 *		pipeline = new PhysicsPipeline(physics);
+	 *		pipeline->start();
+	 *		...
+	 *		// every frame on the render thread
+	 *		pipeline->update(dt);
+	 *		PhysicsFrame const& frame = pipeline->acquire();
+	 *		cloud.map();
+	 *		cloud.insert(frame.fill(cloud.getPointer(), cloud.getFloatsPerParticle(), cloud.getCapacity()));
+	 *		cloud.unmap();
+	 */
+	class PhysicsPipeline {
+	public:
+		PhysicsPipeline(Physics* physics);
+		~PhysicsPipeline();
+
+		void start();
+
+		//! waits for the current step to finish and stops the simulation thread
+		void stop();
+
+		bool isRunning() { return thread.joinable(); }
+
+		//! requests the next simulation step, if the previous one is still running the request replaces the waiting one
+		void update(float dt);
+
+		//! blocks until all requested steps are done
+		void wait();
+
+		//! the most recently published frame, stays valid until the next call to acquire
+		PhysicsFrame const& acquire();
+
+		Physics* getPhysics() { return physics; }
+
+		//! number of requested steps that were dropped because the simulation was still busy
+		int getNumSkipped() { return numSkipped; }
+
+	protected:
+		Physics* physics;
+		TripleBuffer<PhysicsFrame> frames;
+		boost::uint32_t numSteps;
+		int numSkipped;
+
+		boost::thread thread;
+		boost::mutex lock;
+		boost::condition_variable condition;
+		bool isRequested;
+		bool isBusy;
+		bool quit;
+		float requestedDt;
+
+		static void threadMainThunk(PhysicsPipeline* pipeline);
+		void threadMain();
+	};
+
+} } // namespace fieldkit::physics
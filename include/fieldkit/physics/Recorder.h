@@ -0,0 +1,122 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "fieldkit/physics/PhysicsKit_Prefix.h"
+#include "fieldkit/math/AABB.h"
+#include "fieldkit/physics/FrameCodec.h"
+
+namespace fieldkit { namespace physics {
+
+	// FWD
+	class Physics;
+	class RecorderWorker;
+	class MappedFile;
+
+	//! The recorded state of every slot in Physics::particles for a single frame
+	struct ParticleFrame {
+		std::vector<Vec3f> positions;
+		std::vector<float> ages;
+		std::vector<boost::uint8_t> alive;
+
+		int size() { return positions.size(); }
+		void resize(int numSlots);
+
+		//! copies the current state of all particles
+		void capture(Physics* physics);
+
+		void swap(ParticleFrame& other);
+	};
+
+	/*
+	 * Records the particle positions and ages of every frame to disk.
+	 *
+	 * record() only copies the particle state into a buffer, encoding and writing 
+	 * happens on a background thread while the simulation continues. The simulation 
+	 * only waits when the previous frame still hasn't been written.
+	 *
+	 * Frames are compressed with FrameCodec, positions are quantised to 16 bits per 
+	 * axis relative to the given bounds. Every keyframeInterval frames a complete 
+	 * frame is stored, all other frames only store the difference to their previous frame. 
+	 *
+	 * Usage:
+	 *		recorder.open("flock.fkr", *physics->space);
+	 *		...
+	 *		physics->update(dt);
+	 *		recorder.record(physics);
+	 *		...
+	 *		recorder.close();
+	 */
+	class ParticleRecorder {
+	public:
+		ParticleRecorder();
+		~ParticleRecorder();
+
+		void open(std::string const& path, AABB const& bounds, int keyframeInterval=60);
+		void record(Physics* physics);
+
+		//! waits for all frames to be written and finishes the file
+		void close();
+
+		bool isOpen() { return worker != NULL; }
+		int getNumFrames() { return numFrames; }
+
+		//! number of frames the simulation had to wait for the writer thread
+		int getNumStalls() { return numStalls; }
+
+	protected:
+		RecorderWorker* worker;
+		ParticleFrame frame;
+		int numFrames;
+		int numStalls;
+	};
+
+	//! Memory maps a file written by ParticleRecorder and decodes any of its frames
+	class ParticlePlayback {
+	public:
+		ParticlePlayback();
+		~ParticlePlayback();
+
+		//! maps the recording and checks its header and frame index, throws and stays closed when the file is damaged
+		void open(std::string const& path);
+		void close();
+
+		//! decodes the given frame, seeking backwards or far ahead decodes from the nearest keyframe
+		void read(int frame, ParticleFrame& result);
+
+		//! decodes only the positions of the alive particles into an interleaved float array, 
+		//! writes at most capacity particles and returns their number e.g. cloud.map(); 
+		//! cloud.insert(playback.readPositions(frame, cloud.getPointer(), cloud.getFloatsPerParticle(), cloud.getCapacity()));
+		int readPositions(int frame, float* result, int stride, int capacity);
+
+		int getNumFrames() { return offsets.size(); }
+		AABB getBounds() { return bounds; }
+
+	protected:
+		MappedFile* file;
+		std::vector<boost::uint64_t> offsets;
+		AABB bounds;
+		int keyframeInterval;
+
+		//! last decoded frame and the decoder state after it
+		int currentFrame;
+		FrameCodec decoder;
+		ParticleFrame scratch;
+
+		//! reads the header and frame index and checks every frame lies within the file
+		void readIndex();
+
+		//! decodes all frames up to the one before the given frame
+		void seek(int frame);
+		const boost::uint8_t* getFrameData(int frame, boost::uint32_t& size);
+	};
+
+} } // namespace fieldkit::physics
@@ -0,0 +1,144 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#pragma once
+
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/atomic.hpp>
+#include "fieldkit/physics/PhysicsKit_Prefix.h"
+
+namespace fieldkit { namespace physics {
+
+	// FWD
+	class Physics;
+
+	/*
+	 * Layout of the shared memory block, the header is followed by two buffers of
+	 * capacity particles each. Every buffer holds the arrays x, y, z, age (float) and 
+	 * id (int32), each starting on a 64 byte boundary (see SharedMemoryExport::getArrayOffset).
+	 *
+	 * Other processes can map the block without FieldKit - the atomics are plain 
+	 * 32 bit integers in memory.
+	 */
+	struct SharedParticleBuffer {
+		//! odd while the buffer is being written (seqlock)
+		boost::atomic<boost::uint32_t> sequence;
+		boost::uint32_t frame;
+		boost::int32_t numParticles;
+		boost::uint32_t reserved;
+	};
+
+	struct SharedParticleHeader {
+		boost::uint32_t magic;
+		boost::uint32_t version;
+		boost::int32_t capacity;
+		boost::uint32_t bufferSize;
+
+		//! number of published frames
+		boost::atomic<boost::uint32_t> frame;
+		//! index of the most recently completed buffer
+		boost::atomic<boost::uint32_t> latest;
+
+		SharedParticleBuffer buffers[2];
+	};
+
+	//! Pointers into the most recent buffer of a SharedMemoryReader
+	struct SharedParticleView {
+		const float* x;
+		const float* y;
+		const float* z;
+		const float* ages;
+		const boost::int32_t* ids;
+		int numParticles;
+		boost::uint32_t frame;
+
+		int buffer;
+		boost::uint32_t sequence;
+	};
+
+	// FWD
+	class SharedMemoryBlock;
+
+	/*
+	 * Publishes the alive particles of a Physics into a named shared memory block 
+	 * so other processes on the same machine can read them without copying.
+	 *
+	 * The simulation never waits for readers: publish() always writes into the buffer 
+	 * that isn't the latest one and marks it with a sequence counter, so readers can 
+	 * detect when a frame was overwritten while they were still reading it.
+	 *
+	 * Usage:
+	 *		SharedMemoryExport* exporter = new SharedMemoryExport("/flock", 100000);
+	 *		physics->setSharedMemoryExport(exporter);
+	 *		...
+	 *		// another process
+	 *		SharedMemoryReader reader("/flock");
+	 *		SharedParticleView view;
+	 *		if(reader.acquire(view)) {
+	 *			... use view.x[i], view.y[i], view.z[i]
+	 *			if(!reader.isValid(view)) ... the frame was overwritten, discard
+	 *		}
+	 */
+	class SharedMemoryExport {
+	public:
+		static const boost::uint32_t MAGIC = 0x4d534b46; // 'FKSM'
+		static const boost::uint32_t VERSION = 1;
+
+		//! creates the named block for up to capacity particles, names should start with a slash.
+		//! Throws if a block with that name exists, replace removes one a crashed exporter left behind (POSIX only).
+		SharedMemoryExport(std::string const& name, int capacity, bool replace=false);
+		~SharedMemoryExport();
+
+		//! copies the alive particles into the free buffer and makes it the latest one
+		void publish(Physics* physics);
+
+		int getCapacity() { return capacity; }
+		boost::uint32_t getFrame() { return frame; }
+
+		//! number of particles that didn't fit into the last published frame
+		int getNumDropped() { return numDropped; }
+
+		//! size of the whole shared memory block for the given capacity
+		static size_t getSize(int capacity);
+
+		//! offset of the given array (0-4: x, y, z, age, id) of a buffer from the start of the block
+		static size_t getArrayOffset(int capacity, int buffer, int array);
+
+	protected:
+		SharedMemoryBlock* block;
+		SharedParticleHeader* header;
+		int capacity;
+		boost::uint32_t frame;
+		int numDropped;
+	};
+
+	//! Maps a block created by SharedMemoryExport read-only
+	class SharedMemoryReader {
+	public:
+		SharedMemoryReader(std::string const& name);
+		~SharedMemoryReader();
+
+		//! points the view at the most recent frame, returns false if nothing was published yet
+		bool acquire(SharedParticleView& view);
+
+		//! true if the frame of the view wasn't overwritten since it was acquired
+		bool isValid(SharedParticleView const& view);
+
+		//! number of frames published so far
+		boost::uint32_t getFrame();
+
+		int getCapacity() { return capacity; }
+
+	protected:
+		SharedMemoryBlock* block;
+		const SharedParticleHeader* header;
+		int capacity;
+	};
+
+} } // namespace fieldkit::physics
@@ -0,0 +1,138 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace fieldkit { namespace physics {
+
+	// FWD
+	class Physics;
+	class Behavioural;
+
+	//! Writes binary snapshot data to a stream and keeps track of the offset for alignment
+	class SnapshotWriter {
+	public:
+		SnapshotWriter(std::ostream& out) : out(out), offset(0) {}
+
+		void write(const void* data, size_t size) 
+		{
+			out.write(static_cast<const char*>(data), size);
+			offset += size;
+		}
+
+		template<typename T>
+		void write(T const& value) { write(&value, sizeof(T)); }
+
+		//! pads the stream with zeros until the offset is a multiple of the given alignment
+		void align(size_t alignment=16) 
+		{
+			static const char zeros[16] = { 0 };
+			size_t padding = (alignment - offset % alignment) % alignment;
+			while(padding > 0) {
+				size_t n = padding < sizeof(zeros) ? padding : sizeof(zeros);
+				write(zeros, n);
+				padding -= n;
+			}
+		}
+
+		size_t getOffset() { return offset; }
+
+	protected:
+		std::ostream& out;
+		size_t offset;
+	};
+
+	//! Reads binary snapshot data straight from memory e.g. a loaded or memory mapped file
+	class SnapshotReader {
+	public:
+		SnapshotReader(const void* data, size_t size) : 
+			data(static_cast<const char*>(data)), size(size), offset(0) {}
+
+		void read(void* result, size_t n) 
+		{
+			memcpy(result, skip(n), n);
+		}
+
+		template<typename T>
+		void read(T& value) { read(&value, sizeof(T)); }
+
+		//! returns a pointer to the next n bytes and moves past them
+		const char* skip(size_t n)
+		{
+			if(offset + n > size)
+				throw "SnapshotReader: unexpected end of snapshot data";
+			const char* result = data + offset;
+			offset += n;
+			return result;
+		}
+
+		void align(size_t alignment=16)
+		{
+			skip((alignment - offset % alignment) % alignment);
+		}
+
+		size_t getOffset() { return offset; }
+		void setOffset(size_t value) { offset = value; }
+
+	protected:
+		const char* data;
+		size_t size;
+		size_t offset;
+	};
+
+	/*
+	 * Saves and restores the complete state of a Physics instance.
+	 *
+	 * The snapshot holds all particles and springs, the emitter timing, ids and the 
+	 * parameters of all behaviours and constraints that implement Behaviour::write/read.
+	 * Behaviours themselves aren't created when loading - the Physics needs to be set 
+	 * up the same way (same behaviours in the same order) as when the snapshot was saved.
+	 *
+	 * Particle fields are stored as separate arrays (structure of arrays), each starting 
+	 * on a 16 byte boundary, so a memory mapped snapshot can be read without copying.
+	 * Compressed snapshots store every array losslessly compressed with FrameCodec::compress 
+	 * instead, trading load time for size.
+	 * Springs reference their particles by index into Physics::particles.
+	 *
+	 * The state of the random generator isn't saved, call randSeed after loading 
+	 * when the continued simulation needs to be repeatable.
+	 *
+	 * Usage:
+	 *		Snapshot::save(physics, "settled.fks");
+	 *		...
+	 *		Snapshot::load(physics, "settled.fks");
+	 */
+	class Snapshot {
+	public:
+		//! 'FKSN' when read as bytes, appears reversed when the snapshot was saved with a different byte order
+		static const boost::uint32_t MAGIC = 0x4e534b46;
+		static const boost::uint32_t VERSION = 2;
+
+		static void save(Physics* physics, std::ostream& out, bool compress=false);
+		static void save(Physics* physics, std::string const& path, bool compress=false);
+
+		//! restores the physics from snapshot data in memory, data should be 16 byte aligned
+		static void load(Physics* physics, const void* data, size_t size);
+		static void load(Physics* physics, std::istream& in);
+		static void load(Physics* physics, std::string const& path);
+
+	protected:
+		static void writeBehaviours(SnapshotWriter& out, Behavioural* behavioural);
+
+		//! checks the number of behaviours and returns a reader for the parameters of each, without restoring them yet
+		static void readBehaviours(SnapshotReader& in, Behavioural* behavioural, std::vector<SnapshotReader>& result);
+		static void restoreBehaviours(Behavioural* behavioural, std::vector<SnapshotReader>& data);
+	};
+
+} } // namespace fieldkit::physics
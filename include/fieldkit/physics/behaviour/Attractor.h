@@ -10,6 +10,7 @@
 #pragma once
 
 #include "fieldkit/physics/Behaviour.h"
+#include <vector>
 
 namespace fieldkit { namespace physics {
 	
@@ -22,6 +23,8 @@ namespace fieldkit { namespace physics {
 		};
 		
 		void apply(Particle* p);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
 		
 		void setPosition(Vec3f location) { position.set(location); }
 		Vec3f getPosition() { return position; }
@@ -38,5 +41,63 @@ namespace fieldkit { namespace physics {
 		float rangeAbs;
 		float rangeAbsSq;
 	};
+
+
+	//! Many attractor points in a single behaviour.
+	//! Attractors are binned into a coarse grid over the space, so every particle only
+	//! looks at the attractors whose range covers its cell, four at a time with SSE.
+	class AttractorField : public WeightedBehaviour {
+	public:
+		AttractorField(Space* space) : WeightedBehaviour(space), cellSize(0.0f), isDirty(true) {};
+
+		void prepare(float dt);
+		void apply(Particle* p);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
+
+		//! adds an attractor and returns its index, range is relative to the space like AttractorPoint
+		int add(Vec3f const& position, float range, float strength=1.0f);
+
+		//! removes an attractor, the last attractor takes its index
+		void remove(int index);
+		void clear();
+
+		int getNumAttractors() { return (int)positions.size(); }
+
+		void setPosition(int index, Vec3f const& position) { positions[index] = position; isDirty = true; }
+		Vec3f getPosition(int index) { return positions[index]; }
+
+		void setRange(int index, float range) { ranges[index] = range; isDirty = true; }
+		float getRange(int index) { return ranges[index]; }
+
+		void setStrength(int index, float strength) { strengths[index] = strength; isDirty = true; }
+		float getStrength(int index) { return strengths[index]; }
+
+		//! sets the relative size of a grid cell, 0 picks the average attractor range
+		void setCellSize(float value) { cellSize = value; isDirty = true; }
+		float getCellSize() { return cellSize; }
+
+		int getNumCells() { return numCells[0] * numCells[1] * numCells[2]; }
+
+	protected:
+		std::vector<Vec3f> positions;
+		std::vector<float> ranges;
+		std::vector<float> strengths;
+		float cellSize;
+		bool isDirty;
+
+		// grid
+		Vec3f gridMin;
+		float invCellSize;
+		int numCells[3];
+
+		//! the attractors of cell i are at cellStart[i] .. cellStart[i+1], padded to multiples of 4
+		std::vector<int> cellStart;
+		std::vector<float> cellX, cellY, cellZ;
+		std::vector<float> cellRangeSq, cellInvRange, cellStrength;
+
+		void rebuild();
+		int getCell(float value, int axis);
+	};
 	
 } } // namespace fieldkit::physics
\ No newline at end of file
@@ -35,6 +35,8 @@ namespace fieldkit { namespace physics {
 		}
 		
 		void apply(Particle* p);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
 	};
 	
 } } // namespace fieldkit::physics
\ No newline at end of file
@@ -19,9 +19,15 @@ namespace fieldkit { namespace physics {
 		~CollisionConstraint() {};
 		
 		void apply(Particle* p);
+
+		//! moves the neighbours too
+		bool isParallelSafe() { return false; }
     
 		float getBouncyness() { return bouncyness; }
 		void setBouncyness(float b) { bouncyness = b; }
+
+		void write(SnapshotWriter& out) { out.write(bouncyness); }
+		void read(SnapshotReader& in) { in.read(bouncyness); }
 	private:
 		float bouncyness;
 	};
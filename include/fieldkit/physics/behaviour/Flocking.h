@@ -29,6 +29,9 @@ namespace fieldkit { namespace physics {
 
 		void prepare(float dt);
 
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
+
 	protected:
 		float range;
 		float rangeAbs;
@@ -26,6 +26,8 @@ namespace fieldkit { namespace physics {
 		
 		void prepare(float dt);
 		void apply(Particle* p);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
 		
 	protected:
 		Vec3f direction;
@@ -20,6 +20,9 @@ namespace fieldkit { namespace physics {
 		~Initializer() {};
 		
 		void apply(Particle* p);
+		bool isParallelSafe() { return false; }
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
 		
 		void setPerpetual(bool value);
 		bool isPerpetiual();
@@ -0,0 +1,135 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#pragma once
+
+#include <vector>
+#include "fieldkit/physics/Behaviour.h"
+#include "fieldkit/physics/space/Octree.h"
+
+namespace fieldkit { namespace physics {
+	
+	/*
+	 * Long range gravity between all particles with the Barnes-Hut approximation.
+	 *
+	 * Nodes of the Octree that look small enough from a particle (node size / distance 
+	 * below the opening angle) act as a single body at their center of mass, so every 
+	 * particle visits O(log n) nodes instead of all other particles.
+	 *
+	 * Every prepare copies the non empty nodes into a compact array, so the traversals 
+	 * only touch a few contiguous cache lines instead of the whole tree. Octree leaves 
+	 * have a fixed size, crowded ones are split further in the copy.
+	 *
+	 * Nodes are then shrunk to the bounds of their bodies and prepare computes the forces 
+	 * of all bodies in the tree: subtrees with up to 128 bodies share one traversal that 
+	 * collects the nodes and bodies acting on them, summed up with SSE where available and 
+	 * in parallel with ENABLE_OPENMP. apply only looks up the result, particles that 
+	 * aren't in the tree yet traverse it on their own.
+	 *
+	 * The tree needs to contain the particles, usually by using it as the space of the 
+	 * physics together with a neighbour update. Like neighbours, the tree then holds the 
+	 * positions of the previous step. A negative weight repels instead of attracting.
+	 */
+	class NBodyGravity : public WeightedBehaviour {
+	public:
+		NBodyGravity(Octree* tree) : WeightedBehaviour(tree), tree(tree), theta(0.5f) {
+			setWeight(0.01f);
+			setSoftening(0.01f);
+		};
+
+		void prepare(float dt);
+		void apply(Particle* p);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
+
+		//! opening angle, 0 sums up all pairs exactly, larger values are faster but less accurate
+		void setTheta(float value) { theta = value; }
+		float getTheta() { return theta; }
+
+		//! distance relative to the space below which the force stops growing, avoids singularities
+		void setSoftening(float value) { softening = value; }
+		float getSoftening() { return softening; }
+
+	protected:
+		Octree* tree;
+		float theta;
+		float softening;
+
+		float thetaSq;
+		float softeningSq;
+
+		struct FlatNode {
+			Vec3f centerOfMass;
+			float mass;
+			Vec3f min;
+			float sizeSq;
+			Vec3f max;
+			//! children in nodes for branches, spatials in bodies for leaves
+			int first;
+			int count;
+			bool isLeaf;
+		};
+
+		struct Body {
+			Vec3f position;
+			float mass;
+			Spatial* spatial;
+		};
+
+		//! a node that still needs to be copied, either from the tree or a range of bodies
+		struct Source {
+			Octree::Node* node;
+			Vec3f min;
+			Vec3f max;
+			int first;
+			int count;
+		};
+
+		std::vector<FlatNode> nodes;
+		std::vector<Body> bodies;
+		std::vector<Source> sources;
+		std::vector<Body> scratch;
+
+		//! point masses that act on all bodies of a bucket, in structure of arrays layout
+		struct Interactions {
+			std::vector<float> x, y, z, mass;
+
+			void clear();
+			void add(Vec3f const& position, float mass);
+
+			//! force on a body at position, entries at the position itself are skipped
+			Vec3f sum(Vec3f const& position, float softeningSq);
+		};
+
+		//! force of every body
+		std::vector<Vec3f> forces;
+
+		//! bodies below every node and the leaves of every bucket, bucket i owns the leaves from 
+		//! bucketLeaves[bucketStarts[i]] up to bucketLeaves[bucketStarts[i + 1]]
+		std::vector<int> numBodies;
+		std::vector<int> bucketStarts;
+		std::vector<int> bucketLeaves;
+
+		//! entries a traversal starting at every node pushes onto its stack at most
+		std::vector<int> stackSizes;
+
+		//! hash table from the spatial of a body to its index
+		struct BodySlot {
+			Spatial* spatial;
+			int index;
+		};
+		std::vector<BodySlot> slots;
+
+		void flatten();
+		void split(FlatNode& node, Source const& source);
+		void computeForces();
+		void computeBucket(int firstLeaf, int lastLeaf, Interactions& interactions);
+		int findBody(Particle* p);
+	};
+	
+} } // namespace fieldkit::physics
@@ -30,6 +30,8 @@ namespace fieldkit { namespace physics {
 		}
 		
 		void apply(Particle* p);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
 	};
 	
 	//! Makes sure a particle never moves below a certain minimum floor height
@@ -47,6 +49,9 @@ namespace fieldkit { namespace physics {
 		~WallConstraint() {}
 		
 		void apply(Particle* p);
+		void applyBatch(Particle** particles, int count);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
 
 		// Accessors
 		void setAxis(Axis value) { axis = value; }
@@ -70,6 +75,8 @@ namespace fieldkit { namespace physics {
 		int direction;
 		float height;
 		float bouncyness;
+
+		void bounce(Particle* p, float pos);
 	};
 	
 } } // namespace fieldkit::physics
\ No newline at end of file
@@ -26,6 +26,9 @@ namespace fieldkit { namespace physics {
 		}
 		
 		void apply(Particle* p);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
+		bool isParallelSafe() { return false; }
 	};
 	
 } } // namespace fieldkit::physics
\ No newline at end of file
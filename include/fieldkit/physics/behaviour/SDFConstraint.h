@@ -0,0 +1,108 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include "fieldkit/physics/Constraint.h"
+#include "fieldkit/math/AABB.h"
+
+namespace fieldkit { namespace physics {
+
+	/*
+	 * A narrow band signed distance field of a triangle mesh.
+	 *
+	 * The grid is split into bricks of 8^3 cells, only bricks within the band around 
+	 * the surface store distances, all others just remember if they are inside or outside. 
+	 * Negative distances are inside a closed mesh.
+	 *
+	 * Baking is slow, do it at load time or offline and keep the result with save/load.
+	 */
+	class DistanceField {
+	public:
+		static const int BRICK_SIZE = 8;
+
+		DistanceField();
+
+		//! bakes the triangles (3 indices each) into a grid of cellSize over the bounds,
+		//! distances are exact up to bandWidth from the surface. Open meshes need isClosed false,
+		//! their distances are unsigned.
+		void bake(std::vector<Vec3f> const& vertices, std::vector<int> const& indices, 
+				  AABB const& bounds, float cellSize, float bandWidth, bool isClosed=true);
+
+		//! distance at a position with trilinear interpolation, optionally its gradient.
+		//! Outside the band the distance is +/- bandWidth and the gradient zero.
+		float sample(Vec3f const& position, Vec3f* gradient=NULL) const;
+
+		void save(std::string const& path);
+
+		//! throws and keeps the current field when the file is damaged
+		void load(std::string const& path);
+
+		bool isEmpty() const { return brickIndex.empty(); }
+		AABB const& getBounds() const { return bounds; }
+		float getCellSize() const { return cellSize; }
+		float getBandWidth() const { return bandWidth; }
+		int getNumBricks() const { return numBricks[0] * numBricks[1] * numBricks[2]; }
+		int getNumStoredBricks() const { return (int)(data.size() / BRICK_NODES); }
+
+	protected:
+		static const int BRICK_NODES = (BRICK_SIZE + 1) * (BRICK_SIZE + 1) * (BRICK_SIZE + 1);
+
+		AABB bounds;
+		float cellSize;
+		float invCellSize;
+		float bandWidth;
+		int numBricks[3];
+
+		//! per brick the offset of its nodes in data, or -1 when it's outside the band
+		std::vector<int> brickIndex;
+
+		//! per brick +bandWidth or -bandWidth for bricks outside the band
+		std::vector<float> brickValue;
+
+		//! (BRICK_SIZE + 1)^3 distances per stored brick, neighbouring bricks duplicate their shared nodes
+		std::vector<float> data;
+	};
+
+
+	//! Keeps particles out of (or inside) arbitrary geometry given as a DistanceField
+	class SDFConstraint : public Constraint {
+	public:
+		SDFConstraint(DistanceField const* field=NULL, float thickness=0.0f, bool isInside=false) :
+			field(field), thickness(thickness), isInside(isInside), bouncyness(0.0f) {}
+
+		void apply(Particle* p);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
+
+		//! the field isn't owned by the constraint
+		void setField(DistanceField const* value) { field = value; }
+		DistanceField const* getField() { return field; }
+
+		//! distance to keep from the surface, needs to be less than the band width of the field
+		void setThickness(float value) { thickness = value; }
+		float getThickness() { return thickness; }
+
+		//! keeps particles inside the geometry instead of outside
+		void setIsInside(bool value) { isInside = value; }
+		bool getIsInside() { return isInside; }
+
+		//! how much of the velocity into the surface is reflected
+		void setBouncyness(float value) { bouncyness = value; }
+		float getBouncyness() { return bouncyness; }
+
+	protected:
+		DistanceField const* field;
+		float thickness;
+		bool isInside;
+		float bouncyness;
+	};
+
+} } // namespace fieldkit::physics
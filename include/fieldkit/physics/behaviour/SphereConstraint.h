@@ -25,6 +25,12 @@ namespace fieldkit { namespace physics {
 		};
 		
 		void apply(Particle* p);
+		void applyBatch(Particle** particles, int count);
+		void write(SnapshotWriter& out);
+		void read(SnapshotReader& in);
+
+	protected:
+		void project(Particle* p);
 	};
 	
 } } // namespace fieldkit::physics
\ No newline at end of file
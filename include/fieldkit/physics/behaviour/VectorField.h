@@ -0,0 +1,146 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#pragma once
+
+#include <vector>
+#include "fieldkit/physics/Behaviour.h"
+#include "fieldkit/physics/PhysicsPipeline.h"
+#include "fieldkit/math/AABB.h"
+
+namespace fieldkit { namespace physics {
+
+	//! A regular grid of vectors over a bounding box, sampled with trilinear interpolation
+	class VectorField {
+	public:
+		VectorField();
+
+		//! sets up a grid of nx * ny * nz nodes spanning the bounds, a resolution of 1 makes a flat field
+		void init(AABB const& bounds, int nx, int ny, int nz);
+
+		void set(int x, int y, int z, Vec3f const& value);
+		Vec3f get(int x, int y, int z) const;
+
+		//! world position of a grid node
+		Vec3f getPosition(int x, int y, int z) const;
+
+		//! the interpolated value at a position, positions outside the bounds are clamped to the border
+		Vec3f sample(Vec3f const& position) const;
+
+		AABB const& getBounds() const { return bounds; }
+		int getResolution(int axis) const { return resolution[axis]; }
+		bool isEmpty() const { return data.empty(); }
+
+	protected:
+		AABB bounds;
+		int resolution[3];
+		int stride[3];
+		Vec3f nodeScale;
+
+		//! 4 floats per node, so every node can be loaded into one SSE register
+		std::vector<float> data;
+	};
+
+
+	/*
+	 * Regenerates a VectorField from curl noise on a background thread.
+	 *
+	 * The noise slowly moves through time, every interval seconds a new field is baked 
+	 * and published through a TripleBuffer, so the simulation never waits for it.
+	 *
+	 * Usage:
+	 *		baker = new CurlNoiseBaker(space->getBounds(), 32, 32, 32);
+	 *		baker->start();
+	 *		force = new VectorFieldForce(space);
+	 *		force->setBaker(baker);
+	 *		physics->addBehaviour(force);
+	 */
+	class CurlNoiseBaker {
+	public:
+		CurlNoiseBaker(AABB const& bounds, int nx, int ny, int nz);
+		~CurlNoiseBaker();
+
+		//! bakes the first field right away and starts the background thread
+		void start();
+		void stop();
+		bool isRunning() { return thread.joinable(); }
+
+		//! consumer: switches to the latest baked field, returns false if there is nothing new
+		bool acquire() { return fields.acquire(); }
+
+		//! consumer: the field returned by the last acquire
+		VectorField const& getField() { return fields.getFront(); }
+
+		//! noise features per unit
+		void setFrequency(float value) { frequency = value; }
+		float getFrequency() { return frequency; }
+
+		void setOctaves(int value) { octaves = value; }
+		int getOctaves() { return octaves; }
+
+		void setSeed(int value) { seed = value; }
+		int getSeed() { return seed; }
+
+		//! seconds between two bakes
+		void setInterval(float value) { interval = value; }
+		float getInterval() { return interval; }
+
+		//! how fast the noise moves through time
+		void setSpeed(float value) { speed = value; }
+		float getSpeed() { return speed; }
+
+		int getNumBakes() { return numBakes; }
+
+		//! fills the field with curl noise at the given time, can be used without the thread
+		void bake(VectorField& field, float time);
+
+	protected:
+		AABB bounds;
+		int resolution[3];
+		float frequency;
+		int octaves;
+		int seed;
+		float interval;
+		float speed;
+		float time;
+		int numBakes;
+
+		TripleBuffer<VectorField> fields;
+
+		boost::thread thread;
+		boost::mutex lock;
+		boost::condition_variable condition;
+		bool quit;
+
+		static void threadMainThunk(CurlNoiseBaker* baker);
+		void threadMain();
+	};
+
+
+	//! Pushes particles along a VectorField
+	class VectorFieldForce : public WeightedBehaviour {
+	public:
+		VectorFieldForce(Space* space) : WeightedBehaviour(space), field(NULL), baker(NULL) {};
+
+		void prepare(float dt);
+		void apply(Particle* p);
+
+		//! samples a field that is updated by the application
+		void setField(VectorField const* field) { this->field = field; baker = NULL; }
+		VectorField const* getField() { return field; }
+
+		//! samples the latest field of a baker, switches to a new one at the start of every update
+		void setBaker(CurlNoiseBaker* baker) { this->baker = baker; field = NULL; }
+		CurlNoiseBaker* getBaker() { return baker; }
+
+	protected:
+		VectorField const* field;
+		CurlNoiseBaker* baker;
+	};
+
+} } // namespace fieldkit::physics
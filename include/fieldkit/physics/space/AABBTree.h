@@ -0,0 +1,172 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#pragma once
+
+#include <boost/unordered_map.hpp>
+
+#include "fieldkit/physics/space/Spatial.h"
+#include "fieldkit/physics/space/Space.h"
+#include "fieldkit/math/SphereBound.h"
+
+namespace fieldkit { namespace physics {
+
+	//! A dynamic bounding volume hierarchy for spatials with extent (see Spatial::getRadius), 
+	//! e.g. scenes that mix particles of different sizes with large obstacles.
+	//! Spatials are stored with a box enlarged by margin. Inserting a spatial that is already in the tree 
+	//! only updates it and reinserts it when it left its enlarged box, the tree is rebalanced on the way.
+	//! clear() doesn't rebuild the tree either: spatials that weren't inserted again between two calls to clear 
+	//! are removed and ignored by queries in the meantime, so the usual clear & insert every frame turns into a refit.
+	class AABBTree : public Space {
+	public:
+		AABBTree();
+		AABBTree(Vec3f const& offset, Vec3f const& dimension, float margin=1.0f);
+		~AABBTree();
+
+		//! Initializes the tree.
+		void init(Vec3f const& offset, Vec3f const& dimension, float margin=1.0f);
+
+		//! make sure the space can hold a certain amount of spatials
+		void reserve(int count);
+
+		//! Starts a new frame, spatials that weren't inserted since the last call are removed.
+		void clear();
+
+		//! Adds a new spatial or updates the bounds of one that is already in the tree.
+		void insert(Spatial* spatial);
+
+		//! Removes a single spatial right away.
+		void remove(Spatial* spatial);
+
+		//! Selects all spatials whose extent overlaps the given bounding volume.
+		void select(BoundingVolume* volume, SpatialListPtr result);
+
+		//! Selects all spatials whose extent overlaps the given box, see Octree::select
+		void select(AABB const* volume, SpatialListPtr result) { selectOverlapping(*volume, result); }
+
+		//! Selects all spatials whose extent overlaps the given sphere, see Octree::select
+		void select(SphereBound const* volume, SpatialListPtr result) { selectOverlapping(*volume, result); }
+
+		//! Selects all spatials whose extent is hit by the given ray within maxDistance, in no particular order.
+		void selectRay(Ray3f const& ray, float maxDistance, SpatialListPtr result);
+
+		//! Finds the nearest spatial hit by the ray, visits the nearer child first and skips nodes behind the nearest hit.
+		bool raycast(Ray3f const& ray, float maxDistance, RayHit& hit);
+
+		// Accessors
+		void setMargin(float value) { margin = value; }
+		float getMargin() { return margin; }
+
+		//! height of the root node, 0 for a single leaf
+		int getHeight() { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+		//! number of spatials in the tree, including those waiting for removal
+		int getNumLeaves() { return leaves.size(); }
+
+		//! number of spatials that had to be reinserted since the last call to clear
+		int getNumReinserts() { return numReinserts; }
+
+	protected:
+		static const int NULL_NODE = -1;
+		static const int MAX_STACK = 256;
+
+		struct Node {
+			Vec3f min;
+			Vec3f max;
+			int parent;  // next free node while unused
+			int child1;
+			int child2;
+			int height;  // 0 for leaves
+			Spatial* spatial;
+			int generation;
+
+			bool isLeaf() const { return child1 == NULL_NODE; }
+		};
+
+		std::vector<Node> nodes;
+		int root;
+		int freeList;
+		boost::unordered_map<Spatial*, int> leaves;
+
+		float margin;
+		int generation;
+		int numReinserts;
+
+		template<typename Volume>
+		void selectOverlapping(Volume const& volume, SpatialListPtr result)
+		{
+			result->clear();
+			if(root == NULL_NODE) return;
+
+			Vec3f queryMin, queryMax;
+			getBounds(volume, queryMin, queryMax);
+
+			int stack[MAX_STACK];
+			int top = 0;
+			stack[top++] = root;
+
+			while(top > 0) {
+				Node const& node = nodes[stack[--top]];
+				if(!overlaps(node.min, node.max, queryMin, queryMax)) continue;
+
+				if(node.isLeaf()) {
+					if(node.generation == generation && overlaps(volume, node.spatial->getPosition(), node.spatial->getRadius()))
+						result->push_back(node.spatial);
+				} else {
+					if(top + 2 > MAX_STACK) throw "AABBTree: tree too deep";
+					stack[top++] = node.child1;
+					stack[top++] = node.child2;
+				}
+			}
+		}
+
+		int allocateNode();
+		void freeNode(int index);
+		void insertLeaf(int leaf);
+		void removeLeaf(int leaf);
+		int balance(int index);
+		void refit(int index);
+
+		static void getBounds(AABB const& box, Vec3f& min, Vec3f& max) 
+		{
+			min = box.min;
+			max = box.max;
+		}
+
+		static void getBounds(SphereBound const& sphere, Vec3f& min, Vec3f& max) 
+		{
+			Vec3f r(sphere.radius, sphere.radius, sphere.radius);
+			min = sphere.position - r;
+			max = sphere.position + r;
+		}
+
+		static bool overlaps(Vec3f const& minA, Vec3f const& maxA, Vec3f const& minB, Vec3f const& maxB)
+		{
+			return	minA.x <= maxB.x && maxA.x >= minB.x &&
+					minA.y <= maxB.y && maxA.y >= minB.y &&
+					minA.z <= maxB.z && maxA.z >= minB.z;
+		}
+
+		static bool overlaps(AABB const& box, Vec3f const& p, float radius)
+		{
+			float dx = p.x < box.min.x ? p.x - box.min.x : (p.x > box.max.x ? p.x - box.max.x : 0.0f);
+			float dy = p.y < box.min.y ? p.y - box.min.y : (p.y > box.max.y ? p.y - box.max.y : 0.0f);
+			float dz = p.z < box.min.z ? p.z - box.min.z : (p.z > box.max.z ? p.z - box.max.z : 0.0f);
+			return dx * dx + dy * dy + dz * dz <= radius * radius;
+		}
+
+		static bool overlaps(SphereBound const& sphere, Vec3f const& p, float radius)
+		{
+			float dx = sphere.position.x - p.x;
+			float dy = sphere.position.y - p.y;
+			float dz = sphere.position.z - p.z;
+			float r = sphere.radius + radius;
+			return dx * dx + dy * dy + dz * dz <= r * r;
+		}
+	};
+
+} } // namespace fieldkit::physics
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "fieldkit/physics/space/Space.h"
+#include "fieldkit/math/Intersection.h"
 
 namespace fieldkit { namespace physics {
 
@@ -34,9 +35,28 @@ namespace fieldkit { namespace physics {
 
 		//! selects all spatials within the given bounding volume
 		void select(BoundingVolume* volume, SpatialListPtr result);
+
+		//! finds the nearest spatial hit by the ray, tests all of them
+		bool raycast(Ray3f const& ray, float maxDistance, RayHit& hit);
+
+		//! selects all spatials within the given box, with the containment test inlined
+		void select(AABB const* volume, SpatialListPtr result) { selectInside(*volume, result); }
+
+		//! selects all spatials within the given sphere, with the containment test inlined
+		void select(SphereBound const* volume, SpatialListPtr result) { selectInside(*volume, result); }
 		
 	protected:
 		SpatialList spatials;
+
+		template<typename Volume>
+		void selectInside(Volume const& volume, SpatialListPtr result)
+		{
+			result->clear();
+			for(size_t i=0; i<spatials.size(); i++) {
+				if(isInside(volume, spatials[i]->getPosition()))
+					result->push_back(spatials[i]);
+			}
+		}
 	};
 
 } } // namespace fieldkit::physics
\ No newline at end of file
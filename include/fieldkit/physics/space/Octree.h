@@ -11,6 +11,7 @@
 
 #include "fieldkit/physics/space/Spatial.h"
 #include "fieldkit/physics/space/Space.h"
+#include "fieldkit/math/Intersection.h"
 
 namespace fieldkit { namespace physics {
 
@@ -33,8 +34,12 @@ namespace fieldkit { namespace physics {
 			int depth;
 			float minSize;
 			bool isEmpty;
+
+			//! summed mass and its center of all spatials below this node, see Octree::updateMass
+			float mass;
+			Vec3f centerOfMass;
 			
-			Node() { isEmpty = true; };
+			Node() : isEmpty(true), mass(0.0f) {};
 			virtual ~Node() {};
 			
 			virtual void init(Vec3f const& offset, Vec3f const& dimension, float minSize=5.0f, int depth=0);			
@@ -42,6 +47,8 @@ namespace fieldkit { namespace physics {
 			virtual void clear() {};
 			virtual void insert(Spatial* spatial) {};
 			virtual void select(BoundingVolume* volume, SpatialListPtr result) {};
+			virtual void reserve(int countPerLeaf) {};
+			virtual void updateMass() {};
 			
 			// Acessors
 			void setOffset(Vec3f offset);
@@ -62,6 +69,8 @@ namespace fieldkit { namespace physics {
 			void clear();
 			void insert(Spatial* spatial);
 			void select(BoundingVolume* volume, SpatialListPtr result);
+			void reserve(int countPerLeaf);
+			void updateMass();
 			
 			//! Computes the local child octant/cube index for the given point.
 			inline int getOctantID(float x, float y, float z);
@@ -78,6 +87,8 @@ namespace fieldkit { namespace physics {
 			void clear();
 			void insert(Spatial* spatial);
 			void select(BoundingVolume* volume, SpatialListPtr result);
+			void reserve(int countPerLeaf) { data.reserve(countPerLeaf); };
+			void updateMass();
 		};
 		
 		
@@ -91,8 +102,12 @@ namespace fieldkit { namespace physics {
 		//! Initializes the tree.
 		void init(Vec3f offset, Vec3f dimension, float minSize=5.0f);
 		
-		//! make sure the space can hold a certain amount of spatials
+		//! make sure the space can hold a certain amount of spatials.
+		//! Does nothing, leaves only reserve memory when explicitly asked to through reserveLeaves.
 		void reserve(int count) {};
+
+		//! makes every leaf hold countPerLeaf spatials without growing, use this when spatials cluster in a few leaves.
+		void reserveLeaves(int countPerLeaf) { root->reserve(countPerLeaf); }
 		
 		//! Empties the entire space contents.
 		void clear();
@@ -102,12 +117,59 @@ namespace fieldkit { namespace physics {
 		
 		//! Selects all spatials within the given bounding volume.
 		void select(BoundingVolume* volume, SpatialListPtr result);
+
+		//! Finds the nearest spatial hit by the ray, visits the nodes front to back and skips those behind the nearest hit.
+		bool raycast(Ray3f const& ray, float maxDistance, RayHit& hit);
+
+		//! Selects all spatials within the given box.
+		//! Node and containment tests are inlined for the concrete volume type instead of going through virtual calls.
+		void select(AABB const* volume, SpatialListPtr result)
+		{
+			result->clear();
+			selectNode(root, *volume, result);
+		}
+
+		//! Selects all spatials within the given sphere, see select(AABB const*, SpatialListPtr)
+		void select(SphereBound const* volume, SpatialListPtr result)
+		{
+			result->clear();
+			selectNode(root, *volume, result);
+		}
+
+		//! Sums up mass and center of mass of the current contents in every node, bottom up.
+		//! Call again whenever the contents changed.
+		void updateMass();
 		
 		// Accessors
 		Octree::NodePtr getRoot() { return root; };
 		
 	protected:
 		NodePtr root;
+
+		//! largest radius of all inserted spatials, node bounds are grown by it for ray casts
+		float maxRadius;
+
+		template<typename Volume>
+		static void selectNode(NodePtr node, Volume const& volume, SpatialListPtr result)
+		{
+			if(node->isEmpty) return;
+
+			// check wether bounding volume and this node intersect at all
+			if(!isOverlapping(*node, volume)) return;
+
+			if(node->type == Node::TYPE_BRANCH) {
+				std::vector<NodePtr> const& children = static_cast<Branch*>(node)->children;
+				for(size_t i=0; i<children.size(); i++)
+					selectNode(children[i], volume, result);
+
+			} else {
+				SpatialList const& data = static_cast<Leaf*>(node)->data;
+				for(size_t i=0; i<data.size(); i++) {
+					if(isInside(volume, data[i]->getPosition()))
+						result->push_back(data[i]);
+				}
+			}
+		}
 	};
 
 } } // namespace fieldkit::physics
\ No newline at end of file
@@ -12,9 +12,18 @@
 #include "fieldkit/physics/PhysicsKit_Prefix.h"
 #include "fieldkit/physics/space/Spatial.h"
 #include "fieldkit/math/AABB.h"
+#include "fieldkit/math/Ray.h"
 
 namespace fieldkit { namespace physics {
 	
+	//! result of a ray cast, spatial is NULL when nothing was hit
+	struct RayHit {
+		Spatial* spatial;
+		float distance;
+
+		RayHit() : spatial(NULL), distance(0.0f) {};
+	};
+
 	class Space : public AABB {
 	public:
 		Space() 
@@ -34,6 +43,13 @@ namespace fieldkit { namespace physics {
 
 		//! selects all spatials within the given bounding volume
 		virtual void select(BoundingVolume* volume, SpatialListPtr result) = 0;
+
+		//! finds the nearest spatial whose radius (see Spatial::getRadius) is hit by the ray within maxDistance.
+		//! The default selects everything within the space bounds and tests each spatial, spaces override it with their own traversal.
+		virtual bool raycast(Ray3f const& ray, float maxDistance, RayHit& hit);
+
+		//! casts count rays at once, in parallel when OpenMP is enabled. Returns the number of rays that hit something.
+		int raycastMany(Ray3f const* rays, int count, float maxDistance, RayHit* hits);
 		
 		//! returns the center of the space
 		Vec3f getCenter();
@@ -44,6 +60,9 @@ namespace fieldkit { namespace physics {
 		//! converts an absolute value to relative dimensions
 		float toRelative(float value);
 
+		//! appends all candidates within the given volume to result, tests them in batches via containsMany
+		static void selectContained(BoundingVolume* volume, SpatialList const& candidates, SpatialListPtr result);
+
 		void setOwnsSpatials(bool isOwner) { ownsSpatials = isOwner; }
 		bool getOwnsSpatials() { return ownsSpatials; }
 
@@ -33,6 +33,12 @@ namespace fieldkit { namespace physics {
 		
 		virtual Vec3f const& getPosition() = 0;
 		virtual void setPosition(Vec3f const& location) = 0;
+
+		//! used by spaces that aggregate mass, e.g. Octree::updateMass
+		virtual float getMass() { return 1.0f; }
+
+		//! extent of the spatial around its position, used by spaces that store volumes, e.g. AABBTree
+		virtual float getRadius() { return 0.0f; }
 	};
 	
 	//! basic spatial implementation that wraps a Vec3f into a spatial
@@ -49,5 +55,18 @@ namespace fieldkit { namespace physics {
 	protected:
 		Vec3f position;
 	};
+
+	//! a spatial with a spherical extent, e.g. a static obstacle
+	class SphereSpatial : public PointSpatial {
+	public:
+		SphereSpatial(Vec3f p = Vec3f::zero(), float radius = 1.0f) : PointSpatial(p), radius(radius) {};
+		~SphereSpatial() {};
+
+		float getRadius() { return radius; };
+		void setRadius(float value) { radius = value; };
+
+	protected:
+		float radius;
+	};
 	
 } } // namespace fieldkit::physics
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 #include "fieldkit/physics/space/Spatial.h"
 #include "fieldkit/physics/space/Space.h"
+#include "fieldkit/math/SphereBound.h"
 
 namespace fieldkit { namespace physics {
 
@@ -35,16 +36,40 @@ namespace fieldkit { namespace physics {
 		
 		//! Selects all spatials within the given bounding volume.
 		void select(BoundingVolume* volume, SpatialListPtr result);
+
+		//! finds the nearest spatial hit by the ray, walks the cells along the ray and stops at the first cell behind the nearest hit
+		bool raycast(Ray3f const& ray, float maxDistance, RayHit& hit);
+
+		//! Selects all spatials within the given box without looking up the volume type at runtime.
+		void select(AABB const* volume, SpatialListPtr result)
+		{
+			selectCells(volume->position, getSearchExtent(*volume), result);
+		}
+
+		//! Selects all spatials within the given sphere without looking up the volume type at runtime.
+		void select(SphereBound const* volume, SpatialListPtr result)
+		{
+			selectCells(volume->position, getSearchExtent(*volume), result);
+		}
 		
 	protected:
         std::vector< std::vector<Spatial*> > cells;
 		int cellsX;
 		int cellsY;
 		float cellSize;
+
+		//! largest radius of all inserted spatials, ray casts also search the cells around the ray within it
+		float maxRadius;
 		
 		inline int hash(float position) {
 			return (int)(position / cellSize);
 		};
+
+		static Vec3f getSearchExtent(AABB const& box) { return box.extent; }
+		static Vec3f getSearchExtent(SphereBound const& sphere) { return Vec3f(sphere.radius, sphere.radius, sphere.radius); }
+
+		//! puts the contents of all cells around center into result
+		void selectCells(Vec3f const& center, Vec3f const& extent, SpatialListPtr result);
 	};
 	
 } } // namespace fieldkit::physics
\ No newline at end of file
@@ -9,7 +9,11 @@
 
 #pragma once
 
+#include <vector>
+#include <new>
 #include "fieldkit/physics/strategy/PhysicsStrategy.h"
+#include "fieldkit/physics/Particle.h"
+#include "fieldkit/physics/Arena.h"
 
 namespace fieldkit { namespace physics {
 	
@@ -20,9 +24,59 @@ namespace fieldkit { namespace physics {
 	class ParticleAllocator : public PhysicsStrategy {
 	public:
 		ParticleAllocator() {};
-		~ParticleAllocator() {};
+		virtual ~ParticleAllocator() {};
 		
+		//! creates a single particle and adds it to the physics
+		virtual void apply(Physics* physics);
+
+		//! called before a batch of count particles is allocated
+		virtual void reserve(int count) {};
+
+		//! destroys all given particles, which must have been created by this allocator
+		virtual void destroy(std::vector<Particle*>& particles);
+	};
+
+	//! Places particles next to each other in large memory chunks instead of allocating them one by one.
+	//! All particles are freed at once when the physics destroys its particles.
+	//! To allocate Particle subclasses override getParticleSize and construct or use TypedArenaParticleAllocator.
+	class ArenaParticleAllocator : public ParticleAllocator {
+	public:
+		ArenaParticleAllocator(int particlesPerChunk=4096) :
+			particlesPerChunk(particlesPerChunk) {};
+		~ArenaParticleAllocator() {};
+
 		void apply(Physics* physics);
+		void reserve(int count);
+		void destroy(std::vector<Particle*>& particles);
+
+	protected:
+		Arena arena;
+		int particlesPerChunk;
+
+		//! size in bytes of a single particle instance
+		virtual size_t getParticleSize() { return sizeof(Particle); }
+
+		//! constructs a new particle in the given memory block
+		virtual Particle* construct(void* memory) { return new(memory) Particle(); }
+
+		//! prepares the arena the first time its needed (virtual calls dont work in constructors)
+		inline void initArena() 
+		{
+			if(arena.getBlockSize() == 0)
+				arena.init(getParticleSize(), particlesPerChunk);
+		}
+	};
+
+	//! Arena allocator for custom Particle subclasses
+	template<typename T>
+	class TypedArenaParticleAllocator : public ArenaParticleAllocator {
+	public:
+		TypedArenaParticleAllocator(int particlesPerChunk=4096) :
+			ArenaParticleAllocator(particlesPerChunk) {};
+
+	protected:
+		size_t getParticleSize() { return sizeof(T); }
+		Particle* construct(void* memory) { return new(memory) T(); }
 	};
 
 } } // namespace fieldkit::physics
\ No newline at end of file
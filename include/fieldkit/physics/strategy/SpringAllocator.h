@@ -9,7 +9,11 @@
 
 #pragma once
 
+#include <vector>
+#include <new>
 #include "fieldkit/physics/strategy/PhysicsStrategy.h"
+#include "fieldkit/physics/Spring.h"
+#include "fieldkit/physics/Arena.h"
 
 namespace fieldkit { namespace physics {
 	
@@ -20,9 +24,57 @@ namespace fieldkit { namespace physics {
 	class SpringAllocator : public PhysicsStrategy {
 	public:
 		SpringAllocator() {};
-		~SpringAllocator() {};
+		virtual ~SpringAllocator() {};
 		
+		//! creates a single spring and adds it to the physics
+		virtual void apply(Physics* physics);
+
+		//! called before a batch of count springs is allocated
+		virtual void reserve(int count) {};
+
+		//! destroys all given springs, which must have been created by this allocator
+		virtual void destroy(std::vector<Spring*>& springs);
+	};
+
+	//! Places springs next to each other in large memory chunks and frees them all at once.
+	//! To allocate Spring subclasses override getSpringSize and construct or use TypedArenaSpringAllocator.
+	class ArenaSpringAllocator : public SpringAllocator {
+	public:
+		ArenaSpringAllocator(int springsPerChunk=4096) :
+			springsPerChunk(springsPerChunk) {};
+		~ArenaSpringAllocator() {};
+
 		void apply(Physics* physics);
+		void reserve(int count);
+		void destroy(std::vector<Spring*>& springs);
+
+	protected:
+		Arena arena;
+		int springsPerChunk;
+
+		//! size in bytes of a single spring instance
+		virtual size_t getSpringSize() { return sizeof(Spring); }
+
+		//! constructs a new spring in the given memory block
+		virtual Spring* construct(void* memory) { return new(memory) Spring(); }
+
+		inline void initArena() 
+		{
+			if(arena.getBlockSize() == 0)
+				arena.init(getSpringSize(), springsPerChunk);
+		}
+	};
+
+	//! Arena allocator for custom Spring subclasses
+	template<typename T>
+	class TypedArenaSpringAllocator : public ArenaSpringAllocator {
+	public:
+		TypedArenaSpringAllocator(int springsPerChunk=4096) :
+			ArenaSpringAllocator(springsPerChunk) {};
+
+	protected:
+		size_t getSpringSize() { return sizeof(T); }
+		Spring* construct(void* memory) { return new(memory) T(); }
 	};
 
 } } // namespace fieldkit::physics
\ No newline at end of file
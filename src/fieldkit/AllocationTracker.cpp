@@ -0,0 +1,234 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#include "fieldkit/AllocationTracker.h"
+
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+
+#ifdef _MSC_VER
+	#define ALLOCATION_THREAD_LOCAL __declspec(thread)
+#else
+	#define ALLOCATION_THREAD_LOCAL __thread
+#endif
+
+using namespace fieldkit;
+
+namespace {
+	// all state lives in plain arrays so that recording never allocates itself
+	const char* subsystemNames[AllocationTracker::MAX_SUBSYSTEMS] = { "unscoped" };
+	boost::atomic<int> numSubsystems(1);
+	boost::mutex registerMutex;
+
+	boost::atomic<long> frameAllocations[AllocationTracker::MAX_SUBSYSTEMS];
+	boost::atomic<long> frameBytes[AllocationTracker::MAX_SUBSYSTEMS];
+	boost::atomic<long> totalAllocations[AllocationTracker::MAX_SUBSYSTEMS];
+	boost::atomic<long> totalBytes[AllocationTracker::MAX_SUBSYSTEMS];
+
+	long lastFrameAllocations[AllocationTracker::MAX_SUBSYSTEMS];
+	long lastFrameBytes[AllocationTracker::MAX_SUBSYSTEMS];
+
+	boost::atomic<bool> isStrict(false);
+	boost::atomic<bool> failOnViolation(false);
+	boost::atomic<long> numViolations(0);
+
+	ALLOCATION_THREAD_LOCAL int currentSubsystem = AllocationTracker::UNSCOPED;
+}
+
+int AllocationTracker::registerSubsystem(const char* name)
+{
+	boost::mutex::scoped_lock lock(registerMutex);
+
+	int n = numSubsystems.load();
+	for(int i=0; i<n; i++) {
+		if(strcmp(subsystemNames[i], name) == 0)
+			return i;
+	}
+
+	// too many subsystems, count them as unscoped
+	if(n == MAX_SUBSYSTEMS)
+		return UNSCOPED;
+
+	subsystemNames[n] = name;
+	numSubsystems.store(n + 1);
+	return n;
+}
+
+int AllocationTracker::getNumSubsystems()
+{
+	return numSubsystems.load();
+}
+
+void AllocationTracker::record(size_t bytes)
+{
+	int id = currentSubsystem;
+
+	frameAllocations[id].fetch_add(1, boost::memory_order_relaxed);
+	frameBytes[id].fetch_add((long)bytes, boost::memory_order_relaxed);
+	totalAllocations[id].fetch_add(1, boost::memory_order_relaxed);
+	totalBytes[id].fetch_add((long)bytes, boost::memory_order_relaxed);
+
+	if(id != UNSCOPED && isStrict.load(boost::memory_order_relaxed)) {
+		numViolations.fetch_add(1);
+
+		if(failOnViolation.load()) {
+			fprintf(stderr, "AllocationTracker: %lu bytes allocated in strict scope '%s'\n", 
+					(unsigned long)bytes, subsystemNames[id]);
+			abort();
+		}
+	}
+}
+
+void AllocationTracker::beginFrame()
+{
+	for(int i=0; i<MAX_SUBSYSTEMS; i++) {
+		frameAllocations[i].store(0);
+		frameBytes[i].store(0);
+	}
+}
+
+void AllocationTracker::endFrame()
+{
+	for(int i=0; i<MAX_SUBSYSTEMS; i++) {
+		lastFrameAllocations[i] = frameAllocations[i].load();
+		lastFrameBytes[i] = frameBytes[i].load();
+	}
+}
+
+AllocationTracker::Stats AllocationTracker::getFrameStats(int subsystem)
+{
+	Stats stats;
+	stats.name = subsystemNames[subsystem];
+	stats.allocations = lastFrameAllocations[subsystem];
+	stats.bytes = lastFrameBytes[subsystem];
+	return stats;
+}
+
+AllocationTracker::Stats AllocationTracker::getTotalStats(int subsystem)
+{
+	Stats stats;
+	stats.name = subsystemNames[subsystem];
+	stats.allocations = totalAllocations[subsystem].load();
+	stats.bytes = totalBytes[subsystem].load();
+	return stats;
+}
+
+void AllocationTracker::report(std::ostream& out)
+{
+	int n = getNumSubsystems();
+	for(int i=0; i<n; i++) {
+		Stats stats = getFrameStats(i);
+		if(stats.allocations == 0) continue;
+		out << stats.name << ": " << stats.allocations << " allocations, " << stats.bytes << " bytes" << std::endl;
+	}
+}
+
+void AllocationTracker::setStrict(bool enabled, bool failOnAllocation)
+{
+	failOnViolation.store(failOnAllocation);
+	isStrict.store(enabled);
+}
+
+bool AllocationTracker::getStrict()
+{
+	return isStrict.load();
+}
+
+long AllocationTracker::getNumViolations()
+{
+	return numViolations.load();
+}
+
+void AllocationTracker::resetViolations()
+{
+	numViolations.store(0);
+}
+
+int AllocationTracker::getCurrentSubsystem()
+{
+	return currentSubsystem;
+}
+
+void AllocationTracker::setCurrentSubsystem(int subsystem)
+{
+	currentSubsystem = subsystem;
+}
+
+bool AllocationTracker::isEnabled()
+{
+#ifdef ENABLE_ALLOCATION_TRACKING
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+// -- Global operator new/delete -----------------------------------------------
+#ifdef ENABLE_ALLOCATION_TRACKING
+
+#if __cplusplus >= 201103L
+	#define ALLOCATION_THROW_SPEC
+	#define ALLOCATION_NOTHROW_SPEC noexcept
+#else
+	#define ALLOCATION_THROW_SPEC throw(std::bad_alloc)
+	#define ALLOCATION_NOTHROW_SPEC throw()
+#endif
+
+void* operator new(std::size_t size) ALLOCATION_THROW_SPEC
+{
+	AllocationTracker::record(size);
+	void* p = malloc(size > 0 ? size : 1);
+	if(p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size) ALLOCATION_THROW_SPEC
+{
+	AllocationTracker::record(size);
+	void* p = malloc(size > 0 ? size : 1);
+	if(p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) ALLOCATION_NOTHROW_SPEC
+{
+	AllocationTracker::record(size);
+	return malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) ALLOCATION_NOTHROW_SPEC
+{
+	AllocationTracker::record(size);
+	return malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void* p) ALLOCATION_NOTHROW_SPEC
+{
+	free(p);
+}
+
+void operator delete[](void* p) ALLOCATION_NOTHROW_SPEC
+{
+	free(p);
+}
+
+void operator delete(void* p, std::nothrow_t const&) ALLOCATION_NOTHROW_SPEC
+{
+	free(p);
+}
+
+void operator delete[](void* p, std::nothrow_t const&) ALLOCATION_NOTHROW_SPEC
+{
+	free(p);
+}
+
+#endif
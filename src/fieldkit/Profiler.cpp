@@ -0,0 +1,396 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#include "fieldkit/Profiler.h"
+
+#include <map>
+#include <deque>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#if defined(__APPLE__)
+	#include <mach/mach_time.h>
+#elif defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+#ifdef __GNUC__
+	#include <cxxabi.h>
+#endif
+
+#ifdef _MSC_VER
+	#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+	#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+using namespace fieldkit;
+
+namespace {
+	struct Event {
+		int id;
+		Profiler::Ticks start;
+		Profiler::Ticks end;
+	};
+
+	//! sequence is the index of the event held by the slot, or -1 while the event is written
+	struct Slot {
+		boost::atomic<boost::int64_t> sequence;
+		Event event;
+	};
+
+	//! fixed size ring buffer only ever written to by the thread that owns it.
+	//! Readers check the sequence of a slot before and after copying its event,
+	//! so they skip events the owner overwrites meanwhile.
+	struct ThreadBuffer {
+		int threadIndex;
+		Slot* slots;
+		boost::atomic<boost::int64_t> numWritten;
+
+		//! events below this index were dropped by Profiler::clear, guarded by the mutex
+		boost::int64_t numCleared;
+
+		ThreadBuffer(int index) : threadIndex(index), numWritten(0), numCleared(0)
+		{
+			slots = new Slot[Profiler::EVENTS_PER_THREAD];
+			for(int i=0; i<Profiler::EVENTS_PER_THREAD; i++)
+				slots[i].sequence.store(-1, boost::memory_order_relaxed);
+		}
+	};
+
+	boost::mutex mutex;
+	std::vector<const char*> names;
+	std::map<std::type_info const*, int> typeIDs;
+	std::deque<std::string> typeNames;
+	std::vector<ThreadBuffer*> buffers;
+	std::vector<ThreadBuffer*> idleBuffers;
+	boost::atomic<bool> isEnabled(true);
+
+	PROFILER_THREAD_LOCAL ThreadBuffer* threadBuffer = NULL;
+
+	//! hands the buffer of an exiting thread on to the next new thread, 
+	//! so its events stay in the statistics without a buffer per thread ever started
+	void releaseThreadBuffer(ThreadBuffer* buffer)
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		idleBuffers.push_back(buffer);
+	}
+
+	boost::thread_specific_ptr<ThreadBuffer> ownedBuffer(releaseThreadBuffer);
+
+	ThreadBuffer* getThreadBuffer()
+	{
+		if(threadBuffer == NULL) {
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				if(!idleBuffers.empty()) {
+					threadBuffer = idleBuffers.back();
+					idleBuffers.pop_back();
+				} else {
+					threadBuffer = new ThreadBuffer(buffers.size());
+					buffers.push_back(threadBuffer);
+				}
+			}
+			ownedBuffer.reset(threadBuffer);
+		}
+		return threadBuffer;
+	}
+
+	//! copies all intact events still held by the buffer, the caller needs to hold the mutex
+	void copyEvents(ThreadBuffer* buffer, std::vector<Event>& result)
+	{
+		boost::int64_t end = buffer->numWritten.load(boost::memory_order_acquire);
+		boost::int64_t begin = std::max(buffer->numCleared, end - Profiler::EVENTS_PER_THREAD);
+
+		for(boost::int64_t i=begin; i<end; i++) {
+			Slot& slot = buffer->slots[i % Profiler::EVENTS_PER_THREAD];
+			if(slot.sequence.load(boost::memory_order_acquire) != i) continue;
+
+			Event e = slot.event;
+			boost::atomic_thread_fence(boost::memory_order_acquire);
+			if(slot.sequence.load(boost::memory_order_relaxed) == i)
+				result.push_back(e);
+		}
+	}
+
+	//! collects the durations of all buffered events with the given id
+	void collectDurations(int id, std::vector<double>& result)
+	{
+		boost::mutex::scoped_lock lock(mutex);
+
+		std::vector<Event> events;
+		for(std::vector<ThreadBuffer*>::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+			events.clear();
+			copyEvents(*it, events);
+			for(std::vector<Event>::iterator e = events.begin(); e != events.end(); ++e) {
+				if(e->id == id)
+					result.push_back(Profiler::ticksToMilliseconds(e->end - e->start));
+			}
+		}
+	}
+
+	double percentile(std::vector<double> const& sorted, double p)
+	{
+		int index = (int)(p * (sorted.size() - 1) + 0.5);
+		return sorted[index];
+	}
+
+	std::string demangle(const char* name)
+	{
+#ifdef __GNUC__
+		int status = 0;
+		char* demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+		if(status == 0 && demangled != NULL) {
+			std::string result(demangled);
+			free(demangled);
+			return result;
+		}
+#endif
+		// msvc type names are already readable but prefixed with the kind of type
+		std::string result(name);
+		if(result.find("class ") == 0) return result.substr(6);
+		if(result.find("struct ") == 0) return result.substr(7);
+		return result;
+	}
+}
+
+int Profiler::registerName(const char* name)
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	for(int i=0; i<(int)names.size(); i++) {
+		if(strcmp(names[i], name) == 0)
+			return i;
+	}
+
+	names.push_back(name);
+	return names.size() - 1;
+}
+
+int Profiler::registerType(std::type_info const& type)
+{
+	const char* name;
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		std::map<std::type_info const*, int>::iterator it = typeIDs.find(&type);
+		if(it != typeIDs.end())
+			return it->second;
+
+		typeNames.push_back(demangle(type.name()));
+		name = typeNames.back().c_str();
+	}
+
+	int id = registerName(name);
+
+	boost::mutex::scoped_lock lock(mutex);
+	typeIDs[&type] = id;
+	return id;
+}
+
+void Profiler::record(int id, Ticks start, Ticks end)
+{
+	if(!isEnabled.load(boost::memory_order_relaxed)) return;
+
+	ThreadBuffer* buffer = getThreadBuffer();
+	boost::int64_t n = buffer->numWritten.load(boost::memory_order_relaxed);
+	Slot& slot = buffer->slots[n % EVENTS_PER_THREAD];
+
+	// readers skip the slot until its sequence matches the new event
+	slot.sequence.store(-1, boost::memory_order_relaxed);
+	boost::atomic_thread_fence(boost::memory_order_release);
+
+	slot.event.id = id;
+	slot.event.start = start;
+	slot.event.end = end;
+
+	slot.sequence.store(n, boost::memory_order_release);
+	buffer->numWritten.store(n + 1, boost::memory_order_release);
+}
+
+Profiler::Stats Profiler::getStats(int id)
+{
+	Stats stats;
+	memset(&stats, 0, sizeof(Stats));
+
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		if(id < 0 || id >= (int)names.size()) return stats;
+		stats.name = names[id];
+	}
+
+	std::vector<double> durations;
+	collectDurations(id, durations);
+	if(durations.empty()) return stats;
+
+	std::sort(durations.begin(), durations.end());
+
+	double sum = 0.0;
+	for(std::vector<double>::iterator it = durations.begin(); it != durations.end(); ++it) 
+		sum += *it;
+
+	stats.count = durations.size();
+	stats.average = sum / durations.size();
+	stats.min = durations.front();
+	stats.max = durations.back();
+	stats.p50 = percentile(durations, 0.5);
+	stats.p90 = percentile(durations, 0.9);
+	stats.p99 = percentile(durations, 0.99);
+	return stats;
+}
+
+Profiler::Stats Profiler::getStats(const char* name)
+{
+	int id = -1;
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		for(int i=0; i<(int)names.size(); i++) {
+			if(strcmp(names[i], name) == 0) {
+				id = i;
+				break;
+			}
+		}
+	}
+	return getStats(id);
+}
+
+void Profiler::getAllStats(std::vector<Stats>& result)
+{
+	int numNames;
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		numNames = names.size();
+	}
+
+	result.clear();
+	for(int i=0; i<numNames; i++) {
+		Stats stats = getStats(i);
+		if(stats.count > 0)
+			result.push_back(stats);
+	}
+}
+
+void Profiler::report(std::ostream& out)
+{
+	std::vector<Stats> all;
+	getAllStats(all);
+
+	out << "name: count avg min max p50 p90 p99 (ms)" << std::endl;
+	for(std::vector<Stats>::iterator it = all.begin(); it != all.end(); ++it) {
+		out << it->name << ": " << it->count << " " 
+			<< it->average << " " << it->min << " " << it->max << " " 
+			<< it->p50 << " " << it->p90 << " " << it->p99 << std::endl;
+	}
+}
+
+void Profiler::writeChromeTrace(std::ostream& out)
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	std::vector< std::vector<Event> > events(buffers.size());
+	for(size_t i=0; i<buffers.size(); i++)
+		copyEvents(buffers[i], events[i]);
+
+	// find the earliest event so timestamps start at zero
+	Ticks origin = 0;
+	bool hasOrigin = false;
+	for(size_t i=0; i<events.size(); i++) {
+		for(std::vector<Event>::iterator e = events[i].begin(); e != events[i].end(); ++e) {
+			if(!hasOrigin || e->start < origin) {
+				origin = e->start;
+				hasOrigin = true;
+			}
+		}
+	}
+
+	out << "{\"traceEvents\":[";
+	bool isFirst = true;
+	for(size_t i=0; i<events.size(); i++) {
+		for(std::vector<Event>::iterator e = events[i].begin(); e != events[i].end(); ++e) {
+			if(!isFirst) out << ",";
+			isFirst = false;
+
+			out << "{\"name\":\"" << names[e->id] << "\",\"ph\":\"X\",\"pid\":0"
+				<< ",\"tid\":" << buffers[i]->threadIndex
+				<< ",\"ts\":" << ticksToMilliseconds(e->start - origin) * 1000.0
+				<< ",\"dur\":" << ticksToMilliseconds(e->end - e->start) * 1000.0 << "}";
+		}
+	}
+	out << "]}" << std::endl;
+}
+
+void Profiler::clear()
+{
+	// only moves the start of the valid range, the owning threads keep writing numWritten
+	boost::mutex::scoped_lock lock(mutex);
+	for(std::vector<ThreadBuffer*>::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+		(*it)->numCleared = (*it)->numWritten.load(boost::memory_order_acquire);
+	}
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+	isEnabled.store(enabled);
+}
+
+bool Profiler::getEnabled()
+{
+	return isEnabled.load();
+}
+
+bool Profiler::isCompiledIn()
+{
+#ifdef ENABLE_PROFILER
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+// -- Timing -------------------------------------------------------------------
+Profiler::Ticks Profiler::getTicks()
+{
+#if defined(__APPLE__)
+	return mach_absolute_time();
+
+#elif defined(_WIN32)
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+
+#else
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (Ticks)t.tv_sec * 1000000000ULL + t.tv_nsec;
+#endif
+}
+
+double Profiler::ticksToMilliseconds(Ticks ticks)
+{
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t timebase = { 0, 0 };
+	if(timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return (double)ticks * timebase.numer / timebase.denom / 1000000.0;
+
+#elif defined(_WIN32)
+	static LARGE_INTEGER frequency = { 0 };
+	if(frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	return (double)ticks * 1000.0 / frequency.QuadPart;
+
+#else
+	return (double)ticks / 1000000.0;
+#endif
+}
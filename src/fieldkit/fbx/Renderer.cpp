@@ -8,6 +8,7 @@
  */
 
 #include "fieldkit/fbx/Renderer.h"
+#include "fieldkit/AllocationTracker.h"
 
 using namespace fieldkit::fbx;
 
@@ -261,6 +262,8 @@ void Renderer::drawMesh(Scene* scene, KFbxNode* node, KFbxXMatrix& globalPositio
 {
 	if(meshRenderer == NULL) return;
 
+	ALLOCATION_SCOPE("fbx.drawMesh");
+
 	KTime& time = scene->currentTime;
 	KFbxMesh* mesh = (KFbxMesh*) node->GetNodeAttribute();
 	int clusterCount = 0;
@@ -228,6 +228,41 @@ KFbxXMatrix Scene::getGeometry(KFbxNode* node) {
     return lGeometry;
 }
 
+void Scene::getTriangles(std::vector<ci::Vec3f>& vertices, std::vector<int>& indices)
+{
+	KFbxNode* root = fbxScene->GetRootNode();
+	for(int i=0; i<root->GetChildCount(); i++)
+		getTrianglesRecursive(root->GetChild(i), vertices, indices);
+}
+
+void Scene::getTrianglesRecursive(KFbxNode* node, std::vector<ci::Vec3f>& vertices, std::vector<int>& indices)
+{
+	KFbxNodeAttribute* attribute = node->GetNodeAttribute();
+
+	if(attribute && attribute->GetAttributeType() == KFbxNodeAttribute::eMESH) {
+		KFbxMesh* mesh = (KFbxMesh*) attribute;
+		KFbxXMatrix transform = getGlobalPosition(node, currentTime) * getGeometry(node);
+
+		int first = vertices.size();
+		int vertexCount = mesh->GetControlPointsCount();
+		KFbxVector4* controlPoints = mesh->GetControlPoints();
+		for(int i=0; i<vertexCount; i++)
+			vertices.push_back(KFbxVector4ToVec3f(transform.MultT(controlPoints[i])));
+
+		for(int polygon=0; polygon<mesh->GetPolygonCount(); polygon++) {
+			int size = mesh->GetPolygonSize(polygon);
+			for(int v=2; v<size; v++) {
+				indices.push_back(first + mesh->GetPolygonVertex(polygon, 0));
+				indices.push_back(first + mesh->GetPolygonVertex(polygon, v - 1));
+				indices.push_back(first + mesh->GetPolygonVertex(polygon, v));
+			}
+		}
+	}
+
+	for(int i=0; i<node->GetChildCount(); i++)
+		getTrianglesRecursive(node->GetChild(i), vertices, indices);
+}
+
 bool Scene::isProducerCamera(KFbxCamera* camera)
 {
 	KFbxGlobalCameraSettings& lGlobalCameraSettings = fbxScene->GlobalCameraSettings();
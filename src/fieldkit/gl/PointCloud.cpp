@@ -69,6 +69,15 @@ void PointCloud::insert()
 	size += 1;
 }
 
+void PointCloud::insert(int count)
+{
+	if(count > capacity - size)
+		count = capacity - size;
+
+	size += count;
+	ptr += count * getFloatsPerParticle();
+}
+
 void PointCloud::draw()
 {
 	// dont draw when no points were inserted
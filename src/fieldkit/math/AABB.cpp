@@ -9,6 +9,7 @@
 
 #include "fieldkit/math/AABB.h"
 #include "fieldkit/math/SphereBound.h"
+#include "fieldkit/math/MathKit.h"
 
 using namespace fieldkit;
 
@@ -112,6 +113,81 @@ bool AABB::contains(Vec3f const& p)
 	return true;
 }
 
+int AABB::containsMany(const float* x, const float* y, const float* z, int count, unsigned char* outMask)
+{
+	int hits = 0;
+	int i = 0;
+
+#ifdef ENABLE_SSE
+	__m128 minX = _mm_set1_ps(min.x);
+	__m128 minY = _mm_set1_ps(min.y);
+	__m128 minZ = _mm_set1_ps(min.z);
+	__m128 maxX = _mm_set1_ps(max.x);
+	__m128 maxY = _mm_set1_ps(max.y);
+	__m128 maxZ = _mm_set1_ps(max.z);
+
+	for(; i + 4 <= count; i += 4) {
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 pz = _mm_loadu_ps(z + i);
+
+		__m128 inX = _mm_and_ps(_mm_cmpge_ps(px, minX), _mm_cmple_ps(px, maxX));
+		__m128 inY = _mm_and_ps(_mm_cmpge_ps(py, minY), _mm_cmple_ps(py, maxY));
+		__m128 inZ = _mm_and_ps(_mm_cmpge_ps(pz, minZ), _mm_cmple_ps(pz, maxZ));
+		hits += writeMask(_mm_and_ps(_mm_and_ps(inX, inY), inZ), outMask + i);
+	}
+#endif
+
+	for(; i<count; i++) {
+		outMask[i] = x[i] >= min.x && x[i] <= max.x &&
+					 y[i] >= min.y && y[i] <= max.y &&
+					 z[i] >= min.z && z[i] <= max.z;
+		hits += outMask[i];
+	}
+	return hits;
+}
+
+int AABB::intersectsMany(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* outMask)
+{
+	// squared distance from each sphere center to the box, see intersectAABBxSphere
+	int hits = 0;
+	int i = 0;
+
+#ifdef ENABLE_SSE
+	__m128 zero = _mm_setzero_ps();
+	__m128 minX = _mm_set1_ps(min.x);
+	__m128 minY = _mm_set1_ps(min.y);
+	__m128 minZ = _mm_set1_ps(min.z);
+	__m128 maxX = _mm_set1_ps(max.x);
+	__m128 maxY = _mm_set1_ps(max.y);
+	__m128 maxZ = _mm_set1_ps(max.z);
+
+	for(; i + 4 <= count; i += 4) {
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 pz = _mm_loadu_ps(z + i);
+		__m128 r = _mm_loadu_ps(radius + i);
+
+		// at most one of both sides is positive
+		__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minX, px), zero), _mm_max_ps(_mm_sub_ps(px, maxX), zero));
+		__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minY, py), zero), _mm_max_ps(_mm_sub_ps(py, maxY), zero));
+		__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minZ, pz), zero), _mm_max_ps(_mm_sub_ps(pz, maxZ), zero));
+		__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		hits += writeMask(_mm_cmple_ps(distSq, _mm_mul_ps(r, r)), outMask + i);
+	}
+#endif
+
+	for(; i<count; i++) {
+		float dx = x[i] < min.x ? min.x - x[i] : (x[i] > max.x ? x[i] - max.x : 0.0f);
+		float dy = y[i] < min.y ? min.y - y[i] : (y[i] > max.y ? y[i] - max.y : 0.0f);
+		float dz = z[i] < min.z ? min.z - z[i] : (z[i] > max.z ? z[i] - max.z : 0.0f);
+		outMask[i] = dx * dx + dy * dy + dz * dz <= radius[i] * radius[i];
+		hits += outMask[i];
+	}
+	return hits;
+}
+
 // -- Helpers ------------------------------------------------------------------
 void AABB::updateBounds() 
 {
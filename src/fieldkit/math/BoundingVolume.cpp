@@ -11,6 +11,7 @@
 
 #include "fieldkit/math/AABB.h"
 #include "fieldkit/math/SphereBound.h"
+#include "fieldkit/math/Intersection.h"
 
 using namespace fieldkit;
 
@@ -19,32 +20,32 @@ bool BoundingVolume::intersects(BoundingVolume* volume) {
 	switch(type) {
 		// AABB interesections
 		case BOUNDING_BOX: {
-			AABB* a = (AABB*)this;
+			AABB* a = static_cast<AABB*>(this);
 			
 			switch(volume->type) {
 				// AABB x AABB
 				case BOUNDING_BOX:
-					return intersectAABBxAABB(a, (AABB*)volume );
+					return intersectAABBxAABB(a, static_cast<AABB*>(volume));
 					
 				// AABB x Sphere
 				case BOUNDING_SPHERE:
-					return intersectAABBxSphere(a, (SphereBound*)volume );
+					return intersectAABBxSphere(a, static_cast<SphereBound*>(volume));
 			};
 			break;
 		}
 			
 		// Sphere intersections
 		case BOUNDING_SPHERE: {
-			SphereBound* a = (SphereBound*)this;
+			SphereBound* a = static_cast<SphereBound*>(this);
 			
 			switch (volume->type) {
 				// Sphere x Sphere
 				case BOUNDING_SPHERE:
-					return intersectSpherexSphere(a, (SphereBound*)volume );
+					return intersectSpherexSphere(a, static_cast<SphereBound*>(volume));
 					
 				// AABB x Sphere
 				case BOUNDING_BOX:
-					return intersectAABBxSphere( (AABB*)volume, a );
+					return intersectAABBxSphere(static_cast<AABB*>(volume), a);
 			};
 			break;
 		}
@@ -54,65 +55,42 @@ bool BoundingVolume::intersects(BoundingVolume* volume) {
 	return false;
 }
 
+int BoundingVolume::containsMany(const float* x, const float* y, const float* z, int count, unsigned char* outMask)
+{
+	int hits = 0;
+	for(int i=0; i<count; i++) {
+		outMask[i] = contains(Vec3f(x[i], y[i], z[i])) ? 1 : 0;
+		hits += outMask[i];
+	}
+	return hits;
+}
+
+int BoundingVolume::intersectsMany(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* outMask)
+{
+	int hits = 0;
+	SphereBound sphere;
+	for(int i=0; i<count; i++) {
+		sphere.position.set(x[i], y[i], z[i]);
+		sphere.radius = radius[i];
+		outMask[i] = intersects(&sphere) ? 1 : 0;
+		hits += outMask[i];
+	}
+	return hits;
+}
+
 
 // -- Intersection Helpers -----------------------------------------------------
 bool BoundingVolume::intersectAABBxAABB(AABB* a, AABB* b)
 {
-	Vec3f tmp = a->position - b->position;
-	
-	return	abs(tmp.x) <= (a->extent.x + b->extent.x) &&
-			abs(tmp.y) <= (a->extent.y + b->extent.y) &&
-			abs(tmp.z) <= (a->extent.z + b->extent.z);
+	return isOverlapping(*a, *b);
 }
 
 bool BoundingVolume::intersectSpherexSphere(SphereBound* a, SphereBound* b)
 {
-	Vec3f delta = a->position - b->position;
-	float d = delta.length();
-	float r1 = a->radius;
-	float r2 = b->radius;
-	return d <= r1 + r2 && d >= abs(r1 - r2);
+	return isOverlapping(*a, *b);
 }
 
 bool BoundingVolume::intersectAABBxSphere(AABB* a, SphereBound* b)
 {
-	Vec3f min = a->min;
-	Vec3f max = a->max;
-	
-	Vec3f center = b->position;
-	float radius = b->radius;
-	
-	float s = 0;
-	float d = 0;
-	
-	// find the square of the distance
-	// from the sphere to the box
-	if(center.x < min.x) {
-		s = center.x - min.x;
-		d = s * s;
-		
-	} else if (center.x > max.x) {
-		s = center.x - max.x;
-		d += s * s;
-	}
-	
-	if (center.y < min.y) {
-		s = center.y - min.y;
-		d += s * s;
-		
-	} else if (center.y > max.y) {
-		s = center.y - max.y;
-		d += s * s;
-	}
-	
-	if (center.z < min.z) {
-		s = center.z - min.z;
-		d += s * s;
-		
-	} else if (center.z > max.z) {
-		s = center.z - max.z;
-		d += s * s;
-	}
-	
-	return d <= radius * radius;
+	return isOverlapping(*a, *b);
 }
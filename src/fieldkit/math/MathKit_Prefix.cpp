@@ -28,18 +28,50 @@ bool flipCoin( float chance )
 
 
 // -- Random Float ----------------------------------------------------------
+// delegates to ci::Rand unless deterministic mode is on, which switches to a
+// private generator so random numbers drawn by the application through 
+// ci::Rand dont change the sequence seen by fieldkit.
+static bool isRandDeterministic = false;
+
+static ci::Rand& getDeterministicRand()
+{
+	static ci::Rand generator;
+	return generator;
+}
+
+void setRandDeterministic(bool enabled, unsigned int seed)
+{
+	isRandDeterministic = enabled;
+	if(enabled)
+		getDeterministicRand().seed(seed);
+}
+
+void randSeed(unsigned int seed)
+{
+	if(isRandDeterministic)
+		getDeterministicRand().seed(seed);
+	else
+		ci::Rand::randSeed(seed);
+}
+
 float randFloat() 
 {
+	if(isRandDeterministic)
+		return getDeterministicRand().nextFloat();
 	return ci::Rand::randFloat();
 }
 
 float randFloat( float range )
 {
+	if(isRandDeterministic)
+		return getDeterministicRand().nextFloat(range);
 	return ci::Rand::randFloat(range);
 }
 
 float randFloat( float from, float to )
 {
+	if(isRandDeterministic)
+		return getDeterministicRand().nextFloat(from, to);
 	return ci::Rand::randFloat(from, to);
 }
 
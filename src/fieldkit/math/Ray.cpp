@@ -10,6 +10,11 @@
 #include "fieldkit/math/Ray.h"
 
 #include "fieldkit/math/Line.h"
+#include "fieldkit/math/AABB.h"
+#include "fieldkit/math/SphereBound.h"
+
+#include <algorithm>
+#include <limits>
 
 using namespace fieldkit;
 
@@ -99,3 +104,47 @@ bool Ray2f::findIntersection(Line2f const& line, Vec2f* result)
 	return false;
 }
 
+
+// -- Ray3f --------------------------------------------------------------------
+bool Ray3f::findIntersection(SphereBound const& sphere, float* distance) const
+{
+	return findIntersection(sphere.position, sphere.radius, distance);
+}
+
+namespace {
+	//! clips the ray interval against the slab of one axis, rays parallel to the slab miss when they start outside of it
+	inline bool clipSlab(float origin, float direction, float min, float max, float& tEntry, float& tExit)
+	{
+		if(direction == 0.0f)
+			return origin >= min && origin <= max;
+
+		float t1 = (min - origin) / direction;
+		float t2 = (max - origin) / direction;
+		tEntry = std::max(tEntry, std::min(t1, t2));
+		tExit = std::min(tExit, std::max(t1, t2));
+		return true;
+	}
+}
+
+//! Slab test, axes the ray runs parallel to only check whether the origin lies within that slab.
+bool Ray3f::findIntersection(Vec3f const& min, Vec3f const& max, float* tNear, float* tFar) const
+{
+	float tEntry = -std::numeric_limits<float>::infinity();
+	float tExit = std::numeric_limits<float>::infinity();
+
+	if(!clipSlab(origin.x, direction.x, min.x, max.x, tEntry, tExit)) return false;
+	if(!clipSlab(origin.y, direction.y, min.y, max.y, tEntry, tExit)) return false;
+	if(!clipSlab(origin.z, direction.z, min.z, max.z, tEntry, tExit)) return false;
+
+	// box lies behind the ray or is missed
+	if(tEntry > tExit || tExit < 0.0f) return false;
+
+	if(tNear != NULL) *tNear = std::max(tEntry, 0.0f);
+	if(tFar != NULL) *tFar = tExit;
+	return true;
+}
+
+bool Ray3f::findIntersection(AABB const& box, float* tNear, float* tFar) const
+{
+	return findIntersection(box.min, box.max, tNear, tFar);
+}
@@ -0,0 +1,274 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#include "fieldkit/math/SegmentIntersector.h"
+#include "fieldkit/math/MathKit.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef ENABLE_SSE
+	#include <xmmintrin.h>
+#endif
+
+using namespace fieldkit;
+
+namespace {
+	bool compareIntersections(SegmentIntersector::Intersection const& l, SegmentIntersector::Intersection const& r)
+	{
+		return l.a < r.a || (l.a == r.a && l.b < r.b);
+	}
+}
+
+SegmentIntersector::SegmentIntersector() :
+	cellSize(0.0f), cellsX(0), cellsY(0)
+{
+}
+
+void SegmentIntersector::clear()
+{
+	x1.clear();
+	y1.clear();
+	x2.clear();
+	y2.clear();
+}
+
+void SegmentIntersector::reserve(int count)
+{
+	x1.reserve(count);
+	y1.reserve(count);
+	x2.reserve(count);
+	y2.reserve(count);
+}
+
+int SegmentIntersector::add(Vec2f const& p1, Vec2f const& p2)
+{
+	x1.push_back(p1.x);
+	y1.push_back(p1.y);
+	x2.push_back(p2.x);
+	y2.push_back(p2.y);
+	return x1.size() - 1;
+}
+
+int SegmentIntersector::add(Line2f const& line)
+{
+	return add(line.p1, line.p2);
+}
+
+void SegmentIntersector::set(const float* x1, const float* y1, const float* x2, const float* y2, int count)
+{
+	this->x1.assign(x1, x1 + count);
+	this->y1.assign(y1, y1 + count);
+	this->x2.assign(x2, x2 + count);
+	this->y2.assign(y2, y2 + count);
+}
+
+int SegmentIntersector::findIntersections(std::vector<Intersection>& result)
+{
+	result.clear();
+	if(size() < 2) return 0;
+
+	buildGrid();
+	int numCells = cellsX * cellsY;
+
+#ifdef ENABLE_OPENMP
+	#pragma omp parallel
+	{
+		std::vector<float> scratch;
+		std::vector<Intersection> local;
+
+		#pragma omp for schedule(dynamic, 64) nowait
+		for(int c=0; c<numCells; c++)
+			findInCell(c, scratch, local);
+
+		#pragma omp critical
+		result.insert(result.end(), local.begin(), local.end());
+	}
+#else
+	std::vector<float> scratch;
+	for(int c=0; c<numCells; c++)
+		findInCell(c, scratch, result);
+#endif
+
+	// independent of the order cells were processed in
+	std::sort(result.begin(), result.end(), compareIntersections);
+	return result.size();
+}
+
+
+// -- Helpers ------------------------------------------------------------------
+void SegmentIntersector::buildGrid()
+{
+	int n = size();
+
+	float minX = std::min(x1[0], x2[0]);
+	float minY = std::min(y1[0], y2[0]);
+	float maxX = std::max(x1[0], x2[0]);
+	float maxY = std::max(y1[0], y2[0]);
+	double sumSize = 0.0;
+
+	for(int i=0; i<n; i++) {
+		minX = std::min(minX, std::min(x1[i], x2[i]));
+		minY = std::min(minY, std::min(y1[i], y2[i]));
+		maxX = std::max(maxX, std::max(x1[i], x2[i]));
+		maxY = std::max(maxY, std::max(y1[i], y2[i]));
+		sumSize += std::max(fabsf(x2[i] - x1[i]), fabsf(y2[i] - y1[i]));
+	}
+
+	float width = maxX - minX;
+	float height = maxY - minY;
+
+	// cells about the size of an average segment, but never more than about 2 cells per segment,
+	// neither in total nor along one axis. The cap applies to a fixed cell size as well.
+	float minSize = std::max(sqrtf(width * height / (2.0f * n)), std::max(width, height) / (2.0f * n));
+	float size = cellSize > 0.0f ? cellSize : (float)(sumSize / n);
+	size = std::max(size, minSize);
+	if(size <= 0.0f) size = 1.0f;
+	float invSize = 1.0f / size;
+
+	cellsX = (int)(width * invSize) + 1;
+	cellsY = (int)(height * invSize) + 1;
+
+	// cells covered by each segments bounding box
+	ranges.resize(n);
+	cellStart.assign(cellsX * cellsY + 1, 0);
+
+	for(int i=0; i<n; i++) {
+		CellRange& r = ranges[i];
+		r.minX = std::min((int)((std::min(x1[i], x2[i]) - minX) * invSize), cellsX - 1);
+		r.maxX = std::min((int)((std::max(x1[i], x2[i]) - minX) * invSize), cellsX - 1);
+		r.minY = std::min((int)((std::min(y1[i], y2[i]) - minY) * invSize), cellsY - 1);
+		r.maxY = std::min((int)((std::max(y1[i], y2[i]) - minY) * invSize), cellsY - 1);
+
+		for(int y=r.minY; y<=r.maxY; y++) {
+			for(int x=r.minX; x<=r.maxX; x++)
+				cellStart[y * cellsX + x + 1]++;
+		}
+	}
+
+	for(size_t c=1; c<cellStart.size(); c++)
+		cellStart[c] += cellStart[c-1];
+
+	// fill in segment order so every cell lists its segments by ascending index
+	std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+	cellItems.resize(cellStart.back());
+
+	for(int i=0; i<n; i++) {
+		CellRange const& r = ranges[i];
+		for(int y=r.minY; y<=r.maxY; y++) {
+			for(int x=r.minX; x<=r.maxX; x++)
+				cellItems[cursor[y * cellsX + x]++] = i;
+		}
+	}
+}
+
+void SegmentIntersector::findInCell(int cell, std::vector<float>& scratch, std::vector<Intersection>& result)
+{
+	int begin = cellStart[cell];
+	int count = cellStart[cell + 1] - begin;
+	if(count < 2) return;
+
+	const int* items = &cellItems[begin];
+	int cx = cell % cellsX;
+	int cy = cell / cellsX;
+
+	// gather start points and directions, padded with empty segments for the last group of 4
+	int stride = count + 4;
+	scratch.resize(stride * 4);
+	float* px = &scratch[0];
+	float* py = px + stride;
+	float* dx = py + stride;
+	float* dy = dx + stride;
+
+	for(int i=0; i<count; i++) {
+		int s = items[i];
+		px[i] = x1[s];
+		py[i] = y1[s];
+		dx[i] = x2[s] - x1[s];
+		dy[i] = y2[s] - y1[s];
+	}
+	for(int i=count; i<stride; i++)
+		px[i] = py[i] = dx[i] = dy[i] = 0.0f;
+
+	for(int i=0; i<count - 1; i++) {
+		int j = i + 1;
+
+#ifdef ENABLE_SSE
+		__m128 ax = _mm_set1_ps(px[i]);
+		__m128 ay = _mm_set1_ps(py[i]);
+		__m128 adx = _mm_set1_ps(dx[i]);
+		__m128 ady = _mm_set1_ps(dy[i]);
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+
+		for(; j < count; j += 4) {
+			__m128 bx = _mm_loadu_ps(px + j);
+			__m128 by = _mm_loadu_ps(py + j);
+			__m128 bdx = _mm_loadu_ps(dx + j);
+			__m128 bdy = _mm_loadu_ps(dy + j);
+
+			// same terms as Line2f::findIntersection with this = i and line = j
+			__m128 offX = _mm_sub_ps(ax, bx);
+			__m128 offY = _mm_sub_ps(ay, by);
+			__m128 denom = _mm_sub_ps(_mm_mul_ps(bdy, adx), _mm_mul_ps(bdx, ady));
+			__m128 numea = _mm_sub_ps(_mm_mul_ps(bdx, offY), _mm_mul_ps(bdy, offX));
+			__m128 numeb = _mm_sub_ps(_mm_mul_ps(adx, offY), _mm_mul_ps(ady, offX));
+
+			__m128 ua = _mm_div_ps(numea, denom);
+			__m128 ub = _mm_div_ps(numeb, denom);
+
+			__m128 mask = _mm_cmpneq_ps(denom, zero);
+			mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(ua, zero), _mm_cmple_ps(ua, one)));
+			mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(ub, zero), _mm_cmple_ps(ub, one)));
+
+			int bits = _mm_movemask_ps(mask);
+			if(bits == 0) continue;
+
+			float uas[4];
+			_mm_storeu_ps(uas, ua);
+
+			for(int k=0; k<4; k++) {
+				if((bits & (1 << k)) == 0 || j + k >= count) continue;
+
+				// report every pair only in the first cell both bounding boxes share
+				CellRange const& ra = ranges[items[i]];
+				CellRange const& rb = ranges[items[j + k]];
+				if(std::max(ra.minX, rb.minX) != cx || std::max(ra.minY, rb.minY) != cy) continue;
+
+				Intersection hit;
+				hit.a = items[i];
+				hit.b = items[j + k];
+				hit.point.x = px[i] + uas[k] * dx[i];
+				hit.point.y = py[i] + uas[k] * dy[i];
+				result.push_back(hit);
+			}
+		}
+#endif
+
+		for(; j < count; j++) {
+			float offX = px[i] - px[j];
+			float offY = py[i] - py[j];
+			float denom = dy[j] * dx[i] - dx[j] * dy[i];
+			if(denom == 0.0f) continue;
+
+			float ua = (dx[j] * offY - dy[j] * offX) / denom;
+			float ub = (dx[i] * offY - dy[i] * offX) / denom;
+			if(ua < 0.0f || ua > 1.0f || ub < 0.0f || ub > 1.0f) continue;
+
+			CellRange const& ra = ranges[items[i]];
+			CellRange const& rb = ranges[items[j]];
+			if(std::max(ra.minX, rb.minX) != cx || std::max(ra.minY, rb.minY) != cy) continue;
+
+			Intersection hit;
+			hit.a = items[i];
+			hit.b = items[j];
+			hit.point.x = px[i] + ua * dx[i];
+			hit.point.y = py[i] + ua * dy[i];
+			result.push_back(hit);
+		}
+	}
+}
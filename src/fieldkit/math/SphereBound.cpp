@@ -8,6 +8,9 @@
  */
 
 #include "fieldkit/math/SphereBound.h"
+#include "fieldkit/math/MathKit.h"
+
+#include <cmath>
 
 using namespace fieldkit;
 
@@ -32,4 +35,72 @@ bool SphereBound::contains(Vec3f const& p) {
 	float dy = position.y - p.y;
 	float dz = position.z - p.z;
 	return dx * dx + dy * dy + dz * dz <= radius * radius;
-}
\ No newline at end of file
+}
+
+int SphereBound::containsMany(const float* x, const float* y, const float* z, int count, unsigned char* outMask)
+{
+	float radiusSq = radius * radius;
+	int hits = 0;
+	int i = 0;
+
+#ifdef ENABLE_SSE
+	__m128 cx = _mm_set1_ps(position.x);
+	__m128 cy = _mm_set1_ps(position.y);
+	__m128 cz = _mm_set1_ps(position.z);
+	__m128 r2 = _mm_set1_ps(radiusSq);
+
+	for(; i + 4 <= count; i += 4) {
+		__m128 dx = _mm_sub_ps(cx, _mm_loadu_ps(x + i));
+		__m128 dy = _mm_sub_ps(cy, _mm_loadu_ps(y + i));
+		__m128 dz = _mm_sub_ps(cz, _mm_loadu_ps(z + i));
+		__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		hits += writeMask(_mm_cmple_ps(distSq, r2), outMask + i);
+	}
+#endif
+
+	for(; i<count; i++) {
+		float dx = position.x - x[i];
+		float dy = position.y - y[i];
+		float dz = position.z - z[i];
+		outMask[i] = dx * dx + dy * dy + dz * dz <= radiusSq;
+		hits += outMask[i];
+	}
+	return hits;
+}
+
+int SphereBound::intersectsMany(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* outMask)
+{
+	// same rules as intersectSpherexSphere: the surfaces need to touch
+	int hits = 0;
+	int i = 0;
+
+#ifdef ENABLE_SSE
+	__m128 cx = _mm_set1_ps(position.x);
+	__m128 cy = _mm_set1_ps(position.y);
+	__m128 cz = _mm_set1_ps(position.z);
+	__m128 r1 = _mm_set1_ps(this->radius);
+	__m128 signMask = _mm_set1_ps(-0.0f);
+
+	for(; i + 4 <= count; i += 4) {
+		__m128 dx = _mm_sub_ps(cx, _mm_loadu_ps(x + i));
+		__m128 dy = _mm_sub_ps(cy, _mm_loadu_ps(y + i));
+		__m128 dz = _mm_sub_ps(cz, _mm_loadu_ps(z + i));
+		__m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+
+		__m128 r2 = _mm_loadu_ps(radius + i);
+		__m128 outer = _mm_add_ps(r1, r2);
+		__m128 inner = _mm_andnot_ps(signMask, _mm_sub_ps(r1, r2));
+		hits += writeMask(_mm_and_ps(_mm_cmple_ps(d, outer), _mm_cmpge_ps(d, inner)), outMask + i);
+	}
+#endif
+
+	for(; i<count; i++) {
+		float dx = position.x - x[i];
+		float dy = position.y - y[i];
+		float dz = position.z - z[i];
+		float d = sqrtf(dx * dx + dy * dy + dz * dz);
+		outMask[i] = d <= this->radius + radius[i] && d >= fabsf(this->radius - radius[i]);
+		hits += outMask[i];
+	}
+	return hits;
+}
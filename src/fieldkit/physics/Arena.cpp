@@ -0,0 +1,85 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#include "fieldkit/physics/Arena.h"
+
+#include <cstdlib>
+#include <algorithm>
+
+using namespace fieldkit::physics;
+
+Arena::Arena() 
+{
+	init(0);
+}
+
+Arena::Arena(size_t blockSize, int blocksPerChunk)
+{
+	init(blockSize, blocksPerChunk);
+}
+
+Arena::~Arena()
+{
+	release();
+}
+
+void Arena::init(size_t blockSize, int blocksPerChunk)
+{
+	release();
+
+	// keep all blocks aligned to 16 bytes
+	this->blockSize = (blockSize + 15) & ~((size_t)15);
+	this->blocksPerChunk = std::max(blocksPerChunk, 1);
+}
+
+void Arena::reserve(int count)
+{
+	if(count <= 0) return;
+
+	if(!chunks.empty()) {
+		Chunk& chunk = chunks.back();
+		if(chunk.capacity - chunk.used >= count) return;
+	}
+
+	addChunk(std::max(count, blocksPerChunk));
+}
+
+void* Arena::allocate()
+{
+	if(chunks.empty() || chunks.back().used == chunks.back().capacity)
+		addChunk(blocksPerChunk);
+
+	Chunk& chunk = chunks.back();
+	void* block = chunk.data + chunk.used * blockSize;
+	chunk.used++;
+	numBlocks++;
+	return block;
+}
+
+void Arena::release()
+{
+	for(std::vector<Chunk>::iterator it = chunks.begin(); it != chunks.end(); ++it) {
+		free(it->data);
+	}
+	chunks.clear();
+	numBlocks = 0;
+}
+
+void Arena::addChunk(int capacity)
+{
+	if(blockSize == 0)
+		throw "Arena::addChunk block size not set - call init first.";
+
+	Chunk chunk;
+	chunk.data = (char*)malloc(blockSize * capacity);
+	if(chunk.data == NULL)
+		throw "Arena::addChunk out of memory.";
+
+	chunk.capacity = capacity;
+	chunk.used = 0;
+	chunks.push_back(chunk);
+}
@@ -0,0 +1,123 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#include "fieldkit/physics/CommandQueue.h"
+
+#include "fieldkit/physics/Physics.h"
+#include "fieldkit/physics/Particle.h"
+#include "fieldkit/physics/Emitter.h"
+
+using namespace fieldkit::physics;
+
+// -- Queue --------------------------------------------------------------------
+CommandQueue::CommandQueue() : head(&stub), tail(&stub)
+{
+}
+
+CommandQueue::~CommandQueue()
+{
+	PhysicsCommand* command;
+	while((command = pop()) != NULL)
+		delete command;
+}
+
+void CommandQueue::push(PhysicsCommand* command)
+{
+	command->next.store(NULL, boost::memory_order_relaxed);
+	PhysicsCommand* previous = head.exchange(command, boost::memory_order_acq_rel);
+
+	// between the exchange and this store the queue is briefly unlinked, pop waits for it
+	previous->next.store(command, boost::memory_order_release);
+}
+
+PhysicsCommand* CommandQueue::pop()
+{
+	PhysicsCommand* first = tail;
+	PhysicsCommand* next = first->next.load(boost::memory_order_acquire);
+
+	// skip the stub
+	if(first == &stub) {
+		if(next == NULL) return NULL;
+		tail = next;
+		first = next;
+		next = next->next.load(boost::memory_order_acquire);
+	}
+
+	if(next != NULL) {
+		tail = next;
+		return first;
+	}
+
+	// a producer is still linking in a new command
+	if(first != head.load(boost::memory_order_acquire))
+		return NULL;
+
+	// first is the last command, put the stub behind it so it can be taken
+	push(&stub);
+
+	next = first->next.load(boost::memory_order_acquire);
+	if(next != NULL) {
+		tail = next;
+		return first;
+	}
+	return NULL;
+}
+
+int CommandQueue::apply(Physics* physics)
+{
+	int count = 0;
+	PhysicsCommand* command;
+	while((command = pop()) != NULL) {
+		command->apply(physics);
+		delete command;
+		count++;
+	}
+	return count;
+}
+
+
+// -- Commands -----------------------------------------------------------------
+void SpawnParticlesCommand::apply(Physics* physics)
+{
+	for(int i=0; i<count; i++) {
+		if(physics->emitter != NULL && physics->hasParticlesAvailable(1)) {
+			physics->emitter->emit(position);
+		} else {
+			physics->createParticle()->init(position);
+		}
+	}
+}
+
+void RetireParticlesCommand::apply(Physics* physics)
+{
+	physics->retireParticleRange(firstID, lastID);
+}
+
+void AddBehaviourCommand::apply(Physics* physics)
+{
+	physics->addBehaviour(behaviour);
+}
+
+void RemoveBehaviourCommand::apply(Physics* physics)
+{
+	physics->removeBehaviour(behaviour);
+	if(physics->getOwnsBehaviours())
+		delete behaviour;
+}
+
+void AddConstraintCommand::apply(Physics* physics)
+{
+	physics->addConstraint(constraint);
+}
+
+void RemoveConstraintCommand::apply(Physics* physics)
+{
+	physics->removeConstraint(constraint);
+	if(physics->getOwnsConstraints())
+		delete constraint;
+}
@@ -0,0 +1,540 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#include "fieldkit/physics/DistributedPhysics.h"
+
+#include <cfloat>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "fieldkit/physics/Physics.h"
+#include "fieldkit/physics/Particle.h"
+#include "fieldkit/physics/space/Space.h"
+#include "fieldkit/math/SphereBound.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit::physics;
+using boost::asio::ip::tcp;
+
+namespace {
+	const boost::uint32_t MAGIC = 0x4f484b46; // 'FKHO'
+
+	enum ParticleFlags {
+		FLAG_ALIVE = 1,
+		FLAG_LOCKED = 2,
+		FLAG_IGNORE_CONSTRAINTS = 4
+	};
+
+	//! the state of a particle as it is sent to other processes
+	struct ParticleRecord {
+		Vec3f position;
+		Vec3f prev;
+		Vec3f force;
+		float age;
+		float lifeTime;
+		float weight;
+		float invWeight;
+		float drag;
+		float size;
+		boost::int32_t state;
+		boost::int32_t id;
+		boost::uint32_t flags;
+	};
+
+	struct MessageHeader {
+		boost::uint32_t magic;
+		boost::uint32_t step;
+		boost::uint32_t numMigrants;
+		boost::uint32_t numGhosts;
+	};
+
+	void toRecord(Particle* p, ParticleRecord& r)
+	{
+		r.position = p->position;
+		r.prev = p->prev;
+		r.force = p->force;
+		r.age = p->age;
+		r.lifeTime = p->lifeTime;
+		r.weight = p->weight;
+		r.invWeight = p->invWeight;
+		r.drag = p->drag;
+		r.size = p->size;
+		r.state = p->state;
+		r.id = p->id;
+		r.flags = (p->isAlive ? FLAG_ALIVE : 0) | 
+			(p->isLocked ? FLAG_LOCKED : 0) | 
+			(p->ignoreConstraints ? FLAG_IGNORE_CONSTRAINTS : 0);
+	}
+
+	void fromRecord(ParticleRecord const& r, Particle* p)
+	{
+		p->position = r.position;
+		p->prev = r.prev;
+		p->force = r.force;
+		p->age = r.age;
+		p->lifeTime = r.lifeTime;
+		p->weight = r.weight;
+		p->invWeight = r.invWeight;
+		p->drag = r.drag;
+		p->size = r.size;
+		p->state = r.state;
+		p->id = r.id;
+		p->isAlive = (r.flags & FLAG_ALIVE) != 0;
+		p->isLocked = (r.flags & FLAG_LOCKED) != 0;
+		p->ignoreConstraints = (r.flags & FLAG_IGNORE_CONSTRAINTS) != 0;
+	}
+}
+
+namespace fieldkit { namespace physics {
+
+	//! Connection to the process of a neighbouring slab
+	class HaloLink {
+	public:
+		boost::asio::io_service io;
+		tcp::socket socket;
+
+		//! particles to send with the next message
+		std::vector<ParticleRecord> migrants;
+		std::vector<ParticleRecord> ghosts;
+
+		//! particles received with the last message
+		std::vector<ParticleRecord> receivedMigrants;
+		std::vector<ParticleRecord> receivedGhosts;
+
+		HaloLink() : socket(io) {}
+
+		void send(boost::uint32_t step)
+		{
+			MessageHeader header = { MAGIC, step, (boost::uint32_t)migrants.size(), (boost::uint32_t)ghosts.size() };
+
+			std::vector<boost::asio::const_buffer> buffers;
+			buffers.push_back(boost::asio::buffer(&header, sizeof(header)));
+			if(!migrants.empty())
+				buffers.push_back(boost::asio::buffer(&migrants[0], migrants.size() * sizeof(ParticleRecord)));
+			if(!ghosts.empty())
+				buffers.push_back(boost::asio::buffer(&ghosts[0], ghosts.size() * sizeof(ParticleRecord)));
+
+			boost::asio::write(socket, buffers);
+		}
+
+		void receive(boost::uint32_t step)
+		{
+			MessageHeader header;
+			boost::asio::read(socket, boost::asio::buffer(&header, sizeof(header)));
+
+			if(header.magic != MAGIC)
+				throw "DistributedPhysics: received a corrupt message";
+			if(header.step != step)
+				throw "DistributedPhysics: neighbour is at a different step";
+
+			receivedMigrants.resize(header.numMigrants);
+			receivedGhosts.resize(header.numGhosts);
+
+			if(header.numMigrants > 0)
+				boost::asio::read(socket, boost::asio::buffer(&receivedMigrants[0], header.numMigrants * sizeof(ParticleRecord)));
+			if(header.numGhosts > 0)
+				boost::asio::read(socket, boost::asio::buffer(&receivedGhosts[0], header.numGhosts * sizeof(ParticleRecord)));
+		}
+	};
+
+	//! Sends the messages to both neighbours on a thread that lives as long as the connection, 
+	//! while the thread calling update receives - so neither side can block the other on full socket buffers
+	class HaloSender {
+	public:
+		HaloSender(HaloLink** links) : 
+			links(links), step(0), isRequested(false), isBusy(false), quit(false)
+		{
+			thread = boost::thread(&HaloSender::threadMainThunk, this);
+		}
+
+		~HaloSender()
+		{
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				quit = true;
+			}
+			condition.notify_all();
+			thread.join();
+		}
+
+		//! hands the messages of the given step to the sending thread
+		void send(boost::uint32_t step)
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			this->step = step;
+			error.clear();
+			isRequested = true;
+			isBusy = true;
+			condition.notify_all();
+		}
+
+		//! blocks until both messages are sent, returns false if sending failed
+		bool wait()
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			while(isBusy)
+				condition.wait(lock);
+			return error.empty();
+		}
+
+	protected:
+		HaloLink** links;
+		boost::uint32_t step;
+		std::string error;
+
+		boost::thread thread;
+		boost::mutex mutex;
+		boost::condition_variable condition;
+		bool isRequested;
+		bool isBusy;
+		bool quit;
+
+		static void threadMainThunk(HaloSender* sender)
+		{
+			sender->threadMain();
+		}
+
+		void threadMain()
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			while(true) {
+				while(!isRequested && !quit)
+					condition.wait(lock);
+				if(quit) return;
+
+				isRequested = false;
+				boost::uint32_t current = step;
+				lock.unlock();
+
+				std::string result;
+				try {
+					for(int k=0; k<2; k++) {
+						if(links[k] != NULL)
+							links[k]->send(current);
+					}
+				} catch(std::exception& e) {
+					result = e.what();
+				}
+
+				lock.lock();
+				error = result;
+				isBusy = false;
+				condition.notify_all();
+			}
+		}
+	};
+
+} } // namespace fieldkit::physics
+
+
+// -- Setup --------------------------------------------------------------------
+DistributedPhysics::DistributedPhysics(AABB const& bounds, int rank, int numRanks, float haloWidth, DomainFactory const& factory) :
+	rank(rank), numRanks(numRanks), haloWidth(haloWidth), neighbourRadius(haloWidth),
+	physics(NULL), nextID(0), step(0), numMigrations(0), sender(NULL), numGhosts(0)
+{
+	if(numRanks < 1 || rank < 0 || rank >= numRanks)
+		throw "DistributedPhysics: invalid rank";
+
+	this->bounds.set(bounds);
+	links[0] = links[1] = NULL;
+
+	// split along the longest axis
+	Vec3f size = bounds.max - bounds.min;
+	axis = 0;
+	if(size.y > size[axis]) axis = 1;
+	if(size.z > size[axis]) axis = 2;
+	slabWidth = size[axis] / numRanks;
+
+	if(haloWidth > slabWidth)
+		throw "DistributedPhysics: halo can't be wider than a slab";
+
+	physics = factory(getDomainBounds());
+	if(physics == NULL)
+		throw "DistributedPhysics: factory didn't create a physics";
+
+	// neighbours are found across processes here
+	physics->setNeighbourUpdate(NULL);
+}
+
+DistributedPhysics::~DistributedPhysics()
+{
+	disconnect();
+
+	for(size_t i=0; i<ghosts.size(); i++)
+		delete ghosts[i];
+	ghosts.clear();
+
+	delete physics;
+	physics = NULL;
+}
+
+void DistributedPhysics::connect(std::vector<std::string> const& hosts, int basePort, float timeout)
+{
+	if((int)hosts.size() < numRanks)
+		throw "DistributedPhysics: needs the host of every rank";
+
+	disconnect();
+
+	try {
+		// listen first so the next rank can connect while we connect to the previous one
+		tcp::acceptor* acceptor = NULL;
+		if(rank < numRanks - 1) {
+			links[1] = new HaloLink();
+			acceptor = new tcp::acceptor(links[1]->io, tcp::endpoint(tcp::v4(), basePort + rank));
+		}
+
+		if(rank > 0) {
+			links[0] = new HaloLink();
+			tcp::resolver resolver(links[0]->io);
+			tcp::resolver::query query(hosts[rank - 1], boost::lexical_cast<std::string>(basePort + rank - 1));
+
+			// the previous process might not be listening yet
+			boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds((long)(timeout * 1000));
+			while(true) {
+				boost::system::error_code error;
+				boost::asio::connect(links[0]->socket, resolver.resolve(query), error);
+				if(!error) break;
+
+				links[0]->socket.close();
+				if(boost::get_system_time() > deadline) {
+					delete acceptor;
+					throw "DistributedPhysics: couldn't connect to the previous rank";
+				}
+				boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+			}
+
+			boost::uint32_t id = rank;
+			boost::asio::write(links[0]->socket, boost::asio::buffer(&id, sizeof(id)));
+			links[0]->socket.set_option(tcp::no_delay(true));
+		}
+
+		if(acceptor != NULL) {
+			acceptor->accept(links[1]->socket);
+			delete acceptor;
+
+			boost::uint32_t id;
+			boost::asio::read(links[1]->socket, boost::asio::buffer(&id, sizeof(id)));
+			if(id != (boost::uint32_t)rank + 1)
+				throw "DistributedPhysics: unexpected rank connected";
+			links[1]->socket.set_option(tcp::no_delay(true));
+		}
+
+		sender = new HaloSender(links);
+	} catch(boost::system::system_error&) {
+		disconnect();
+		throw "DistributedPhysics: couldn't connect to the neighbouring ranks";
+	}
+}
+
+void DistributedPhysics::disconnect()
+{
+	delete sender;
+	sender = NULL;
+
+	for(int k=0; k<2; k++) {
+		if(links[k] != NULL) {
+			delete links[k];
+			links[k] = NULL;
+		}
+	}
+}
+
+AABB DistributedPhysics::getDomainBounds()
+{
+	Vec3f min = bounds.min;
+	Vec3f max = bounds.max;
+	min[axis] = bounds.min[axis] + rank * slabWidth - haloWidth;
+	max[axis] = bounds.min[axis] + (rank + 1) * slabWidth + haloWidth;
+	return AABB(min, max);
+}
+
+void DistributedPhysics::setNeighbourRadius(float radius)
+{
+	if(radius > haloWidth)
+		throw "DistributedPhysics: neighbour radius can't be larger than the halo";
+	neighbourRadius = radius;
+}
+
+int DistributedPhysics::getRankIndex(Vec3f const& position)
+{
+	int index = (int)floorf((position[axis] - bounds.min[axis]) / slabWidth);
+	if(index < 0) return 0;
+	if(index >= numRanks) return numRanks - 1;
+	return index;
+}
+
+float DistributedPhysics::getSlabMin(int index)
+{
+	return index == 0 ? -FLT_MAX : bounds.min[axis] + index * slabWidth;
+}
+
+float DistributedPhysics::getSlabMax(int index)
+{
+	return index == numRanks - 1 ? FLT_MAX : bounds.min[axis] + (index + 1) * slabWidth;
+}
+
+int DistributedPhysics::getNumParticles()
+{
+	return physics->getNumParticles();
+}
+
+Particle* DistributedPhysics::createParticle(Vec3f const& position)
+{
+	// every process counts every particle so ids stay the same everywhere
+	int id = ++nextID;
+	if(getRankIndex(position) != rank)
+		return NULL;
+
+	Particle* p = physics->createParticle();
+	p->init(position);
+	p->id = id;
+	return p;
+}
+
+
+// -- Update -------------------------------------------------------------------
+void DistributedPhysics::update(float dt)
+{
+	PROFILE_SCOPE("distributed.update");
+
+	physics->update(dt);
+	step++;
+
+	exchange();
+	updateNeighbours();
+}
+
+void DistributedPhysics::exchange()
+{
+	PROFILE_SCOPE("distributed.exchange");
+
+	for(int k=0; k<2; k++) {
+		if(links[k] != NULL) {
+			links[k]->migrants.clear();
+			links[k]->ghosts.clear();
+		}
+	}
+
+	if((links[0] == NULL && rank > 0) || (links[1] == NULL && rank < numRanks - 1))
+		throw "DistributedPhysics: connect before updating";
+
+	float slabMin = getSlabMin(rank);
+	float slabMax = getSlabMax(rank);
+	numMigrations = 0;
+
+	// particles that leave keep being seen as ghosts when they're still within the halo
+	std::vector<ParticleRecord> ownGhosts;
+
+	std::vector<Particle*>& particles = physics->particles;
+	int numSlots = particles.size();
+	for(int i=0; i<numSlots; i++) {
+		Particle* p = particles[i];
+		if(!p->isAlive) continue;
+
+		ParticleRecord record;
+		float value = p->position[axis];
+		int target = getRankIndex(p->position);
+
+		if(target != rank) {
+			toRecord(p, record);
+			links[target < rank ? 0 : 1]->migrants.push_back(record);
+			if(value >= slabMin - haloWidth && value <= slabMax + haloWidth)
+				ownGhosts.push_back(record);
+
+			p->isAlive = false;
+			physics->numActiveParticles--;
+			numMigrations++;
+			continue;
+		}
+
+		if(links[0] != NULL && value <= slabMin + haloWidth) {
+			toRecord(p, record);
+			links[0]->ghosts.push_back(record);
+		}
+
+		if(links[1] != NULL && value >= slabMax - haloWidth) {
+			toRecord(p, record);
+			links[1]->ghosts.push_back(record);
+		}
+	}
+
+	// a single rank doesn't need to connect
+	if(sender != NULL) {
+		sender->send(step);
+
+		try {
+			for(int k=0; k<2; k++) {
+				if(links[k] != NULL)
+					links[k]->receive(step);
+			}
+		} catch(std::exception&) {
+			sender->wait();
+			throw "DistributedPhysics: lost connection to a neighbouring rank";
+		}
+
+		if(!sender->wait())
+			throw "DistributedPhysics: lost connection to a neighbouring rank";
+	}
+
+	// arrivals
+	for(int k=0; k<2; k++) {
+		if(links[k] == NULL) continue;
+
+		std::vector<ParticleRecord>& arrivals = links[k]->receivedMigrants;
+		for(size_t i=0; i<arrivals.size(); i++) {
+			Particle* p = physics->createParticle();
+			fromRecord(arrivals[i], p);
+			p->getNeighbours()->clear();
+		}
+	}
+
+	// ghosts
+	numGhosts = 0;
+	for(int k=0; k<3; k++) {
+		std::vector<ParticleRecord>* records = &ownGhosts;
+		if(k < 2) {
+			if(links[k] == NULL) continue;
+			records = &links[k]->receivedGhosts;
+		}
+
+		for(size_t i=0; i<records->size(); i++) {
+			if(numGhosts == (int)ghosts.size())
+				ghosts.push_back(new Particle());
+			fromRecord((*records)[i], ghosts[numGhosts++]);
+		}
+	}
+}
+
+void DistributedPhysics::updateNeighbours()
+{
+	PROFILE_SCOPE("distributed.neighbours");
+
+	Space* space = physics->space;
+	std::vector<Particle*>& particles = physics->particles;
+	int numSlots = particles.size();
+
+	space->clear();
+	for(int i=0; i<numSlots; i++) {
+		if(particles[i]->isAlive)
+			space->insert(particles[i]);
+	}
+	for(int i=0; i<numGhosts; i++)
+		space->insert(ghosts[i]);
+
+#ifdef ENABLE_OPENMP
+	#pragma omp parallel for
+#endif
+	for(int i=0; i<numSlots; i++) {
+		Particle* p = particles[i];
+		if(!p->isAlive) continue;
+
+		SphereBound query(p->position, neighbourRadius);
+		space->select(&query, p->getNeighbours());
+	}
+}
@@ -10,6 +10,7 @@
 
 #include "fieldkit/physics/Emitter.h"
 #include "fieldkit/physics/Physics.h"
+#include "fieldkit/AllocationTracker.h"
 
 using namespace fieldkit::physics;
 
@@ -32,6 +33,8 @@ void Emitter::setMax(int value) {
 
 void Emitter::update(float dt) {
 	if(!isEnabled) return;
+
+	ALLOCATION_SCOPE("physics.emitter");
 	
 	// prepare behaviours & constraints
 	BOOST_FOREACH(Behaviour* b, behaviours) {
@@ -57,7 +60,7 @@ void Emitter::update(float dt) {
 
 // emits a single particle and applies the emitter behaviours
 Particle* Emitter::emit(Vec3f const& location) {
-	if(physics->getNumParticles() == physics->getNumAllocated()) {
+	if(physics->getNumParticles() == physics->getNumAllocatedParticles()) {
 		throw "Emitter::emit cannot emit more particles - allocate more particles first.";
 		return NULL;
 	}
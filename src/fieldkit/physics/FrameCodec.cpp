@@ -0,0 +1,566 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#include "fieldkit/physics/FrameCodec.h"
+
+#include <cstring>
+#include "fieldkit/physics/Recorder.h"
+
+#ifdef ENABLE_SSE
+	#include <emmintrin.h>
+#endif
+
+using namespace fieldkit::physics;
+
+namespace {
+	//! ages are stored in milliseconds
+	const float AGE_SCALE = 1000.0f;
+	const float QUANTISE_RANGE = 65535.0f;
+
+	//! position planes (low & high byte per axis) followed by the four age byte planes
+	const int NUM_PLANES = 10;
+
+	// -- Serialisation helpers ------------------------------------------------
+	template<typename T>
+	void writeValue(std::vector<boost::uint8_t>& out, T const& value)
+	{
+		const boost::uint8_t* bytes = reinterpret_cast<const boost::uint8_t*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	template<typename T>
+	T readValue(const boost::uint8_t*& data, const boost::uint8_t* end)
+	{
+		if(data + sizeof(T) > end)
+			throw "FrameCodec: unexpected end of data";
+		T value;
+		memcpy(&value, data, sizeof(T));
+		data += sizeof(T);
+		return value;
+	}
+
+	void writeVarint(std::vector<boost::uint8_t>& out, boost::uint32_t value)
+	{
+		while(value >= 0x80) {
+			out.push_back((boost::uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((boost::uint8_t)value);
+	}
+
+	boost::uint32_t readVarint(const boost::uint8_t*& data, const boost::uint8_t* end)
+	{
+		boost::uint32_t value = 0;
+		for(int shift=0; shift < 35; shift += 7) {
+			if(data == end)
+				throw "FrameCodec: unexpected end of data";
+			boost::uint8_t byte = *data++;
+			value |= (boost::uint32_t)(byte & 0x7f) << shift;
+			if(byte < 0x80) return value;
+		}
+		throw "FrameCodec: corrupt varint";
+	}
+
+
+	// -- Entropy coding -------------------------------------------------------
+	/*
+	 * Every byte plane is stored with one of three methods: raw, a single repeated 
+	 * byte or order-0 range asymmetric numeral systems (rANS) with 12 bit 
+	 * probabilities - whichever is smallest.
+	 */
+	enum PlaneMethod { PLANE_RAW = 0, PLANE_CONSTANT = 1, PLANE_RANS = 2 };
+
+	const int PROB_BITS = 12;
+	const boost::uint32_t PROB_SCALE = 1 << PROB_BITS;
+	const boost::uint32_t RANS_L = 1u << 23;
+
+	//! scales the symbol counts so they sum up to PROB_SCALE while every used symbol keeps at least 1
+	void normaliseFrequencies(const boost::uint32_t* counts, size_t total, boost::uint32_t* freqs)
+	{
+		boost::uint32_t sum = 0;
+		int largest = 0;
+		for(int s=0; s<256; s++) {
+			freqs[s] = counts[s] == 0 ? 0 : 
+				std::max((boost::uint32_t)1, (boost::uint32_t)((boost::uint64_t)counts[s] * PROB_SCALE / total));
+			sum += freqs[s];
+			if(freqs[s] > freqs[largest]) largest = s;
+		}
+
+		// put the rounding error on the most frequent symbol where it hurts least
+		boost::int32_t error = (boost::int32_t)PROB_SCALE - (boost::int32_t)sum;
+		if((boost::int32_t)freqs[largest] + error >= 1) {
+			freqs[largest] += error;
+			return;
+		}
+
+		// lots of rare symbols - take from everyone that can spare
+		while(sum > PROB_SCALE) {
+			for(int s=0; s<256 && sum > PROB_SCALE; s++) {
+				if(freqs[s] > 1) { freqs[s]--; sum--; }
+			}
+		}
+	}
+
+	//! appends the rANS encoded data, returns false if it wouldn't be smaller than maxSize
+	bool encodeRANS(const boost::uint8_t* data, size_t n, size_t maxSize, std::vector<boost::uint8_t>& out)
+	{
+		boost::uint32_t counts[256] = { 0 };
+		for(size_t i=0; i<n; i++)
+			counts[data[i]]++;
+
+		boost::uint32_t freqs[256], starts[256];
+		normaliseFrequencies(counts, n, freqs);
+		boost::uint32_t start = 0;
+		for(int s=0; s<256; s++) {
+			starts[s] = start;
+			start += freqs[s];
+		}
+
+		// rANS works backwards, write into a scratch buffer from its end
+		std::vector<boost::uint8_t> buffer(maxSize);
+		boost::uint8_t* begin = buffer.empty() ? NULL : &buffer[0];
+		boost::uint8_t* end = begin + buffer.size();
+		boost::uint8_t* ptr = end;
+
+		boost::uint32_t x = RANS_L;
+		for(size_t i=n; i>0; i--) {
+			boost::uint8_t s = data[i-1];
+			boost::uint32_t f = freqs[s];
+			boost::uint32_t xMax = ((RANS_L >> PROB_BITS) << 8) * f;
+			while(x >= xMax) {
+				if(ptr == begin) return false;
+				*--ptr = (boost::uint8_t)(x & 0xff);
+				x >>= 8;
+			}
+			x = ((x / f) << PROB_BITS) + (x % f) + starts[s];
+		}
+
+		if(ptr - begin < 4) return false;
+		ptr -= 4;
+		ptr[0] = (boost::uint8_t)(x);
+		ptr[1] = (boost::uint8_t)(x >> 8);
+		ptr[2] = (boost::uint8_t)(x >> 16);
+		ptr[3] = (boost::uint8_t)(x >> 24);
+
+		// frequency table & payload
+		std::vector<boost::uint8_t> header;
+		for(int s=0; s<256; s++)
+			writeVarint(header, freqs[s]);
+		writeVarint(header, end - ptr);
+
+		if(header.size() + (end - ptr) >= maxSize) return false;
+		out.insert(out.end(), header.begin(), header.end());
+		out.insert(out.end(), ptr, end);
+		return true;
+	}
+
+	void decodeRANS(const boost::uint8_t*& data, const boost::uint8_t* end, boost::uint8_t* result, size_t n)
+	{
+		boost::uint32_t freqs[256], starts[256];
+		boost::uint32_t start = 0;
+		for(int s=0; s<256; s++) {
+			freqs[s] = readVarint(data, end);
+			starts[s] = start;
+			start += freqs[s];
+		}
+		if(start != PROB_SCALE)
+			throw "FrameCodec: corrupt frequency table";
+
+		boost::uint8_t symbols[PROB_SCALE];
+		for(int s=0; s<256; s++)
+			memset(symbols + starts[s], s, freqs[s]);
+
+		boost::uint32_t size = readVarint(data, end);
+		if(size < 4 || data + size > end)
+			throw "FrameCodec: unexpected end of data";
+
+		const boost::uint8_t* ptr = data;
+		const boost::uint8_t* payloadEnd = data + size;
+		boost::uint32_t x = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((boost::uint32_t)ptr[3] << 24);
+		ptr += 4;
+
+		for(size_t i=0; i<n; i++) {
+			boost::uint32_t slot = x & (PROB_SCALE - 1);
+			boost::uint8_t s = symbols[slot];
+			result[i] = s;
+			x = freqs[s] * (x >> PROB_BITS) + slot - starts[s];
+			while(x < RANS_L) {
+				if(ptr == payloadEnd)
+					throw "FrameCodec: corrupt entropy coded data";
+				x = (x << 8) | *ptr++;
+			}
+		}
+		data = payloadEnd;
+	}
+
+	void writePlane(std::vector<boost::uint8_t>& out, const boost::uint8_t* data, size_t n)
+	{
+		bool isConstant = n > 0;
+		for(size_t i=1; i<n && isConstant; i++)
+			isConstant = data[i] == data[0];
+
+		if(isConstant) {
+			out.push_back(PLANE_CONSTANT);
+			out.push_back(data[0]);
+			return;
+		}
+
+		size_t methodOffset = out.size();
+		out.push_back(PLANE_RANS);
+		if(n > 0 && encodeRANS(data, n, n, out))
+			return;
+
+		out[methodOffset] = PLANE_RAW;
+		out.insert(out.end(), data, data + n);
+	}
+
+	void readPlane(const boost::uint8_t*& data, const boost::uint8_t* end, boost::uint8_t* result, size_t n)
+	{
+		switch(readValue<boost::uint8_t>(data, end)) {
+			case PLANE_RAW:
+				if(data + n > end)
+					throw "FrameCodec: unexpected end of data";
+				if(n > 0) memcpy(result, data, n);
+				data += n;
+				break;
+
+			case PLANE_CONSTANT:
+				memset(result, readValue<boost::uint8_t>(data, end), n);
+				break;
+
+			case PLANE_RANS:
+				decodeRANS(data, end, result, n);
+				break;
+
+			default:
+				throw "FrameCodec: unknown plane encoding";
+		}
+	}
+
+
+	// -- Fixed point ----------------------------------------------------------
+	inline boost::uint16_t quantise(float value, float min, float scale)
+	{
+		float q = (value - min) * scale + 0.5f;
+		if(!(q >= 0.0f)) return 0;
+		if(q > QUANTISE_RANGE) return (boost::uint16_t)QUANTISE_RANGE;
+		return (boost::uint16_t)q;
+	}
+
+	inline boost::uint32_t quantiseAge(float age)
+	{
+		return age > 0.0f ? (boost::uint32_t)(age * AGE_SCALE + 0.5f) : 0;
+	}
+
+	//! quantises one axis of all slots, stores the zigzag encoded difference to the previous frame as two byte planes
+	void encodeAxis(const float* values, const boost::uint8_t* alive, int n, float min, float scale,
+					boost::uint16_t* previous, boost::uint8_t* lo, boost::uint8_t* hi)
+	{
+		int i = 0;
+#ifdef ENABLE_SSE
+		const __m128 vMin = _mm_set1_ps(min);
+		const __m128 vScale = _mm_set1_ps(scale);
+		const __m128 vHalf = _mm_set1_ps(0.5f);
+		const __m128 vZero = _mm_setzero_ps();
+		const __m128 vRange = _mm_set1_ps(QUANTISE_RANGE);
+		const __m128i bias32 = _mm_set1_epi32(32768);
+		const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+		const __m128i lowMask = _mm_set1_epi16(0xff);
+		const __m128i zero = _mm_setzero_si128();
+
+		for(; i + 8 <= n; i += 8) {
+			__m128 a = _mm_loadu_ps(values + i);
+			__m128 b = _mm_loadu_ps(values + i + 4);
+			a = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(a, vMin), vScale), vHalf), vZero), vRange);
+			b = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(b, vMin), vScale), vHalf), vZero), vRange);
+
+			// pack to unsigned 16 bit by biasing into the signed range
+			__m128i qa = _mm_sub_epi32(_mm_cvttps_epi32(a), bias32);
+			__m128i qb = _mm_sub_epi32(_mm_cvttps_epi32(b), bias32);
+			__m128i q = _mm_xor_si128(_mm_packs_epi32(qa, qb), bias16);
+
+			// dead slots keep their previous value
+			__m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i));
+			__m128i isAlive = _mm_cmpgt_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(alive + i)), zero);
+			isAlive = _mm_unpacklo_epi8(isAlive, isAlive);
+			q = _mm_or_si128(_mm_and_si128(isAlive, q), _mm_andnot_si128(isAlive, prev));
+
+			__m128i d = _mm_sub_epi16(q, prev);
+			__m128i z = _mm_xor_si128(_mm_slli_epi16(d, 1), _mm_srai_epi16(d, 15));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(previous + i), q);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(lo + i), _mm_packus_epi16(_mm_and_si128(z, lowMask), zero));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(hi + i), _mm_packus_epi16(_mm_srli_epi16(z, 8), zero));
+		}
+#endif
+		for(; i<n; i++) {
+			boost::uint16_t q = alive[i] ? quantise(values[i], min, scale) : previous[i];
+			boost::int16_t d = (boost::int16_t)(q - previous[i]);
+			boost::uint16_t z = (boost::uint16_t)((d << 1) ^ (d >> 15));
+			previous[i] = q;
+			lo[i] = (boost::uint8_t)(z & 0xff);
+			hi[i] = (boost::uint8_t)(z >> 8);
+		}
+	}
+
+	void decodeAxis(const boost::uint8_t* lo, const boost::uint8_t* hi, int n, float min, float invScale,
+					boost::uint16_t* previous, float* values)
+	{
+		int i = 0;
+#ifdef ENABLE_SSE
+		const __m128 vMin = _mm_set1_ps(min);
+		const __m128 vInvScale = _mm_set1_ps(invScale);
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i zero = _mm_setzero_si128();
+
+		for(; i + 8 <= n; i += 8) {
+			__m128i z = _mm_unpacklo_epi8(
+				_mm_loadl_epi64(reinterpret_cast<const __m128i*>(lo + i)),
+				_mm_loadl_epi64(reinterpret_cast<const __m128i*>(hi + i)));
+			__m128i d = _mm_xor_si128(_mm_srli_epi16(z, 1), _mm_sub_epi16(zero, _mm_and_si128(z, one)));
+
+			__m128i q = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i)), d);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(previous + i), q);
+
+			__m128 a = _mm_cvtepi32_ps(_mm_unpacklo_epi16(q, zero));
+			__m128 b = _mm_cvtepi32_ps(_mm_unpackhi_epi16(q, zero));
+			_mm_storeu_ps(values + i, _mm_add_ps(_mm_mul_ps(a, vInvScale), vMin));
+			_mm_storeu_ps(values + i + 4, _mm_add_ps(_mm_mul_ps(b, vInvScale), vMin));
+		}
+#endif
+		for(; i<n; i++) {
+			boost::uint16_t z = (boost::uint16_t)(lo[i] | (hi[i] << 8));
+			boost::uint16_t d = (boost::uint16_t)((z >> 1) ^ -(z & 1));
+			boost::uint16_t q = (boost::uint16_t)(previous[i] + d);
+			previous[i] = q;
+			values[i] = (float)q * invScale + min;
+		}
+	}
+
+	Vec3f getQuantiseScale(AABB const& bounds)
+	{
+		Vec3f scale;
+		for(int axis=0; axis<3; axis++) {
+			float range = bounds.max[axis] - bounds.min[axis];
+			scale[axis] = range > 0.0f ? QUANTISE_RANGE / range : 0.0f;
+		}
+		return scale;
+	}
+
+	Vec3f getDequantiseScale(AABB const& bounds)
+	{
+		Vec3f scale;
+		for(int axis=0; axis<3; axis++)
+			scale[axis] = (bounds.max[axis] - bounds.min[axis]) / QUANTISE_RANGE;
+		return scale;
+	}
+}
+
+
+// -- FrameCodec ---------------------------------------------------------------
+FrameCodec::FrameCodec() : needsKeyframe(true)
+{
+}
+
+FrameCodec::FrameCodec(AABB const& bounds) : needsKeyframe(true)
+{
+	setBounds(bounds);
+}
+
+void FrameCodec::setBounds(AABB const& bounds)
+{
+	this->bounds.set(bounds);
+	reset();
+}
+
+void FrameCodec::reset()
+{
+	needsKeyframe = true;
+}
+
+void FrameCodec::prepare(int numSlots, bool isKeyframe)
+{
+	for(int axis=0; axis<3; axis++) {
+		if(isKeyframe)
+			quantised[axis].assign(numSlots, 0);
+		else
+			quantised[axis].resize(numSlots, 0);
+		values[axis].resize(numSlots);
+	}
+
+	if(isKeyframe)
+		ages.assign(numSlots, 0);
+	else
+		ages.resize(numSlots, 0);
+
+	decodedAges.resize(numSlots);
+	planes.resize(numSlots * NUM_PLANES);
+}
+
+/*
+ * Frame layout:
+ *	int32 numSlots, uint8 isKeyframe, alive bitmask plane, 6 position planes, 4 age planes
+ */
+void FrameCodec::encode(ParticleFrame& frame, bool isKeyframe, std::vector<boost::uint8_t>& result)
+{
+	int n = frame.size();
+	isKeyframe = isKeyframe || needsKeyframe;
+	needsKeyframe = false;
+	prepare(n, isKeyframe);
+
+	result.clear();
+	writeValue(result, (boost::int32_t)n);
+	writeValue(result, (boost::uint8_t)isKeyframe);
+
+	alive.assign((n + 7) / 8, 0);
+	for(int i=0; i<n; i++) {
+		if(frame.alive[i])
+			alive[i / 8] |= 1 << (i % 8);
+	}
+	writePlane(result, alive.empty() ? NULL : &alive[0], alive.size());
+
+	if(n == 0) return;
+
+	// positions
+	Vec3f scale = getQuantiseScale(bounds);
+	for(int axis=0; axis<3; axis++) {
+		float* axisValues = &values[axis][0];
+		for(int i=0; i<n; i++)
+			axisValues[i] = frame.positions[i][axis];
+
+		encodeAxis(axisValues, &frame.alive[0], n, bounds.min[axis], scale[axis], 
+				   &quantised[axis][0], &planes[(axis * 2) * n], &planes[(axis * 2 + 1) * n]);
+	}
+
+	// ages
+	boost::uint8_t* agePlanes = &planes[6 * n];
+	for(int i=0; i<n; i++) {
+		boost::uint32_t age = frame.alive[i] ? quantiseAge(frame.ages[i]) : ages[i];
+		boost::int32_t d = (boost::int32_t)(age - ages[i]);
+		boost::uint32_t z = ((boost::uint32_t)d << 1) ^ (boost::uint32_t)(d >> 31);
+		ages[i] = age;
+		for(int b=0; b<4; b++)
+			agePlanes[b * n + i] = (boost::uint8_t)(z >> (b * 8));
+	}
+
+	for(int p=0; p<NUM_PLANES; p++)
+		writePlane(result, &planes[p * n], n);
+}
+
+int FrameCodec::decodeValues(const boost::uint8_t* data, size_t size)
+{
+	const boost::uint8_t* end = data + size;
+
+	int n = readValue<boost::int32_t>(data, end);
+	bool isKeyframe = readValue<boost::uint8_t>(data, end) != 0;
+	if(n < 0)
+		throw "FrameCodec: corrupt frame";
+	if(needsKeyframe && !isKeyframe)
+		throw "FrameCodec: decoding needs to start at a keyframe";
+	needsKeyframe = false;
+	prepare(n, isKeyframe);
+
+	// alive bitmask expanded to one byte per slot
+	std::vector<boost::uint8_t> mask((n + 7) / 8);
+	readPlane(data, end, mask.empty() ? NULL : &mask[0], mask.size());
+
+	alive.resize(n);
+	for(int i=0; i<n; i++)
+		alive[i] = (mask[i / 8] >> (i % 8)) & 1;
+
+	if(n == 0) return 0;
+
+	for(int p=0; p<NUM_PLANES; p++)
+		readPlane(data, end, &planes[p * n], n);
+
+	// positions
+	Vec3f invScale = getDequantiseScale(bounds);
+	for(int axis=0; axis<3; axis++) {
+		decodeAxis(&planes[(axis * 2) * n], &planes[(axis * 2 + 1) * n], n, 
+				   bounds.min[axis], invScale[axis], &quantised[axis][0], &values[axis][0]);
+	}
+
+	// ages
+	const boost::uint8_t* agePlanes = &planes[6 * n];
+	for(int i=0; i<n; i++) {
+		boost::uint32_t z = agePlanes[i] | (agePlanes[n + i] << 8) | 
+			(agePlanes[2 * n + i] << 16) | ((boost::uint32_t)agePlanes[3 * n + i] << 24);
+		boost::uint32_t d = (z >> 1) ^ -(z & 1);
+		ages[i] += d;
+		decodedAges[i] = ages[i] / AGE_SCALE;
+	}
+
+	return n;
+}
+
+void FrameCodec::decode(const boost::uint8_t* data, size_t size, ParticleFrame& result)
+{
+	int n = decodeValues(data, size);
+	result.resize(n);
+
+	for(int i=0; i<n; i++) {
+		result.positions[i].set(values[0][i], values[1][i], values[2][i]);
+		result.ages[i] = decodedAges[i];
+		result.alive[i] = alive[i];
+	}
+}
+
+int FrameCodec::decodePositions(const boost::uint8_t* data, size_t size, float* result, int stride, int capacity)
+{
+	int n = decodeValues(data, size);
+
+	int count = 0;
+	for(int i=0; i<n && count < capacity; i++) {
+		if(!alive[i]) continue;
+		result[0] = values[0][i];
+		result[1] = values[1][i];
+		result[2] = values[2][i];
+		result += stride;
+		count++;
+	}
+	return count;
+}
+
+
+// -- Lossless -----------------------------------------------------------------
+void FrameCodec::compress(const void* data, size_t size, int elementSize, std::vector<boost::uint8_t>& result)
+{
+	if(elementSize < 1 || size % elementSize != 0)
+		throw "FrameCodec::compress size needs to be a multiple of elementSize";
+
+	const boost::uint8_t* bytes = static_cast<const boost::uint8_t*>(data);
+	size_t n = size / elementSize;
+
+	result.clear();
+	writeValue(result, (boost::uint64_t)size);
+
+	std::vector<boost::uint8_t> plane(n);
+	for(int b=0; b<elementSize; b++) {
+		for(size_t i=0; i<n; i++)
+			plane[i] = bytes[i * elementSize + b];
+		writePlane(result, plane.empty() ? NULL : &plane[0], n);
+	}
+}
+
+void FrameCodec::decompress(const boost::uint8_t* data, size_t size, void* result, size_t resultSize, int elementSize)
+{
+	const boost::uint8_t* end = data + size;
+	if(readValue<boost::uint64_t>(data, end) != resultSize)
+		throw "FrameCodec::decompress unexpected size of the decompressed data";
+	if(elementSize < 1 || resultSize % elementSize != 0)
+		throw "FrameCodec::decompress size needs to be a multiple of elementSize";
+
+	boost::uint8_t* bytes = static_cast<boost::uint8_t*>(result);
+	size_t n = resultSize / elementSize;
+
+	std::vector<boost::uint8_t> plane(n);
+	for(int b=0; b<elementSize; b++) {
+		readPlane(data, end, plane.empty() ? NULL : &plane[0], n);
+		for(size_t i=0; i<n; i++)
+			bytes[i * elementSize + b] = plane[i];
+	}
+}
@@ -0,0 +1,89 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#include <algorithm>
+#include <boost/atomic.hpp>
+#include "fieldkit/physics/Lifecycle.h"
+
+using namespace fieldkit::physics;
+
+// -- LifecycleQueue -----------------------------------------------------------
+struct LifecycleQueue::Counter {
+	boost::atomic<int> value;
+	Counter() : value(0) {}
+};
+
+LifecycleQueue::LifecycleQueue() 
+{
+	count = new Counter();
+}
+
+LifecycleQueue::~LifecycleQueue() 
+{
+	delete count;
+}
+
+void LifecycleQueue::reserve(int capacity)
+{
+	indices.resize(capacity);
+}
+
+void LifecycleQueue::push(int index)
+{
+	int slot = count->value.fetch_add(1, boost::memory_order_relaxed);
+	if(slot < (int)indices.size())
+		indices[slot] = index;
+}
+
+void LifecycleQueue::clear() 
+{
+	count->value.store(0, boost::memory_order_relaxed);
+}
+
+int LifecycleQueue::size()
+{
+	return std::min(count->value.load(boost::memory_order_acquire), (int)indices.size());
+}
+
+bool LifecycleQueue::hasOverflown() 
+{
+	return count->value.load(boost::memory_order_relaxed) > (int)indices.size();
+}
+
+int LifecycleQueue::drain(std::vector<int>& result)
+{
+	int n = size();
+	result.assign(indices.begin(), indices.begin() + n);
+	clear();
+	return n;
+}
+
+
+// -- ParticleLifecycle --------------------------------------------------------
+void ParticleLifecycle::resize(int numParticles)
+{
+	if((int)states.size() >= numParticles) return;
+
+	states.resize(numParticles, 0);
+	born.reserve(numParticles);
+	died.reserve(numParticles);
+}
+
+void ParticleLifecycle::clear()
+{
+	states.clear();
+	born.clear();
+	died.clear();
+}
+
+void ParticleLifecycle::recycle(int index)
+{
+	if(states[index] == 0) return;
+	
+	states[index] = 0;
+	died.push(index);
+}
@@ -0,0 +1,454 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#include "fieldkit/physics/PartitionedPhysics.h"
+
+#include <cfloat>
+
+#include "fieldkit/physics/Physics.h"
+#include "fieldkit/physics/Particle.h"
+#include "fieldkit/physics/space/Space.h"
+#include "fieldkit/physics/strategy/NeighbourUpdate.h"
+#include "fieldkit/math/SphereBound.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit::physics;
+
+namespace fieldkit { namespace physics {
+
+	//! A slab of a PartitionedPhysics, its own particles and the ghosts it sees of its neighbours
+	class PartitionDomain {
+	public:
+		Physics* physics;
+
+		//! particles that left this slab during the last update and the domains they moved to
+		std::vector<Particle*> outgoing;
+		std::vector<int> outgoingTargets;
+
+		//! pool of ghost particles, only the first numGhosts are in use
+		std::vector<Particle*> ghosts;
+		std::vector<Particle*> ghostSources;
+		int numGhosts;
+
+		//! indices of the springs with both ends in this domain
+		std::vector<int> springs;
+
+		//! selects the neighbours of the owned particles after the ghosts were inserted
+		FixedRadiusNeighbourUpdate neighbourUpdate;
+
+		PartitionDomain(Physics* physics) : physics(physics), numGhosts(0) 
+		{
+			neighbourUpdate.setEmptySpaceOnUpdate(false);
+		}
+
+		~PartitionDomain()
+		{
+			for(size_t i=0; i<ghosts.size(); i++)
+				delete ghosts[i];
+			delete physics;
+		}
+
+		Particle* addGhost(Particle* source)
+		{
+			if(numGhosts == (int)ghosts.size())
+				ghosts.push_back(new Particle());
+
+			Particle* ghost = ghosts[numGhosts++];
+			ghostSources.resize(numGhosts);
+			ghostSources[numGhosts - 1] = source;
+			return ghost;
+		}
+	};
+
+} } // namespace fieldkit::physics
+
+namespace {
+	//! copies the simulation state, not the neighbours
+	void copyState(Particle* from, Particle* to)
+	{
+		to->state = from->state;
+		to->age = from->age;
+		to->lifeTime = from->lifeTime;
+		to->isAlive = from->isAlive;
+		to->ignoreConstraints = from->ignoreConstraints;
+		to->weight = from->weight;
+		to->invWeight = from->invWeight;
+		to->isLocked = from->isLocked;
+		to->position = from->position;
+		to->prev = from->prev;
+		to->drag = from->drag;
+		to->force = from->force;
+		to->size = from->size;
+		to->id = from->id;
+	}
+}
+
+
+// -- Setup --------------------------------------------------------------------
+PartitionedPhysics::PartitionedPhysics(AABB const& bounds, int numDomains, float haloWidth, DomainFactory const& factory) :
+	haloWidth(haloWidth), neighbourRadius(haloWidth), numMigrations(0)
+{
+	if(numDomains < 1)
+		throw "PartitionedPhysics: needs at least one domain";
+
+	this->bounds.set(bounds);
+
+	// split along the longest axis
+	Vec3f size = bounds.max - bounds.min;
+	axis = 0;
+	if(size.y > size[axis]) axis = 1;
+	if(size.z > size[axis]) axis = 2;
+	slabWidth = size[axis] / numDomains;
+
+	// the bounds of a domain depend on the number of domains
+	for(int i=0; i<numDomains; i++)
+		domains.push_back(new PartitionDomain(NULL));
+
+	for(int i=0; i<numDomains; i++) {
+		Physics* physics = factory(getDomainBounds(i));
+		if(physics == NULL)
+			throw "PartitionedPhysics: factory didn't create a domain";
+		domains[i]->physics = physics;
+
+		// neighbours are found across domains here
+		physics->setNeighbourUpdate(NULL);
+		domains[i]->neighbourUpdate.setRadius(neighbourRadius);
+	}
+
+	// ids start at 1 like in Physics
+	Location empty = { 0, NULL };
+	locations.resize(1, empty);
+}
+
+PartitionedPhysics::~PartitionedPhysics()
+{
+	for(size_t i=0; i<domains.size(); i++)
+		delete domains[i];
+	domains.clear();
+}
+
+Physics* PartitionedPhysics::getDomain(int index)
+{
+	return domains[index]->physics;
+}
+
+AABB PartitionedPhysics::getDomainBounds(int index)
+{
+	// only sides facing another domain need a halo, a single domain covers exactly the same space as a Physics
+	Vec3f min = bounds.min;
+	Vec3f max = bounds.max;
+	if(index > 0)
+		min[axis] = bounds.min[axis] + index * slabWidth - haloWidth;
+	if(index < (int)domains.size() - 1)
+		max[axis] = bounds.min[axis] + (index + 1) * slabWidth + haloWidth;
+	return AABB(min, max);
+}
+
+int PartitionedPhysics::getNumGhosts(int index)
+{
+	return domains[index]->numGhosts;
+}
+
+void PartitionedPhysics::setNeighbourRadius(float radius)
+{
+	if(radius > haloWidth)
+		throw "PartitionedPhysics: neighbour radius can't be larger than the halo";
+	neighbourRadius = radius;
+
+	for(size_t i=0; i<domains.size(); i++)
+		domains[i]->neighbourUpdate.setRadius(radius);
+}
+
+int PartitionedPhysics::getDomainIndex(Vec3f const& position)
+{
+	int index = (int)floorf((position[axis] - bounds.min[axis]) / slabWidth);
+	if(index < 0) return 0;
+	if(index >= (int)domains.size()) return domains.size() - 1;
+	return index;
+}
+
+int PartitionedPhysics::getNumParticles()
+{
+	int count = 0;
+	for(size_t i=0; i<domains.size(); i++)
+		count += domains[i]->physics->getNumParticles();
+	return count;
+}
+
+Particle* PartitionedPhysics::createParticle(Vec3f const& position)
+{
+	int index = getDomainIndex(position);
+	Particle* p = domains[index]->physics->createParticle();
+	p->init(position);
+	p->id = locations.size();
+
+	Location location = { index, p };
+	locations.push_back(location);
+	return p;
+}
+
+void PartitionedPhysics::createSpring(int idA, int idB, float restLength, float strength)
+{
+	if(getCurrent(idA) == NULL || getCurrent(idB) == NULL)
+		throw "PartitionedPhysics: spring needs two alive particles";
+
+	SpringLink link = { idA, idB, restLength, strength };
+	springs.push_back(link);
+}
+
+Particle* PartitionedPhysics::getParticle(int id)
+{
+	return getCurrent(id);
+}
+
+Particle* PartitionedPhysics::getCurrent(int id)
+{
+	if(id <= 0 || id >= (int)locations.size()) 
+		return NULL;
+
+	Particle* p = locations[id].particle;
+	return (p != NULL && p->isAlive && p->id == id) ? p : NULL;
+}
+
+
+// -- Update -------------------------------------------------------------------
+void PartitionedPhysics::update(float dt)
+{
+	PROFILE_SCOPE("partitioned.update");
+	int n = domains.size();
+
+	{
+		PROFILE_SCOPE("partitioned.domains");
+#ifdef ENABLE_OPENMP
+		#pragma omp parallel for
+#endif
+		for(int d=0; d<n; d++)
+			domains[d]->physics->update(dt);
+	}
+
+	migrate();
+	exchangeGhosts();
+	updateSprings();
+	refreshGhosts();
+	updateNeighbours();
+}
+
+void PartitionedPhysics::migrate()
+{
+	PROFILE_SCOPE("partitioned.migrate");
+	int n = domains.size();
+
+	// find the particles that left their slab
+#ifdef ENABLE_OPENMP
+	#pragma omp parallel for
+#endif
+	for(int d=0; d<n; d++) {
+		PartitionDomain* domain = domains[d];
+		domain->outgoing.clear();
+		domain->outgoingTargets.clear();
+
+		std::vector<Particle*>& particles = domain->physics->particles;
+		int numSlots = particles.size();
+		for(int i=0; i<numSlots; i++) {
+			Particle* p = particles[i];
+			if(!p->isAlive) continue;
+
+			int target = getDomainIndex(p->position);
+			if(target != d) {
+				domain->outgoing.push_back(p);
+				domain->outgoingTargets.push_back(target);
+			}
+		}
+	}
+
+	// particles a domain created itself (e.g. through its own emitter) aren't in the table yet
+	for(int d=0; d<n; d++) {
+		std::vector<Particle*>& outgoing = domains[d]->outgoing;
+		for(size_t i=0; i<outgoing.size(); i++) {
+			if(outgoing[i]->id >= (int)locations.size()) {
+				Location empty = { 0, NULL };
+				locations.resize(outgoing[i]->id + 1, empty);
+			}
+		}
+	}
+
+	// every domain creates its arrivals, the leaving particles are still alive so their slots aren't reused
+#ifdef ENABLE_OPENMP
+	#pragma omp parallel for
+#endif
+	for(int t=0; t<n; t++) {
+		Physics* physics = domains[t]->physics;
+		for(int d=0; d<n; d++) {
+			PartitionDomain* source = domains[d];
+			for(size_t i=0; i<source->outgoing.size(); i++) {
+				if(source->outgoingTargets[i] != t) continue;
+
+				Particle* p = physics->createParticle();
+				copyState(source->outgoing[i], p);
+				p->getNeighbours()->clear();
+
+				locations[p->id].domain = t;
+				locations[p->id].particle = p;
+			}
+		}
+	}
+
+	numMigrations = 0;
+	for(int d=0; d<n; d++) {
+		PartitionDomain* domain = domains[d];
+		for(size_t i=0; i<domain->outgoing.size(); i++)
+			domain->outgoing[i]->isAlive = false;
+		domain->physics->numActiveParticles -= domain->outgoing.size();
+		numMigrations += domain->outgoing.size();
+	}
+
+	// springs within a slab are applied by its domain, those across a boundary in a pass of their own
+	for(int d=0; d<n; d++)
+		domains[d]->springs.clear();
+	boundarySprings.clear();
+
+	for(size_t i=0; i<springs.size(); i++) {
+		int a = locations[springs[i].a].domain;
+		int b = locations[springs[i].b].domain;
+		if(a == b) 
+			domains[a]->springs.push_back(i);
+		else
+			boundarySprings.push_back(i);
+	}
+}
+
+void PartitionedPhysics::exchangeGhosts()
+{
+	PROFILE_SCOPE("partitioned.ghosts");
+	int n = domains.size();
+
+#ifdef ENABLE_OPENMP
+	#pragma omp parallel for
+#endif
+	for(int d=0; d<n; d++) {
+		PartitionDomain* domain = domains[d];
+		domain->numGhosts = 0;
+
+		// the outermost slabs extend to infinity
+		float min = d == 0 ? -FLT_MAX : bounds.min[axis] + d * slabWidth - haloWidth;
+		float max = d == n - 1 ? FLT_MAX : bounds.min[axis] + (d + 1) * slabWidth + haloWidth;
+
+		for(int e=0; e<n; e++) {
+			if(e == d) continue;
+
+			// skip domains that are too far away
+			float sourceMin = e == 0 ? -FLT_MAX : bounds.min[axis] + e * slabWidth;
+			float sourceMax = e == n - 1 ? FLT_MAX : bounds.min[axis] + (e + 1) * slabWidth;
+			if(sourceMax < min || sourceMin > max) continue;
+
+			std::vector<Particle*>& particles = domains[e]->physics->particles;
+			int numSlots = particles.size();
+			for(int i=0; i<numSlots; i++) {
+				Particle* p = particles[i];
+				if(!p->isAlive) continue;
+
+				float value = p->position[axis];
+				if(value < min || value > max) continue;
+
+				copyState(p, domain->addGhost(p));
+			}
+		}
+	}
+}
+
+void PartitionedPhysics::updateSprings()
+{
+	if(springs.empty()) return;
+
+	PROFILE_SCOPE("partitioned.springs");
+	int n = domains.size();
+
+	// springs within a slab only move particles of their own domain
+#ifdef ENABLE_OPENMP
+	#pragma omp parallel for
+#endif
+	for(int d=0; d<n; d++) {
+		PartitionDomain* domain = domains[d];
+		for(size_t i=0; i<domain->springs.size(); i++) {
+			SpringLink& s = springs[domain->springs[i]];
+			Particle* a = getCurrent(s.a);
+			Particle* b = getCurrent(s.b);
+			if(a != NULL && b != NULL)
+				applySpring(s, a, b, domain->physics, domain->physics);
+		}
+	}
+
+	// springs across a boundary move particles of two domains, applying them afterwards 
+	// reads both ends at their current position instead of a ghost from before the springs
+	for(size_t i=0; i<boundarySprings.size(); i++) {
+		SpringLink& s = springs[boundarySprings[i]];
+		Particle* a = getCurrent(s.a);
+		Particle* b = getCurrent(s.b);
+		if(a != NULL && b != NULL)
+			applySpring(s, a, b, domains[locations[s.a].domain]->physics, domains[locations[s.b].domain]->physics);
+	}
+}
+
+//! same as Spring::update and the constraints SpringUpdate applies afterwards, 
+//! each end is constrained by the domain that owns it
+void PartitionedPhysics::applySpring(SpringLink const& s, Particle* a, Particle* b, Physics* physicsA, Physics* physicsB)
+{
+	Vec3f delta = b->position - a->position;
+	float dist = delta.length() + (float)EPSILON_VALUE;
+	float normDistStrength = (dist - s.restLength) / (dist * (a->invWeight + b->invWeight)) * s.strength;
+
+	if(!a->isLocked)
+		a->position += delta * normDistStrength * a->invWeight;
+
+	if(!b->isLocked)
+		b->position += delta * -normDistStrength * b->invWeight;
+
+	BOOST_FOREACH(Constraint* c, physicsA->constraints) {
+		c->apply(a);
+	}
+	BOOST_FOREACH(Constraint* c, physicsB->constraints) {
+		c->apply(b);
+	}
+}
+
+void PartitionedPhysics::refreshGhosts()
+{
+	if(springs.empty()) return;
+
+	// springs moved the originals
+	int n = domains.size();
+#ifdef ENABLE_OPENMP
+	#pragma omp parallel for
+#endif
+	for(int d=0; d<n; d++) {
+		PartitionDomain* domain = domains[d];
+		for(int i=0; i<domain->numGhosts; i++)
+			domain->ghosts[i]->position = domain->ghostSources[i]->position;
+	}
+}
+
+void PartitionedPhysics::updateNeighbours()
+{
+	PROFILE_SCOPE("partitioned.neighbours");
+	int n = domains.size();
+
+#ifdef ENABLE_OPENMP
+	#pragma omp parallel for
+#endif
+	for(int d=0; d<n; d++) {
+		PartitionDomain* domain = domains[d];
+		Space* space = domain->physics->space;
+
+		// the neighbour update adds the owned particles and queries the space like in a single Physics
+		space->clear();
+		for(int i=0; i<domain->numGhosts; i++)
+			space->insert(domain->ghosts[i]);
+
+		domain->neighbourUpdate.apply(domain->physics);
+	}
+}
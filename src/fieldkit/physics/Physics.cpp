@@ -8,6 +8,8 @@
  */
 
 #include "fieldkit/physics/Physics.h"
+#include "fieldkit/AllocationTracker.h"
+#include "fieldkit/Profiler.h"
 
 #include "fieldkit/physics/space/Space.h"
 #include "fieldkit/physics/Emitter.h"
@@ -17,6 +19,7 @@
 #include "fieldkit/physics/strategy/ParticleUpdate.h"
 #include "fieldkit/physics/strategy/SpringUpdate.h"
 #include "fieldkit/physics/strategy/NeighbourUpdate.h"
+#include "fieldkit/physics/SharedMemoryExport.h"
 
 using namespace fieldkit::physics;
 
@@ -30,6 +33,11 @@ Physics::Physics(Space* space)
 	numAllocatedSprings = 0;
 
 	nextID = 0;
+	neighboursPerParticle = 0;
+	numPoolGrowths = 0;
+	nextFreeParticle = 0;
+	nextFreeSpring = 0;
+	isDeterministic = false;
 	
 	emitter = NULL;
 	ownsSpace = true;
@@ -38,6 +46,7 @@ Physics::Physics(Space* space)
 	particleUpdate = NULL;
 	springUpdate = NULL;
 	neighbourUpdate = NULL;
+	sharedMemoryExport = NULL;
 
 //	setParticleAllocator(new ParticleAllocator());
 //	setParticleUpdate(new ParticleUpdate());
@@ -52,6 +61,10 @@ Physics::Physics(Space* space)
 
 Physics::~Physics() 
 {
+	// springs & particles - need to be destroyed by the allocators that created them
+	destroySprings();
+	destroyParticles();
+
 	// strategies
 	if(particleAllocator != NULL) {
 		delete particleAllocator;
@@ -78,10 +91,6 @@ Physics::~Physics()
 		neighbourUpdate = NULL;
 	}
 
-	// springs & particles
-	destroySprings();
-	destroyParticles();
-
 	// emitter
 	if(emitter != NULL) {
 		delete emitter;
@@ -97,17 +106,125 @@ Physics::~Physics()
 
 void Physics::update(float dt)
 {
-	if(emitter != NULL)
+	ALLOCATION_SCOPE("physics");
+	PROFILE_SCOPE("physics.update");
+
+	// changes requested from other threads may grow the pools
+	{
+		PROFILE_SCOPE("physics.commands");
+		commands.apply(this);
+	}
+
+#ifdef PHYSICS_DEBUG
+	size_t capacity = getPoolCapacity();
+#endif
+
+	if(emitter != NULL) {
+		PROFILE_SCOPE("physics.emitter");
 		emitter->update(dt);
+	}
 	
-	if(particleUpdate != NULL)
+	if(particleUpdate != NULL) {
+		PROFILE_SCOPE("physics.particles");
 		particleUpdate->apply(this, dt);
+	}
 
-	if(springUpdate != NULL)
+	if(springUpdate != NULL) {
+		PROFILE_SCOPE("physics.springs");
 		springUpdate->apply(this);
+	}
 
-	if(neighbourUpdate != NULL)
+	if(neighbourUpdate != NULL) {
+		PROFILE_SCOPE("physics.neighbours");
 		neighbourUpdate->apply(this);
+	}
+
+	if(sharedMemoryExport != NULL) {
+		PROFILE_SCOPE("physics.export");
+		sharedMemoryExport->publish(this);
+	}
+
+#ifdef PHYSICS_DEBUG
+	if(getPoolCapacity() != capacity)
+		numPoolGrowths++;
+#endif
+}
+
+void Physics::reserve(int numParticles, int numSprings, int neighboursPerParticle)
+{
+	if(numParticles > numAllocatedParticles)
+		allocParticles(numParticles - numAllocatedParticles);
+
+	if(numSprings > numAllocatedSprings)
+		allocSprings(numSprings - numAllocatedSprings);
+
+	space->reserve(numParticles);
+
+	// also applied to all particles added later on
+	this->neighboursPerParticle = neighboursPerParticle;
+	BOOST_FOREACH(Particle* p, particles) {
+		p->getNeighbours()->reserve(neighboursPerParticle);
+	}
+}
+
+void Physics::setDeterministic(bool enabled, unsigned int seed)
+{
+	isDeterministic = enabled;
+	setRandDeterministic(enabled, seed);
+}
+
+// FNV-1a over the raw bytes of the given value
+template<typename T>
+static void hashValue(boost::uint64_t& hash, T const& value)
+{
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+	for(size_t i=0; i<sizeof(T); i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+boost::uint64_t Physics::getStateHash()
+{
+	boost::uint64_t hash = 14695981039346656037ULL;
+
+	int n = particles.size();
+	for(int i=0; i<n; i++) {
+		Particle* p = particles[i];
+		if(!p->isAlive) continue;
+
+		hashValue(hash, i);
+		hashValue(hash, p->id);
+		hashValue(hash, p->age);
+		hashValue(hash, p->position.x);
+		hashValue(hash, p->position.y);
+		hashValue(hash, p->position.z);
+		hashValue(hash, p->prev.x);
+		hashValue(hash, p->prev.y);
+		hashValue(hash, p->prev.z);
+	}
+
+	n = springs.size();
+	for(int i=0; i<n; i++) {
+		Spring* s = springs[i];
+		if(!s->isAlive) continue;
+
+		hashValue(hash, i);
+		hashValue(hash, s->a->id);
+		hashValue(hash, s->b->id);
+		hashValue(hash, s->restLength);
+	}
+
+	return hash;
+}
+
+size_t Physics::getPoolCapacity()
+{
+	size_t capacity = particles.capacity() + springs.capacity();
+	BOOST_FOREACH(Particle* p, particles) {
+		capacity += p->getNeighbours()->capacity();
+	}
+	return capacity;
 }
 
 // -- Particles ----------------------------------------------------------------
@@ -116,9 +233,17 @@ void Physics::update(float dt)
 Particle* Physics::createParticle() 
 {
 	numActiveParticles++;
-	BOOST_FOREACH(Particle* p, particles) {
+
+	// continue searching where the last particle was found instead of always 
+	// scanning the whole pool from the start
+	int n = particles.size();
+	for(int j=0; j<n; j++) {
+		int i = (nextFreeParticle + j) % n;
+		Particle* p = particles[i];
 		if(!p->isAlive)
 		{
+			nextFreeParticle = i + 1;
+			lifecycle.recycle(i);
 			p->id = getNextID();
 			return p;
 		}
@@ -138,6 +263,8 @@ void Physics::allocParticles(int count)
 	numAllocatedParticles = particles.size() + count;
 	space->reserve(numAllocatedParticles);
 	particles.reserve(numAllocatedParticles);
+	lifecycle.resize(numAllocatedParticles);
+	particleAllocator->reserve(count);
 	
 	for(int i=0; i<count; i++)
 		particleAllocator->apply(this);
@@ -146,6 +273,10 @@ void Physics::allocParticles(int count)
 void Physics::addParticle(Particle* particle)
 {
 	particles.push_back(particle);
+	lifecycle.resize(particles.size());
+
+	if(neighboursPerParticle > 0)
+		particle->getNeighbours()->reserve(neighboursPerParticle);
 }
 
 // retiring a particle sets its isAlive flag to false allowing it to recycled later
@@ -155,7 +286,7 @@ void Physics::retireParticle(const int id)
 {
 	BOOST_FOREACH(Particle* p, particles)
 	{
-		if(id == p->id)
+		if(id == p->id && p->isAlive)
 		{
 			//we assume that a spring is never apped to the list twice.
 			p->isAlive = false;
@@ -170,7 +301,7 @@ void Physics::retireParticleRange(const int id_1, const int id_2)
 {
 	BOOST_FOREACH(Particle* p, particles)
 	{
-		if(id_1 <= p->id && p->id <= id_2)
+		if(id_1 <= p->id && p->id <= id_2 && p->isAlive)
 		{
 			p->isAlive = false;
 			numActiveParticles--;
@@ -180,11 +311,17 @@ void Physics::retireParticleRange(const int id_1, const int id_2)
 
 void Physics::destroyParticles()
 {
-	BOOST_FOREACH(Particle* p, particles) {
-		delete p;
-		p = NULL;
+	if(particleAllocator != NULL) {
+		particleAllocator->destroy(particles);
+
+	} else {
+		BOOST_FOREACH(Particle* p, particles) {
+			delete p;
+		}
+		particles.clear();
 	}
-	particles.clear();
+	lifecycle.clear();
+	nextFreeParticle = 0;
 
 	numAllocatedParticles = 0;
 	numActiveParticles = 0;
@@ -196,9 +333,13 @@ void Physics::destroyParticles()
 Spring* Physics::createSpring() 
 {
 	numActiveSprings++;
-	BOOST_FOREACH(Spring* s, springs) {
+	int n = springs.size();
+	for(int j=0; j<n; j++) {
+		int i = (nextFreeSpring + j) % n;
+		Spring* s = springs[i];
 		if(!s->isAlive)
 		{
+			nextFreeSpring = i + 1;
 			s->id = getNextID();
 			return s;
 		}
@@ -216,8 +357,8 @@ Spring* Physics::createSpring()
 void Physics::allocSprings(int count) 
 {
 	numAllocatedSprings = springs.size() + count;
-	space->reserve(numAllocatedSprings);
-	particles.reserve(numAllocatedSprings);
+	springs.reserve(numAllocatedSprings);
+	springAllocator->reserve(count);
 
 	for(int i=0; i<count; i++)
 		springAllocator->apply(this);
@@ -265,19 +406,31 @@ void Physics::destroySprings()
 {
 	if(springs.size() == 0) return;
 	
-	BOOST_FOREACH(Spring* s, springs) {
-		delete s;
+	if(springAllocator != NULL) {
+		springAllocator->destroy(springs);
+
+	} else {
+		BOOST_FOREACH(Spring* s, springs) {
+			delete s;
+		}
+		springs.clear();
 	}
-	springs.clear();
 
 	numAllocatedSprings = 0;
 	numActiveSprings = 0;
+	nextFreeSpring = 0;
 }
 
 // -- Setters -----------------------------------------------------------------
+// changing an allocator destroys all elements it created so far,
+// springs and the space point to those particles so they're emptied as well
 void Physics::setParticleAllocator(ParticleAllocator* strategy )
 {
 	if(particleAllocator != NULL) {
+		destroySprings();
+		destroyParticles();
+		if(space != NULL)
+			space->clear();
 		delete particleAllocator;
 	}
 	particleAllocator = strategy;
@@ -286,6 +439,7 @@ void Physics::setParticleAllocator(ParticleAllocator* strategy )
 void Physics::setSpringAllocator(SpringAllocator* strategy )
 {
 	if(springAllocator != NULL) {
+		destroySprings();
 		delete springAllocator;
 	}
 	springAllocator = strategy;
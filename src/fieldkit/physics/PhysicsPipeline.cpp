@@ -0,0 +1,146 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#include "fieldkit/physics/PhysicsPipeline.h"
+
+#include <algorithm>
+#include "fieldkit/physics/Physics.h"
+#include "fieldkit/physics/Particle.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit::physics;
+
+// -- Frame --------------------------------------------------------------------
+void PhysicsFrame::capture(Physics* physics, boost::uint32_t index)
+{
+	this->index = index;
+
+	// only grows, so a warmed up pipeline doesnt allocate
+	int numSlots = physics->particles.size();
+	if((int)positions.size() < numSlots) {
+		positions.resize(numSlots);
+		ages.resize(numSlots);
+	}
+
+	int n = 0;
+	for(int i=0; i<numSlots; i++) {
+		Particle* p = physics->particles[i];
+		if(!p->isAlive) continue;
+		positions[n] = p->position;
+		ages[n] = p->age;
+		n++;
+	}
+	numParticles = n;
+}
+
+int PhysicsFrame::fill(float* result, int stride, int capacity) const
+{
+	int n = std::min(numParticles, capacity);
+	for(int i=0; i<n; i++) {
+		Vec3f const& p = positions[i];
+		result[0] = p.x;
+		result[1] = p.y;
+		result[2] = p.z;
+		result += stride;
+	}
+	return n;
+}
+
+
+// -- Pipeline -----------------------------------------------------------------
+PhysicsPipeline::PhysicsPipeline(Physics* physics) :
+	physics(physics), numSteps(0), numSkipped(0),
+	isRequested(false), isBusy(false), quit(false), requestedDt(0.0f)
+{
+}
+
+PhysicsPipeline::~PhysicsPipeline()
+{
+	stop();
+}
+
+void PhysicsPipeline::start()
+{
+	if(isRunning()) return;
+
+	quit = false;
+	boost::thread t(&PhysicsPipeline::threadMainThunk, this);
+	thread.swap(t);
+}
+
+void PhysicsPipeline::stop()
+{
+	if(!isRunning()) return;
+
+	wait();
+	{
+		boost::mutex::scoped_lock scopedLock(lock);
+		quit = true;
+		condition.notify_all();
+	}
+	thread.join();
+}
+
+void PhysicsPipeline::update(float dt)
+{
+	boost::mutex::scoped_lock scopedLock(lock);
+	if(isRequested)
+		numSkipped++;
+
+	isRequested = true;
+	requestedDt = dt;
+	condition.notify_all();
+}
+
+void PhysicsPipeline::wait()
+{
+	boost::mutex::scoped_lock scopedLock(lock);
+	while((isRequested || isBusy) && thread.joinable())
+		condition.wait(scopedLock);
+}
+
+PhysicsFrame const& PhysicsPipeline::acquire()
+{
+	frames.acquire();
+	return frames.getFront();
+}
+
+void PhysicsPipeline::threadMainThunk(PhysicsPipeline* pipeline)
+{
+	pipeline->threadMain();
+}
+
+void PhysicsPipeline::threadMain()
+{
+	while(true) {
+		float dt;
+		{
+			boost::mutex::scoped_lock scopedLock(lock);
+			while(!isRequested && !quit)
+				condition.wait(scopedLock);
+			if(quit) break;
+
+			dt = requestedDt;
+			isRequested = false;
+			isBusy = true;
+		}
+
+		physics->update(dt);
+		numSteps++;
+
+		{
+			PROFILE_SCOPE("pipeline.publish");
+			frames.getBack().capture(physics, numSteps);
+			frames.publish();
+		}
+
+		boost::mutex::scoped_lock scopedLock(lock);
+		isBusy = false;
+		condition.notify_all();
+	}
+}
@@ -0,0 +1,461 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#include "fieldkit/physics/Recorder.h"
+#include "fieldkit/physics/FrameCodec.h"
+
+#include <fstream>
+#include <cstring>
+#include <boost/thread.hpp>
+
+#include "fieldkit/physics/Physics.h"
+#include "fieldkit/physics/Particle.h"
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace fieldkit::physics;
+
+namespace {
+	const boost::uint32_t MAGIC = 0x52504b46; // 'FKPR'
+	const boost::uint32_t VERSION = 2;
+
+	template<typename T>
+	T readValue(const boost::uint8_t*& data, const boost::uint8_t* end)
+	{
+		if((size_t)(end - data) < sizeof(T))
+			throw "ParticlePlayback: corrupt frame data";
+		T value;
+		memcpy(&value, data, sizeof(T));
+		data += sizeof(T);
+		return value;
+	}
+}
+
+
+// -- ParticleFrame ------------------------------------------------------------
+void ParticleFrame::resize(int numSlots)
+{
+	positions.resize(numSlots);
+	ages.resize(numSlots);
+	alive.resize(numSlots);
+}
+
+void ParticleFrame::capture(Physics* physics)
+{
+	int numSlots = physics->particles.size();
+	resize(numSlots);
+
+	for(int i=0; i<numSlots; i++) {
+		Particle* p = physics->particles[i];
+		positions[i] = p->position;
+		ages[i] = p->age;
+		alive[i] = p->isAlive;
+	}
+}
+
+void ParticleFrame::swap(ParticleFrame& other)
+{
+	positions.swap(other.positions);
+	ages.swap(other.ages);
+	alive.swap(other.alive);
+}
+
+
+// -- Worker -------------------------------------------------------------------
+namespace fieldkit { namespace physics {
+
+	//! Encodes and writes recorded frames on its own thread
+	class RecorderWorker {
+	public:
+		RecorderWorker(std::string const& path, AABB const& bounds, int keyframeInterval) : 
+			encoder(bounds), keyframeInterval(keyframeInterval), 
+			quit(false), isAvailable(true), frameIndex(0), offset(0)
+		{
+			out.open(path.c_str(), std::ios::binary);
+			if(!out)
+				throw "ParticleRecorder: couldn't open file for writing";
+
+			write(MAGIC);
+			write(VERSION);
+			write((boost::int32_t)keyframeInterval);
+			write(bounds.min);
+			write(bounds.max);
+		}
+
+		~RecorderWorker() 
+		{
+			finish();
+		}
+
+		void start()
+		{
+			boost::thread t(&RecorderWorker::threadMainThunk, this);
+			thread.swap(t);
+		}
+
+		//! waits until the previous frame is written, returns true if it had to wait
+		bool waitUntilAvailable()
+		{
+			boost::mutex::scoped_lock scopedLock(lock);
+			bool hasWaited = false;
+			while(!isAvailable) {
+				condition.wait(scopedLock);
+				hasWaited = true;
+			}
+			return hasWaited;
+		}
+
+		//! takes over the contents of the given frame and leaves it with the previous buffer
+		void process(ParticleFrame& next)
+		{
+			boost::mutex::scoped_lock scopedLock(lock);
+			frame.swap(next);
+			isAvailable = false;
+			condition.notify_all();
+		}
+
+		//! writes the remaining frame, stops the thread and writes the frame index
+		void finish()
+		{
+			if(!thread.joinable()) return;
+
+			waitUntilAvailable();
+			{
+				boost::mutex::scoped_lock scopedLock(lock);
+				quit = true;
+				condition.notify_all();
+			}
+			thread.join();
+
+			for(size_t i=0; i<offsets.size(); i++)
+				write(offsets[i]);
+			write((boost::uint32_t)offsets.size());
+			write(MAGIC);
+			out.close();
+		}
+
+		static void threadMainThunk(RecorderWorker* worker)
+		{
+			worker->threadMain();
+		}
+
+		void threadMain()
+		{
+			while(true) {
+				{
+					boost::mutex::scoped_lock scopedLock(lock);
+					while(isAvailable && !quit)
+						condition.wait(scopedLock);
+					if(quit) break;
+				}
+
+				// do the work
+				bool isKeyframe = frameIndex % keyframeInterval == 0;
+				encoder.encode(frame, isKeyframe, buffer);
+
+				offsets.push_back(offset);
+				write((boost::uint32_t)buffer.size());
+				out.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size());
+				offset += buffer.size();
+				frameIndex++;
+
+				boost::mutex::scoped_lock scopedLock(lock);
+				isAvailable = true;
+				condition.notify_all();
+			}
+		}
+
+	private:
+		FrameCodec encoder;
+		int keyframeInterval;
+
+		bool quit;
+		bool isAvailable;
+		boost::mutex lock;
+		boost::condition_variable condition;
+		boost::thread thread;
+
+		ParticleFrame frame;
+		std::ofstream out;
+		int frameIndex;
+		boost::uint64_t offset;
+		std::vector<boost::uint64_t> offsets;
+
+		std::vector<boost::uint8_t> buffer;
+
+		template<typename T>
+		void write(T const& value)
+		{
+			out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+			offset += sizeof(T);
+		}
+	};
+
+
+	// -- Memory mapped file ---------------------------------------------------
+	class MappedFile {
+	public:
+		MappedFile(std::string const& path) : data(NULL), size(0)
+		{
+#ifdef _WIN32
+			file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if(file == INVALID_HANDLE_VALUE)
+				throw "MappedFile: couldn't open file";
+
+			LARGE_INTEGER fileSize;
+			GetFileSizeEx(file, &fileSize);
+			size = (size_t)fileSize.QuadPart;
+
+			mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if(mapping != NULL)
+				data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+			fd = ::open(path.c_str(), O_RDONLY);
+			if(fd < 0)
+				throw "MappedFile: couldn't open file";
+
+			struct stat info;
+			fstat(fd, &info);
+			size = info.st_size;
+
+			data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(data == MAP_FAILED)
+				data = NULL;
+#endif
+			if(data == NULL) {
+				unmap();
+				throw "MappedFile: couldn't map file";
+			}
+		}
+
+		~MappedFile()
+		{
+			unmap();
+		}
+
+		const boost::uint8_t* getData() { return static_cast<const boost::uint8_t*>(data); }
+		size_t getSize() { return size; }
+
+	private:
+		void* data;
+		size_t size;
+
+#ifdef _WIN32
+		HANDLE file;
+		HANDLE mapping;
+
+		void unmap()
+		{
+			if(data != NULL) UnmapViewOfFile(data);
+			if(mapping != NULL) CloseHandle(mapping);
+			CloseHandle(file);
+		}
+#else
+		int fd;
+
+		void unmap()
+		{
+			if(data != NULL) munmap(data, size);
+			::close(fd);
+		}
+#endif
+	};
+
+} } // namespace fieldkit::physics
+
+
+// -- Recorder -----------------------------------------------------------------
+ParticleRecorder::ParticleRecorder() : 
+	worker(NULL), numFrames(0), numStalls(0)
+{
+}
+
+ParticleRecorder::~ParticleRecorder()
+{
+	close();
+}
+
+void ParticleRecorder::open(std::string const& path, AABB const& bounds, int keyframeInterval)
+{
+	close();
+
+	if(keyframeInterval < 1)
+		throw "ParticleRecorder: keyframeInterval needs to be at least 1";
+
+	numFrames = 0;
+	numStalls = 0;
+	worker = new RecorderWorker(path, bounds, keyframeInterval);
+	worker->start();
+}
+
+void ParticleRecorder::record(Physics* physics)
+{
+	if(worker == NULL)
+		throw "ParticleRecorder: open a file before recording";
+
+	// fill the free buffer while the worker might still be writing the last frame
+	frame.capture(physics);
+
+	if(worker->waitUntilAvailable())
+		numStalls++;
+
+	worker->process(frame);
+	numFrames++;
+}
+
+void ParticleRecorder::close()
+{
+	if(worker == NULL) return;
+
+	worker->finish();
+	delete worker;
+	worker = NULL;
+}
+
+
+// -- Playback -----------------------------------------------------------------
+ParticlePlayback::ParticlePlayback() :
+	file(NULL), keyframeInterval(1), currentFrame(-1)
+{
+}
+
+ParticlePlayback::~ParticlePlayback()
+{
+	close();
+}
+
+void ParticlePlayback::open(std::string const& path)
+{
+	close();
+	file = new MappedFile(path);
+
+	try {
+		readIndex();
+	} catch(...) {
+		close();
+		throw;
+	}
+	currentFrame = -1;
+}
+
+void ParticlePlayback::readIndex()
+{
+	const boost::uint8_t* data = file->getData();
+	const boost::uint8_t* end = data + file->getSize();
+
+	// header
+	if(readValue<boost::uint32_t>(data, end) != MAGIC)
+		throw "ParticlePlayback: not a particle recording";
+	if(readValue<boost::uint32_t>(data, end) != VERSION)
+		throw "ParticlePlayback: unsupported recording version";
+
+	keyframeInterval = readValue<boost::int32_t>(data, end);
+	if(keyframeInterval < 1)
+		throw "ParticlePlayback: corrupt keyframe interval";
+
+	Vec3f min = readValue<Vec3f>(data, end);
+	Vec3f max = readValue<Vec3f>(data, end);
+	bounds.set(min, max);
+	decoder.setBounds(bounds);
+
+	// frame index at the end of the file, checked in byte counts so corrupt sizes cant point outside of the file
+	size_t fileSize = file->getSize();
+	size_t headerSize = data - file->getData();
+	size_t footerSize = 2 * sizeof(boost::uint32_t);
+	if(fileSize - headerSize < footerSize)
+		throw "ParticlePlayback: recording wasn't closed properly";
+
+	const boost::uint8_t* footer = end - footerSize;
+	boost::uint32_t numFrames = readValue<boost::uint32_t>(footer, end);
+	if(readValue<boost::uint32_t>(footer, end) != MAGIC)
+		throw "ParticlePlayback: recording wasn't closed properly";
+
+	if(numFrames > (fileSize - headerSize - footerSize) / sizeof(boost::uint64_t))
+		throw "ParticlePlayback: corrupt frame index";
+
+	const boost::uint8_t* index = end - footerSize - numFrames * sizeof(boost::uint64_t);
+	offsets.resize(numFrames);
+	if(numFrames > 0)
+		memcpy(&offsets[0], index, numFrames * sizeof(boost::uint64_t));
+
+	// every frame is its size followed by the encoded data
+	for(size_t i=0; i<offsets.size(); i++) {
+		boost::uint64_t offset = offsets[i];
+		if(offset > fileSize || fileSize - offset < sizeof(boost::uint32_t))
+			throw "ParticlePlayback: corrupt frame index";
+
+		boost::uint32_t size;
+		memcpy(&size, file->getData() + offset, sizeof(size));
+		if(size > fileSize - offset - sizeof(boost::uint32_t))
+			throw "ParticlePlayback: corrupt frame data";
+	}
+}
+
+void ParticlePlayback::close()
+{
+	if(file != NULL) {
+		delete file;
+		file = NULL;
+	}
+	offsets.clear();
+	currentFrame = -1;
+}
+
+void ParticlePlayback::seek(int frame)
+{
+	if(file == NULL)
+		throw "ParticlePlayback: open a recording before reading";
+	if(frame < 0 || frame >= getNumFrames())
+		throw "ParticlePlayback: frame out of range";
+
+	// continue decoding from the current frame when possible, otherwise start at the last keyframe
+	int keyframe = frame - frame % keyframeInterval;
+	int start = (currentFrame >= keyframe && currentFrame < frame) ? currentFrame + 1 : keyframe;
+
+	// frames in between only need to update the decoder state
+	for(int i=start; i<frame; i++) {
+		boost::uint32_t size;
+		const boost::uint8_t* data = getFrameData(i, size);
+		decoder.decode(data, size, scratch);
+	}
+}
+
+void ParticlePlayback::read(int frame, ParticleFrame& result)
+{
+	seek(frame);
+
+	boost::uint32_t size;
+	const boost::uint8_t* data = getFrameData(frame, size);
+	decoder.decode(data, size, result);
+	currentFrame = frame;
+}
+
+int ParticlePlayback::readPositions(int frame, float* result, int stride, int capacity)
+{
+	seek(frame);
+
+	boost::uint32_t size;
+	const boost::uint8_t* data = getFrameData(frame, size);
+	int count = decoder.decodePositions(data, size, result, stride, capacity);
+	currentFrame = frame;
+	return count;
+}
+
+const boost::uint8_t* ParticlePlayback::getFrameData(int frame, boost::uint32_t& size)
+{
+	// open checked that the frame lies within the file
+	const boost::uint8_t* data = file->getData() + offsets[frame];
+	memcpy(&size, data, sizeof(size));
+	return data + sizeof(size);
+}
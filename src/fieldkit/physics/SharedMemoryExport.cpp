@@ -0,0 +1,333 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#include "fieldkit/physics/SharedMemoryExport.h"
+
+#include <new>
+#include <algorithm>
+#include <boost/static_assert.hpp>
+#include "fieldkit/physics/Physics.h"
+#include "fieldkit/physics/Particle.h"
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <errno.h>
+#endif
+
+using namespace fieldkit::physics;
+
+// readers without FieldKit rely on the atomics being plain 32 bit integers
+BOOST_STATIC_ASSERT(sizeof(boost::atomic<boost::uint32_t>) == 4);
+BOOST_STATIC_ASSERT(BOOST_ATOMIC_INT32_LOCK_FREE == 2);
+
+namespace {
+	const int NUM_ARRAYS = 5;
+	const size_t ALIGNMENT = 64;
+
+	size_t align(size_t size) 
+	{
+		return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+}
+
+namespace fieldkit { namespace physics {
+
+	//! A named block of memory shared between processes
+	class SharedMemoryBlock {
+	public:
+		//! creates a writable block, fails if a block with that name exists unless replace is set
+		SharedMemoryBlock(std::string const& name, size_t size, bool replace) : 
+			name(name), data(NULL), size(size), isOwner(true)
+		{
+#ifdef _WIN32
+			// the system keeps a mapping while any process has a handle, so it can't be replaced
+			handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 
+										(DWORD)((boost::uint64_t)size >> 32), (DWORD)size, getWin32Name().c_str());
+			if(handle == NULL)
+				throw "SharedMemoryBlock: couldn't create shared memory";
+
+			if(GetLastError() == ERROR_ALREADY_EXISTS) {
+				CloseHandle(handle);
+				throw "SharedMemoryBlock: shared memory with this name is in use by another process";
+			}
+			data = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else
+			// a block left behind by a crashed exporter is only removed when asked to
+			if(replace)
+				shm_unlink(name.c_str());
+
+			fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+			if(fd < 0 && errno == EEXIST)
+				throw "SharedMemoryBlock: shared memory with this name already exists";
+			if(fd < 0)
+				throw "SharedMemoryBlock: couldn't create shared memory";
+
+			if(ftruncate(fd, size) != 0) {
+				unmap();
+				throw "SharedMemoryBlock: couldn't resize shared memory";
+			}
+
+			data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if(data == MAP_FAILED)
+				data = NULL;
+#endif
+			if(data == NULL) {
+				unmap();
+				throw "SharedMemoryBlock: couldn't map shared memory";
+			}
+		}
+
+		//! opens an existing block read-only
+		SharedMemoryBlock(std::string const& name) : 
+			name(name), data(NULL), size(0), isOwner(false)
+		{
+#ifdef _WIN32
+			handle = OpenFileMappingA(FILE_MAP_READ, FALSE, getWin32Name().c_str());
+			if(handle == NULL)
+				throw "SharedMemoryBlock: couldn't open shared memory";
+
+			data = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+			if(data != NULL) {
+				MEMORY_BASIC_INFORMATION info;
+				VirtualQuery(data, &info, sizeof(info));
+				size = info.RegionSize;
+			}
+#else
+			fd = shm_open(name.c_str(), O_RDONLY, 0);
+			if(fd < 0)
+				throw "SharedMemoryBlock: couldn't open shared memory";
+
+			struct stat info;
+			fstat(fd, &info);
+			size = info.st_size;
+
+			data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+			if(data == MAP_FAILED)
+				data = NULL;
+#endif
+			if(data == NULL) {
+				unmap();
+				throw "SharedMemoryBlock: couldn't map shared memory";
+			}
+		}
+
+		~SharedMemoryBlock()
+		{
+			unmap();
+		}
+
+		void* getData() { return data; }
+		size_t getSize() { return size; }
+
+	private:
+		std::string name;
+		void* data;
+		size_t size;
+		bool isOwner;
+
+#ifdef _WIN32
+		HANDLE handle;
+
+		//! the system removes the mapping when its last handle is closed
+		void unmap()
+		{
+			if(data != NULL) UnmapViewOfFile(data);
+			if(handle != NULL) CloseHandle(handle);
+		}
+
+		//! names in the local namespace dont have the leading slash
+		std::string getWin32Name()
+		{
+			return "Local\\" + (name.size() > 0 && name[0] == '/' ? name.substr(1) : name);
+		}
+#else
+		int fd;
+
+		void unmap()
+		{
+			if(data != NULL) munmap(data, size);
+			if(fd >= 0) ::close(fd);
+			if(isOwner) shm_unlink(name.c_str());
+		}
+#endif
+	};
+
+} } // namespace fieldkit::physics
+
+
+// -- Export -------------------------------------------------------------------
+size_t SharedMemoryExport::getSize(int capacity)
+{
+	return getArrayOffset(capacity, 2, 0);
+}
+
+size_t SharedMemoryExport::getArrayOffset(int capacity, int buffer, int array)
+{
+	size_t arraySize = align(capacity * sizeof(float));
+	return align(sizeof(SharedParticleHeader)) + (buffer * NUM_ARRAYS + array) * arraySize;
+}
+
+SharedMemoryExport::SharedMemoryExport(std::string const& name, int capacity, bool replace) :
+	block(NULL), header(NULL), capacity(capacity), frame(0), numDropped(0)
+{
+	if(capacity < 1)
+		throw "SharedMemoryExport: capacity needs to be at least 1";
+
+	block = new SharedMemoryBlock(name, getSize(capacity), replace);
+	header = new(block->getData()) SharedParticleHeader();
+
+	header->magic = MAGIC;
+	header->version = VERSION;
+	header->capacity = capacity;
+	header->bufferSize = getArrayOffset(capacity, 1, 0) - getArrayOffset(capacity, 0, 0);
+	header->frame.store(0);
+	header->latest.store(0);
+
+	for(int b=0; b<2; b++) {
+		header->buffers[b].sequence.store(0);
+		header->buffers[b].frame = 0;
+		header->buffers[b].numParticles = 0;
+		header->buffers[b].reserved = 0;
+	}
+}
+
+SharedMemoryExport::~SharedMemoryExport()
+{
+	if(block != NULL) {
+		delete block;
+		block = NULL;
+	}
+}
+
+void SharedMemoryExport::publish(Physics* physics)
+{
+	// only this process ever changes latest, so the other buffer is free
+	int b = 1 - header->latest.load(boost::memory_order_relaxed);
+	SharedParticleBuffer& buffer = header->buffers[b];
+
+	boost::uint32_t sequence = buffer.sequence.load(boost::memory_order_relaxed);
+	buffer.sequence.store(sequence + 1, boost::memory_order_relaxed);
+	boost::atomic_thread_fence(boost::memory_order_release);
+
+	char* data = static_cast<char*>(block->getData());
+	float* x = reinterpret_cast<float*>(data + getArrayOffset(capacity, b, 0));
+	float* y = reinterpret_cast<float*>(data + getArrayOffset(capacity, b, 1));
+	float* z = reinterpret_cast<float*>(data + getArrayOffset(capacity, b, 2));
+	float* ages = reinterpret_cast<float*>(data + getArrayOffset(capacity, b, 3));
+	boost::int32_t* ids = reinterpret_cast<boost::int32_t*>(data + getArrayOffset(capacity, b, 4));
+
+	int n = 0;
+	numDropped = 0;
+	int numSlots = physics->particles.size();
+	for(int i=0; i<numSlots; i++) {
+		Particle* p = physics->particles[i];
+		if(!p->isAlive) continue;
+
+		if(n == capacity) {
+			numDropped++;
+			continue;
+		}
+
+		x[n] = p->position.x;
+		y[n] = p->position.y;
+		z[n] = p->position.z;
+		ages[n] = p->age;
+		ids[n] = p->id;
+		n++;
+	}
+
+	frame++;
+	buffer.frame = frame;
+	buffer.numParticles = n;
+	buffer.sequence.store(sequence + 2, boost::memory_order_release);
+
+	header->latest.store(b, boost::memory_order_release);
+	header->frame.store(frame, boost::memory_order_release);
+}
+
+
+// -- Reader -------------------------------------------------------------------
+SharedMemoryReader::SharedMemoryReader(std::string const& name) :
+	block(NULL), header(NULL), capacity(0)
+{
+	block = new SharedMemoryBlock(name);
+	header = static_cast<const SharedParticleHeader*>(block->getData());
+
+	if(block->getSize() < sizeof(SharedParticleHeader) || header->magic != SharedMemoryExport::MAGIC) {
+		delete block;
+		throw "SharedMemoryReader: not a particle export";
+	}
+
+	if(header->version != SharedMemoryExport::VERSION) {
+		delete block;
+		throw "SharedMemoryReader: unsupported export version";
+	}
+
+	capacity = header->capacity;
+	if(block->getSize() < SharedMemoryExport::getSize(capacity)) {
+		delete block;
+		throw "SharedMemoryReader: shared memory is smaller than expected";
+	}
+}
+
+SharedMemoryReader::~SharedMemoryReader()
+{
+	if(block != NULL) {
+		delete block;
+		block = NULL;
+	}
+}
+
+boost::uint32_t SharedMemoryReader::getFrame()
+{
+	return header->frame.load(boost::memory_order_acquire);
+}
+
+bool SharedMemoryReader::acquire(SharedParticleView& view)
+{
+	const char* data = static_cast<const char*>(block->getData());
+
+	// only fails repeatedly when the writer keeps lapping this reader
+	for(int attempt=0; attempt<100; attempt++) {
+		if(header->frame.load(boost::memory_order_acquire) == 0)
+			return false;
+
+		int b = header->latest.load(boost::memory_order_acquire) & 1;
+		const SharedParticleBuffer& buffer = header->buffers[b];
+
+		boost::uint32_t sequence = buffer.sequence.load(boost::memory_order_acquire);
+		if(sequence & 1) continue;
+
+		view.buffer = b;
+		view.sequence = sequence;
+		view.frame = buffer.frame;
+		view.numParticles = std::min(std::max((int)buffer.numParticles, 0), capacity);
+
+		boost::atomic_thread_fence(boost::memory_order_acquire);
+		if(buffer.sequence.load(boost::memory_order_relaxed) != sequence) continue;
+
+		view.x = reinterpret_cast<const float*>(data + SharedMemoryExport::getArrayOffset(capacity, b, 0));
+		view.y = reinterpret_cast<const float*>(data + SharedMemoryExport::getArrayOffset(capacity, b, 1));
+		view.z = reinterpret_cast<const float*>(data + SharedMemoryExport::getArrayOffset(capacity, b, 2));
+		view.ages = reinterpret_cast<const float*>(data + SharedMemoryExport::getArrayOffset(capacity, b, 3));
+		view.ids = reinterpret_cast<const boost::int32_t*>(data + SharedMemoryExport::getArrayOffset(capacity, b, 4));
+		return true;
+	}
+	return false;
+}
+
+bool SharedMemoryReader::isValid(SharedParticleView const& view)
+{
+	boost::atomic_thread_fence(boost::memory_order_acquire);
+	return header->buffers[view.buffer].sequence.load(boost::memory_order_relaxed) == view.sequence;
+}
@@ -0,0 +1,495 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#include "fieldkit/physics/Snapshot.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <list>
+
+#include "fieldkit/physics/Physics.h"
+#include "fieldkit/physics/Particle.h"
+#include "fieldkit/physics/Spring.h"
+#include "fieldkit/physics/Emitter.h"
+#include "fieldkit/physics/FrameCodec.h"
+#include "fieldkit/physics/strategy/NeighbourUpdate.h"
+
+using namespace fieldkit::physics;
+
+namespace {
+	enum ParticleFlags {
+		FLAG_ALIVE = 1,
+		FLAG_LOCKED = 2,
+		FLAG_IGNORE_CONSTRAINTS = 4
+	};
+
+	enum SpringFlags {
+		FLAG_A_LOCKED = 2,
+		FLAG_B_LOCKED = 4
+	};
+
+	//! byte planes are formed per 32 bit component, so vectors compress like their floats
+	template<typename T>
+	int getElementSize()
+	{
+		return sizeof(T) % 4 == 0 ? 4 : sizeof(T);
+	}
+
+	//! writes arrays either raw or compressed with FrameCodec::compress, prefixed by their compressed size
+	class ArrayWriter {
+	public:
+		ArrayWriter(SnapshotWriter& out, bool isCompressed) : 
+			out(out), isCompressed(isCompressed) {}
+
+		template<typename T>
+		void write(std::vector<T> const& values)
+		{
+			out.align();
+			if(values.empty()) return;
+
+			size_t size = sizeof(T) * values.size();
+			if(isCompressed) {
+				FrameCodec::compress(&values[0], size, getElementSize<T>(), buffer);
+				out.write((boost::uint32_t)buffer.size());
+				out.write(&buffer[0], buffer.size());
+			} else {
+				out.write(&values[0], size);
+			}
+		}
+
+	protected:
+		SnapshotWriter& out;
+		bool isCompressed;
+		std::vector<boost::uint8_t> buffer;
+	};
+
+	//! returns arrays straight from the snapshot data or decompressed into buffers owned by the reader
+	class ArrayReader {
+	public:
+		ArrayReader(SnapshotReader& in, bool isCompressed) : 
+			in(in), isCompressed(isCompressed) {}
+
+		template<typename T>
+		const T* read(int count)
+		{
+			in.align();
+			size_t size = sizeof(T) * count;
+			if(!isCompressed)
+				return reinterpret_cast<const T*>(in.skip(size));
+
+			if(count == 0) return NULL;
+
+			boost::uint32_t compressedSize;
+			in.read(compressedSize);
+			const char* data = in.skip(compressedSize);
+
+			// list elements dont move, so earlier arrays stay valid
+			buffers.push_back(std::vector<char>(size));
+			char* result = &buffers.back()[0];
+			FrameCodec::decompress(reinterpret_cast<const boost::uint8_t*>(data), compressedSize, 
+								   result, size, getElementSize<T>());
+			return reinterpret_cast<const T*>(result);
+		}
+
+	protected:
+		SnapshotReader& in;
+		bool isCompressed;
+		std::list<std::vector<char> > buffers;
+	};
+
+	typedef std::pair<Particle*, int> ParticleIndex;
+
+	//! looks up the index of a particle in a list sorted by particle address
+	int findIndex(std::vector<ParticleIndex> const& indices, Particle* p)
+	{
+		if(p == NULL) return -1;
+		std::vector<ParticleIndex>::const_iterator it = std::lower_bound(indices.begin(), indices.end(), ParticleIndex(p, 0));
+		if(it == indices.end() || it->first != p)
+			throw "Snapshot: spring references a particle that isn't part of this physics";
+		return it->second;
+	}
+}
+
+// -- Save ---------------------------------------------------------------------
+void Snapshot::save(Physics* physics, std::ostream& out, bool compress)
+{
+	SnapshotWriter writer(out);
+
+	int numParticles = physics->particles.size();
+	int numSprings = physics->springs.size();
+	Emitter* emitter = physics->emitter;
+
+	// header
+	boost::uint32_t magic = MAGIC;
+	boost::uint32_t version = VERSION;
+	writer.write(magic);
+	writer.write(version);
+	writer.write(numParticles);
+	writer.write(numSprings);
+	writer.write(physics->nextID);
+	writer.write(physics->nextFreeParticle);
+	writer.write(physics->nextFreeSpring);
+	writer.write((boost::int32_t)(emitter != NULL));
+	writer.write((boost::int32_t)compress);
+
+	// emitter
+	if(emitter != NULL) {
+		writer.write(emitter->position);
+		writer.write(emitter->rate);
+		writer.write(emitter->max);
+		writer.write(emitter->interval);
+		writer.write(emitter->time);
+		writer.write((boost::uint8_t)emitter->isEnabled);
+		writeBehaviours(writer, emitter);
+	}
+
+	writeBehaviours(writer, physics);
+
+	ArrayWriter arrays(writer, compress);
+
+	// particles, gathered in a single pass over the pool
+	std::vector<Vec3f> position(numParticles), prev(numParticles), force(numParticles);
+	std::vector<float> age(numParticles), lifeTime(numParticles), weight(numParticles);
+	std::vector<float> invWeight(numParticles), drag(numParticles), size(numParticles);
+	std::vector<boost::int32_t> state(numParticles), id(numParticles);
+	std::vector<boost::uint8_t> flags(numParticles);
+
+	for(int i=0; i<numParticles; i++) {
+		Particle* p = physics->particles[i];
+		position[i] = p->position;
+		prev[i] = p->prev;
+		force[i] = p->force;
+		age[i] = p->age;
+		lifeTime[i] = p->lifeTime;
+		weight[i] = p->weight;
+		invWeight[i] = p->invWeight;
+		drag[i] = p->drag;
+		size[i] = p->size;
+		state[i] = p->state;
+		id[i] = p->id;
+		flags[i] = (p->isAlive ? FLAG_ALIVE : 0) | 
+			(p->isLocked ? FLAG_LOCKED : 0) | 
+			(p->ignoreConstraints ? FLAG_IGNORE_CONSTRAINTS : 0);
+	}
+
+	arrays.write(position);
+	arrays.write(prev);
+	arrays.write(force);
+	arrays.write(age);
+	arrays.write(lifeTime);
+	arrays.write(weight);
+	arrays.write(invWeight);
+	arrays.write(drag);
+	arrays.write(size);
+	arrays.write(state);
+	arrays.write(id);
+	arrays.write(flags);
+
+	// springs
+	if(numSprings > 0) {
+		std::vector<ParticleIndex> indices(numParticles);
+		for(int i=0; i<numParticles; i++)
+			indices[i] = ParticleIndex(physics->particles[i], i);
+		std::sort(indices.begin(), indices.end());
+
+		std::vector<boost::int32_t> a(numSprings), b(numSprings), springID(numSprings);
+		std::vector<float> restLength(numSprings), strength(numSprings);
+		std::vector<boost::uint8_t> springFlags(numSprings);
+
+		for(int i=0; i<numSprings; i++) {
+			Spring* s = physics->springs[i];
+			a[i] = findIndex(indices, s->a);
+			b[i] = findIndex(indices, s->b);
+			springID[i] = s->id;
+			restLength[i] = s->restLength;
+			strength[i] = s->strength;
+			springFlags[i] = (s->isAlive ? FLAG_ALIVE : 0) | 
+				(s->isALocked ? FLAG_A_LOCKED : 0) | 
+				(s->isBLocked ? FLAG_B_LOCKED : 0);
+		}
+
+		arrays.write(a);
+		arrays.write(b);
+		arrays.write(springID);
+		arrays.write(restLength);
+		arrays.write(strength);
+		arrays.write(springFlags);
+	}
+	writer.align();
+}
+
+void Snapshot::save(Physics* physics, std::string const& path, bool compress)
+{
+	std::ofstream out(path.c_str(), std::ios::binary);
+	if(!out)
+		throw "Snapshot::save couldn't open file for writing";
+	save(physics, out, compress);
+}
+
+void Snapshot::writeBehaviours(SnapshotWriter& out, Behavioural* behavioural)
+{
+	// every entry is prefixed with its size so readers can skip behaviours they dont know
+	std::list<Behaviour*> all(behavioural->behaviours.begin(), behavioural->behaviours.end());
+	all.insert(all.end(), behavioural->constraints.begin(), behavioural->constraints.end());
+
+	out.write((boost::int32_t)all.size());
+	for(std::list<Behaviour*>::iterator it = all.begin(); it != all.end(); ++it) {
+		std::ostringstream buffer;
+		SnapshotWriter behaviourWriter(buffer);
+		(*it)->write(behaviourWriter);
+
+		std::string data = buffer.str();
+		out.write((boost::uint32_t)data.size());
+		out.write(data.data(), data.size());
+	}
+}
+
+
+// -- Load ---------------------------------------------------------------------
+void Snapshot::load(Physics* physics, const void* data, size_t size)
+{
+	SnapshotReader reader(data, size);
+
+	// everything is read and checked before the physics is touched, 
+	// so a broken snapshot leaves it as it was
+	
+	// header
+	boost::uint32_t magic, version;
+	reader.read(magic);
+	reader.read(version);
+
+	if(magic != MAGIC) 
+		throw "Snapshot::load data isn't a snapshot or was saved on a machine with different byte order";
+	if(version < 1 || version > VERSION) 
+		throw "Snapshot::load unsupported snapshot version";
+
+	boost::int32_t numParticles, numSprings, nextID, nextFreeParticle, nextFreeSpring, hasEmitter;
+	reader.read(numParticles);
+	reader.read(numSprings);
+	reader.read(nextID);
+	reader.read(nextFreeParticle);
+	reader.read(nextFreeSpring);
+	reader.read(hasEmitter);
+
+	if(numParticles < 0 || numSprings < 0)
+		throw "Snapshot::load negative number of particles or springs";
+
+	// the search for free slots continues at these indices, the pool size itself is valid too
+	if(nextFreeParticle < 0 || nextFreeParticle > numParticles ||
+	   nextFreeSpring < 0 || nextFreeSpring > numSprings)
+		throw "Snapshot::load next free particle or spring outside of the snapshot";
+
+	// version 1 snapshots are never compressed
+	boost::int32_t isCompressed = 0;
+	if(version >= 2)
+		reader.read(isCompressed);
+
+	// emitter
+	Emitter* emitter = physics->emitter;
+	if(hasEmitter && emitter == NULL)
+		throw "Snapshot::load snapshot contains an emitter but physics has none";
+
+	Vec3f emitterPosition;
+	boost::int32_t emitterRate = 0, emitterMax = 0;
+	float emitterInterval = 0.0f, emitterTime = 0.0f;
+	boost::uint8_t emitterIsEnabled = 0;
+	std::vector<SnapshotReader> emitterBehaviours;
+
+	if(hasEmitter) {
+		reader.read(emitterPosition);
+		reader.read(emitterRate);
+		reader.read(emitterMax);
+		reader.read(emitterInterval);
+		reader.read(emitterTime);
+		reader.read(emitterIsEnabled);
+		readBehaviours(reader, emitter, emitterBehaviours);
+	}
+
+	std::vector<SnapshotReader> physicsBehaviours;
+	readBehaviours(reader, physics, physicsBehaviours);
+
+	ArrayReader arrays(reader, isCompressed != 0);
+
+	// particles
+	const Vec3f* position = arrays.read<Vec3f>(numParticles);
+	const Vec3f* prev = arrays.read<Vec3f>(numParticles);
+	const Vec3f* force = arrays.read<Vec3f>(numParticles);
+	const float* age = arrays.read<float>(numParticles);
+	const float* lifeTime = arrays.read<float>(numParticles);
+	const float* weight = arrays.read<float>(numParticles);
+	const float* invWeight = arrays.read<float>(numParticles);
+	const float* drag = arrays.read<float>(numParticles);
+	const float* particleSize = arrays.read<float>(numParticles);
+	const boost::int32_t* state = arrays.read<boost::int32_t>(numParticles);
+	const boost::int32_t* id = arrays.read<boost::int32_t>(numParticles);
+	const boost::uint8_t* flags = arrays.read<boost::uint8_t>(numParticles);
+
+	// springs, their ends are either -1 for none or an index into the snapshot particles
+	const boost::int32_t* a = NULL;
+	const boost::int32_t* b = NULL;
+	const boost::int32_t* springID = NULL;
+	const float* restLength = NULL;
+	const float* strength = NULL;
+	const boost::uint8_t* springFlags = NULL;
+
+	if(numSprings > 0) {
+		a = arrays.read<boost::int32_t>(numSprings);
+		b = arrays.read<boost::int32_t>(numSprings);
+		springID = arrays.read<boost::int32_t>(numSprings);
+		restLength = arrays.read<float>(numSprings);
+		strength = arrays.read<float>(numSprings);
+		springFlags = arrays.read<boost::uint8_t>(numSprings);
+
+		for(int i=0; i<numSprings; i++) {
+			if(a[i] < -1 || a[i] >= numParticles || b[i] < -1 || b[i] >= numParticles)
+				throw "Snapshot::load spring references a particle outside of the snapshot";
+		}
+	}
+
+	// -- restore, only behaviours that fail to parse their own parameters can still throw from here on
+	if(hasEmitter)
+		restoreBehaviours(emitter, emitterBehaviours);
+	restoreBehaviours(physics, physicsBehaviours);
+
+	// make sure the pools are large enough
+	if(numParticles > (int)physics->particles.size())
+		physics->allocParticles(numParticles - physics->particles.size());
+
+	if(numSprings > (int)physics->springs.size())
+		physics->allocSprings(numSprings - physics->springs.size());
+
+	physics->nextID = nextID;
+	physics->nextFreeParticle = nextFreeParticle;
+	physics->nextFreeSpring = nextFreeSpring;
+
+	if(hasEmitter) {
+		emitter->position = emitterPosition;
+		emitter->rate = emitterRate;
+		emitter->max = emitterMax;
+		emitter->interval = emitterInterval;
+		emitter->time = emitterTime;
+		emitter->isEnabled = emitterIsEnabled != 0;
+	}
+
+	int numAlive = 0;
+	for(int i=0; i<numParticles; i++) {
+		Particle* p = physics->particles[i];
+		p->position = position[i];
+		p->prev = prev[i];
+		p->force = force[i];
+		p->age = age[i];
+		p->lifeTime = lifeTime[i];
+		p->weight = weight[i];
+		p->invWeight = invWeight[i];
+		p->drag = drag[i];
+		p->size = particleSize[i];
+		p->state = state[i];
+		p->id = id[i];
+		p->isAlive = (flags[i] & FLAG_ALIVE) != 0;
+		p->isLocked = (flags[i] & FLAG_LOCKED) != 0;
+		p->ignoreConstraints = (flags[i] & FLAG_IGNORE_CONSTRAINTS) != 0;
+		p->getNeighbours()->clear();
+		numAlive += p->isAlive;
+	}
+
+	// particles beyond the snapshot are unused
+	for(int i=numParticles; i<(int)physics->particles.size(); i++) {
+		physics->particles[i]->isAlive = false;
+		physics->particles[i]->getNeighbours()->clear();
+	}
+
+	int numAliveSprings = 0;
+	for(int i=0; i<numSprings; i++) {
+		Spring* s = physics->springs[i];
+		s->a = a[i] >= 0 ? physics->particles[a[i]] : NULL;
+		s->b = b[i] >= 0 ? physics->particles[b[i]] : NULL;
+		s->id = springID[i];
+		s->restLength = restLength[i];
+		s->strength = strength[i];
+		s->isAlive = (springFlags[i] & FLAG_ALIVE) != 0;
+		s->isALocked = (springFlags[i] & FLAG_A_LOCKED) != 0;
+		s->isBLocked = (springFlags[i] & FLAG_B_LOCKED) != 0;
+		numAliveSprings += s->isAlive;
+	}
+
+	for(int i=numSprings; i<(int)physics->springs.size(); i++)
+		physics->springs[i]->isAlive = false;
+
+	physics->numActiveParticles = numAlive;
+	physics->numActiveSprings = numAliveSprings;
+
+	// events queued before loading are dropped, the restored live particles are reported as born
+	physics->lifecycle.clear();
+	physics->lifecycle.resize(physics->particles.size());
+	for(int i=0; i<numParticles; i++)
+		physics->lifecycle.track(i, physics->particles[i]->isAlive);
+
+	// behaviours expect the neighbours of the previous frame
+	physics->space->clear();
+	if(physics->neighbourUpdate != NULL)
+		physics->neighbourUpdate->apply(physics);
+}
+
+void Snapshot::load(Physics* physics, std::istream& in)
+{
+	std::vector<char> data;
+	char chunk[65536];
+	while(in.read(chunk, sizeof(chunk)) || in.gcount() > 0)
+		data.insert(data.end(), chunk, chunk + in.gcount());
+
+	// vector storage comes from the heap so it's suitably aligned
+	if(!data.empty())
+		load(physics, &data[0], data.size());
+}
+
+void Snapshot::load(Physics* physics, std::string const& path)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	if(!in)
+		throw "Snapshot::load couldn't open file for reading";
+
+	// read the whole file at once
+	in.seekg(0, std::ios::end);
+	size_t size = in.tellg();
+	in.seekg(0, std::ios::beg);
+
+	if(size == 0)
+		throw "Snapshot::load file is empty";
+
+	std::vector<char> data(size);
+	if(!in.read(&data[0], size))
+		throw "Snapshot::load couldn't read file";
+
+	load(physics, &data[0], size);
+}
+
+void Snapshot::readBehaviours(SnapshotReader& in, Behavioural* behavioural, std::vector<SnapshotReader>& result)
+{
+	boost::int32_t count;
+	in.read(count);
+
+	if(count != (int)(behavioural->behaviours.size() + behavioural->constraints.size()))
+		throw "Snapshot::load number of behaviours and constraints doesn't match the snapshot";
+
+	for(int i=0; i<count; i++) {
+		boost::uint32_t size;
+		in.read(size);
+		result.push_back(SnapshotReader(in.skip(size), size));
+	}
+}
+
+void Snapshot::restoreBehaviours(Behavioural* behavioural, std::vector<SnapshotReader>& data)
+{
+	std::list<Behaviour*> all(behavioural->behaviours.begin(), behavioural->behaviours.end());
+	all.insert(all.end(), behavioural->constraints.begin(), behavioural->constraints.end());
+
+	std::vector<SnapshotReader>::iterator reader = data.begin();
+	for(std::list<Behaviour*>::iterator it = all.begin(); it != all.end(); ++it, ++reader)
+		(*it)->read(*reader);
+}
@@ -9,8 +9,17 @@
 
 #include "fieldkit/physics/behaviour/Attractor.h"
 
+#ifdef ENABLE_SSE
+	#include <emmintrin.h>
+#endif
+
 using namespace fieldkit::physics;
 
+namespace {
+	//! keeps the grid small when attractors are tiny compared to the space
+	const int MAX_CELLS_PER_AXIS = 64;
+}
+
 // -- Point --------------------------------------------------------------------
 void AttractorPoint::setRange(float value) 
 {
@@ -31,3 +40,235 @@ void AttractorPoint::apply(Particle* p)
 		p->force += (delta / dist) * (1.0f - dist/ rangeAbs) * weight;
 	}
 }
+
+void AttractorPoint::write(SnapshotWriter& out)
+{
+	WeightedBehaviour::write(out);
+	out.write(position);
+	out.write(range);
+}
+
+void AttractorPoint::read(SnapshotReader& in)
+{
+	WeightedBehaviour::read(in);
+	in.read(position);
+	in.read(range);
+	setRange(range);
+}
+
+
+// -- Field --------------------------------------------------------------------
+int AttractorField::add(Vec3f const& position, float range, float strength)
+{
+	positions.push_back(position);
+	ranges.push_back(range);
+	strengths.push_back(strength);
+	isDirty = true;
+	return (int)positions.size() - 1;
+}
+
+void AttractorField::remove(int index)
+{
+	positions[index] = positions.back();
+	ranges[index] = ranges.back();
+	strengths[index] = strengths.back();
+	positions.pop_back();
+	ranges.pop_back();
+	strengths.pop_back();
+	isDirty = true;
+}
+
+void AttractorField::clear()
+{
+	positions.clear();
+	ranges.clear();
+	strengths.clear();
+	isDirty = true;
+}
+
+void AttractorField::prepare(float dt)
+{
+	if(isDirty)
+		rebuild();
+}
+
+int AttractorField::getCell(float value, int axis)
+{
+	int cell = (int)floorf((value - gridMin[axis]) * invCellSize);
+	if(cell < 0) return 0;
+	if(cell >= numCells[axis]) return numCells[axis] - 1;
+	return cell;
+}
+
+void AttractorField::rebuild()
+{
+	isDirty = false;
+	int numAttractors = positions.size();
+
+	// cell size
+	Vec3f size = space->max - space->min;
+	float extent = std::max(size.x, std::max(size.y, size.z));
+
+	float cellSizeAbs = space->toAbsolute(cellSize);
+	if(cellSize <= 0.0f) {
+		cellSizeAbs = 0.0f;
+		for(int i=0; i<numAttractors; i++)
+			cellSizeAbs += space->toAbsolute(ranges[i]);
+		cellSizeAbs = numAttractors > 0 ? cellSizeAbs / numAttractors : extent;
+	}
+	cellSizeAbs = std::max(cellSizeAbs, extent / MAX_CELLS_PER_AXIS);
+	if(cellSizeAbs <= 0.0f) cellSizeAbs = 1.0f;
+
+	gridMin = space->min;
+	invCellSize = 1.0f / cellSizeAbs;
+	for(int a=0; a<3; a++)
+		numCells[a] = std::max(1, (int)ceilf(size[a] * invCellSize));
+
+	// particles and attractors outside the space use the closest border cell,
+	// so an attractor is found from every point its range covers
+	int totalCells = getNumCells();
+	std::vector<int> counts(totalCells + 1, 0);
+	std::vector<int> bounds(numAttractors * 6);
+
+	for(int i=0; i<numAttractors; i++) {
+		float rangeAbs = space->toAbsolute(ranges[i]);
+		int* b = &bounds[i * 6];
+		for(int a=0; a<3; a++) {
+			b[a] = getCell(positions[i][a] - rangeAbs, a);
+			b[a + 3] = getCell(positions[i][a] + rangeAbs, a);
+		}
+
+		for(int z=b[2]; z<=b[5]; z++)
+			for(int y=b[1]; y<=b[4]; y++)
+				for(int x=b[0]; x<=b[3]; x++)
+					counts[(z * numCells[1] + y) * numCells[0] + x]++;
+	}
+
+	// every cell holds a multiple of 4 entries
+	cellStart.resize(totalCells + 1);
+	int numEntries = 0;
+	for(int c=0; c<totalCells; c++) {
+		cellStart[c] = numEntries;
+		numEntries += (counts[c] + 3) & ~3;
+	}
+	cellStart[totalCells] = numEntries;
+
+	// padding never passes the range test
+	cellX.assign(numEntries, 0.0f);
+	cellY.assign(numEntries, 0.0f);
+	cellZ.assign(numEntries, 0.0f);
+	cellRangeSq.assign(numEntries, -1.0f);
+	cellInvRange.assign(numEntries, 0.0f);
+	cellStrength.assign(numEntries, 0.0f);
+
+	std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+	for(int i=0; i<numAttractors; i++) {
+		float rangeAbs = space->toAbsolute(ranges[i]);
+		if(rangeAbs <= 0.0f) continue;
+
+		int* b = &bounds[i * 6];
+		for(int z=b[2]; z<=b[5]; z++) {
+			for(int y=b[1]; y<=b[4]; y++) {
+				for(int x=b[0]; x<=b[3]; x++) {
+					int j = fill[(z * numCells[1] + y) * numCells[0] + x]++;
+					cellX[j] = positions[i].x;
+					cellY[j] = positions[i].y;
+					cellZ[j] = positions[i].z;
+					cellRangeSq[j] = rangeAbs * rangeAbs;
+					cellInvRange[j] = 1.0f / rangeAbs;
+					cellStrength[j] = strengths[i];
+				}
+			}
+		}
+	}
+}
+
+void AttractorField::apply(Particle* p)
+{
+	if(cellStart.empty()) return;
+
+	int cell = (getCell(p->position.z, 2) * numCells[1] + getCell(p->position.y, 1)) * numCells[0] + getCell(p->position.x, 0);
+	int start = cellStart[cell];
+	int end = cellStart[cell + 1];
+	if(start == end) return;
+
+	Vec3f force = Vec3f::zero();
+
+#ifdef ENABLE_SSE
+	__m128 px = _mm_set1_ps(p->position.x);
+	__m128 py = _mm_set1_ps(p->position.y);
+	__m128 pz = _mm_set1_ps(p->position.z);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 zero = _mm_setzero_ps();
+	__m128 fx = zero, fy = zero, fz = zero;
+
+	for(int i=start; i<end; i+=4) {
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(&cellX[i]), px);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(&cellY[i]), py);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(&cellZ[i]), pz);
+		__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		__m128 mask = _mm_and_ps(_mm_cmplt_ps(distSq, _mm_loadu_ps(&cellRangeSq[i])), _mm_cmpgt_ps(distSq, zero));
+		if(_mm_movemask_ps(mask) == 0) continue;
+
+		// normalize and inverse proportional weight
+		__m128 dist = _mm_sqrt_ps(distSq);
+		__m128 falloff = _mm_sub_ps(one, _mm_mul_ps(dist, _mm_loadu_ps(&cellInvRange[i])));
+		__m128 scale = _mm_div_ps(_mm_mul_ps(falloff, _mm_loadu_ps(&cellStrength[i])), dist);
+		scale = _mm_and_ps(scale, mask);
+
+		fx = _mm_add_ps(fx, _mm_mul_ps(dx, scale));
+		fy = _mm_add_ps(fy, _mm_mul_ps(dy, scale));
+		fz = _mm_add_ps(fz, _mm_mul_ps(dz, scale));
+	}
+
+	float sum[3][4];
+	_mm_storeu_ps(sum[0], fx);
+	_mm_storeu_ps(sum[1], fy);
+	_mm_storeu_ps(sum[2], fz);
+	for(int a=0; a<3; a++)
+		force[a] = (sum[a][0] + sum[a][1]) + (sum[a][2] + sum[a][3]);
+#else
+	for(int i=start; i<end; i++) {
+		Vec3f delta(cellX[i] - p->position.x, cellY[i] - p->position.y, cellZ[i] - p->position.z);
+		float distSq = delta.lengthSquared();
+
+		if(distSq < cellRangeSq[i] && distSq > 0.0f) {
+			float dist = sqrtf(distSq);
+			force += delta * ((1.0f - dist * cellInvRange[i]) * cellStrength[i] / dist);
+		}
+	}
+#endif
+
+	p->force += force * weight;
+}
+
+void AttractorField::write(SnapshotWriter& out)
+{
+	WeightedBehaviour::write(out);
+	out.write(cellSize);
+	out.write((boost::int32_t)positions.size());
+	for(size_t i=0; i<positions.size(); i++) {
+		out.write(positions[i]);
+		out.write(ranges[i]);
+		out.write(strengths[i]);
+	}
+}
+
+void AttractorField::read(SnapshotReader& in)
+{
+	WeightedBehaviour::read(in);
+	in.read(cellSize);
+
+	boost::int32_t count;
+	in.read(count);
+	clear();
+	for(int i=0; i<count; i++) {
+		Vec3f position;
+		float range, strength;
+		in.read(position);
+		in.read(range);
+		in.read(strength);
+		add(position, range, strength);
+	}
+}
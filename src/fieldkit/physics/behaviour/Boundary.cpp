@@ -51,3 +51,19 @@ void BoxWrap::apply(Particle* p) {
 	if(wrapped && !preserveMomentum)
 		p->clearVelocity();
 }
+
+void BoxWrap::write(SnapshotWriter& out)
+{
+	out.write(min);
+	out.write(max);
+	out.write(preserveMomentum);
+}
+
+void BoxWrap::read(SnapshotReader& in)
+{
+	Vec3f boxMin, boxMax;
+	in.read(boxMin);
+	in.read(boxMax);
+	in.read(preserveMomentum);
+	set(boxMin, boxMax);
+}
@@ -41,7 +41,7 @@ void CollisionConstraint::apply(Particle* p)
 			
 		// particle x other interaction
 		} else {
-			radius = p->getSize();
+			radius = p->getSize() + n->getRadius();
 		}
 		
 		radiusSq = radius * radius;
@@ -18,6 +18,18 @@ void FlockingBehaviour::prepare(float dt)
 	rangeAbsSq = rangeAbs * rangeAbs;
 }
 
+void FlockingBehaviour::write(SnapshotWriter& out)
+{
+	WeightedBehaviour::write(out);
+	out.write(range);
+}
+
+void FlockingBehaviour::read(SnapshotReader& in)
+{
+	WeightedBehaviour::read(in);
+	in.read(range);
+}
+
 
 // Attract - calculate center of neighbours and move towards it
 void FlockAttract::apply(Particle* p)
@@ -55,7 +67,7 @@ void FlockAttract::apply(Particle* p)
 
 	// check length, avoid division by zero!
 	distSq = average.lengthSquared();
-	if(distSq <= EPSILON && distSq > rangeAbsSq) return;
+	if(distSq <= EPSILON || distSq > rangeAbsSq) return;
 
 	// normalize and inverse proportional weight
 	float dist = sqrt(distSq);
@@ -116,7 +128,7 @@ void FlockAlign::apply(Particle* p)
 
 	// check length, avoid division by zero!
 	distSq = average.lengthSquared();
-	if(distSq > EPSILON && distSq > rangeAbsSq) return;
+	if(distSq <= EPSILON || distSq > rangeAbsSq) return;
 
 	// normalize and inverse proportional weight
 	float dist = sqrt(distSq);
@@ -163,7 +175,7 @@ void FlockRepel::apply(Particle* p)
 
 	// check length, avoid division by zero!
 	distSq = average.lengthSquared();
-	if(distSq <= EPSILON && distSq > rangeAbsSq) return;
+	if(distSq <= EPSILON || distSq > rangeAbsSq) return;
 
 	// normalize and inverse proportional weight
 	float dist = sqrt(distSq);
@@ -26,4 +26,16 @@ void Force::prepare(float dt) {
 
 void Force::apply(Particle* p) {
 	p->force += acceleration * p->weight;
-}
\ No newline at end of file
+}
+
+void Force::write(SnapshotWriter& out)
+{
+	WeightedBehaviour::write(out);
+	out.write(direction);
+}
+
+void Force::read(SnapshotReader& in)
+{
+	WeightedBehaviour::read(in);
+	in.read(direction);
+}
@@ -50,6 +50,41 @@ void Initializer::apply(Particle* p)
 }
 
 
+void Initializer::write(SnapshotWriter& out)
+{
+	out.write(state);
+	out.write(lifeTime);
+	out.write(lifeTimeVariance);
+	out.write(size);
+	out.write(sizeVariance);
+	out.write(weight);
+	out.write(weightVariance);
+	out.write(drag);
+	out.write(dragVariance);
+	out.write(force);
+	out.write(forceVariance);
+	out.write(lock);
+	out.write(lockChance);
+}
+
+void Initializer::read(SnapshotReader& in)
+{
+	in.read(state);
+	in.read(lifeTime);
+	in.read(lifeTimeVariance);
+	in.read(size);
+	in.read(sizeVariance);
+	in.read(weight);
+	in.read(weightVariance);
+	in.read(drag);
+	in.read(dragVariance);
+	in.read(force);
+	in.read(forceVariance);
+	in.read(lock);
+	in.read(lockChance);
+}
+
+
 // -- Helpers -----------------------------------------------------------------
 float Initializer::getVariant( float value, float variance )
 {
@@ -0,0 +1,490 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#include "fieldkit/physics/behaviour/NBody.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#ifdef ENABLE_SSE
+	#include <xmmintrin.h>
+#endif
+
+using namespace fieldkit::physics;
+
+namespace {
+	//! deeper trees would need a larger traversal stack
+	const int MAX_STACK = 512;
+
+	//! crowded octree leaves are split until they hold at most this many bodies
+	const int MAX_BODIES_PER_LEAF = 16;
+
+	//! bodies that share one traversal of the tree
+	const int MAX_BODIES_PER_BUCKET = 128;
+
+	//! unless they get smaller than this, relative to the space
+	const float MIN_SPLIT_SIZE = 1e-5f;
+
+	//! spreads the pointer bits, the lowest ones are always zero because of the alignment
+	inline int hashSpatial(fieldkit::physics::Spatial* spatial)
+	{
+		size_t value = (size_t)spatial >> 4;
+		return (int)((value * 2654435761u) >> 8);
+	}
+
+	inline int getOctant(Vec3f const& p, Vec3f const& center)
+	{
+		return (p.x >= center.x ? 1 : 0) + (p.y >= center.y ? 2 : 0) + (p.z >= center.z ? 4 : 0);
+	}
+}
+
+// -- Interactions -------------------------------------------------------------
+void NBodyGravity::Interactions::clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	mass.clear();
+}
+
+void NBodyGravity::Interactions::add(Vec3f const& position, float m)
+{
+	x.push_back(position.x);
+	y.push_back(position.y);
+	z.push_back(position.z);
+	mass.push_back(m);
+}
+
+Vec3f NBodyGravity::Interactions::sum(Vec3f const& position, float softeningSq)
+{
+	// pad to whole groups of 4, massless entries dont add any force
+	while(x.size() % 4 != 0)
+		add(position, 0.0f);
+
+	int n = x.size();
+	if(n == 0) return Vec3f::zero();
+
+#ifdef ENABLE_SSE
+	__m128 px = _mm_set1_ps(position.x);
+	__m128 py = _mm_set1_ps(position.y);
+	__m128 pz = _mm_set1_ps(position.z);
+	__m128 soft = _mm_set1_ps(softeningSq);
+	__m128 zero = _mm_setzero_ps();
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 threeHalves = _mm_set1_ps(1.5f);
+	__m128 fx = zero, fy = zero, fz = zero;
+
+	for(int i=0; i<n; i+=4) {
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(&x[i]), px);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(&y[i]), py);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(&z[i]), pz);
+		__m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_add_ps(_mm_mul_ps(dz, dz), soft));
+
+		// 1 / r with one newton step on the 12 bit estimate
+		__m128 inv = _mm_rsqrt_ps(r2);
+		inv = _mm_mul_ps(inv, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, r2), _mm_mul_ps(inv, inv))));
+
+		// m / r^3, the particle itself (r = 0) is masked out
+		__m128 s = _mm_mul_ps(_mm_loadu_ps(&mass[i]), _mm_mul_ps(inv, _mm_mul_ps(inv, inv)));
+		s = _mm_and_ps(s, _mm_cmpgt_ps(r2, zero));
+
+		fx = _mm_add_ps(fx, _mm_mul_ps(dx, s));
+		fy = _mm_add_ps(fy, _mm_mul_ps(dy, s));
+		fz = _mm_add_ps(fz, _mm_mul_ps(dz, s));
+	}
+
+	float rx[4], ry[4], rz[4];
+	_mm_storeu_ps(rx, fx);
+	_mm_storeu_ps(ry, fy);
+	_mm_storeu_ps(rz, fz);
+	return Vec3f(rx[0] + rx[1] + rx[2] + rx[3], ry[0] + ry[1] + ry[2] + ry[3], rz[0] + rz[1] + rz[2] + rz[3]);
+#else
+	Vec3f force = Vec3f::zero();
+	for(int i=0; i<n; i++) {
+		Vec3f d(x[i] - position.x, y[i] - position.y, z[i] - position.z);
+		float r2 = d.lengthSquared() + softeningSq;
+		if(r2 > 0.0f)
+			force += d * (mass[i] / (r2 * sqrtf(r2)));
+	}
+	return force;
+#endif
+}
+
+
+// -- Gravity ------------------------------------------------------------------
+
+void NBodyGravity::prepare(float dt)
+{
+	thetaSq = theta * theta;
+	float softeningAbs = space->toAbsolute(softening);
+	softeningSq = softeningAbs * softeningAbs;
+
+	tree->updateMass();
+	flatten();
+	computeForces();
+}
+
+void NBodyGravity::flatten()
+{
+	nodes.clear();
+	bodies.clear();
+	sources.clear();
+
+	Octree::Node* root = tree->getRoot();
+	if(root->mass == 0.0f) return;
+
+	// breadth first, so the children of every node are next to each other
+	Source rootSource = { root, root->min, root->max, 0, 0 };
+	sources.push_back(rootSource);
+
+	for(size_t i=0; i<sources.size(); i++) {
+		Source source = sources[i];
+
+		FlatNode node;
+		node.min = source.min;
+		node.max = source.max;
+		Vec3f size = source.max - source.min;
+		float maxSize = std::max(size.x, std::max(size.y, size.z));
+		node.sizeSq = maxSize * maxSize;
+
+		// branches of the tree
+		if(source.node != NULL && source.node->type == Octree::Node::TYPE_BRANCH) {
+			node.centerOfMass = source.node->centerOfMass;
+			node.mass = source.node->mass;
+			node.isLeaf = false;
+			node.first = sources.size();
+			node.count = 0;
+
+			std::vector<Octree::NodePtr>& children = static_cast<Octree::Branch*>(source.node)->children;
+			for(size_t j=0; j<children.size(); j++) {
+				if(children[j]->mass == 0.0f) continue;
+				Source child = { children[j], children[j]->min, children[j]->max, 0, 0 };
+				sources.push_back(child);
+				node.count++;
+			}
+
+			nodes.push_back(node);
+			continue;
+		}
+
+		// leaves of the tree bring their bodies along
+		if(source.node != NULL) {
+			SpatialList& data = static_cast<Octree::Leaf*>(source.node)->data;
+			source.first = bodies.size();
+			source.count = data.size();
+			for(size_t j=0; j<data.size(); j++) {
+				Body body = { data[j]->getPosition(), data[j]->getMass(), data[j] };
+				bodies.push_back(body);
+			}
+		}
+
+		// a range of bodies
+		node.mass = 0.0f;
+		node.centerOfMass = Vec3f::zero();
+		for(int j=source.first; j<source.first + source.count; j++) {
+			node.mass += bodies[j].mass;
+			node.centerOfMass += bodies[j].position * bodies[j].mass;
+		}
+		if(node.mass != 0.0f)
+			node.centerOfMass /= node.mass;
+
+		node.isLeaf = true;
+		node.first = source.first;
+		node.count = source.count;
+
+		if(source.count > MAX_BODIES_PER_LEAF && maxSize > MIN_SPLIT_SIZE * space->getWidth())
+			split(node, source);
+
+		nodes.push_back(node);
+	}
+}
+
+void NBodyGravity::split(FlatNode& node, Source const& source)
+{
+	Vec3f center = (source.min + source.max) * 0.5f;
+
+	// sort the bodies of the range by octant
+	scratch.assign(bodies.begin() + source.first, bodies.begin() + source.first + source.count);
+
+	int counts[8] = { 0 };
+	for(int j=0; j<source.count; j++)
+		counts[getOctant(scratch[j].position, center)]++;
+
+	int starts[8];
+	int fill[8];
+	int offset = source.first;
+	for(int o=0; o<8; o++) {
+		starts[o] = fill[o] = offset;
+		offset += counts[o];
+	}
+
+	for(int j=0; j<source.count; j++)
+		bodies[fill[getOctant(scratch[j].position, center)]++] = scratch[j];
+
+	node.isLeaf = false;
+	node.first = sources.size();
+	node.count = 0;
+
+	for(int o=0; o<8; o++) {
+		if(counts[o] == 0) continue;
+
+		Source child;
+		child.node = NULL;
+		child.min = source.min;
+		child.max = center;
+		if((o & 1) != 0) { child.min.x = center.x; child.max.x = source.max.x; }
+		if((o & 2) != 0) { child.min.y = center.y; child.max.y = source.max.y; }
+		if((o & 4) != 0) { child.min.z = center.z; child.max.z = source.max.z; }
+		child.first = starts[o];
+		child.count = counts[o];
+
+		sources.push_back(child);
+		node.count++;
+	}
+}
+
+void NBodyGravity::computeForces()
+{
+	forces.resize(bodies.size());
+
+	// shrinks every node to the bounds of its bodies and counts them, children always come after their parent.
+	// Nodes with few bodies in a corner look a lot smaller and get opened less often.
+	int numNodes = nodes.size();
+	numBodies.resize(numNodes);
+	stackSizes.resize(numNodes);
+	for(int i=numNodes - 1; i>=0; i--) {
+		FlatNode& node = nodes[i];
+		stackSizes[i] = 1;
+		if(node.count == 0) continue;
+
+		// the siblings pushed before the last child stay on the stack while it is traversed
+		if(!node.isLeaf) {
+			for(int j=node.first; j<node.first + node.count; j++)
+				stackSizes[i] = std::max(stackSizes[i], node.count - 1 + stackSizes[j]);
+		}
+
+		Vec3f min(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vec3f max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		numBodies[i] = 0;
+
+		for(int j=node.first; j<node.first + node.count; j++) {
+			Vec3f const& childMin = node.isLeaf ? bodies[j].position : nodes[j].min;
+			Vec3f const& childMax = node.isLeaf ? bodies[j].position : nodes[j].max;
+			min.x = std::min(min.x, childMin.x); max.x = std::max(max.x, childMax.x);
+			min.y = std::min(min.y, childMin.y); max.y = std::max(max.y, childMax.y);
+			min.z = std::min(min.z, childMin.z); max.z = std::max(max.z, childMax.z);
+			numBodies[i] += node.isLeaf ? 1 : numBodies[j];
+		}
+
+		node.min = min;
+		node.max = max;
+		Vec3f size = max - min;
+		float maxSize = std::max(size.x, std::max(size.y, size.z));
+		node.sizeSq = maxSize * maxSize;
+	}
+
+	// checked before the traversals, which run in parallel and can't throw
+	if(numNodes > 0 && stackSizes[0] > MAX_STACK)
+		throw "NBodyGravity: octree is too deep";
+
+	// the largest subtrees with few enough bodies become buckets, their leaves are listed one after another
+	bucketStarts.clear();
+	bucketLeaves.clear();
+
+	std::vector<int> stack;
+	stack.push_back(0);
+	while(!stack.empty()) {
+		int index = stack.back();
+		stack.pop_back();
+		FlatNode const& node = nodes[index];
+
+		if(numBodies[index] > MAX_BODIES_PER_BUCKET && !node.isLeaf) {
+			for(int i=0; i<node.count; i++)
+				stack.push_back(node.first + i);
+			continue;
+		}
+
+		bucketStarts.push_back(bucketLeaves.size());
+		std::vector<int> leaves(1, index);
+		while(!leaves.empty()) {
+			int leaf = leaves.back();
+			leaves.pop_back();
+			if(nodes[leaf].isLeaf) {
+				bucketLeaves.push_back(leaf);
+			} else {
+				for(int i=0; i<nodes[leaf].count; i++)
+					leaves.push_back(nodes[leaf].first + i);
+			}
+		}
+	}
+	bucketStarts.push_back(bucketLeaves.size());
+
+	// open addressing table to find the body of a particle in apply, kept at most half full
+	int numSlots = 16;
+	while(numSlots < 2 * (int)bodies.size())
+		numSlots *= 2;
+
+	BodySlot empty = { NULL, -1 };
+	slots.assign(numSlots, empty);
+	for(int i=0; i<(int)bodies.size(); i++) {
+		int slot = hashSpatial(bodies[i].spatial) & (numSlots - 1);
+		while(slots[slot].spatial != NULL)
+			slot = (slot + 1) & (numSlots - 1);
+		slots[slot].spatial = bodies[i].spatial;
+		slots[slot].index = i;
+	}
+
+	int numBuckets = bucketStarts.size() - 1;
+#ifdef ENABLE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+		// every thread collects its own interactions
+		Interactions interactions;
+
+#ifdef ENABLE_OPENMP
+		#pragma omp for schedule(dynamic, 4)
+#endif
+		for(int i=0; i<numBuckets; i++)
+			computeBucket(bucketStarts[i], bucketStarts[i + 1], interactions);
+	}
+}
+
+void NBodyGravity::computeBucket(int firstLeaf, int lastLeaf, Interactions& interactions)
+{
+	// bounds of the bodies in the bucket
+	Vec3f min(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vec3f max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for(int l=firstLeaf; l<lastLeaf; l++) {
+		FlatNode const& leaf = nodes[bucketLeaves[l]];
+		min.x = std::min(min.x, leaf.min.x); max.x = std::max(max.x, leaf.max.x);
+		min.y = std::min(min.y, leaf.min.y); max.y = std::max(max.y, leaf.max.y);
+		min.z = std::min(min.z, leaf.min.z); max.z = std::max(max.z, leaf.max.z);
+	}
+
+	// one traversal for the whole bucket, a node has to look small from every point of its bounds
+	interactions.clear();
+
+	int stack[MAX_STACK];
+	int top = 0;
+	stack[top++] = 0;
+
+	while(top > 0) {
+		FlatNode const& node = nodes[stack[--top]];
+
+		bool isOverlapping = node.min.x <= max.x && node.max.x >= min.x &&
+			node.min.y <= max.y && node.max.y >= min.y &&
+			node.min.z <= max.z && node.max.z >= min.z;
+
+		Vec3f const& c = node.centerOfMass;
+		Vec3f delta(std::max(0.0f, std::max(min.x - c.x, c.x - max.x)),
+					std::max(0.0f, std::max(min.y - c.y, c.y - max.y)),
+					std::max(0.0f, std::max(min.z - c.z, c.z - max.z)));
+
+		if(!isOverlapping && node.sizeSq < thetaSq * delta.lengthSquared()) {
+			interactions.add(node.centerOfMass, node.mass);
+
+		} else if(node.isLeaf) {
+			for(int i=node.first; i<node.first + node.count; i++)
+				interactions.add(bodies[i].position, bodies[i].mass);
+
+		} else {
+			for(int i=0; i<node.count; i++)
+				stack[top++] = node.first + i;
+		}
+	}
+
+	// the bodies of the bucket are part of the list, their own entry has zero distance and is skipped
+	for(int l=firstLeaf; l<lastLeaf; l++) {
+		FlatNode const& leaf = nodes[bucketLeaves[l]];
+		for(int i=leaf.first; i<leaf.first + leaf.count; i++)
+			forces[i] = interactions.sum(bodies[i].position, softeningSq);
+	}
+}
+
+int NBodyGravity::findBody(Particle* p)
+{
+	if(slots.empty()) return -1;
+
+	int mask = slots.size() - 1;
+	for(int i=hashSpatial(p) & mask; slots[i].spatial != NULL; i = (i + 1) & mask) {
+		if(slots[i].spatial == p) 
+			return slots[i].index;
+	}
+	return -1;
+}
+
+void NBodyGravity::apply(Particle* p)
+{
+	if(nodes.empty()) return;
+
+	// bodies of the tree got their force in prepare
+	int index = findBody(p);
+	if(index >= 0) {
+		p->force += forces[index] * weight;
+		return;
+	}
+
+	// particles that aren't part of the tree yet traverse it on their own
+	Vec3f const& position = p->position;
+	Vec3f force = Vec3f::zero();
+
+	// iterative traversal, every thread only reads the nodes
+	int stack[MAX_STACK];
+	int top = 0;
+	stack[top++] = 0;
+
+	while(top > 0) {
+		FlatNode const& node = nodes[stack[--top]];
+
+		Vec3f delta = node.centerOfMass - position;
+		float distSq = delta.lengthSquared();
+
+		// far enough away to be seen as a single body, never when it contains the particle itself
+		bool isInside = position.x >= node.min.x && position.x <= node.max.x &&
+			position.y >= node.min.y && position.y <= node.max.y &&
+			position.z >= node.min.z && position.z <= node.max.z;
+
+		if(node.sizeSq < thetaSq * distSq && !isInside) {
+			float r2 = distSq + softeningSq;
+			force += delta * (node.mass / (r2 * sqrtf(r2)));
+			continue;
+		}
+
+		if(node.isLeaf) {
+			for(int i=node.first; i<node.first + node.count; i++) {
+				Body const& body = bodies[i];
+				if(body.spatial == p) continue;
+
+				Vec3f d = body.position - position;
+				float r2 = d.lengthSquared() + softeningSq;
+				force += d * (body.mass / (r2 * sqrtf(r2)));
+			}
+
+		} else {
+			for(int i=0; i<node.count; i++)
+				stack[top++] = node.first + i;
+		}
+	}
+
+	p->force += force * weight;
+}
+
+void NBodyGravity::write(SnapshotWriter& out)
+{
+	WeightedBehaviour::write(out);
+	out.write(theta);
+	out.write(softening);
+}
+
+void NBodyGravity::read(SnapshotReader& in)
+{
+	WeightedBehaviour::read(in);
+	in.read(theta);
+	in.read(softening);
+}
@@ -9,6 +9,10 @@
 
 #include "fieldkit/physics/behaviour/PlaneConstraint.h"
 
+#ifdef ENABLE_SSE
+	#include <xmmintrin.h>
+#endif
+
 using namespace fieldkit::physics;
 
 void PlaneConstraint::apply(Particle* p) {
@@ -21,9 +25,77 @@ void WallConstraint::apply(Particle* p) {
 	
 	if( (isPositive && p->position[axis] > pos) ||
 	    (!isPositive && p->position[axis] < pos) ) {
-		float velocity = p->getVelocity()[axis];
-		p->position[axis] = pos;
-		p->prev[axis] = pos - velocity * bouncyness;
+		bounce(p, pos);
+	}
+}
+
+void WallConstraint::bounce(Particle* p, float pos) {
+	float velocity = p->getVelocity()[axis];
+	p->position[axis] = pos;
+	p->prev[axis] = pos - velocity * bouncyness;
+}
+
+void WallConstraint::applyBatch(Particle** particles, int count)
+{
+	int i = 0;
+	float dir = (float)direction;
+
+#ifdef ENABLE_SSE
+	__m128 h = _mm_set1_ps(height);
+	__m128 d = _mm_set1_ps(dir);
+
+	for(; i + 4 <= count; i += 4) {
+		Particle** p = particles + i;
+		__m128 value = _mm_setr_ps(p[0]->position[axis], p[1]->position[axis], p[2]->position[axis], p[3]->position[axis]);
+		__m128 size = _mm_setr_ps(p[0]->size, p[1]->size, p[2]->size, p[3]->size);
+		__m128 pos = _mm_add_ps(h, _mm_mul_ps(size, d));
+
+		int affected = _mm_movemask_ps(isPositive ? _mm_cmpgt_ps(value, pos) : _mm_cmplt_ps(value, pos));
+		if(affected == 0) continue;
+
+		for(int j=0; j<4; j++) {
+			if((affected & (1 << j)) && p[j]->isAlive)
+				bounce(p[j], height + p[j]->size * dir);
+		}
 	}
+#endif
+
+	for(; i<count; i++) {
+		Particle* p = particles[i];
+		float pos = height + p->size * dir;
+		float value = p->position[axis];
+
+		if(((isPositive && value > pos) || (!isPositive && value < pos)) && p->isAlive)
+			bounce(p, pos);
+	}
+}
+
+void PlaneConstraint::write(SnapshotWriter& out)
+{
+	out.write(axis);
+	out.write(constraint);
 }
 
+void PlaneConstraint::read(SnapshotReader& in)
+{
+	in.read(axis);
+	in.read(constraint);
+}
+
+void WallConstraint::write(SnapshotWriter& out)
+{
+	out.write(axis);
+	out.write(isPositive);
+	out.write(height);
+	out.write(bouncyness);
+}
+
+void WallConstraint::read(SnapshotReader& in)
+{
+	bool positive;
+	in.read(axis);
+	in.read(positive);
+	in.read(height);
+	in.read(bouncyness);
+	setIsPositive(positive);
+}
@@ -16,4 +16,18 @@ void BoxRandom::apply(Particle* p) {
 	p->position.y = randFloat(min.y, max.y);
 	p->position.z = randFloat(min.z, max.z);
 	p->clearVelocity();
-}
\ No newline at end of file
+}
+
+void BoxRandom::write(SnapshotWriter& out)
+{
+	out.write(min);
+	out.write(max);
+}
+
+void BoxRandom::read(SnapshotReader& in)
+{
+	Vec3f boxMin, boxMax;
+	in.read(boxMin);
+	in.read(boxMax);
+	set(boxMin, boxMax);
+}
@@ -0,0 +1,473 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#include "fieldkit/physics/behaviour/SDFConstraint.h"
+
+#include <fstream>
+#include <algorithm>
+#include <boost/cstdint.hpp>
+
+using namespace fieldkit::physics;
+
+namespace {
+	const boost::uint32_t MAGIC = 0x46444b46; // 'FKDF'
+	const boost::uint32_t VERSION = 1;
+
+	//! squared distance from p to the closest point on triangle abc, after Ericson
+	float getDistanceSq(Vec3f const& p, Vec3f const& a, Vec3f const& b, Vec3f const& c)
+	{
+		Vec3f ab = b - a;
+		Vec3f ac = c - a;
+		Vec3f ap = p - a;
+		float d1 = ab.dot(ap);
+		float d2 = ac.dot(ap);
+		if(d1 <= 0.0f && d2 <= 0.0f) return ap.lengthSquared();
+
+		Vec3f bp = p - b;
+		float d3 = ab.dot(bp);
+		float d4 = ac.dot(bp);
+		if(d3 >= 0.0f && d4 <= d3) return bp.lengthSquared();
+
+		float vc = d1 * d4 - d3 * d2;
+		if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+			float v = d1 / (d1 - d3);
+			return (ap - ab * v).lengthSquared();
+		}
+
+		Vec3f cp = p - c;
+		float d5 = ab.dot(cp);
+		float d6 = ac.dot(cp);
+		if(d6 >= 0.0f && d5 <= d6) return cp.lengthSquared();
+
+		float vb = d5 * d2 - d1 * d6;
+		if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+			float w = d2 / (d2 - d6);
+			return (ap - ac * w).lengthSquared();
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+			float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			return (bp - (c - b) * w).lengthSquared();
+		}
+
+		float denom = 1.0f / (va + vb + vc);
+		float v = vb * denom;
+		float w = vc * denom;
+		return (ap - ab * v - ac * w).lengthSquared();
+	}
+
+	//! where the line parallel to x through (y, z) crosses the triangle, false if it misses
+	bool intersectRow(float y, float z, Vec3f const& a, Vec3f const& b, Vec3f const& c, float& x)
+	{
+		// barycentric coordinates in the yz projection
+		float det = (b.y - a.y) * (c.z - a.z) - (c.y - a.y) * (b.z - a.z);
+		if(det == 0.0f) return false;
+
+		float u = ((y - a.y) * (c.z - a.z) - (c.y - a.y) * (z - a.z)) / det;
+		float v = ((b.y - a.y) * (z - a.z) - (y - a.y) * (b.z - a.z)) / det;
+		if(u < 0.0f || v < 0.0f || u + v > 1.0f) return false;
+
+		x = a.x + (b.x - a.x) * u + (c.x - a.x) * v;
+		return true;
+	}
+
+	int clampIndex(int value, int count)
+	{
+		return value < 0 ? 0 : (value >= count ? count - 1 : value);
+	}
+}
+
+
+// -- Field --------------------------------------------------------------------
+DistanceField::DistanceField() :
+	cellSize(1.0f), invCellSize(1.0f), bandWidth(0.0f)
+{
+	numBricks[0] = numBricks[1] = numBricks[2] = 0;
+}
+
+void DistanceField::bake(std::vector<Vec3f> const& vertices, std::vector<int> const& indices, 
+						 AABB const& bounds, float cellSize, float bandWidth, bool isClosed)
+{
+	if(indices.size() % 3 != 0)
+		throw "DistanceField: needs three indices per triangle";
+	if(cellSize <= 0.0f || bandWidth <= 0.0f)
+		throw "DistanceField: cell size and band width need to be positive";
+	for(size_t i=0; i<indices.size(); i++) {
+		if(indices[i] < 0 || indices[i] >= (int)vertices.size())
+			throw "DistanceField: triangle index outside of the vertices";
+	}
+
+	const int B = BRICK_SIZE;
+
+	this->bounds.set(bounds);
+	this->cellSize = cellSize;
+	this->invCellSize = 1.0f / cellSize;
+	this->bandWidth = bandWidth;
+
+	Vec3f size = bounds.max - bounds.min;
+	int numNodes[3];
+	for(int a=0; a<3; a++) {
+		numBricks[a] = std::max(1, (int)ceilf(size[a] / (cellSize * B)));
+		numNodes[a] = numBricks[a] * B + 1;
+	}
+
+	int numTriangles = indices.size() / 3;
+	int totalBricks = getNumBricks();
+	Vec3f const& origin = bounds.min;
+
+	// triangles near every brick
+	std::vector< std::vector<int> > brickTriangles(totalBricks);
+	for(int t=0; t<numTriangles; t++) {
+		Vec3f const& a = vertices[indices[t * 3]];
+		Vec3f const& b = vertices[indices[t * 3 + 1]];
+		Vec3f const& c = vertices[indices[t * 3 + 2]];
+
+		int range[6];
+		bool isOutside = false;
+		for(int i=0; i<3; i++) {
+			float lo = std::min(a[i], std::min(b[i], c[i])) - bandWidth;
+			float hi = std::max(a[i], std::max(b[i], c[i])) + bandWidth;
+			if(hi < bounds.min[i] || lo > bounds.max[i]) isOutside = true;
+			range[i] = clampIndex((int)floorf((lo - origin[i]) * invCellSize / B), numBricks[i]);
+			range[i + 3] = clampIndex((int)floorf((hi - origin[i]) * invCellSize / B), numBricks[i]);
+		}
+		if(isOutside) continue;
+
+		for(int z=range[2]; z<=range[5]; z++)
+			for(int y=range[1]; y<=range[4]; y++)
+				for(int x=range[0]; x<=range[3]; x++)
+					brickTriangles[(z * numBricks[1] + y) * numBricks[0] + x].push_back(t);
+	}
+
+	// inside or outside of every node, by counting crossings along rows in x
+	std::vector<char> inside;
+	if(isClosed) {
+		inside.assign(numNodes[0] * numNodes[1] * numNodes[2], 0);
+
+		std::vector< std::vector<int> > rowTriangles(numNodes[1] * numNodes[2]);
+		for(int t=0; t<numTriangles; t++) {
+			Vec3f const& a = vertices[indices[t * 3]];
+			Vec3f const& b = vertices[indices[t * 3 + 1]];
+			Vec3f const& c = vertices[indices[t * 3 + 2]];
+
+			int range[4];
+			for(int i=1; i<3; i++) {
+				float lo = std::min(a[i], std::min(b[i], c[i]));
+				float hi = std::max(a[i], std::max(b[i], c[i]));
+				range[i - 1] = clampIndex((int)floorf((lo - origin[i]) * invCellSize), numNodes[i]);
+				range[i + 1] = clampIndex((int)ceilf((hi - origin[i]) * invCellSize), numNodes[i]);
+			}
+
+			for(int z=range[1]; z<=range[3]; z++)
+				for(int y=range[0]; y<=range[2]; y++)
+					rowTriangles[z * numNodes[1] + y].push_back(t);
+		}
+
+		std::vector<float> crossings;
+		for(int z=0; z<numNodes[2]; z++) {
+			for(int y=0; y<numNodes[1]; y++) {
+				std::vector<int>& row = rowTriangles[z * numNodes[1] + y];
+				if(row.empty()) continue;
+
+				// slightly off the node so rows don't run exactly through edges and vertices
+				float py = origin.y + (y + 1.3e-4f) * cellSize;
+				float pz = origin.z + (z + 2.7e-4f) * cellSize;
+
+				crossings.clear();
+				for(size_t i=0; i<row.size(); i++) {
+					int t = row[i];
+					float x;
+					if(intersectRow(py, pz, vertices[indices[t * 3]], vertices[indices[t * 3 + 1]], vertices[indices[t * 3 + 2]], x))
+						crossings.push_back(x);
+				}
+				std::sort(crossings.begin(), crossings.end());
+
+				size_t passed = 0;
+				char* nodes = &inside[(z * numNodes[1] + y) * numNodes[0]];
+				for(int x=0; x<numNodes[0]; x++) {
+					float px = origin.x + x * cellSize;
+					while(passed < crossings.size() && crossings[passed] < px)
+						passed++;
+					nodes[x] = (char)(passed % 2);
+				}
+			}
+		}
+	}
+
+	// distances of the bricks within the band
+	brickIndex.assign(totalBricks, -1);
+	brickValue.assign(totalBricks, bandWidth);
+	data.clear();
+
+	for(int bz=0; bz<numBricks[2]; bz++) {
+		for(int by=0; by<numBricks[1]; by++) {
+			for(int bx=0; bx<numBricks[0]; bx++) {
+				int brick = (bz * numBricks[1] + by) * numBricks[0] + bx;
+				std::vector<int>& triangles = brickTriangles[brick];
+
+				if(triangles.empty()) {
+					if(isClosed && inside[((bz * B + B / 2) * numNodes[1] + by * B + B / 2) * numNodes[0] + bx * B + B / 2])
+						brickValue[brick] = -bandWidth;
+					continue;
+				}
+
+				int offset = data.size();
+				data.resize(offset + BRICK_NODES);
+				float* nodes = &data[offset];
+				bool isNearSurface = false;
+
+				for(int z=0; z<=B; z++) {
+					for(int y=0; y<=B; y++) {
+						for(int x=0; x<=B; x++) {
+							int nx = bx * B + x, ny = by * B + y, nz = bz * B + z;
+							Vec3f p = origin + Vec3f((float)nx, (float)ny, (float)nz) * cellSize;
+
+							float distSq = bandWidth * bandWidth;
+							for(size_t i=0; i<triangles.size(); i++) {
+								int t = triangles[i];
+								distSq = std::min(distSq, getDistanceSq(p, vertices[indices[t * 3]], vertices[indices[t * 3 + 1]], vertices[indices[t * 3 + 2]]));
+							}
+
+							float distance = sqrtf(distSq);
+							if(distance < bandWidth) isNearSurface = true;
+							if(isClosed && inside[(nz * numNodes[1] + ny) * numNodes[0] + nx])
+								distance = -distance;
+
+							nodes[(z * (B + 1) + y) * (B + 1) + x] = distance;
+						}
+					}
+				}
+
+				// the triangles were close to the brick but not within the band of any node
+				if(!isNearSurface) {
+					brickValue[brick] = nodes[((B / 2) * (B + 1) + B / 2) * (B + 1) + B / 2];
+					data.resize(offset);
+					continue;
+				}
+
+				brickIndex[brick] = offset;
+			}
+		}
+	}
+}
+
+float DistanceField::sample(Vec3f const& position, Vec3f* gradient) const
+{
+	if(gradient != NULL)
+		*gradient = Vec3f::zero();
+	if(brickIndex.empty())
+		return bandWidth;
+
+	const int B = BRICK_SIZE;
+
+	// positions outside the bounds are clamped to the border
+	int brick[3];
+	int cell[3];
+	float f[3];
+	for(int a=0; a<3; a++) {
+		float u = (position[a] - bounds.min[a]) * invCellSize;
+		float last = (float)(numBricks[a] * B);
+		if(u < 0.0f) u = 0.0f;
+		if(u > last) u = last;
+
+		brick[a] = std::min((int)u / B, numBricks[a] - 1);
+		float local = u - brick[a] * B;
+		cell[a] = std::min((int)local, B - 1);
+		f[a] = local - cell[a];
+	}
+
+	int b = (brick[2] * numBricks[1] + brick[1]) * numBricks[0] + brick[0];
+	int offset = brickIndex[b];
+	if(offset < 0)
+		return brickValue[b];
+
+	const int sy = B + 1;
+	const int sz = (B + 1) * (B + 1);
+	const float* n = &data[offset + cell[2] * sz + cell[1] * sy + cell[0]];
+
+	float c000 = n[0],       c100 = n[1];
+	float c010 = n[sy],      c110 = n[sy + 1];
+	float c001 = n[sz],      c101 = n[sz + 1];
+	float c011 = n[sz + sy], c111 = n[sz + sy + 1];
+
+	float fx = f[0], fy = f[1], fz = f[2];
+
+	float c00 = c000 + (c100 - c000) * fx;
+	float c10 = c010 + (c110 - c010) * fx;
+	float c01 = c001 + (c101 - c001) * fx;
+	float c11 = c011 + (c111 - c011) * fx;
+	float c0 = c00 + (c10 - c00) * fy;
+	float c1 = c01 + (c11 - c01) * fy;
+
+	if(gradient != NULL) {
+		float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+		float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+		gradient->x = (dx0 + (dx1 - dx0) * fz) * invCellSize;
+		gradient->y = ((c10 - c00) + ((c11 - c01) - (c10 - c00)) * fz) * invCellSize;
+		gradient->z = (c1 - c0) * invCellSize;
+	}
+
+	return c0 + (c1 - c0) * fz;
+}
+
+void DistanceField::save(std::string const& path)
+{
+	std::ofstream out(path.c_str(), std::ios::binary);
+	if(!out)
+		throw "DistanceField::save couldn't open file for writing";
+
+	boost::uint32_t header[2] = { MAGIC, VERSION };
+	boost::int32_t counts[5] = { numBricks[0], numBricks[1], numBricks[2], (boost::int32_t)data.size(), 0 };
+	out.write(reinterpret_cast<const char*>(header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(&bounds.min), sizeof(Vec3f));
+	out.write(reinterpret_cast<const char*>(&bounds.max), sizeof(Vec3f));
+	out.write(reinterpret_cast<const char*>(&cellSize), sizeof(float));
+	out.write(reinterpret_cast<const char*>(&bandWidth), sizeof(float));
+	out.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+
+	if(!brickIndex.empty()) {
+		out.write(reinterpret_cast<const char*>(&brickIndex[0]), brickIndex.size() * sizeof(int));
+		out.write(reinterpret_cast<const char*>(&brickValue[0]), brickValue.size() * sizeof(float));
+	}
+	if(!data.empty())
+		out.write(reinterpret_cast<const char*>(&data[0]), data.size() * sizeof(float));
+
+	if(!out)
+		throw "DistanceField::save couldn't write file";
+}
+
+void DistanceField::load(std::string const& path)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	if(!in)
+		throw "DistanceField::load couldn't open file for reading";
+
+	in.seekg(0, std::ios::end);
+	boost::int64_t fileSize = in.tellg();
+	in.seekg(0, std::ios::beg);
+
+	boost::uint32_t header[2];
+	in.read(reinterpret_cast<char*>(header), sizeof(header));
+	if(!in || header[0] != MAGIC)
+		throw "DistanceField::load file isn't a distance field";
+	if(header[1] != VERSION)
+		throw "DistanceField::load unsupported version";
+
+	// everything is read and checked before this field changes
+	Vec3f min, max;
+	float fileCellSize, fileBandWidth;
+	boost::int32_t counts[5];
+	in.read(reinterpret_cast<char*>(&min), sizeof(Vec3f));
+	in.read(reinterpret_cast<char*>(&max), sizeof(Vec3f));
+	in.read(reinterpret_cast<char*>(&fileCellSize), sizeof(float));
+	in.read(reinterpret_cast<char*>(&fileBandWidth), sizeof(float));
+	in.read(reinterpret_cast<char*>(counts), sizeof(counts));
+	if(!in)
+		throw "DistanceField::load file is truncated";
+
+	if(!(fileCellSize > 0.0f) || !(fileBandWidth > 0.0f))
+		throw "DistanceField::load cell size and band width need to be positive";
+
+	// every brick takes up an index and a value, so larger counts cant fit into the file
+	boost::int64_t remaining = fileSize - (boost::int64_t)in.tellg();
+	boost::int64_t totalBricks = 1;
+	for(int a=0; a<3; a++) {
+		if(counts[a] < 0)
+			throw "DistanceField::load negative number of bricks";
+		totalBricks *= counts[a];
+		if(totalBricks * (boost::int64_t)(sizeof(int) + sizeof(float)) > remaining)
+			throw "DistanceField::load file is truncated";
+	}
+
+	boost::int32_t dataSize = counts[3];
+	if(dataSize < 0 || dataSize % BRICK_NODES != 0 || dataSize / BRICK_NODES > totalBricks)
+		throw "DistanceField::load brick data doesn't match the number of bricks";
+	if(totalBricks * (boost::int64_t)(sizeof(int) + sizeof(float)) + (boost::int64_t)dataSize * sizeof(float) > remaining)
+		throw "DistanceField::load file is truncated";
+
+	std::vector<int> fileBrickIndex((size_t)totalBricks);
+	std::vector<float> fileBrickValue((size_t)totalBricks);
+	std::vector<float> fileData(dataSize);
+
+	if(totalBricks > 0) {
+		in.read(reinterpret_cast<char*>(&fileBrickIndex[0]), fileBrickIndex.size() * sizeof(int));
+		in.read(reinterpret_cast<char*>(&fileBrickValue[0]), fileBrickValue.size() * sizeof(float));
+	}
+	if(dataSize > 0)
+		in.read(reinterpret_cast<char*>(&fileData[0]), fileData.size() * sizeof(float));
+
+	if(!in)
+		throw "DistanceField::load file is truncated";
+
+	// stored bricks start at a multiple of BRICK_NODES within the brick data, which holds exactly these bricks
+	int numStored = 0;
+	for(size_t i=0; i<fileBrickIndex.size(); i++) {
+		int offset = fileBrickIndex[i];
+		if(offset == -1) continue;
+		if(offset < 0 || offset % BRICK_NODES != 0 || offset >= dataSize)
+			throw "DistanceField::load brick index outside of the brick data";
+		numStored++;
+	}
+	if(numStored * BRICK_NODES != dataSize)
+		throw "DistanceField::load brick data doesn't match the number of bricks";
+
+	bounds.set(min, max);
+	cellSize = fileCellSize;
+	invCellSize = 1.0f / cellSize;
+	bandWidth = fileBandWidth;
+	for(int a=0; a<3; a++)
+		numBricks[a] = counts[a];
+
+	brickIndex.swap(fileBrickIndex);
+	brickValue.swap(fileBrickValue);
+	data.swap(fileData);
+}
+
+
+// -- Constraint ---------------------------------------------------------------
+void SDFConstraint::apply(Particle* p)
+{
+	if(field == NULL || !p->isAlive || p->ignoreConstraints) return;
+
+	Vec3f gradient;
+	float distance = field->sample(p->position, &gradient);
+	if(isInside) {
+		distance = -distance;
+		gradient = -gradient;
+	}
+	if(distance >= thickness) return;
+
+	// deeper than the band there's no direction to push towards
+	float length = gradient.length();
+	if(length == 0.0f) return;
+	Vec3f normal = gradient / length;
+
+	// project onto the surface and remove (or reflect) the velocity into it
+	Vec3f velocity = p->position - p->prev;
+	p->position += normal * (thickness - distance);
+
+	float intoSurface = velocity.dot(normal);
+	if(intoSurface < 0.0f)
+		velocity -= normal * (intoSurface * (1.0f + bouncyness));
+	p->prev = p->position - velocity;
+}
+
+void SDFConstraint::write(SnapshotWriter& out)
+{
+	out.write(thickness);
+	out.write(isInside);
+	out.write(bouncyness);
+}
+
+void SDFConstraint::read(SnapshotReader& in)
+{
+	in.read(thickness);
+	in.read(isInside);
+	in.read(bouncyness);
+}
@@ -9,6 +9,10 @@
 
 #include "fieldkit/physics/behaviour/SphereConstraint.h"
 
+#ifdef ENABLE_SSE
+	#include <xmmintrin.h>
+#endif
+
 using namespace fieldkit::physics;
 
 void SphereConstraint::apply(Particle* p) {
@@ -16,9 +20,69 @@ void SphereConstraint::apply(Particle* p) {
 	{
 		bool isInside = contains(p->position);
 		if((isBoundingSphere && !isInside) || (!isBoundingSphere && isInside)) {
-			p->position.set(
-				((p->position - position).normalized() *= radius) += position
-				);
+			project(p);
 		}	
 	}
-}
\ No newline at end of file
+}
+
+void SphereConstraint::project(Particle* p) {
+	p->position.set(
+		((p->position - position).normalized() *= radius) += position
+		);
+}
+
+void SphereConstraint::applyBatch(Particle** particles, int count)
+{
+	// same test as contains, so batches and apply always agree
+	float radiusSq = radius * radius;
+	int i = 0;
+
+#ifdef ENABLE_SSE
+	__m128 cx = _mm_set1_ps(position.x);
+	__m128 cy = _mm_set1_ps(position.y);
+	__m128 cz = _mm_set1_ps(position.z);
+	__m128 r2 = _mm_set1_ps(radiusSq);
+
+	for(; i + 4 <= count; i += 4) {
+		Particle** p = particles + i;
+		__m128 dx = _mm_sub_ps(cx, _mm_setr_ps(p[0]->position.x, p[1]->position.x, p[2]->position.x, p[3]->position.x));
+		__m128 dy = _mm_sub_ps(cy, _mm_setr_ps(p[0]->position.y, p[1]->position.y, p[2]->position.y, p[3]->position.y));
+		__m128 dz = _mm_sub_ps(cz, _mm_setr_ps(p[0]->position.z, p[1]->position.z, p[2]->position.z, p[3]->position.z));
+		__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		int inside = _mm_movemask_ps(_mm_cmple_ps(distSq, r2));
+		int affected = isBoundingSphere ? (~inside & 15) : inside;
+		if(affected == 0) continue;
+
+		for(int j=0; j<4; j++) {
+			if((affected & (1 << j)) && p[j]->isAlive && !p[j]->ignoreConstraints)
+				project(p[j]);
+		}
+	}
+#endif
+
+	for(; i<count; i++) {
+		Particle* p = particles[i];
+		float dx = position.x - p->position.x;
+		float dy = position.y - p->position.y;
+		float dz = position.z - p->position.z;
+		bool isInside = dx * dx + dy * dy + dz * dz <= radiusSq;
+
+		if(isInside != isBoundingSphere && p->isAlive && !p->ignoreConstraints)
+			project(p);
+	}
+}
+
+void SphereConstraint::write(SnapshotWriter& out)
+{
+	out.write(position);
+	out.write(radius);
+	out.write(isBoundingSphere);
+}
+
+void SphereConstraint::read(SnapshotReader& in)
+{
+	in.read(position);
+	in.read(radius);
+	in.read(isBoundingSphere);
+}
@@ -0,0 +1,261 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+#include "fieldkit/physics/behaviour/VectorField.h"
+
+#include "cinder/Perlin.h"
+#include "fieldkit/Profiler.h"
+
+#ifdef ENABLE_SSE
+	#include <emmintrin.h>
+#endif
+
+using namespace fieldkit::physics;
+
+// -- Field --------------------------------------------------------------------
+VectorField::VectorField()
+{
+	resolution[0] = resolution[1] = resolution[2] = 0;
+	stride[0] = stride[1] = stride[2] = 0;
+}
+
+void VectorField::init(AABB const& bounds, int nx, int ny, int nz)
+{
+	if(nx < 1 || ny < 1 || nz < 1)
+		throw "VectorField: resolution needs to be at least 1";
+
+	this->bounds.set(bounds);
+	resolution[0] = nx;
+	resolution[1] = ny;
+	resolution[2] = nz;
+
+	stride[0] = 4;
+	stride[1] = nx * 4;
+	stride[2] = nx * ny * 4;
+
+	// maps a position to node coordinates
+	Vec3f size = bounds.max - bounds.min;
+	for(int a=0; a<3; a++)
+		nodeScale[a] = (resolution[a] > 1 && size[a] > 0.0f) ? (resolution[a] - 1) / size[a] : 0.0f;
+
+	data.assign(nx * ny * nz * 4, 0.0f);
+}
+
+void VectorField::set(int x, int y, int z, Vec3f const& value)
+{
+	float* node = &data[x * stride[0] + y * stride[1] + z * stride[2]];
+	node[0] = value.x;
+	node[1] = value.y;
+	node[2] = value.z;
+}
+
+Vec3f VectorField::get(int x, int y, int z) const
+{
+	const float* node = &data[x * stride[0] + y * stride[1] + z * stride[2]];
+	return Vec3f(node[0], node[1], node[2]);
+}
+
+Vec3f VectorField::getPosition(int x, int y, int z) const
+{
+	Vec3f position = bounds.min;
+	int index[3] = { x, y, z };
+	for(int a=0; a<3; a++) {
+		if(nodeScale[a] > 0.0f)
+			position[a] += index[a] / nodeScale[a];
+	}
+	return position;
+}
+
+Vec3f VectorField::sample(Vec3f const& position) const
+{
+	// find the lower corner of the cell and the offsets into it
+	int offset = 0;
+	int step[3];
+	float f[3];
+	for(int a=0; a<3; a++) {
+		float u = (position[a] - bounds.min[a]) * nodeScale[a];
+		int last = resolution[a] - 1;
+
+		if(last == 0 || u <= 0.0f) {
+			step[a] = 0;
+			f[a] = 0.0f;
+			continue;
+		}
+		if(u >= last) {
+			offset += last * stride[a];
+			step[a] = 0;
+			f[a] = 0.0f;
+			continue;
+		}
+
+		int i = (int)u;
+		offset += i * stride[a];
+		step[a] = stride[a];
+		f[a] = u - i;
+	}
+
+	const float* c000 = &data[offset];
+
+#ifdef ENABLE_SSE
+	__m128 fx = _mm_set1_ps(f[0]);
+	__m128 fy = _mm_set1_ps(f[1]);
+	__m128 fz = _mm_set1_ps(f[2]);
+
+	__m128 v000 = _mm_loadu_ps(c000);
+	__m128 v100 = _mm_loadu_ps(c000 + step[0]);
+	__m128 v010 = _mm_loadu_ps(c000 + step[1]);
+	__m128 v110 = _mm_loadu_ps(c000 + step[1] + step[0]);
+	__m128 v001 = _mm_loadu_ps(c000 + step[2]);
+	__m128 v101 = _mm_loadu_ps(c000 + step[2] + step[0]);
+	__m128 v011 = _mm_loadu_ps(c000 + step[2] + step[1]);
+	__m128 v111 = _mm_loadu_ps(c000 + step[2] + step[1] + step[0]);
+
+	// a + (b - a) * f
+	__m128 v00 = _mm_add_ps(v000, _mm_mul_ps(_mm_sub_ps(v100, v000), fx));
+	__m128 v10 = _mm_add_ps(v010, _mm_mul_ps(_mm_sub_ps(v110, v010), fx));
+	__m128 v01 = _mm_add_ps(v001, _mm_mul_ps(_mm_sub_ps(v101, v001), fx));
+	__m128 v11 = _mm_add_ps(v011, _mm_mul_ps(_mm_sub_ps(v111, v011), fx));
+
+	__m128 v0 = _mm_add_ps(v00, _mm_mul_ps(_mm_sub_ps(v10, v00), fy));
+	__m128 v1 = _mm_add_ps(v01, _mm_mul_ps(_mm_sub_ps(v11, v01), fy));
+
+	float result[4];
+	_mm_storeu_ps(result, _mm_add_ps(v0, _mm_mul_ps(_mm_sub_ps(v1, v0), fz)));
+	return Vec3f(result[0], result[1], result[2]);
+#else
+	float result[3];
+	for(int c=0; c<3; c++) {
+		const float* n = c000 + c;
+		float v00 = n[0] + (n[step[0]] - n[0]) * f[0];
+		float v10 = n[step[1]] + (n[step[1] + step[0]] - n[step[1]]) * f[0];
+		float v01 = n[step[2]] + (n[step[2] + step[0]] - n[step[2]]) * f[0];
+		float v11 = n[step[2] + step[1]] + (n[step[2] + step[1] + step[0]] - n[step[2] + step[1]]) * f[0];
+
+		float v0 = v00 + (v10 - v00) * f[1];
+		float v1 = v01 + (v11 - v01) * f[1];
+		result[c] = v0 + (v1 - v0) * f[2];
+	}
+	return Vec3f(result[0], result[1], result[2]);
+#endif
+}
+
+
+// -- Baker --------------------------------------------------------------------
+CurlNoiseBaker::CurlNoiseBaker(AABB const& bounds, int nx, int ny, int nz) :
+	frequency(0.01f), octaves(3), seed(0), interval(0.5f), speed(0.1f), 
+	time(0.0f), numBakes(0), quit(false)
+{
+	if(nx < 1 || ny < 1 || nz < 1)
+		throw "CurlNoiseBaker: resolution needs to be at least 1";
+
+	this->bounds.set(bounds);
+	resolution[0] = nx;
+	resolution[1] = ny;
+	resolution[2] = nz;
+}
+
+CurlNoiseBaker::~CurlNoiseBaker()
+{
+	stop();
+}
+
+void CurlNoiseBaker::start()
+{
+	if(isRunning()) return;
+
+	// the simulation has a field to work with from the first update
+	bake(fields.getBack(), time);
+	fields.publish();
+	numBakes++;
+
+	quit = false;
+	boost::thread t(&CurlNoiseBaker::threadMainThunk, this);
+	thread.swap(t);
+}
+
+void CurlNoiseBaker::stop()
+{
+	if(!isRunning()) return;
+
+	{
+		boost::mutex::scoped_lock scopedLock(lock);
+		quit = true;
+		condition.notify_all();
+	}
+	thread.join();
+}
+
+void CurlNoiseBaker::bake(VectorField& field, float time)
+{
+	PROFILE_SCOPE("vectorfield.bake");
+
+	if(field.getResolution(0) != resolution[0] || field.getResolution(1) != resolution[1] || field.getResolution(2) != resolution[2])
+		field.init(bounds, resolution[0], resolution[1], resolution[2]);
+
+	ci::Perlin perlin(octaves, seed);
+
+	// three unrelated potentials taken from the same noise at different offsets
+	Vec3f offsetY(31.416f, -47.853f, 12.793f);
+	Vec3f offsetZ(-23.141f, 18.067f, 53.975f);
+	Vec3f drift(time, time * 0.7f, time * 1.3f);
+
+	for(int z=0; z<resolution[2]; z++) {
+		for(int y=0; y<resolution[1]; y++) {
+			for(int x=0; x<resolution[0]; x++) {
+				Vec3f p = field.getPosition(x, y, z) * frequency + drift;
+
+				Vec3f dx = perlin.dfBm(p);
+				Vec3f dy = perlin.dfBm(p + offsetY);
+				Vec3f dz = perlin.dfBm(p + offsetZ);
+
+				// curl of the potential (dx, dy, dz) is divergence free
+				field.set(x, y, z, Vec3f(dz.y - dy.z, dx.z - dz.x, dy.x - dx.y));
+			}
+		}
+	}
+}
+
+void CurlNoiseBaker::threadMainThunk(CurlNoiseBaker* baker)
+{
+	baker->threadMain();
+}
+
+void CurlNoiseBaker::threadMain()
+{
+	while(true) {
+		boost::system_time next = boost::get_system_time() + boost::posix_time::milliseconds((long)(interval * 1000));
+
+		time += interval * speed;
+		bake(fields.getBack(), time);
+		fields.publish();
+		numBakes++;
+
+		boost::mutex::scoped_lock scopedLock(lock);
+		while(!quit) {
+			if(!condition.timed_wait(scopedLock, next))
+				break;
+		}
+		if(quit) break;
+	}
+}
+
+
+// -- Force --------------------------------------------------------------------
+void VectorFieldForce::prepare(float dt)
+{
+	if(baker != NULL) {
+		baker->acquire();
+		field = &baker->getField();
+	}
+}
+
+void VectorFieldForce::apply(Particle* p)
+{
+	if(field == NULL || field->isEmpty()) return;
+	p->force += field->sample(p->position) * (weight * p->weight);
+}
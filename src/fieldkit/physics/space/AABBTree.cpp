@@ -0,0 +1,470 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+#include "fieldkit/physics/space/AABBTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace fieldkit::physics;
+
+namespace {
+	inline float surfaceArea(Vec3f const& min, Vec3f const& max)
+	{
+		Vec3f d = max - min;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	inline Vec3f minimum(Vec3f const& a, Vec3f const& b)
+	{
+		return Vec3f(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+	}
+
+	inline Vec3f maximum(Vec3f const& a, Vec3f const& b)
+	{
+		return Vec3f(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+	}
+}
+
+AABBTree::AABBTree() :
+	root(NULL_NODE), freeList(NULL_NODE), margin(1.0f), generation(0), numReinserts(0)
+{
+}
+
+AABBTree::AABBTree(Vec3f const& offset, Vec3f const& dimension, float margin) :
+	root(NULL_NODE), freeList(NULL_NODE), generation(0), numReinserts(0)
+{
+	init(offset, dimension, margin);
+}
+
+AABBTree::~AABBTree()
+{
+	if(ownsSpatials) {
+		for(boost::unordered_map<Spatial*, int>::iterator it = leaves.begin(); it != leaves.end(); it++)
+			delete it->first;
+	}
+}
+
+void AABBTree::init(Vec3f const& offset, Vec3f const& dimension, float margin)
+{
+	this->position = offset + dimension * 0.5f;
+	this->extent = dimension * 0.5f;
+	updateBounds();
+
+	this->margin = margin;
+}
+
+void AABBTree::reserve(int count)
+{
+	nodes.reserve(count * 2);
+	leaves.rehash(count);
+}
+
+void AABBTree::clear()
+{
+	// drop everything that wasn't inserted again during the last frame, e.g. dead particles
+	boost::unordered_map<Spatial*, int>::iterator it = leaves.begin();
+	while(it != leaves.end()) {
+		int leaf = it->second;
+		if(nodes[leaf].generation != generation) {
+			removeLeaf(leaf);
+			freeNode(leaf);
+			it = leaves.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	generation++;
+	numReinserts = 0;
+}
+
+void AABBTree::insert(Spatial* spatial)
+{
+	Vec3f p = spatial->getPosition();
+	float r = spatial->getRadius();
+	Vec3f tightMin = p - Vec3f(r, r, r);
+	Vec3f tightMax = p + Vec3f(r, r, r);
+	Vec3f fat(r + margin, r + margin, r + margin);
+
+	boost::unordered_map<Spatial*, int>::iterator it = leaves.find(spatial);
+
+	// already in the tree, only reinsert when it left its enlarged box
+	if(it != leaves.end()) {
+		int leaf = it->second;
+		Node& node = nodes[leaf];
+		node.generation = generation;
+
+		if(node.min.x <= tightMin.x && node.min.y <= tightMin.y && node.min.z <= tightMin.z &&
+		   node.max.x >= tightMax.x && node.max.y >= tightMax.y && node.max.z >= tightMax.z)
+			return;
+
+		removeLeaf(leaf);
+		nodes[leaf].min = p - fat;
+		nodes[leaf].max = p + fat;
+		insertLeaf(leaf);
+		numReinserts++;
+		return;
+	}
+
+	int leaf = allocateNode();
+	Node& node = nodes[leaf];
+	node.min = p - fat;
+	node.max = p + fat;
+	node.spatial = spatial;
+	node.generation = generation;
+	insertLeaf(leaf);
+	leaves[spatial] = leaf;
+}
+
+void AABBTree::remove(Spatial* spatial)
+{
+	boost::unordered_map<Spatial*, int>::iterator it = leaves.find(spatial);
+	if(it == leaves.end()) return;
+
+	removeLeaf(it->second);
+	freeNode(it->second);
+	leaves.erase(it);
+}
+
+void AABBTree::select(BoundingVolume* volume, SpatialListPtr result)
+{
+	switch(volume->getType()) {
+		case BOUNDING_BOX:
+			select(static_cast<AABB*>(volume), result);
+			return;
+
+		case BOUNDING_SPHERE:
+			select(static_cast<SphereBound*>(volume), result);
+			return;
+	}
+
+	throw "AABBTree: unsupported bounding volume type";
+}
+
+void AABBTree::selectRay(Ray3f const& ray, float maxDistance, SpatialListPtr result)
+{
+	result->clear();
+	if(root == NULL_NODE) return;
+
+	int stack[MAX_STACK];
+	int top = 0;
+	stack[top++] = root;
+
+	while(top > 0) {
+		Node const& node = nodes[stack[--top]];
+
+		float tNear;
+		if(!ray.findIntersection(node.min, node.max, &tNear) || tNear > maxDistance) continue;
+
+		if(node.isLeaf()) {
+			float t;
+			if(node.generation == generation && 
+			   ray.findIntersection(node.spatial->getPosition(), node.spatial->getRadius(), &t) && t <= maxDistance)
+				result->push_back(node.spatial);
+
+		} else {
+			if(top + 2 > MAX_STACK) throw "AABBTree: tree too deep";
+			stack[top++] = node.child1;
+			stack[top++] = node.child2;
+		}
+	}
+}
+
+bool AABBTree::raycast(Ray3f const& ray, float maxDistance, RayHit& hit)
+{
+	hit.spatial = NULL;
+	if(root == NULL_NODE) return false;
+
+	float limit = maxDistance;
+	float tNear;
+	if(!ray.findIntersection(nodes[root].min, nodes[root].max, &tNear) || tNear > limit) return false;
+
+	// stack of nodes together with the distance where the ray enters them
+	int stack[MAX_STACK];
+	float entries[MAX_STACK];
+	int top = 0;
+	stack[top] = root;
+	entries[top++] = tNear;
+
+	while(top > 0) {
+		top--;
+		if(entries[top] > limit) continue;
+		Node const& node = nodes[stack[top]];
+
+		if(node.isLeaf()) {
+			float t;
+			if(node.generation == generation && 
+			   ray.findIntersection(node.spatial->getPosition(), node.spatial->getRadius(), &t) && t <= limit) {
+				limit = t;
+				hit.spatial = node.spatial;
+				hit.distance = t;
+			}
+			continue;
+		}
+
+		float t1, t2;
+		bool hit1 = ray.findIntersection(nodes[node.child1].min, nodes[node.child1].max, &t1) && t1 <= limit;
+		bool hit2 = ray.findIntersection(nodes[node.child2].min, nodes[node.child2].max, &t2) && t2 <= limit;
+		if(top + 2 > MAX_STACK) throw "AABBTree: tree too deep";
+
+		// push the farther child first so the nearer one is visited next
+		if(hit1 && hit2 && t1 < t2) {
+			stack[top] = node.child2; entries[top++] = t2;
+			stack[top] = node.child1; entries[top++] = t1;
+		} else {
+			if(hit1) { stack[top] = node.child1; entries[top++] = t1; }
+			if(hit2) { stack[top] = node.child2; entries[top++] = t2; }
+		}
+	}
+
+	return hit.spatial != NULL;
+}
+
+
+// -- Tree ---------------------------------------------------------------------
+int AABBTree::allocateNode()
+{
+	int index;
+	if(freeList != NULL_NODE) {
+		index = freeList;
+		freeList = nodes[index].parent;
+	} else {
+		index = nodes.size();
+		nodes.push_back(Node());
+	}
+
+	Node& node = nodes[index];
+	node.parent = NULL_NODE;
+	node.child1 = NULL_NODE;
+	node.child2 = NULL_NODE;
+	node.height = 0;
+	node.spatial = NULL;
+	node.generation = generation;
+	return index;
+}
+
+void AABBTree::freeNode(int index)
+{
+	nodes[index].parent = freeList;
+	nodes[index].height = -1;
+	freeList = index;
+}
+
+void AABBTree::insertLeaf(int leaf)
+{
+	if(root == NULL_NODE) {
+		root = leaf;
+		nodes[root].parent = NULL_NODE;
+		return;
+	}
+
+	// find the best sibling by the surface area heuristic
+	Vec3f leafMin = nodes[leaf].min;
+	Vec3f leafMax = nodes[leaf].max;
+	int index = root;
+
+	while(!nodes[index].isLeaf()) {
+		Node const& node = nodes[index];
+
+		float area = surfaceArea(node.min, node.max);
+		float combinedArea = surfaceArea(minimum(node.min, leafMin), maximum(node.max, leafMax));
+
+		// cost of creating a new parent for this node and the new leaf
+		float cost = 2.0f * combinedArea;
+
+		// minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float costs[2];
+		int children[2] = { node.child1, node.child2 };
+		for(int i=0; i<2; i++) {
+			Node const& child = nodes[children[i]];
+			float childArea = surfaceArea(minimum(child.min, leafMin), maximum(child.max, leafMax));
+			if(!child.isLeaf())
+				childArea -= surfaceArea(child.min, child.max);
+			costs[i] = childArea + inheritanceCost;
+		}
+
+		if(cost < costs[0] && cost < costs[1]) break;
+		index = costs[0] < costs[1] ? children[0] : children[1];
+	}
+
+	int sibling = index;
+
+	// create a new parent
+	int oldParent = nodes[sibling].parent;
+	int newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].min = minimum(leafMin, nodes[sibling].min);
+	nodes[newParent].max = maximum(leafMax, nodes[sibling].max);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if(oldParent != NULL_NODE) {
+		if(nodes[oldParent].child1 == sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+	} else {
+		root = newParent;
+	}
+
+	refit(nodes[leaf].parent);
+}
+
+void AABBTree::removeLeaf(int leaf)
+{
+	if(leaf == root) {
+		root = NULL_NODE;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	if(grandParent != NULL_NODE) {
+		// replace the parent with the sibling
+		if(nodes[grandParent].child1 == parent)
+			nodes[grandParent].child1 = sibling;
+		else
+			nodes[grandParent].child2 = sibling;
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+
+		refit(grandParent);
+	} else {
+		root = sibling;
+		nodes[sibling].parent = NULL_NODE;
+		freeNode(parent);
+	}
+}
+
+void AABBTree::refit(int index)
+{
+	// walk back up, rebalance and update heights and bounds
+	while(index != NULL_NODE) {
+		index = balance(index);
+
+		Node& node = nodes[index];
+		Node const& child1 = nodes[node.child1];
+		Node const& child2 = nodes[node.child2];
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.min = minimum(child1.min, child2.min);
+		node.max = maximum(child1.max, child2.max);
+
+		index = node.parent;
+	}
+}
+
+int AABBTree::balance(int iA)
+{
+	// rotates the higher child up when both subtrees differ by more than one level
+	Node& A = nodes[iA];
+	if(A.isLeaf() || A.height < 2) return iA;
+
+	int iB = A.child1;
+	int iC = A.child2;
+	Node& B = nodes[iB];
+	Node& C = nodes[iC];
+
+	int difference = C.height - B.height;
+
+	// rotate C up
+	if(difference > 1) {
+		int iF = C.child1;
+		int iG = C.child2;
+		Node& F = nodes[iF];
+		Node& G = nodes[iG];
+
+		C.child1 = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		if(C.parent != NULL_NODE) {
+			if(nodes[C.parent].child1 == iA)
+				nodes[C.parent].child1 = iC;
+			else
+				nodes[C.parent].child2 = iC;
+		} else {
+			root = iC;
+		}
+
+		if(F.height > G.height) {
+			C.child2 = iF;
+			A.child2 = iG;
+			G.parent = iA;
+			A.min = minimum(B.min, G.min);
+			A.max = maximum(B.max, G.max);
+			C.min = minimum(A.min, F.min);
+			C.max = maximum(A.max, F.max);
+			A.height = 1 + std::max(B.height, G.height);
+			C.height = 1 + std::max(A.height, F.height);
+		} else {
+			C.child2 = iG;
+			A.child2 = iF;
+			F.parent = iA;
+			A.min = minimum(B.min, F.min);
+			A.max = maximum(B.max, F.max);
+			C.min = minimum(A.min, G.min);
+			C.max = maximum(A.max, G.max);
+			A.height = 1 + std::max(B.height, F.height);
+			C.height = 1 + std::max(A.height, G.height);
+		}
+		return iC;
+	}
+
+	// rotate B up
+	if(difference < -1) {
+		int iD = B.child1;
+		int iE = B.child2;
+		Node& D = nodes[iD];
+		Node& E = nodes[iE];
+
+		B.child1 = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		if(B.parent != NULL_NODE) {
+			if(nodes[B.parent].child1 == iA)
+				nodes[B.parent].child1 = iB;
+			else
+				nodes[B.parent].child2 = iB;
+		} else {
+			root = iB;
+		}
+
+		if(D.height > E.height) {
+			B.child2 = iD;
+			A.child1 = iE;
+			E.parent = iA;
+			A.min = minimum(C.min, E.min);
+			A.max = maximum(C.max, E.max);
+			B.min = minimum(A.min, D.min);
+			B.max = maximum(A.max, D.max);
+			A.height = 1 + std::max(C.height, E.height);
+			B.height = 1 + std::max(A.height, D.height);
+		} else {
+			B.child2 = iE;
+			A.child1 = iD;
+			D.parent = iA;
+			A.min = minimum(C.min, D.min);
+			A.max = maximum(C.max, D.max);
+			B.min = minimum(A.min, E.min);
+			B.max = maximum(A.max, E.max);
+			A.height = 1 + std::max(C.height, D.height);
+			B.height = 1 + std::max(A.height, E.height);
+		}
+		return iB;
+	}
+
+	return iA;
+}
@@ -59,9 +59,22 @@ void BasicSpace::insert(Spatial* s)
 void BasicSpace::select(BoundingVolume* volume, SpatialListPtr result)
 {
 	result->clear();
-	BOOST_FOREACH(Spatial* s, spatials) {
-		if(volume->contains(s->getPosition())) {
-			result->push_back(s);
+	selectContained(volume, spatials, result);
+}
+
+bool BasicSpace::raycast(Ray3f const& ray, float maxDistance, RayHit& hit)
+{
+	hit.spatial = NULL;
+	float limit = maxDistance;
+
+	for(size_t i=0; i<spatials.size(); i++) {
+		float t;
+		float r = spatials[i]->getRadius();
+		if(r > 0.0f && ray.findIntersection(spatials[i]->getPosition(), r, &t) && t <= limit) {
+			limit = t;
+			hit.spatial = spatials[i];
+			hit.distance = t;
 		}
 	}
+	return hit.spatial != NULL;
 }
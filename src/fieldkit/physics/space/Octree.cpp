@@ -7,10 +7,59 @@
  *	 Created by Marcus Wendt on 30/06/2010.
  */
 
+#include <algorithm>
 #include "fieldkit/physics/space/Octree.h"
 
 using namespace fieldkit::physics;
 
+namespace {
+	//! nearest hit below the given node, nodes are grown by radius since spatials are sorted in by their center only
+	void raycastNode(Octree::NodePtr node, Ray3f const& ray, float radius, float& limit, RayHit& hit)
+	{
+		if(node->type == Octree::Node::TYPE_LEAF) {
+			SpatialList const& data = static_cast<Octree::Leaf*>(node)->data;
+			for(size_t i=0; i<data.size(); i++) {
+				float t;
+				float r = data[i]->getRadius();
+				if(r > 0.0f && ray.findIntersection(data[i]->getPosition(), r, &t) && t <= limit) {
+					limit = t;
+					hit.spatial = data[i];
+					hit.distance = t;
+				}
+			}
+			return;
+		}
+
+		// sort the children by the distance where the ray enters them
+		std::vector<Octree::NodePtr> const& children = static_cast<Octree::Branch*>(node)->children;
+		Vec3f grow(radius, radius, radius);
+		float entries[8];
+		int order[8];
+		int count = 0;
+
+		for(size_t i=0; i<children.size(); i++) {
+			Octree::NodePtr child = children[i];
+			float tNear;
+			if(child->isEmpty || !ray.findIntersection(child->min - grow, child->max + grow, &tNear) || tNear > limit) 
+				continue;
+
+			int j = count++;
+			for(; j > 0 && entries[j-1] > tNear; j--) {
+				entries[j] = entries[j-1];
+				order[j] = order[j-1];
+			}
+			entries[j] = tNear;
+			order[j] = i;
+		}
+
+		for(int i=0; i<count; i++) {
+			// the nearest hit so far lies in front of all remaining children
+			if(entries[i] > limit) break;
+			raycastNode(children[order[i]], ray, radius, limit, hit);
+		}
+	}
+}
+
 // -- Octree -------------------------------------------------------------------
 Octree::Octree()
 {
@@ -38,16 +87,19 @@ void Octree::init(Vec3f offset, Vec3f dimension, float minSize)
 	// init tree
 	root = new Branch();
 	root->init(offset, dimension, minSize, 0);
+	maxRadius = 0.0f;
 }
 
 void Octree::clear() 
 {
 	root->clear();
+	maxRadius = 0.0f;
 }
 
 void Octree::insert(Spatial* spatial) 
 {
 	root->insert(spatial);
+	maxRadius = std::max(maxRadius, spatial->getRadius());
 }
 
 void Octree::select(BoundingVolume* volume, SpatialListPtr result)
@@ -56,6 +108,24 @@ void Octree::select(BoundingVolume* volume, SpatialListPtr result)
 	root->select(volume, result);
 }
 
+bool Octree::raycast(Ray3f const& ray, float maxDistance, RayHit& hit)
+{
+	hit.spatial = NULL;
+
+	Vec3f grow(maxRadius, maxRadius, maxRadius);
+	if(root->isEmpty || !ray.findIntersection(root->min - grow, root->max + grow)) 
+		return false;
+
+	float limit = maxDistance;
+	raycastNode(root, ray, maxRadius, limit, hit);
+	return hit.spatial != NULL;
+}
+
+void Octree::updateMass()
+{
+	root->updateMass();
+}
+
 
 // -- Node ---------------------------------------------------------------------
 void Octree::Node::init(Vec3f const& offset, Vec3f const& dimension, float minSize, int depth)
@@ -119,7 +189,8 @@ void Octree::Branch::destroy( bool ownsSpatials )
 		delete child;
 		child = NULL;
 	}
-	clear();
+	children.clear();
+	isEmpty = true;
 }
 
 
@@ -159,6 +230,30 @@ void Octree::Branch::select(BoundingVolume* volume, SpatialListPtr result)
 	}	
 }
 
+void Octree::Branch::reserve(int countPerLeaf)
+{
+	BOOST_FOREACH(Octree::NodePtr child, children) {
+		child->reserve(countPerLeaf);
+	}
+}
+
+void Octree::Branch::updateMass()
+{
+	mass = 0.0f;
+	centerOfMass = Vec3f::zero();
+	if(isEmpty) return;
+
+	BOOST_FOREACH(Octree::NodePtr child, children) {
+		child->updateMass();
+		if(child->mass == 0.0f) continue;
+		mass += child->mass;
+		centerOfMass += child->centerOfMass * child->mass;
+	}
+
+	if(mass != 0.0f)
+		centerOfMass /= mass;
+}
+
 int Octree::Branch::getOctantID(float x, float y, float z) 
 {
 	int id = 0;
@@ -220,8 +315,20 @@ void Octree::Leaf::select(BoundingVolume* volume, SpatialListPtr result)
 	// check wether bounding volume and this node intersect at all
 	if(!intersects(volume)) return;
 	
+	Space::selectContained(volume, data, result);
+}
+void Octree::Leaf::updateMass()
+{
+	mass = 0.0f;
+	centerOfMass = Vec3f::zero();
+	if(isEmpty) return;
+
 	BOOST_FOREACH(Spatial* s, data) {
-		if(volume->contains(s->getPosition()))
-			result->push_back(s);	
+		float m = s->getMass();
+		mass += m;
+		centerOfMass += s->getPosition() * m;
 	}
-}
\ No newline at end of file
+
+	if(mass != 0.0f)
+		centerOfMass /= mass;
+}
@@ -9,8 +9,14 @@
 
 #include "fieldkit/physics/space/Space.h"
 
+#include <algorithm>
+
 using namespace fieldkit::physics;
 
+namespace {
+	const int SELECT_BATCH_SIZE = 256;
+}
+
 Vec3f Space::getCenter() {
 	return this->position;
 }
@@ -22,3 +28,64 @@ float Space::toAbsolute(float value) {
 float Space::toRelative(float value) {
 	return value / getWidth();
 }
+
+void Space::selectContained(BoundingVolume* volume, SpatialList const& candidates, SpatialListPtr result)
+{
+	float x[SELECT_BATCH_SIZE];
+	float y[SELECT_BATCH_SIZE];
+	float z[SELECT_BATCH_SIZE];
+	unsigned char mask[SELECT_BATCH_SIZE];
+
+	int numCandidates = candidates.size();
+	for(int start=0; start<numCandidates; start += SELECT_BATCH_SIZE) {
+		int count = std::min(SELECT_BATCH_SIZE, numCandidates - start);
+		Spatial* const* batch = &candidates[start];
+
+		for(int i=0; i<count; i++) {
+			Vec3f const& p = batch[i]->getPosition();
+			x[i] = p.x;
+			y[i] = p.y;
+			z[i] = p.z;
+		}
+
+		if(volume->containsMany(x, y, z, count, mask) == 0) continue;
+
+		for(int i=0; i<count; i++) {
+			if(mask[i]) result->push_back(batch[i]);
+		}
+	}
+}
+
+bool Space::raycast(Ray3f const& ray, float maxDistance, RayHit& hit)
+{
+	SpatialList candidates;
+	select(this, &candidates);
+
+	hit.spatial = NULL;
+	float limit = maxDistance;
+
+	for(size_t i=0; i<candidates.size(); i++) {
+		float t;
+		float r = candidates[i]->getRadius();
+		if(r > 0.0f && ray.findIntersection(candidates[i]->getPosition(), r, &t) && t <= limit) {
+			limit = t;
+			hit.spatial = candidates[i];
+			hit.distance = t;
+		}
+	}
+	return hit.spatial != NULL;
+}
+
+int Space::raycastMany(Ray3f const* rays, int count, float maxDistance, RayHit* hits)
+{
+	int numHits = 0;
+
+	#ifdef ENABLE_OPENMP
+	#pragma omp parallel for reduction(+:numHits)
+	#endif
+	for(int i=0; i<count; i++) {
+		if(raycast(rays[i], maxDistance, hits[i]))
+			numHits++;
+	}
+	return numHits;
+}
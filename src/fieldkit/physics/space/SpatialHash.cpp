@@ -10,6 +10,9 @@
 #include "fieldkit/physics/space/SpatialHash.h"
 #include "fieldkit/math/SphereBound.h"
 
+#include <cmath>
+#include <limits>
+
 using namespace fieldkit::physics;
 
 SpatialHash::SpatialHash()
@@ -51,6 +54,7 @@ void SpatialHash::init(Vec3f offset, Vec3f dimension, float cellSize)
 	
 	// reserve cells
 	cells.resize(cellsX * cellsY);
+	maxRadius = 0.0f;
 }
 
 void SpatialHash::clear() 
@@ -59,6 +63,7 @@ void SpatialHash::clear()
 	for(int i = 0; i < n; i++) {
 		cells[i].clear();
 	}
+	maxRadius = 0.0f;
 }
 
 void SpatialHash::insert(Spatial* spatial) 
@@ -72,33 +77,35 @@ void SpatialHash::insert(Spatial* spatial)
 	unsigned int index = hashY * cellsX + hashX;
 	if(index >= cells.size()) return;
 	cells[index].push_back(spatial);
+	maxRadius = std::max(maxRadius, spatial->getRadius());
 }
 
 void SpatialHash::select(BoundingVolume* volume, SpatialListPtr result)
 {
-	// find search center position in cell space
-	Vec3f p = volume->getPosition() - (this->position - this->extent);
-	int hashX = hash(p.x);
-	int hashY = hash(p.y);
-	
 	// figure out search radius
-	int searchX = 0;
-	int searchY = 0;
+	Vec3f extent = Vec3f::zero();
 	switch(volume->getType()) {
-		case BOUNDING_BOX: {
-			AABB* box = (AABB*)volume;
-			searchX = hash(box->getWidth() * 0.5f);
-			searchY = hash(box->getHeight() * 0.5f);
+		case BOUNDING_BOX:
+			extent = getSearchExtent(*static_cast<AABB*>(volume));
 			break;
-		}
 			
-		case BOUNDING_SPHERE: {
-			SphereBound* sphere = (SphereBound*)volume;
-			searchX = searchY = hash(sphere->getRadius());
+		case BOUNDING_SPHERE:
+			extent = getSearchExtent(*static_cast<SphereBound*>(volume));
 			break;
-		}
 	};
 	
+	selectCells(volume->getPosition(), extent, result);
+}
+
+void SpatialHash::selectCells(Vec3f const& center, Vec3f const& extent, SpatialListPtr result)
+{
+	// find search center position in cell space
+	Vec3f p = center - (this->position - this->extent);
+	int hashX = hash(p.x);
+	int hashY = hash(p.y);
+	int searchX = hash(extent.x);
+	int searchY = hash(extent.y);
+	
 	// make sure we have a clean list
 	result->clear();
 	
@@ -118,3 +125,92 @@ void SpatialHash::select(BoundingVolume* volume, SpatialListPtr result)
 		}
 	}
 }
+
+bool SpatialHash::raycast(Ray3f const& ray, float maxDistance, RayHit& hit)
+{
+	hit.spatial = NULL;
+	float limit = maxDistance;
+
+	// ray in cell space, clipped to the grid grown by the largest radius.
+	// the grid is 2D, z is only checked per spatial
+	Vec3f o = ray.getOrigin() - (this->position - this->extent);
+	Vec3f d = ray.getDirection();
+	float lo[2] = { -maxRadius, -maxRadius };
+	float hi[2] = { cellsX * cellSize + maxRadius, cellsY * cellSize + maxRadius };
+	float origin[2] = { o.x, o.y };
+	float dir[2] = { d.x, d.y };
+
+	float tStart = 0.0f;
+	float tEnd = maxDistance;
+	for(int axis=0; axis<2; axis++) {
+		if(dir[axis] == 0.0f) {
+			if(origin[axis] < lo[axis] || origin[axis] > hi[axis]) return false;
+			continue;
+		}
+		float t1 = (lo[axis] - origin[axis]) / dir[axis];
+		float t2 = (hi[axis] - origin[axis]) / dir[axis];
+		tStart = std::max(tStart, std::min(t1, t2));
+		tEnd = std::min(tEnd, std::max(t1, t2));
+	}
+	if(tStart > tEnd) return false;
+
+	// set up the grid walk
+	int cell[2];
+	int step[2];
+	float tNext[2];
+	float tDelta[2];
+	for(int axis=0; axis<2; axis++) {
+		float p = origin[axis] + dir[axis] * tStart;
+		cell[axis] = (int)floorf(p / cellSize);
+
+		if(dir[axis] > 0.0f) {
+			step[axis] = 1;
+			tDelta[axis] = cellSize / dir[axis];
+			tNext[axis] = tStart + ((cell[axis] + 1) * cellSize - p) / dir[axis];
+		} else if(dir[axis] < 0.0f) {
+			step[axis] = -1;
+			tDelta[axis] = -cellSize / dir[axis];
+			tNext[axis] = tStart + (p - cell[axis] * cellSize) / -dir[axis];
+		} else {
+			step[axis] = 0;
+			tDelta[axis] = tNext[axis] = std::numeric_limits<float>::max();
+		}
+	}
+
+	// spatials that reach into the cells along the ray can lie up to this many cells to the side
+	int reach = (int)ceilf(maxRadius / cellSize);
+
+	while(true) {
+		float tExit = std::min(std::min(tNext[0], tNext[1]), tEnd);
+
+		int sx = std::max(cell[0] - reach, 0);
+		int ex = std::min(cell[0] + reach, cellsX - 1);
+		int sy = std::max(cell[1] - reach, 0);
+		int ey = std::min(cell[1] + reach, cellsY - 1);
+
+		for(int y=sy; y<=ey; y++) {
+			for(int x=sx; x<=ex; x++) {
+				SpatialList const& spatials = cells[y * cellsX + x];
+				for(size_t i=0; i<spatials.size(); i++) {
+					float t;
+					float r = spatials[i]->getRadius();
+					if(r > 0.0f && ray.findIntersection(spatials[i]->getPosition(), r, &t) && t <= limit) {
+						limit = t;
+						hit.spatial = spatials[i];
+						hit.distance = t;
+					}
+				}
+			}
+		}
+
+		// every hit still to come lies behind the current cell
+		if(hit.spatial != NULL && hit.distance <= tExit) break;
+		if(tExit >= tEnd) break;
+
+		int axis = tNext[0] < tNext[1] ? 0 : 1;
+		cell[axis] += step[axis];
+		tNext[axis] += tDelta[axis];
+	}
+
+	return hit.spatial != NULL;
+}
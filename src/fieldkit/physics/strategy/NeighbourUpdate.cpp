@@ -9,39 +9,78 @@
 
 #include "fieldkit/physics/strategy/NeighbourUpdate.h"
 #include "fieldkit/physics/Physics.h"
+#include "fieldkit/AllocationTracker.h"
+#include "fieldkit/Profiler.h"
+#include "fieldkit/physics/space/AABBTree.h"
+#include "fieldkit/physics/space/BasicSpace.h"
+#include "fieldkit/physics/space/Octree.h"
+#include "fieldkit/physics/space/SpatialHash.h"
+
+#include <typeinfo>
 
 using namespace fieldkit::physics;
 
+namespace {
+	//! selects the neighbours of all living particles. 
+	//! For the concrete space types select resolves to their inlined template version, for Space to the virtual one.
+	template<typename SpaceType>
+	void selectNeighbours(Physics* physics, SpaceType* space, float radius)
+	{
+		// Parallel For
+		#ifdef ENABLE_OPENMP
+		int size = physics->particles.size();
+
+		#pragma omp parallel for
+		for(int i=0; i<size; i++) {
+			Particle* p = physics->particles[i];
+
+		// Single threaded
+		#else
+		for (std::vector<Particle*>::iterator it = physics->particles.begin(); it != physics->particles.end(); it++) {
+			Particle* p = *it;
+		#endif
+			// Body
+			if(p->isAlive) {
+				// every thread needs its own query volume
+				SphereBound particleQuery(p->position, radius);
+				space->select(&particleQuery, p->getNeighbours());
+			}
+		} 
+	}
+}
+
 void FixedRadiusNeighbourUpdate::apply(Physics* physics) 
 {
-	if(emptySpaceOnUpdate) 
-		physics->space->clear();
+	ALLOCATION_SCOPE("physics.neighbours");
 
-	for (std::vector<Particle*>::iterator it = physics->particles.begin(); it != physics->particles.end(); it++) {
-		Particle* p = *it;
-		if(p->isAlive)
-			physics->space->insert(p);
-	}
+	{
+		PROFILE_SCOPE("space.build");
 
+		if(emptySpaceOnUpdate) 
+			physics->space->clear();
 
-	// Parallel For
-	#ifdef ENABLE_OPENMP
-	vector<Particle*>::iterator it;
-	int size = physics->particles.size();
-
-	#pragma omp parallel for
-	for(int i=0; i<size; i++) {
-		Particle* p = physics->particles[i];
-
-	// Single threaded
-	#else
-        for (std::vector<Particle*>::iterator it = physics->particles.begin(); it != physics->particles.end(); it++) {
-		Particle* p = *it;
-	#endif
-		// Body
-		if(p->isAlive) {
-			query.position = p->position;
-			physics->space->select(&query, p->getNeighbours());
+		for (std::vector<Particle*>::iterator it = physics->particles.begin(); it != physics->particles.end(); it++) {
+			Particle* p = *it;
+			if(p->isAlive)
+				physics->space->insert(p);
 		}
-	} 
+	}
+
+	PROFILE_SCOPE("space.query");
+
+	// look up the space type once per update instead of once per particle, 
+	// subclasses might override select so only exact matches are specialised
+	Space* space = physics->space;
+	std::type_info const& type = typeid(*space);
+
+	if(type == typeid(Octree))
+		selectNeighbours(physics, static_cast<Octree*>(space), query.radius);
+	else if(type == typeid(BasicSpace))
+		selectNeighbours(physics, static_cast<BasicSpace*>(space), query.radius);
+	else if(type == typeid(SpatialHash))
+		selectNeighbours(physics, static_cast<SpatialHash*>(space), query.radius);
+	else if(type == typeid(AABBTree))
+		selectNeighbours(physics, static_cast<AABBTree*>(space), query.radius);
+	else
+		selectNeighbours(physics, space, query.radius);
 }
\ No newline at end of file
@@ -15,4 +15,36 @@ using namespace fieldkit::physics;
 void ParticleAllocator::apply(Physics* physics) 
 {
 	physics->addParticle( new Particle() );
-}
\ No newline at end of file
+}
+
+void ParticleAllocator::destroy(std::vector<Particle*>& particles)
+{
+	BOOST_FOREACH(Particle* p, particles) {
+		delete p;
+	}
+	particles.clear();
+}
+
+
+// -- Arena --------------------------------------------------------------------
+void ArenaParticleAllocator::apply(Physics* physics)
+{
+	initArena();
+	physics->addParticle( construct(arena.allocate()) );
+}
+
+void ArenaParticleAllocator::reserve(int count)
+{
+	initArena();
+	arena.reserve(count);
+}
+
+void ArenaParticleAllocator::destroy(std::vector<Particle*>& particles)
+{
+	// particles still need to release their own resources e.g. their neighbour lists
+	BOOST_FOREACH(Particle* p, particles) {
+		p->~Particle();
+	}
+	particles.clear();
+	arena.release();
+}
@@ -10,14 +10,23 @@
 #include "fieldkit/physics/strategy/ParticleUpdate.h"
 #include "fieldkit/physics/Physics.h"
 #include "fieldkit/physics/Particle.h"
+#include "fieldkit/AllocationTracker.h"
+#include "fieldkit/Profiler.h"
 
 using namespace fieldkit::physics;
 
+namespace {
+	//! particles per Constraint::applyBatch call when running in parallel
+	const int CONSTRAINT_BATCH_SIZE = 256;
+}
+
 //! updates all particles by applying all behaviours and constraints
 void ParticleUpdate::apply(Physics* physics, float dt) 
 {	
     using std::vector;
     using std::list;
+
+	ALLOCATION_SCOPE("physics.particles");
     
 #ifndef ENABLE_OPENMP
 	vector<Particle*>::iterator pbegin = physics->particles.begin();
@@ -26,6 +35,7 @@ void ParticleUpdate::apply(Physics* physics, float dt)
 	// apply behaviours
 	for (list<Behaviour*>::iterator bit = physics->behaviours.begin(); bit != physics->behaviours.end(); ++bit) {
 		Behaviour* b = *bit;
+		PROFILE_SCOPE_ID(b->getProfileID());
 		b->prepare(dt);
 
 		for (vector<Particle*>::iterator pit = pbegin; pit != pend; ++pit) {
@@ -36,13 +46,15 @@ void ParticleUpdate::apply(Physics* physics, float dt)
 	}
 
 	// update all particles
+	ParticleLifecycle& lifecycle = physics->lifecycle;
 	int numAlive = 0;
 	for (vector<Particle*>::iterator pit = pbegin; pit != pend; ++pit) {
 		Particle* p = *pit;
-		if(!p->isAlive) 
-			continue;
-		p->update(dt);
-		numAlive++;
+		if(p->isAlive) {
+			p->update(dt);
+			numAlive += p->isAlive;
+		}
+		lifecycle.track(pit - pbegin, p->isAlive);
 	}
 	physics->numActiveParticles = numAlive;
 
@@ -50,15 +62,13 @@ void ParticleUpdate::apply(Physics* physics, float dt)
 	for (int i=0; i<constraintIterations; i++) {
 		for (list<Constraint*>::iterator cit = physics->constraints.begin(); cit != physics->constraints.end(); ++cit) {
 			Constraint* c = *cit;
+			PROFILE_SCOPE_ID(c->getProfileID());
 
 			if(i==0)
 				c->prepare(dt);
 
-			for (vector<Particle*>::iterator pit = pbegin; pit != pend; ++pit) {
-				Particle* p = *pit;
-				if(p->isAlive)
-					c->apply(p);
-			}
+			if(pbegin != pend)
+				c->applyBatch(&*pbegin, pend - pbegin);
 		}
 	}
 #else
@@ -70,9 +80,11 @@ void ParticleUpdate::apply(Physics* physics, float dt)
 	// apply behaviours
 	for (list<Behaviour*>::iterator bit = physics->behaviours.begin(); bit != physics->behaviours.end(); bit++) {
 		Behaviour* b = *bit;
+		PROFILE_SCOPE_ID(b->getProfileID());
 		b->prepare(dt);
 
-		#pragma omp parallel for
+		bool isSerial = !b->isParallelSafe();
+		#pragma omp parallel for if(!isSerial)
 		for(int i=0; i < psize; i++) {
 			Particle* p = physics->particles[i];
 			if(p->isAlive)
@@ -81,14 +93,16 @@ void ParticleUpdate::apply(Physics* physics, float dt)
 	}
 
 	// update all particles
+	ParticleLifecycle& lifecycle = physics->lifecycle;
 	int numAlive = 0;
-	//#pragma omp parallel for
+	#pragma omp parallel for reduction(+:numAlive)
 	for(int i=0; i < psize; i++) {
 		Particle* p = physics->particles[i];
-		if(!p->isAlive) 
-			continue;
-		p->update(dt);
-		numAlive++;
+		if(p->isAlive) {
+			p->update(dt);
+			numAlive += p->isAlive;
+		}
+		lifecycle.track(i, p->isAlive);
 	}
 	physics->numActiveParticles = numAlive;
 
@@ -96,15 +110,17 @@ void ParticleUpdate::apply(Physics* physics, float dt)
 	for (int i=0; i<constraintIterations; i++) {
 		for (list<Constraint*>::iterator cit = physics->constraints.begin(); cit != physics->constraints.end(); cit++) {
 			Constraint* c = *cit;
+			PROFILE_SCOPE_ID(c->getProfileID());
 
 			if(i==0) 
 				c->prepare(dt);
 
-			#pragma omp parallel for
-			for(int i=0; i < psize; i++) {
-				Particle* p = physics->particles[i];
-				if(p->isAlive)
-					c->apply(p);
+			bool isSerial = !c->isParallelSafe();
+			int numBatches = (psize + CONSTRAINT_BATCH_SIZE - 1) / CONSTRAINT_BATCH_SIZE;
+			#pragma omp parallel for if(!isSerial)
+			for(int b=0; b < numBatches; b++) {
+				int first = b * CONSTRAINT_BATCH_SIZE;
+				c->applyBatch(&physics->particles[first], std::min(CONSTRAINT_BATCH_SIZE, psize - first));
 			}
 		}
 	}
@@ -16,4 +16,35 @@ using namespace fieldkit::physics;
 void SpringAllocator::apply(Physics* physics) 
 {
 	physics->addSpring( new Spring() );
-}
\ No newline at end of file
+}
+
+void SpringAllocator::destroy(std::vector<Spring*>& springs)
+{
+	BOOST_FOREACH(Spring* s, springs) {
+		delete s;
+	}
+	springs.clear();
+}
+
+
+// -- Arena --------------------------------------------------------------------
+void ArenaSpringAllocator::apply(Physics* physics)
+{
+	initArena();
+	physics->addSpring( construct(arena.allocate()) );
+}
+
+void ArenaSpringAllocator::reserve(int count)
+{
+	initArena();
+	arena.reserve(count);
+}
+
+void ArenaSpringAllocator::destroy(std::vector<Spring*>& springs)
+{
+	BOOST_FOREACH(Spring* s, springs) {
+		s->~Spring();
+	}
+	springs.clear();
+	arena.release();
+}
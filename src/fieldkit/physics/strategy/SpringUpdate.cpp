@@ -11,12 +11,15 @@
 
 #include "fieldkit/physics/Physics.h"
 #include "fieldkit/physics/Spring.h"
+#include "fieldkit/AllocationTracker.h"
 
 using namespace fieldkit::physics;
 
 //! updates all spring connections based on new particle positions
 void SpringUpdate::apply(Physics* physics) 
 {
+	ALLOCATION_SCOPE("physics.springs");
+
 	BOOST_FOREACH(Spring* s, physics->springs) {
 		if(!s->isAlive)
 			continue;
@@ -14,6 +14,7 @@
 #include "cinder/Font.h"
 
 #include "fieldkit/Logger.h"
+#include "fieldkit/AllocationTracker.h"
 #include "fieldkit/math/MathKit.h"
 #include "fieldkit/script/ObjectWrap.h"
 
@@ -79,6 +80,8 @@ namespace fieldkit { namespace script {
         // -- Shapes -----------------------------------------------------------
         void Ellipse(float x, float y, float w, float h)
         {
+            ALLOCATION_SCOPE("script.graphics2d");
+
             int numSamples = 6 + (int)(abs(w)*0.45); // abs in case w is negative
             if(numSamples > 64) numSamples = 64;
             
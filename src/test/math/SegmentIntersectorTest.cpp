@@ -0,0 +1,112 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Intersects random strokes made of short segments with SegmentIntersector and compares 
+ the result against testing every pair with Line2f::findIntersection.
+
+ Usage: SegmentIntersectorTest [--segments n] [--repeat n]
+
+ Returns 0 when both find the same intersections, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "fieldkit/math/MathKit.h"
+#include "fieldkit/math/SegmentIntersector.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+
+const float SIZE = 1000.0f;
+
+int main(int argc, char* argv[]) 
+{
+	int numSegments = 20000;
+	int numRepeats = 5;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--segments") == 0 && i + 1 < argc)
+			numSegments = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			numRepeats = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Segment Intersector Test ----" << std::endl;
+
+	// random walks of 50 segments each, a few of them long straight lines
+	randSeed(1);
+	std::vector<Line2f> lines;
+	Vec2f p;
+	float angle = 0.0f;
+	for(int i=0; i<numSegments; i++) {
+		if(i % 50 == 0) {
+			p = Vec2f(randFloat(SIZE), randFloat(SIZE));
+			angle = randFloat(6.2831853f);
+		}
+		angle += randFloat(-0.5f, 0.5f);
+		float length = i % 500 == 0 ? randFloat(100.0f, 300.0f) : randFloat(2.0f, 20.0f);
+		Vec2f next = p + Vec2f(cosf(angle), sinf(angle)) * length;
+		lines.push_back(Line2f(p, next));
+		p = next;
+	}
+
+	SegmentIntersector intersector;
+	intersector.reserve(numSegments);
+	for(int i=0; i<numSegments; i++)
+		intersector.add(lines[i]);
+
+	std::vector<SegmentIntersector::Intersection> result;
+	Profiler::Ticks start = Profiler::getTicks();
+	for(int r=0; r<numRepeats; r++)
+		intersector.findIntersections(result);
+	double gridTime = Profiler::ticksToMilliseconds(Profiler::getTicks() - start) / numRepeats;
+
+	// every pair, in the same order as the sorted result
+	std::vector<SegmentIntersector::Intersection> expected;
+	start = Profiler::getTicks();
+	for(int a=0; a<numSegments; a++) {
+		for(int b=a+1; b<numSegments; b++) {
+			SegmentIntersector::Intersection hit;
+			if(lines[a].findIntersection(lines[b], &hit.point)) {
+				hit.a = a;
+				hit.b = b;
+				expected.push_back(hit);
+			}
+		}
+	}
+	double bruteTime = Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+	bool isOK = result.size() == expected.size();
+	for(size_t i=0; isOK && i<result.size(); i++) {
+		isOK = result[i].a == expected[i].a && result[i].b == expected[i].b &&
+			(result[i].point - expected[i].point).length() < 1e-3f;
+	}
+
+	std::cout << numSegments <<" segments, "<< result.size() <<" intersections, "
+		<<"grid "<< gridTime <<" ms, all pairs "<< bruteTime <<" ms" << std::endl;
+
+	// a tiny fixed cell size is raised to the cell limit instead of allocating a huge grid
+	intersector.setCellSize(1e-4f);
+	std::vector<SegmentIntersector::Intersection> fixedResult;
+	intersector.findIntersections(fixedResult);
+	if(fixedResult.size() != expected.size()) {
+		std::cout << "FAILED: fixed cell size found "<< fixedResult.size() <<" intersections" << std::endl;
+		isOK = false;
+	}
+
+	if(!isOK) {
+		std::cout << "FAILED: expected "<< expected.size() <<" intersections" << std::endl;
+		return 1;
+	}
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
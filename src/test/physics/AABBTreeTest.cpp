@@ -0,0 +1,215 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Mixed scene of particles with varied sizes and large static obstacles in an AABBTree.
+ Every frame the particles move and a few of them die, the tree is updated via clear & insert. 
+ Sphere, box and ray queries are compared against brute force over all live spatials.
+
+ Usage: AABBTreeTest [--particles n] [--obstacles n] [--frames n]
+
+ Returns 0 when all queries match brute force, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+
+bool overlaps(SphereBound const& sphere, Spatial* s)
+{
+	float r = sphere.radius + s->getRadius();
+	return (sphere.position - s->getPosition()).lengthSquared() <= r * r;
+}
+
+bool overlaps(AABB const& box, Spatial* s)
+{
+	Vec3f p = s->getPosition();
+	Vec3f closest(std::max(box.min.x, std::min(p.x, box.max.x)),
+				  std::max(box.min.y, std::min(p.y, box.max.y)),
+				  std::max(box.min.z, std::min(p.z, box.max.z)));
+	return (closest - p).lengthSquared() <= s->getRadius() * s->getRadius();
+}
+
+bool hits(Vec3f const& origin, Vec3f const& dir, float maxDistance, Spatial* s)
+{
+	Vec3f toCenter = s->getPosition() - origin;
+	float t = std::max(0.0f, std::min(toCenter.dot(dir), maxDistance));
+	return (toCenter - dir * t).lengthSquared() <= s->getRadius() * s->getRadius();
+}
+
+//! sorts the tree result and compares it with the brute force one
+bool matches(SpatialList& result, SpatialList& expected)
+{
+	std::sort(result.begin(), result.end());
+	std::sort(expected.begin(), expected.end());
+	return result == expected;
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 20000;
+	int numObstacles = 200;
+	int numFrames = 10;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--obstacles") == 0 && i + 1 < argc)
+			numObstacles = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			numFrames = atoi(argv[++i]);
+	}
+
+	std::cout << "---- AABBTree Test ----" << std::endl;
+
+	randSeed(1);
+	std::vector<Particle*> particles;
+	for(int i=0; i<numParticles; i++) {
+		Particle* p = new Particle();
+		p->init(Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE)));
+		p->setSize(randFloat(1.0f, 10.0f));
+		particles.push_back(p);
+	}
+
+	std::vector<SphereSpatial*> obstacles;
+	for(int i=0; i<numObstacles; i++)
+		obstacles.push_back(new SphereSpatial(Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE)), randFloat(20.0f, 80.0f)));
+
+	AABBTree tree(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE), 5.0f);
+	tree.reserve(numParticles + numObstacles);
+
+	bool isOK = true;
+	double updateTime = 0.0;
+	double rebuildTime = 0.0;
+	double treeQueryTime = 0.0;
+	double bruteQueryTime = 0.0;
+	int numReinserts = 0;
+	int numQueries = 0;
+	SpatialList result;
+	SpatialList expected;
+
+	for(int frame=0; frame<numFrames; frame++) {
+		// move particles, let a few die
+		for(int i=0; i<numParticles; i++) {
+			Particle* p = particles[i];
+			p->position += Vec3f(randFloat(-2.0f, 2.0f), randFloat(-2.0f, 2.0f), randFloat(-2.0f, 2.0f));
+			if(randFloat() < 0.01f) p->isAlive = false;
+		}
+
+		std::vector<Spatial*> live;
+		for(int i=0; i<numParticles; i++) {
+			if(particles[i]->isAlive) live.push_back(particles[i]);
+		}
+		live.insert(live.end(), obstacles.begin(), obstacles.end());
+
+		// refit the existing tree
+		Profiler::Ticks start = Profiler::getTicks();
+		tree.clear();
+		for(size_t i=0; i<live.size(); i++)
+			tree.insert(live[i]);
+		updateTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+		numReinserts += tree.getNumReinserts();
+
+		// compare against building a fresh tree
+		start = Profiler::getTicks();
+		{
+			AABBTree fresh(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE), 5.0f);
+			fresh.reserve(live.size());
+			for(size_t i=0; i<live.size(); i++)
+				fresh.insert(live[i]);
+		}
+		rebuildTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+		// sphere queries around some of the particles
+		for(int i=frame; i<numParticles; i += 97) {
+			SphereBound query(particles[i]->position, 15.0f);
+
+			start = Profiler::getTicks();
+			tree.select(&query, &result);
+			treeQueryTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+			start = Profiler::getTicks();
+			expected.clear();
+			for(size_t j=0; j<live.size(); j++) {
+				if(overlaps(query, live[j])) expected.push_back(live[j]);
+			}
+			bruteQueryTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+			numQueries++;
+
+			if(!matches(result, expected)) {
+				std::cout << "FAILED: sphere query "<< i <<" in frame "<< frame <<" found "<< result.size() <<" of "<< expected.size() << std::endl;
+				isOK = false;
+			}
+		}
+
+		// box queries through the virtual interface
+		for(int i=0; i<20; i++) {
+			Vec3f min(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE));
+			AABB query(min, min + Vec3f(randFloat(100.0f), randFloat(100.0f), randFloat(100.0f)));
+			BoundingVolume* volume = &query;
+			tree.select(volume, &result);
+
+			expected.clear();
+			for(size_t j=0; j<live.size(); j++) {
+				if(overlaps(query, live[j])) expected.push_back(live[j]);
+			}
+			if(!matches(result, expected)) {
+				std::cout << "FAILED: box query "<< i <<" in frame "<< frame <<" found "<< result.size() <<" of "<< expected.size() << std::endl;
+				isOK = false;
+			}
+		}
+
+		// rays from the outside into the scene
+		for(int i=0; i<20; i++) {
+			Vec3f origin(randFloat(SIZE), randFloat(SIZE), -10.0f);
+			Vec3f dir = (Vec3f(randFloat(SIZE), randFloat(SIZE), SIZE) - origin).normalized();
+			float maxDistance = randFloat(SIZE);
+			tree.selectRay(Ray3f(origin, dir), maxDistance, &result);
+
+			expected.clear();
+			for(size_t j=0; j<live.size(); j++) {
+				if(hits(origin, dir, maxDistance, live[j])) expected.push_back(live[j]);
+			}
+			if(!matches(result, expected)) {
+				std::cout << "FAILED: ray "<< i <<" in frame "<< frame <<" hit "<< result.size() <<" of "<< expected.size() << std::endl;
+				isOK = false;
+			}
+		}
+	}
+
+	int numLeaves = tree.getNumLeaves();
+	std::cout << "leaves "<< numLeaves <<", height "<< tree.getHeight() <<" (log2 "<< log((double)numLeaves) / log(2.0) <<")" << std::endl;
+	std::cout << "update "<< updateTime / numFrames <<" ms with "<< numReinserts / numFrames <<" reinserts per frame, "
+		<<"rebuild "<< rebuildTime / numFrames <<" ms" << std::endl;
+	std::cout << "sphere query "<< treeQueryTime * 1000.0 / numQueries <<" us, "
+		<<"brute force "<< bruteQueryTime * 1000.0 / numQueries <<" us" << std::endl;
+
+	if(tree.getHeight() > 3 * log((double)numLeaves) / log(2.0)) {
+		std::cout << "FAILED: tree is out of balance" << std::endl;
+		isOK = false;
+	}
+
+	for(int i=0; i<numParticles; i++)
+		delete particles[i];
+	for(int i=0; i<numObstacles; i++)
+		delete obstacles[i];
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
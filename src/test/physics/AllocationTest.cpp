@@ -0,0 +1,111 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+/*
+ Checks that a warmed up Physics::update doesnt allocate any heap memory.
+ FieldKit needs to be compiled with ENABLE_ALLOCATION_TRACKING for this test.
+ 
+ Returns 0 when no allocations were made, 1 otherwise.
+ */
+
+#include <iostream>
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/AllocationTracker.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+int main(int argc, char* argv[]) 
+{
+	std::cout << "---- Allocation Test ----" << std::endl;
+
+	if(!AllocationTracker::isEnabled()) {
+		std::cout << "FieldKit was built without ENABLE_ALLOCATION_TRACKING - skipping test." << std::endl;
+		return 0;
+	}
+
+	// config
+	int numParticles = 10 * 1000;
+	int numWarmupFrames = 60;
+	int maxWarmupFrames = 2000;
+	int numTestFrames = 500;
+	float dt = 1.0f / 60.0f;
+
+	// setup a typical flocking simulation
+	Vec3f dimension(1000.0f, 1000.0f, 1000.0f);
+	Octree* octree = new Octree(Vec3f::zero(), dimension, 50.0f);
+	Physics* physics = new Physics(octree);
+
+	FixedRadiusNeighbourUpdate* neighbourUpdate = new FixedRadiusNeighbourUpdate();
+	neighbourUpdate->setRadius(25.0f);
+	physics->setNeighbourUpdate(neighbourUpdate);
+
+	Emitter* emitter = new Emitter(physics);
+	emitter->setPosition(dimension * 0.5f);
+	emitter->setRate(100);
+	emitter->setInterval(0.0f);
+	emitter->setMax(numParticles);
+	emitter->addBehaviour(new BoxRandom(physics->space));
+	physics->emitter = emitter;
+	physics->reserve(numParticles, 0, 64);
+
+	// flocks cluster in a few leaves, far above the average number of particles per leaf
+	octree->reserveLeaves(16);
+
+	FlockRepel* repel = new FlockRepel(physics->space);
+	repel->setRange(0.025f);
+	physics->addBehaviour(repel);
+
+	physics->addBehaviour(new BoxWrap(physics->space));
+
+	// warm up until all pools and space cells reached their final size
+	int numQuietFrames = 0;
+	int frame = 0;
+	while(numQuietFrames < numWarmupFrames) {
+		if(frame++ == maxWarmupFrames) {
+			std::cout << "FAILED: simulation still allocates after "<< maxWarmupFrames <<" frames" << std::endl;
+			AllocationTracker::report(std::cout);
+			return 1;
+		}
+
+		AllocationTracker::beginFrame();
+		physics->update(dt);
+		AllocationTracker::endFrame();
+
+		bool hasAllocated = false;
+		for(int i=0; i<AllocationTracker::getNumSubsystems(); i++) {
+			if(AllocationTracker::getFrameStats(i).allocations > 0)
+				hasAllocated = true;
+		}
+		numQuietFrames = hasAllocated ? 0 : numQuietFrames + 1;
+	}
+	std::cout << "warmed up after "<< frame <<" frames" << std::endl;
+
+	// any allocation from now on is a violation
+	AllocationTracker::resetViolations();
+	AllocationTracker::setStrict(true);
+
+	for(int i=0; i<numTestFrames; i++) {
+		AllocationTracker::beginFrame();
+		physics->update(dt);
+		AllocationTracker::endFrame();
+
+		if(AllocationTracker::getNumViolations() > 0) {
+			AllocationTracker::setStrict(false);
+			std::cout << "FAILED: frame "<< i <<" allocated memory" << std::endl;
+			AllocationTracker::report(std::cout);
+			return 1;
+		}
+	}
+
+	AllocationTracker::setStrict(false);
+	delete physics;
+
+	std::cout << "OK: "<< numTestFrames <<" frames without allocations" << std::endl;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ *      _____  __  _____  __     ____
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.
+ *   /_/        /____/ /____/ /_____/    http://www.field.io
+ */
+
+/*
+ Compares the default particle and spring allocators against ArenaParticleAllocator and
+ ArenaSpringAllocator: allocating the pools, updating a chain of springs and destroying
+ the physics again. Afterwards swaps allocators while particles and springs are alive
+ and checks the physics can still be updated.
+
+ Usage: AllocatorBenchmark [--particles n] [--frames n]
+
+ Returns 0 when the allocator swap left the physics in a usable state, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "cinder/Rand.h"
+#include "fieldkit/physics/PhysicsKit.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+using namespace boost::posix_time;
+
+const float SIZE = 1000.0f;
+
+double millisecondsSince(ptime start)
+{
+	return (microsec_clock::local_time() - start).total_microseconds() / 1000.0;
+}
+
+//! activates all particles and links every particle to the next one
+void populate(Physics* physics, int numParticles)
+{
+	physics->allocParticles(numParticles);
+	physics->allocSprings(numParticles - 1);
+
+	Particle* previous = NULL;
+	for(int i=0; i<numParticles; i++) {
+		Particle* p = physics->createParticle();
+		p->init(Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE)));
+
+		if(previous != NULL)
+			physics->createSpring()->init(previous, p, 1.0f, 0.5f);
+		previous = p;
+	}
+}
+
+void run(const char* name, bool useArena, int numParticles, int numFrames)
+{
+	double allocTime = 0.0;
+	double updateTime = 0.0;
+	double destroyTime = 0.0;
+	const int numRepeats = 5;
+
+	for(int r=0; r<numRepeats; r++) {
+		ci::Rand::randSeed(1);
+		Physics* physics = new Physics(new BasicSpace());
+		if(useArena) {
+			physics->setParticleAllocator(new ArenaParticleAllocator());
+			physics->setSpringAllocator(new ArenaSpringAllocator());
+		}
+
+		ptime start = microsec_clock::local_time();
+		populate(physics, numParticles);
+		allocTime += millisecondsSince(start);
+
+		start = microsec_clock::local_time();
+		for(int f=0; f<numFrames; f++)
+			physics->update(1.0f / 60.0f);
+		updateTime += millisecondsSince(start);
+
+		start = microsec_clock::local_time();
+		delete physics;
+		destroyTime += millisecondsSince(start);
+	}
+
+	std::cout << name <<": alloc "<< allocTime / numRepeats <<" ms, "
+		<< numFrames <<" updates "<< updateTime / numRepeats <<" ms, "
+		<<"destroy "<< destroyTime / numRepeats <<" ms" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	int numParticles = 100000;
+	int numFrames = 10;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			numFrames = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Allocator Benchmark ----" << std::endl;
+	std::cout << numParticles <<" particles, "<< numParticles - 1 <<" springs" << std::endl;
+
+	run("new/delete", false, numParticles, numFrames);
+	run("arena", true, numParticles, numFrames);
+
+	// swapping allocators destroys everything the old ones created
+	Physics* physics = new Physics(new BasicSpace());
+	populate(physics, 1000);
+	physics->update(1.0f / 60.0f);
+
+	physics->setParticleAllocator(new ArenaParticleAllocator());
+	AABB everything(Vec3f(-SIZE, -SIZE, -SIZE), Vec3f(SIZE * 2.0f, SIZE * 2.0f, SIZE * 2.0f));
+	SpatialList selected;
+	physics->space->select(&everything, &selected);
+	bool isOK = physics->particles.empty() && physics->springs.empty() && selected.empty();
+	physics->update(1.0f / 60.0f);
+
+	physics->setSpringAllocator(new ArenaSpringAllocator());
+	populate(physics, 1000);
+	physics->update(1.0f / 60.0f);
+	isOK = isOK && physics->getNumParticles() == 1000 && physics->getNumSprings() == 999;
+	delete physics;
+
+	if(!isOK) {
+		std::cout << "FAILED: allocator swap left particles or springs behind" << std::endl;
+		return 1;
+	}
+
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Compares AttractorField against the same attractors as separate AttractorPoint 
+ behaviours and measures the time both take to apply to all particles.
+
+ Usage: AttractorFieldTest [--particles n] [--attractors n]
+
+ Returns 0 when the forces match, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 50000;
+	int numAttractors = 200;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--attractors") == 0 && i + 1 < argc)
+			numAttractors = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Attractor Field Test ----" << std::endl;
+
+	randSeed(1);
+	BasicSpace space(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE));
+
+	// a few particles lie outside of the space
+	std::vector<Particle*> particles;
+	for(int i=0; i<numParticles; i++) {
+		Particle* p = new Particle();
+		p->init(Vec3f(randFloat(-50.0f, SIZE + 50.0f), randFloat(-50.0f, SIZE + 50.0f), randFloat(-50.0f, SIZE + 50.0f)));
+		particles.push_back(p);
+	}
+
+	std::vector<AttractorPoint*> points;
+	AttractorField field(&space);
+	field.setWeight(0.5f);
+
+	for(int i=0; i<numAttractors; i++) {
+		Vec3f position(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE));
+		float range = randFloat(0.02f, 0.1f);
+		float strength = randFloat(0.5f, 2.0f);
+
+		AttractorPoint* point = new AttractorPoint(&space);
+		point->setPosition(position);
+		point->setRange(range);
+		point->setWeight(strength * 0.5f);
+		points.push_back(point);
+
+		field.add(position, range, strength);
+	}
+
+	// one pass per attractor
+	Profiler::Ticks start = Profiler::getTicks();
+	for(size_t a=0; a<points.size(); a++) {
+		points[a]->prepare(0.0f);
+		for(int i=0; i<numParticles; i++)
+			points[a]->apply(particles[i]);
+	}
+	double pointTime = Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+	std::vector<Vec3f> expected(numParticles);
+	for(int i=0; i<numParticles; i++) {
+		expected[i] = particles[i]->force;
+		particles[i]->force = Vec3f::zero();
+	}
+
+	// a single pass
+	start = Profiler::getTicks();
+	field.prepare(0.0f);
+	for(int i=0; i<numParticles; i++)
+		field.apply(particles[i]);
+	double fieldTime = Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+	double maxError = 0.0;
+	int numAffected = 0;
+	for(int i=0; i<numParticles; i++) {
+		double error = (particles[i]->force - expected[i]).length();
+		maxError = std::max(maxError, error / std::max(1.0f, expected[i].length()));
+		if(expected[i].lengthSquared() > 0.0f)
+			numAffected++;
+	}
+
+	std::cout << numAttractors <<" AttractorPoints: "<< pointTime <<" ms" << std::endl;
+	std::cout << "AttractorField: "<< fieldTime <<" ms ("<< field.getNumCells() <<" cells)" << std::endl;
+	std::cout << numAffected <<" particles affected, max relative error "<< maxError << std::endl;
+
+	for(int i=0; i<numParticles; i++)
+		delete particles[i];
+	for(size_t a=0; a<points.size(); a++)
+		delete points[a];
+
+	if(maxError > 1e-4) {
+		std::cout << "FAILED: AttractorField differs from AttractorPoint" << std::endl;
+		return 1;
+	}
+
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
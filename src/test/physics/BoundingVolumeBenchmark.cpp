@@ -0,0 +1,177 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Compares the batched containsMany / intersectsMany kernels of AABB and SphereBound 
+ against testing one point or sphere at a time through contains / intersects, 
+ and checks that BasicSpace and Octree still select the same spatials.
+
+ Usage: BoundingVolumeBenchmark [--points n] [--repeat n]
+
+ Returns 0 when all results match, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+
+struct Volume {
+	const char* name;
+	BoundingVolume* volume;
+};
+
+int main(int argc, char* argv[]) 
+{
+	int numPoints = 100000;
+	int numRepeats = 20;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--points") == 0 && i + 1 < argc)
+			numPoints = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			numRepeats = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Bounding Volume Benchmark ----" << std::endl;
+
+	randSeed(1);
+	std::vector<float> x(numPoints), y(numPoints), z(numPoints), radius(numPoints);
+	for(int i=0; i<numPoints; i++) {
+		x[i] = randFloat(SIZE);
+		y[i] = randFloat(SIZE);
+		z[i] = randFloat(SIZE);
+		radius[i] = randFloat(1.0f, SIZE * 0.1f);
+	}
+
+	Vec3f center(SIZE * 0.5f, SIZE * 0.5f, SIZE * 0.5f);
+	Volume volumes[] = {
+		{ "box", new AABB(center - Vec3f(100.0f, 200.0f, 300.0f), center + Vec3f(150.0f, 50.0f, 100.0f)) },
+		{ "sphere", new SphereBound(center, SIZE * 0.25f) }
+	};
+	int numVolumes = sizeof(volumes) / sizeof(Volume);
+
+	bool isOK = true;
+	std::vector<unsigned char> expected(numPoints);
+	std::vector<unsigned char> mask(numPoints);
+	SphereBound sphere;
+
+	for(int v=0; v<numVolumes; v++) {
+		BoundingVolume* volume = volumes[v].volume;
+
+		// containment
+		double singleTime = 0.0;
+		double batchTime = 0.0;
+		int numHits = 0;
+		for(int r=0; r<numRepeats; r++) {
+			Profiler::Ticks start = Profiler::getTicks();
+			for(int i=0; i<numPoints; i++)
+				expected[i] = volume->contains(Vec3f(x[i], y[i], z[i]));
+			singleTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+			start = Profiler::getTicks();
+			numHits = volume->containsMany(&x[0], &y[0], &z[0], numPoints, &mask[0]);
+			batchTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+		}
+
+		int numExpected = std::count(expected.begin(), expected.end(), 1);
+		if(numHits != numExpected || mask != expected) {
+			std::cout << "FAILED: "<< volumes[v].name <<" containsMany differs" << std::endl;
+			isOK = false;
+		}
+		std::cout << volumes[v].name <<" contains: "<< numExpected <<" hits, "
+			<<"single "<< singleTime / numRepeats <<" ms, batch "<< batchTime / numRepeats <<" ms" << std::endl;
+
+		// intersection with spheres
+		singleTime = 0.0;
+		batchTime = 0.0;
+		for(int r=0; r<numRepeats; r++) {
+			Profiler::Ticks start = Profiler::getTicks();
+			for(int i=0; i<numPoints; i++) {
+				sphere.position.set(x[i], y[i], z[i]);
+				sphere.radius = radius[i];
+				expected[i] = volume->intersects(&sphere);
+			}
+			singleTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+			start = Profiler::getTicks();
+			numHits = volume->intersectsMany(&x[0], &y[0], &z[0], &radius[0], numPoints, &mask[0]);
+			batchTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+		}
+
+		numExpected = std::count(expected.begin(), expected.end(), 1);
+		if(numHits != numExpected || mask != expected) {
+			std::cout << "FAILED: "<< volumes[v].name <<" intersectsMany differs" << std::endl;
+			isOK = false;
+		}
+		std::cout << volumes[v].name <<" intersects: "<< numExpected <<" hits, "
+			<<"single "<< singleTime / numRepeats <<" ms, batch "<< batchTime / numRepeats <<" ms" << std::endl;
+	}
+
+	// spaces select through the batched kernels, compare against brute force
+	std::vector<PointSpatial> points(numPoints);
+	for(int i=0; i<numPoints; i++)
+		points[i].setPosition(Vec3f(x[i], y[i], z[i]));
+
+	BasicSpace basic(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE));
+	Octree octree(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE), SIZE / 16.0f);
+	for(int i=0; i<numPoints; i++) {
+		basic.insert(&points[i]);
+		octree.insert(&points[i]);
+	}
+
+	SpatialList result;
+	for(int v=0; v<numVolumes; v++) {
+		BoundingVolume* volume = volumes[v].volume;
+
+		SpatialList reference;
+		for(int i=0; i<numPoints; i++) {
+			if(volume->contains(points[i].getPosition()))
+				reference.push_back(&points[i]);
+		}
+		std::sort(reference.begin(), reference.end());
+
+		Profiler::Ticks start = Profiler::getTicks();
+		for(int r=0; r<numRepeats; r++)
+			basic.select(volume, &result);
+		double basicTime = Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+		std::sort(result.begin(), result.end());
+		if(result != reference) {
+			std::cout << "FAILED: BasicSpace selected "<< result.size() <<" of "<< reference.size() << std::endl;
+			isOK = false;
+		}
+
+		start = Profiler::getTicks();
+		for(int r=0; r<numRepeats; r++)
+			octree.select(volume, &result);
+		double octreeTime = Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+		std::sort(result.begin(), result.end());
+		if(result != reference) {
+			std::cout << "FAILED: Octree selected "<< result.size() <<" of "<< reference.size() << std::endl;
+			isOK = false;
+		}
+
+		std::cout << volumes[v].name <<" select: BasicSpace "<< basicTime / numRepeats <<" ms, "
+			<<"Octree "<< octreeTime / numRepeats <<" ms" << std::endl;
+	}
+
+	for(int v=0; v<numVolumes; v++)
+		delete volumes[v].volume;
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
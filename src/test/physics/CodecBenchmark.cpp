@@ -0,0 +1,190 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+/*
+ Measures FrameCodec throughput and compression ratio for keyframes and delta frames 
+ of slowly moving particles and checks that decoded frames match the originals 
+ within the quantisation error.
+
+ Usage: CodecBenchmark [--frames n]
+
+ Returns 0 when all decoded frames match, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+struct Result {
+	double encodeTime;
+	double decodeTime;
+	size_t bytes;
+	int numFrames;
+
+	Result() : encodeTime(0), decodeTime(0), bytes(0), numFrames(0) {}
+};
+
+//! moves all particles a little, kills and respawns a few
+void step(ParticleFrame& frame, std::vector<Vec3f>& velocities, float size)
+{
+	for(int i=0; i<frame.size(); i++) {
+		if(frame.alive[i]) {
+			velocities[i] += randVec3f(0.05f);
+			frame.positions[i] += velocities[i];
+			frame.ages[i] += 1.0f / 60.0f;
+
+			for(int axis=0; axis<3; axis++) {
+				if(frame.positions[i][axis] < 0.0f || frame.positions[i][axis] > size)
+					velocities[i][axis] *= -1.0f;
+			}
+		}
+
+		if(randFloat() < 0.001f) {
+			frame.alive[i] = !frame.alive[i];
+			frame.positions[i] = Vec3f(randFloat(size), randFloat(size), randFloat(size));
+			frame.ages[i] = 0.0f;
+		}
+	}
+}
+
+//! returns false if any alive particle was decoded outside of the quantisation error
+bool compare(ParticleFrame& expected, ParticleFrame& actual, float tolerance)
+{
+	if(expected.size() != actual.size()) 
+		return false;
+
+	for(int i=0; i<expected.size(); i++) {
+		if(expected.alive[i] != actual.alive[i])
+			return false;
+		if(!expected.alive[i]) 
+			continue;
+
+		Vec3f p = expected.positions[i];
+		for(int axis=0; axis<3; axis++) {
+			float clamped = std::min(std::max(p[axis], 0.0f), 1000.0f);
+			if(fabs(clamped - actual.positions[i][axis]) > tolerance)
+				return false;
+		}
+		if(fabs(expected.ages[i] - actual.ages[i]) > 0.001f)
+			return false;
+	}
+	return true;
+}
+
+double getMilliseconds(Profiler::Ticks start)
+{
+	return Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+}
+
+void print(const char* name, int numParticles, Result const& result)
+{
+	double rawBytes = (double)numParticles * sizeof(Vec3f) * result.numFrames;
+	double encodeTime = result.encodeTime / result.numFrames;
+	double decodeTime = result.decodeTime / result.numFrames;
+
+	std::cout << numParticles <<","<< name 
+		<<","<< result.bytes / result.numFrames 
+		<<","<< rawBytes / result.bytes
+		<<","<< encodeTime 
+		<<","<< decodeTime
+		<<","<< numParticles / (encodeTime * 1000.0) 
+		<<","<< numParticles / (decodeTime * 1000.0)
+		<< std::endl;
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numFrames = 60;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			numFrames = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Codec Benchmark ----" << std::endl;
+#ifdef ENABLE_SSE
+	std::cout << "SSE enabled" << std::endl;
+#endif
+	std::cout << "particles,frames,bytes per frame,ratio vs Vec3f,encode ms,decode ms,encode M particles/s,decode M particles/s" << std::endl;
+
+	float size = 1000.0f;
+	AABB bounds(Vec3f::zero(), Vec3f(size, size, size));
+	float tolerance = size / 65535.0f;
+	bool isOK = true;
+
+	int counts[] = { 100 * 1000, 500 * 1000 };
+	for(int c=0; c<2; c++) {
+		int numParticles = counts[c];
+		randSeed(1);
+
+		ParticleFrame frame, decoded;
+		frame.resize(numParticles);
+		std::vector<Vec3f> velocities(numParticles, Vec3f::zero());
+		for(int i=0; i<numParticles; i++) {
+			frame.positions[i] = Vec3f(randFloat(size), randFloat(size), randFloat(size));
+			frame.ages[i] = randFloat(10.0f);
+			frame.alive[i] = randFloat() < 0.9f;
+		}
+
+		FrameCodec encoder(bounds), decoder(bounds);
+		std::vector<boost::uint8_t> data;
+		Result keyframes, deltas;
+
+		for(int f=0; f<numFrames; f++) {
+			bool isKeyframe = f % 30 == 0;
+			Result& result = isKeyframe ? keyframes : deltas;
+
+			Profiler::Ticks start = Profiler::getTicks();
+			encoder.encode(frame, isKeyframe, data);
+			result.encodeTime += getMilliseconds(start);
+
+			start = Profiler::getTicks();
+			decoder.decode(&data[0], data.size(), decoded);
+			result.decodeTime += getMilliseconds(start);
+
+			result.bytes += data.size();
+			result.numFrames++;
+
+			if(!compare(frame, decoded, tolerance)) {
+				std::cout << "FAILED: frame "<< f <<" doesn't match after decoding" << std::endl;
+				isOK = false;
+			}
+
+			step(frame, velocities, size);
+		}
+
+		print("keyframe", numParticles, keyframes);
+		print("delta", numParticles, deltas);
+	}
+
+	// lossless array compression
+	std::vector<float> values(500 * 1000);
+	for(size_t i=0; i<values.size(); i++)
+		values[i] = sinf(i * 0.001f) * 100.0f;
+
+	std::vector<boost::uint8_t> compressed;
+	std::vector<float> decompressed(values.size());
+	size_t bytes = values.size() * sizeof(float);
+	FrameCodec::compress(&values[0], bytes, sizeof(float), compressed);
+	FrameCodec::decompress(&compressed[0], compressed.size(), &decompressed[0], bytes, sizeof(float));
+
+	if(memcmp(&values[0], &decompressed[0], bytes) != 0) {
+		std::cout << "FAILED: lossless compression doesn't round trip" << std::endl;
+		isOK = false;
+	}
+	std::cout << "lossless float array ratio: "<< (double)bytes / compressed.size() << std::endl;
+
+	std::cout << "---- Done ----" << std::endl;
+	return isOK ? 0 : 1;
+}
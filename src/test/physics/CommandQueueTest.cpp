@@ -0,0 +1,93 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+/*
+ Several threads post commands to a Physics while it is updated on the main thread.
+ Checks that every command is applied exactly once and in order per producer.
+
+ Returns 0 when all commands were applied, 1 otherwise.
+ */
+
+#include <iostream>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+#include "fieldkit/physics/PhysicsKit.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const int NUM_PRODUCERS = 4;
+const int NUM_COMMANDS = 20000;
+
+//! only touched by the simulation thread
+std::vector<int> lastValue(NUM_PRODUCERS, -1);
+int numOutOfOrder = 0;
+
+void receive(int producer, int value)
+{
+	if(value != lastValue[producer] + 1)
+		numOutOfOrder++;
+	lastValue[producer] = value;
+}
+
+void producerMain(Physics* physics, int producer)
+{
+	for(int i=0; i<NUM_COMMANDS; i++) {
+		physics->post(boost::bind(&receive, producer, i));
+
+		if(i % 100 == 0)
+			physics->post(new SpawnParticlesCommand(Vec3f::zero(), 1));
+	}
+}
+
+int main(int argc, char* argv[]) 
+{
+	std::cout << "---- Command Queue Test ----" << std::endl;
+
+	Physics* physics = new Physics(new BasicSpace());
+	physics->setParticleUpdate(NULL);
+	physics->setSpringUpdate(NULL);
+
+	std::vector<boost::thread*> producers;
+	for(int i=0; i<NUM_PRODUCERS; i++)
+		producers.push_back(new boost::thread(producerMain, physics, i));
+
+	// keep updating while the producers post
+	int numUpdates = 0;
+	bool isRunning = true;
+	while(isRunning) {
+		physics->update(1.0f / 60.0f);
+		numUpdates++;
+
+		isRunning = false;
+		for(int i=0; i<NUM_PRODUCERS; i++)
+			isRunning = isRunning || lastValue[i] < NUM_COMMANDS - 1;
+	}
+
+	for(int i=0; i<NUM_PRODUCERS; i++) {
+		producers[i]->join();
+		delete producers[i];
+	}
+	physics->applyCommands();
+
+	int numExpected = NUM_PRODUCERS * NUM_COMMANDS / 100;
+	std::cout << numUpdates <<" updates, "<< physics->getNumParticles() <<" of "<< numExpected <<" particles spawned" << std::endl;
+
+	bool isOK = numOutOfOrder == 0 && physics->getNumParticles() == numExpected;
+	delete physics;
+
+	if(!isOK) {
+		std::cout << "FAILED: "<< numOutOfOrder <<" commands out of order" << std::endl;
+		return 1;
+	}
+
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
@@ -0,0 +1,134 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Compares Constraint::applyBatch of the built-in constraints against calling apply 
+ for every particle, in scenes where only a few particles are affected.
+
+ Usage: ConstraintTest [--particles n] [--repeat n]
+
+ Returns 0 when both produce the same positions, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+
+struct Scene {
+	const char* name;
+	Constraint* constraint;
+};
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 100000;
+	int numRepeats = 20;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			numRepeats = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Constraint Test ----" << std::endl;
+
+	randSeed(1);
+	std::vector<Particle*> particles;
+	std::vector<Vec3f> positions;
+	std::vector<Vec3f> prevs;
+	for(int i=0; i<numParticles; i++) {
+		Particle* p = new Particle();
+		p->init(Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE)));
+		p->prev = p->position - Vec3f(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f));
+		p->setSize(randFloat(1.0f, 3.0f));
+		if(i % 10 == 0) p->isAlive = false;
+		if(i % 17 == 0) p->ignoreConstraints = true;
+		particles.push_back(p);
+		positions.push_back(p->position);
+		prevs.push_back(p->prev);
+	}
+
+	Vec3f center(SIZE * 0.5f, SIZE * 0.5f, SIZE * 0.5f);
+	Scene scenes[] = {
+		{ "obstacle sphere", new SphereConstraint(SphereBound(center, SIZE * 0.2f), false) },
+		{ "bounding sphere", new SphereConstraint(SphereBound(center, SIZE * 0.8f), true) },
+		{ "floor", new WallConstraint(AXIS_Y, false, SIZE * 0.03f, 0.5f) },
+		{ "ceiling", new WallConstraint(AXIS_Y, true, SIZE * 0.97f, 0.5f) }
+	};
+	int numScenes = sizeof(scenes) / sizeof(Scene);
+
+	bool isOK = true;
+	for(int s=0; s<numScenes; s++) {
+		Constraint* c = scenes[s].constraint;
+		c->prepare(0.0f);
+
+		std::vector<Vec3f> expected(numParticles);
+		std::vector<Vec3f> expectedPrev(numParticles);
+		double applyTime = 0.0;
+		double batchTime = 0.0;
+
+		for(int r=0; r<numRepeats; r++) {
+			for(int i=0; i<numParticles; i++) {
+				particles[i]->position = positions[i];
+				particles[i]->prev = prevs[i];
+			}
+
+			Profiler::Ticks start = Profiler::getTicks();
+			for(int i=0; i<numParticles; i++) {
+				if(particles[i]->isAlive)
+					c->apply(particles[i]);
+			}
+			applyTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+			for(int i=0; i<numParticles; i++) {
+				expected[i] = particles[i]->position;
+				expectedPrev[i] = particles[i]->prev;
+				particles[i]->position = positions[i];
+				particles[i]->prev = prevs[i];
+			}
+
+			start = Profiler::getTicks();
+			c->applyBatch(&particles[0], numParticles);
+			batchTime += Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+		}
+
+		int numAffected = 0;
+		int numDifferent = 0;
+		for(int i=0; i<numParticles; i++) {
+			if(expected[i] != positions[i]) numAffected++;
+			if(particles[i]->position != expected[i] || particles[i]->prev != expectedPrev[i])
+				numDifferent++;
+		}
+
+		std::cout << scenes[s].name <<": "<< numAffected * 100.0 / numParticles <<"% affected, "
+			<<"apply "<< applyTime / numRepeats <<" ms, applyBatch "<< batchTime / numRepeats <<" ms" << std::endl;
+
+		if(numDifferent > 0) {
+			std::cout << "FAILED: "<< numDifferent <<" particles differ" << std::endl;
+			isOK = false;
+		}
+
+		delete c;
+	}
+
+	for(int i=0; i<numParticles; i++)
+		delete particles[i];
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
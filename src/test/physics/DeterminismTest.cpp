@@ -0,0 +1,170 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+/*
+ Checks that a simulation in deterministic mode gives the exact same state for the 
+ same seed, however many threads are used.
+ 
+ Runs the same setup several times and compares the hash of the particle state 
+ every few frames. The final hash is printed so runs of different builds can be 
+ diffed too.
+ 
+ Usage:
+	DeterminismTest [--frames n] [--seed s]
+ 
+ Returns 0 when all runs match, 1 otherwise.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+#include "fieldkit/physics/PhysicsKit.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const int HASH_INTERVAL = 10;
+
+//! emitter churn, flocking, collisions and springs all in one simulation
+Physics* createPhysics(unsigned int seed)
+{
+	int numParticles = 5000;
+	Vec3f dimension(1000.0f, 1000.0f, 1000.0f);
+
+	Physics* physics = new Physics(new Octree(Vec3f::zero(), dimension, 50.0f));
+	physics->setDeterministic(true, seed);
+
+	FixedRadiusNeighbourUpdate* neighbourUpdate = new FixedRadiusNeighbourUpdate();
+	neighbourUpdate->setRadius(25.0f);
+	physics->setNeighbourUpdate(neighbourUpdate);
+
+	Emitter* emitter = new Emitter(physics);
+	emitter->setPosition(dimension * 0.5f);
+	emitter->setRate(50);
+	emitter->setInterval(0.0f);
+	emitter->setMax(numParticles);
+	emitter->addBehaviour(new BoxRandom(physics->space));
+
+	Initializer* initializer = new Initializer();
+	initializer->setLifeTime(2.0f);
+	initializer->setLifeTimeVariance(0.5f);
+	initializer->setSize(5.0f);
+	initializer->setSizeVariance(0.5f);
+	emitter->addBehaviour(initializer);
+	physics->emitter = emitter;
+	physics->reserve(numParticles, 500, 64);
+
+	FlockAttract* attract = new FlockAttract(physics->space);
+	attract->setRange(0.025f);
+	attract->setWeight(0.01f);
+	physics->addBehaviour(attract);
+
+	FlockAlign* align = new FlockAlign(physics->space);
+	align->setRange(0.025f);
+	align->setWeight(0.01f);
+	physics->addBehaviour(align);
+
+	FlockRepel* repel = new FlockRepel(physics->space);
+	repel->setRange(0.0125f);
+	repel->setWeight(0.02f);
+	physics->addBehaviour(repel);
+
+	physics->addBehaviour(new BoxWrap(physics->space));
+	physics->addConstraint(new CollisionConstraint());
+
+	// a chain of springs between perpetual particles
+	Particle* previous = NULL;
+	for(int i=0; i<500; i++) {
+		Particle* p = physics->createParticle();
+		p->init(Vec3f(i * 2.0f, 500.0f, 500.0f));
+		p->lifeTime = Particle::LIFETIME_PERPETUAL;
+		if(i == 0) p->lock();
+
+		if(previous != NULL) {
+			Spring* s = physics->createSpring();
+			s->init(previous, p, 2.0f, 0.5f);
+		}
+		previous = p;
+	}
+
+	return physics;
+}
+
+void run(unsigned int seed, int numFrames, std::vector<boost::uint64_t>& hashes)
+{
+	float dt = 1.0f / 60.0f;
+	Physics* physics = createPhysics(seed);
+
+	hashes.clear();
+	for(int i=1; i<=numFrames; i++) {
+		physics->update(dt);
+		if(i % HASH_INTERVAL == 0 || i == numFrames)
+			hashes.push_back(physics->getStateHash());
+	}
+
+	delete physics;
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numFrames = 300;
+	unsigned int seed = 12345;
+
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--frames") == 0 && i+1 < argc) {
+			numFrames = std::max(1, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) {
+			seed = atoi(argv[++i]);
+		} else {
+			std::cerr << "usage: "<< argv[0] <<" [--frames n] [--seed s]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << "---- Determinism Test ----" << std::endl;
+
+	// thread counts to compare, single threaded is the reference
+	std::vector<int> threadCounts;
+	threadCounts.push_back(1);
+#ifdef ENABLE_OPENMP
+	int maxThreads = omp_get_max_threads();
+	for(int n=2; n<maxThreads; n*=2)
+		threadCounts.push_back(n);
+	if(maxThreads > 1)
+		threadCounts.push_back(maxThreads);
+#endif
+
+	// at least check that two runs match
+	if(threadCounts.size() == 1)
+		threadCounts.push_back(1);
+
+	std::vector<boost::uint64_t> reference;
+	std::vector<boost::uint64_t> hashes;
+
+	for(int t=0; t<threadCounts.size(); t++) {
+#ifdef ENABLE_OPENMP
+		omp_set_num_threads(threadCounts[t]);
+#endif
+		run(seed, numFrames, t == 0 ? reference : hashes);
+		if(t == 0) continue;
+
+		for(int i=0; i<reference.size(); i++) {
+			if(hashes[i] != reference[i]) {
+				int frame = std::min((i + 1) * HASH_INTERVAL, numFrames);
+				std::cout << "FAILED: "<< threadCounts[t] <<" threads diverged by frame "<< frame << std::endl;
+				return 1;
+			}
+		}
+		std::cout << threadCounts[t] <<" threads: OK" << std::endl;
+	}
+
+	std::cout << "seed "<< seed <<", "<< numFrames <<" frames, hash "<< std::hex << reference.back() << std::dec << std::endl;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
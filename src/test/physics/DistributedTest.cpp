@@ -0,0 +1,273 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Runs a flocking simulation with DistributedPhysics in several processes that talk 
+ to each other over localhost and compares the result against the same simulation 
+ in a single Physics.
+
+ Usage: DistributedTest [--particles n] [--frames n]
+
+ Returns 0 when all process counts match the single process result, 1 otherwise.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#ifndef _WIN32
+	#include <sys/types.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+#endif
+
+#include <boost/bind.hpp>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+const float RADIUS = 25.0f;
+const int BASE_PORT = 47000;
+
+//! behaviours are set up relative to the whole world, not the domain
+void addBehaviours(Physics* physics, Space* world)
+{
+	FlockAttract* attract = new FlockAttract(world);
+	attract->setRange(RADIUS / SIZE);
+	attract->setWeight(0.01f);
+	physics->addBehaviour(attract);
+
+	FlockRepel* repel = new FlockRepel(world);
+	repel->setRange(RADIUS * 0.5f / SIZE);
+	repel->setWeight(0.02f);
+	physics->addBehaviour(repel);
+
+	FlockAlign* align = new FlockAlign(world);
+	align->setRange(RADIUS / SIZE);
+	align->setWeight(0.01f);
+	physics->addBehaviour(align);
+
+	physics->addBehaviour(new BoxWrap(world));
+}
+
+Physics* createDomain(AABB const& bounds, Space* world)
+{
+	Physics* physics = new Physics(new Octree(bounds.min, bounds.max - bounds.min, RADIUS));
+	addBehaviours(physics, world);
+	return physics;
+}
+
+Vec3f getPosition(int index)
+{
+	return Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE));
+}
+
+std::string getResultPath(int numRanks, int rank)
+{
+	std::stringstream ss;
+	ss << "DistributedTest."<< numRanks <<"."<< rank;
+	return ss.str();
+}
+
+#ifndef _WIN32
+
+//! simulates one slab and writes id, position and neighbour count of its particles after every frame
+int runRank(int rank, int numRanks, int numParticles, int numFrames)
+{
+	try {
+		float dt = 1.0f / 60.0f;
+		Vec3f dimension(SIZE, SIZE, SIZE);
+		BasicSpace world(Vec3f::zero(), dimension);
+
+		DistributedPhysics physics(AABB(Vec3f::zero(), dimension), rank, numRanks, RADIUS, 
+								   boost::bind(&createDomain, _1, &world));
+		physics.setNeighbourRadius(RADIUS);
+
+		std::vector<std::string> hosts(numRanks, "127.0.0.1");
+		physics.connect(hosts, BASE_PORT + numRanks * 10);
+
+		// every rank creates all particles in the same order to get the same ids
+		randSeed(1);
+		for(int i=0; i<numParticles; i++)
+			physics.createParticle(getPosition(i));
+
+		std::ofstream out(getResultPath(numRanks, rank).c_str());
+		out.precision(9);
+		Profiler::Ticks start = Profiler::getTicks();
+
+		for(int f=0; f<numFrames; f++) {
+			physics.update(dt);
+
+			std::vector<Particle*>& particles = physics.getPhysics()->particles;
+			out << f <<" "<< physics.getNumParticles() <<" "<< physics.getNumMigrations() << "\n";
+			for(size_t i=0; i<particles.size(); i++) {
+				Particle* p = particles[i];
+				if(!p->isAlive) continue;
+				out << p->id <<" "<< p->position.x <<" "<< p->position.y <<" "<< p->position.z <<" "<< p->getNeighbours()->size() << "\n";
+			}
+		}
+
+		if(rank == 0) {
+			std::cout << numRanks <<" processes: "
+				<< Profiler::ticksToMilliseconds(Profiler::getTicks() - start) / numFrames <<" ms/frame" << std::endl;
+		}
+		return 0;
+
+	} catch(const char* error) {
+		std::cout << "rank "<< rank <<": "<< error << std::endl;
+	}
+	return 1;
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 10000;
+	int numFrames = 10;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			numFrames = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Distributed Physics Test ----" << std::endl;
+
+	float dt = 1.0f / 60.0f;
+	Vec3f dimension(SIZE, SIZE, SIZE);
+
+	// single process reference
+	randSeed(1);
+	Physics* reference = new Physics(new Octree(Vec3f::zero(), dimension, RADIUS));
+	FixedRadiusNeighbourUpdate* neighbourUpdate = new FixedRadiusNeighbourUpdate();
+	neighbourUpdate->setRadius(RADIUS);
+	reference->setNeighbourUpdate(neighbourUpdate);
+	addBehaviours(reference, reference->space);
+
+	for(int i=0; i<numParticles; i++)
+		reference->createParticle()->init(getPosition(i));
+
+	std::vector< std::vector<Vec3f> > expected(numFrames);
+	std::vector< std::vector<int> > expectedNeighbours(numFrames);
+
+	Profiler::Ticks start = Profiler::getTicks();
+	for(int f=0; f<numFrames; f++) {
+		reference->update(dt);
+
+		for(int i=0; i<numParticles; i++) {
+			Particle* p = reference->particles[i];
+			expected[f].push_back(p->position);
+			expectedNeighbours[f].push_back(p->getNeighbours()->size());
+		}
+	}
+	std::cout << "1 process (Physics): "<< Profiler::ticksToMilliseconds(Profiler::getTicks() - start) / numFrames <<" ms/frame" << std::endl;
+	delete reference;
+
+	bool isOK = true;
+	for(int numRanks=2; numRanks<=4; numRanks++) {
+		std::vector<pid_t> children;
+		for(int r=0; r<numRanks; r++) {
+			pid_t pid = fork();
+			if(pid == 0)
+				_exit(runRank(r, numRanks, numParticles, numFrames));
+			children.push_back(pid);
+		}
+
+		bool hasFailed = false;
+		for(int r=0; r<numRanks; r++) {
+			int status = 0;
+			waitpid(children[r], &status, 0);
+			if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+				hasFailed = true;
+		}
+
+		if(hasFailed) {
+			std::cout << "FAILED: "<< numRanks <<" processes didn't finish" << std::endl;
+			isOK = false;
+			continue;
+		}
+
+		// every particle needs to be owned by exactly one process in every frame
+		std::vector< std::vector<int> > numOwners(numFrames, std::vector<int>(numParticles, 0));
+		double sumError = 0.0;
+		double maxError = 0.0;
+		int numCompared = 0;
+		int numNeighbourErrors = 0;
+		int numMigrations = 0;
+
+		for(int r=0; r<numRanks; r++) {
+			std::string path = getResultPath(numRanks, r);
+			std::ifstream in(path.c_str());
+
+			for(int f=0; f<numFrames; f++) {
+				int frame, count, migrations;
+				in >> frame >> count >> migrations;
+				numMigrations += migrations;
+
+				for(int i=0; i<count; i++) {
+					int id, neighbours;
+					Vec3f position;
+					in >> id >> position.x >> position.y >> position.z >> neighbours;
+
+					int index = id - 1;
+					if(index < 0 || index >= numParticles) continue;
+					numOwners[f][index]++;
+
+					double error = (position - expected[f][index]).length();
+					maxError = std::max(maxError, error);
+					sumError += error;
+					numCompared++;
+					if(neighbours != expectedNeighbours[f][index])
+						numNeighbourErrors++;
+				}
+			}
+			in.close();
+			remove(path.c_str());
+		}
+
+		int numOwnershipErrors = 0;
+		for(int f=0; f<numFrames; f++) {
+			for(int i=0; i<numParticles; i++) {
+				if(numOwners[f][i] != 1)
+					numOwnershipErrors++;
+			}
+		}
+
+		std::cout << numRanks <<" processes: "<< numMigrations <<" migrations, "
+			<<"position error avg "<< sumError / std::max(numCompared, 1) <<" max "<< maxError <<", "
+			<< numNeighbourErrors <<" neighbour count differences, "
+			<< numOwnershipErrors <<" ownership errors" << std::endl;
+
+		// the neighbour sums come in a different order, see PartitionedTest
+		if(numOwnershipErrors > 0 || sumError / numCompared > 0.001 || numNeighbourErrors > numCompared / 1000) {
+			std::cout << "FAILED: "<< numRanks <<" processes differ from the single process result" << std::endl;
+			isOK = false;
+		}
+	}
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
+
+#else
+
+int main(int argc, char* argv[]) 
+{
+	std::cout << "DistributedTest: not supported on this platform" << std::endl;
+	return 0;
+}
+
+#endif
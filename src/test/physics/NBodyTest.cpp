@@ -0,0 +1,125 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Compares NBodyGravity with different opening angles against the exact sum over 
+ all pairs and measures the time for one step of all particles.
+
+ Usage: NBodyTest [--particles n]
+
+ Returns 0 when the approximation stays close to the exact forces, 1 otherwise. 
+ The timings are only reported.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+const int NUM_CHECKED = 500;
+
+//! a few dense clusters in an otherwise sparse space
+Vec3f getPosition(int index)
+{
+	Vec3f centers[3] = { Vec3f(300, 300, 300), Vec3f(700, 500, 400), Vec3f(400, 700, 700) };
+	if(index % 4 == 0)
+		return Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE));
+
+	Vec3f offset(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f));
+	return centers[index % 3] + offset * (randFloat(10.0f, 100.0f));
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 100000;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+	}
+
+	std::cout << "---- NBody Test ----" << std::endl;
+
+	randSeed(1);
+	Octree tree(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE), 20.0f);
+
+	std::vector<Particle*> particles;
+	for(int i=0; i<numParticles; i++) {
+		Particle* p = new Particle();
+		p->init(getPosition(i));
+		p->weight = randFloat(0.5f, 2.0f);
+		particles.push_back(p);
+		tree.insert(p);
+	}
+
+	NBodyGravity gravity(&tree);
+	float softening = tree.toAbsolute(gravity.getSoftening());
+	float softeningSq = softening * softening;
+
+	// exact forces for a subset
+	Profiler::Ticks start = Profiler::getTicks();
+	std::vector<Vec3f> expected(NUM_CHECKED);
+	for(int i=0; i<NUM_CHECKED; i++) {
+		Vec3f force = Vec3f::zero();
+		for(int j=0; j<numParticles; j++) {
+			if(i == j) continue;
+			Vec3f d = particles[j]->position - particles[i]->position;
+			float r2 = d.lengthSquared() + softeningSq;
+			force += d * (particles[j]->getMass() / (r2 * sqrtf(r2)));
+		}
+		expected[i] = force * gravity.getWeight();
+	}
+	double exactTime = Profiler::ticksToMilliseconds(Profiler::getTicks() - start) * numParticles / NUM_CHECKED;
+	std::cout << "all pairs: "<< exactTime <<" ms (estimated)" << std::endl;
+
+	bool isOK = true;
+	float thetas[] = { 0.3f, 0.5f, 0.8f };
+	for(int t=0; t<3; t++) {
+		gravity.setTheta(thetas[t]);
+
+		start = Profiler::getTicks();
+		gravity.prepare(0.0f);
+
+		int size = numParticles;
+#ifdef ENABLE_OPENMP
+		#pragma omp parallel for
+#endif
+		for(int i=0; i<size; i++) {
+			particles[i]->force = Vec3f::zero();
+			gravity.apply(particles[i]);
+		}
+		double time = Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+		double sumError = 0.0;
+		for(int i=0; i<NUM_CHECKED; i++)
+			sumError += (particles[i]->force - expected[i]).length() / expected[i].length();
+		double error = sumError / NUM_CHECKED;
+
+		std::cout << "theta "<< thetas[t] <<": "<< time <<" ms, average relative error "<< error << std::endl;
+
+		// the usual accuracy of Barnes-Hut with a monopole expansion
+		if(error > thetas[t] * thetas[t] * 0.1) {
+			std::cout << "FAILED: approximation error is too large" << std::endl;
+			isOK = false;
+		}
+	}
+
+	for(int i=0; i<numParticles; i++)
+		delete particles[i];
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
@@ -0,0 +1,279 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+/*
+ Compares a flocking simulation with a chain of springs in PartitionedPhysics 
+ against the same simulation in a single Physics, then measures the update time 
+ for different numbers of domains.
+
+ Usage: PartitionedTest [--particles n] [--frames n]
+
+ Returns 0 when a single domain matches the Physics exactly, springs across domain 
+ boundaries match a Physics applying them in the same order and more domains match 
+ within a tolerance, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <boost/bind.hpp>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+const float RADIUS = 25.0f;
+const int CHAIN_LENGTH = 100;
+
+//! behaviours are set up relative to the whole world, not the domain
+void addBehaviours(Physics* physics, Space* world)
+{
+	FlockAttract* attract = new FlockAttract(world);
+	attract->setRange(RADIUS / SIZE);
+	attract->setWeight(0.01f);
+	physics->addBehaviour(attract);
+
+	FlockRepel* repel = new FlockRepel(world);
+	repel->setRange(RADIUS * 0.5f / SIZE);
+	repel->setWeight(0.02f);
+	physics->addBehaviour(repel);
+
+	FlockAlign* align = new FlockAlign(world);
+	align->setRange(RADIUS / SIZE);
+	align->setWeight(0.01f);
+	physics->addBehaviour(align);
+
+	physics->addBehaviour(new BoxWrap(world));
+}
+
+Physics* createDomain(AABB const& bounds, Space* world)
+{
+	Physics* physics = new Physics(new Octree(bounds.min, bounds.max - bounds.min, RADIUS));
+	addBehaviours(physics, world);
+	return physics;
+}
+
+//! the initial state of every particle
+Vec3f getPosition(int index)
+{
+	return Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE));
+}
+
+Vec3f getChainPosition(int index)
+{
+	// crosses all slabs along x
+	return Vec3f(5.0f + index * 9.9f, SIZE * 0.5f, SIZE * 0.5f);
+}
+
+Physics* createSpringDomain(AABB const& bounds)
+{
+	return new Physics(new BasicSpace());
+}
+
+//! springs only, the reference applies the springs within each slab first and then those 
+//! across a boundary, the same order PartitionedPhysics uses - every spring has to see the 
+//! current positions of both ends to match exactly
+bool testSprings(int numDomains)
+{
+	float dt = 1.0f / 60.0f;
+	float slabWidth = SIZE / numDomains;
+	float restLength = 9.2f;
+	int numFrames = 10;
+
+	Physics* reference = new Physics(new BasicSpace());
+	PartitionedPhysics physics(AABB(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE)), numDomains, RADIUS, &createSpringDomain);
+
+	std::vector<int> domainIndices;
+	for(int i=0; i<CHAIN_LENGTH; i++) {
+		// at least 4 units away from the slab boundaries of up to 8 domains
+		Vec3f position(5.6f + i * 9.6f, SIZE * 0.5f, SIZE * 0.5f);
+		reference->createParticle()->init(position);
+		physics.createParticle(position);
+		domainIndices.push_back(std::min((int)(position.x / slabWidth), numDomains - 1));
+	}
+
+	for(int d=0; d<=numDomains; d++) {
+		for(int i=1; i<CHAIN_LENGTH; i++) {
+			bool isBoundary = domainIndices[i - 1] != domainIndices[i];
+			if(d < numDomains ? isBoundary || domainIndices[i] != d : !isBoundary) 
+				continue;
+			reference->createSpring()->init(reference->particles[i - 1], reference->particles[i], restLength, 0.5f);
+			physics.createSpring(i, i + 1, restLength, 0.5f);
+		}
+	}
+
+	double maxError = 0.0;
+	int numMigrations = 0;
+	for(int f=0; f<numFrames; f++) {
+		reference->update(dt);
+		physics.update(dt);
+		numMigrations += physics.getNumMigrations();
+
+		for(int i=0; i<CHAIN_LENGTH; i++)
+			maxError = std::max(maxError, (double)(physics.getParticle(i + 1)->position - reference->particles[i]->position).length());
+	}
+	delete reference;
+
+	// the order of the reference only holds while no particle changes its domain
+	if(numMigrations > 0 || maxError > 0.0) {
+		std::cout << "FAILED: "<< numDomains <<" domains, springs differ by "<< maxError <<" ("<< numMigrations <<" migrations)" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+double getMilliseconds(Profiler::Ticks start)
+{
+	return Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 20000;
+	int numFrames = 10;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			numFrames = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Partitioned Physics Test ----" << std::endl;
+
+	float dt = 1.0f / 60.0f;
+	Vec3f dimension(SIZE, SIZE, SIZE);
+
+	// single domain reference
+	randSeed(1);
+	Physics* reference = new Physics(new Octree(Vec3f::zero(), dimension, RADIUS));
+	FixedRadiusNeighbourUpdate* neighbourUpdate = new FixedRadiusNeighbourUpdate();
+	neighbourUpdate->setRadius(RADIUS);
+	reference->setNeighbourUpdate(neighbourUpdate);
+	addBehaviours(reference, reference->space);
+
+	for(int i=0; i<numParticles; i++)
+		reference->createParticle()->init(getPosition(i));
+
+	for(int i=0; i<CHAIN_LENGTH; i++) {
+		Particle* p = reference->createParticle();
+		p->init(getChainPosition(i));
+		if(i > 0)
+			reference->createSpring()->init(reference->particles[numParticles + i - 1], p, 9.9f, 0.5f);
+	}
+
+	std::vector< std::vector<Vec3f> > expected(numFrames);
+	std::vector< std::vector<int> > expectedNeighbours(numFrames);
+
+	Profiler::Ticks start = Profiler::getTicks();
+	for(int f=0; f<numFrames; f++) {
+		reference->update(dt);
+
+		for(int i=0; i<(int)reference->particles.size(); i++) {
+			Particle* p = reference->particles[i];
+			expected[f].push_back(p->position);
+			expectedNeighbours[f].push_back(p->getNeighbours()->size());
+		}
+	}
+	double referenceTime = getMilliseconds(start) / numFrames;
+	std::cout << "1 domain (Physics): "<< referenceTime <<" ms/frame" << std::endl;
+
+	bool isOK = true;
+	int domainCounts[] = { 1, 2, 4, 8 };
+	for(int c=0; c<4; c++)
+		isOK &= testSprings(domainCounts[c]);
+	if(isOK)
+		std::cout << "springs across boundaries match: OK" << std::endl;
+
+	// particles a domain created itself have ids the table of locations doesn't know yet
+	{
+		PartitionedPhysics physics(AABB(Vec3f::zero(), dimension), 2, RADIUS, &createSpringDomain);
+		Particle* p = physics.getDomain(0)->createParticle();
+		p->init(Vec3f(SIZE * 0.75f, SIZE * 0.5f, SIZE * 0.5f));
+		p->id = 1000;
+		physics.update(dt);
+		if(physics.getNumMigrations() != 1 || physics.getParticle(1000) == NULL) {
+			std::cout << "FAILED: particle created by a domain didn't migrate" << std::endl;
+			isOK = false;
+		}
+	}
+
+	// partitioned
+	for(int c=0; c<4; c++) {
+		int numDomains = domainCounts[c];
+
+		randSeed(1);
+		PartitionedPhysics physics(AABB(Vec3f::zero(), dimension), numDomains, RADIUS, 
+								   boost::bind(&createDomain, _1, reference->space));
+		physics.setNeighbourRadius(RADIUS);
+
+		for(int i=0; i<numParticles; i++)
+			physics.createParticle(getPosition(i));
+
+		for(int i=0; i<CHAIN_LENGTH; i++) {
+			Particle* p = physics.createParticle(getChainPosition(i));
+			if(i > 0)
+				physics.createSpring(p->id - 1, p->id, 9.9f, 0.5f);
+		}
+
+		double maxError = 0.0;
+		double sumError = 0.0;
+		int numCompared = 0;
+		int numNeighbourErrors = 0;
+		int numMigrations = 0;
+		double time = 0.0;
+
+		for(int f=0; f<numFrames; f++) {
+			start = Profiler::getTicks();
+			physics.update(dt);
+			time += getMilliseconds(start);
+			numMigrations += physics.getNumMigrations();
+
+			// ids are assigned in creation order in both
+			for(int i=0; i<(int)expected[f].size(); i++) {
+				Particle* p = physics.getParticle(i + 1);
+				if(p == NULL) {
+					numNeighbourErrors++;
+					continue;
+				}
+				double error = (p->position - expected[f][i]).length();
+				maxError = std::max(maxError, error);
+				sumError += error;
+				numCompared++;
+				if((int)p->getNeighbours()->size() != expectedNeighbours[f][i])
+					numNeighbourErrors++;
+			}
+		}
+
+		std::cout << numDomains <<" domains: "<< time / numFrames <<" ms/frame, "<< numMigrations <<" migrations, "
+			<<"position error avg "<< sumError / numCompared <<" max "<< maxError <<", "
+			<< numNeighbourErrors <<" neighbour count differences" << std::endl;
+
+		// a single domain has to match exactly. With more domains springs across a boundary are 
+		// applied after those within the slabs instead of in creation order (checked exactly by 
+		// testSprings), which moves the stiff spring chain a little. Neighbour lists also hold the 
+		// ghosts after the owned particles, so flocking forces differ in their last bits and close 
+		// pairs amplify that - the tolerance leaves room for both, not for missing neighbours
+		bool isEqual = numDomains == 1 ? 
+			maxError == 0.0 && numNeighbourErrors == 0 :
+			sumError / numCompared <= 0.001 && numNeighbourErrors <= numCompared / 1000;
+		if(!isEqual) {
+			std::cout << "FAILED: "<< numDomains <<" domains differ from the single domain result" << std::endl;
+			isOK = false;
+		}
+	}
+
+	delete reference;
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
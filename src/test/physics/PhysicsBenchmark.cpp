@@ -0,0 +1,377 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+/*
+ Headless benchmark for the physics pipeline - doesnt need a window or GL context.
+ 
+ Measures Physics::update for a number of typical setups at increasing particle 
+ counts and writes one result per line as CSV (default) or JSON.
+ 
+ Usage:
+	PhysicsBenchmark [--json] [--max particles] [--frames n] [--filter name]
+ 
+ e.g. compare two builds with
+	PhysicsBenchmark --max 100000 > before.csv
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+// -- Config -------------------------------------------------------------------
+enum SpaceType { SPACE_BASIC, SPACE_HASH, SPACE_OCTREE };
+
+//! the average number of neighbours every particle should see
+const float NEIGHBOURS_PER_PARTICLE = 16.0f;
+
+//! side length of the simulation volume
+const float WORLD_SIZE = 1000.0f;
+
+//! BasicSpace queries are O(n^2) so it's only measured with smaller counts
+const int MAX_BASIC_SPACE_PARTICLES = 10 * 1000;
+
+struct Scenario {
+	const char* name;
+	SpaceType spaceType;
+	Physics* (*setup)(Space* space, int count, float radius);
+
+	//! frames needed before the simulation reaches a steady state
+	int numWarmupFrames;
+};
+
+struct Result {
+	std::string scenario;
+	std::string space;
+	int particles;
+	int springs;
+	int frames;
+	double setup;
+	double average;
+	double min;
+	double max;
+	double p50;
+	double p99;
+	double neighbours;
+};
+
+// -- Helpers ------------------------------------------------------------------
+const char* getSpaceName(SpaceType type)
+{
+	switch(type) {
+		case SPACE_BASIC: return "BasicSpace";
+		case SPACE_HASH: return "SpatialHash";
+		case SPACE_OCTREE: return "Octree";
+	}
+	return "";
+}
+
+//! SpatialHash only hashes x and y, so its particles are spread over a plane 
+bool is2D(SpaceType type)
+{
+	return type == SPACE_HASH;
+}
+
+//! neighbour radius that keeps the density of the neighbourhood constant for any particle count
+float getNeighbourRadius(SpaceType type, int count)
+{
+	if(is2D(type))
+		return WORLD_SIZE * sqrt(NEIGHBOURS_PER_PARTICLE / (M_PI * count));
+	else
+		return WORLD_SIZE * pow(NEIGHBOURS_PER_PARTICLE * 3.0f / (4.0f * M_PI * count), 1.0f / 3.0f);
+}
+
+Space* createSpace(SpaceType type, int count)
+{
+	Vec3f dimension(WORLD_SIZE, WORLD_SIZE, is2D(type) ? 0.0f : WORLD_SIZE);
+	float radius = getNeighbourRadius(type, count);
+
+	switch(type) {
+		case SPACE_BASIC: return new BasicSpace(Vec3f::zero(), dimension);
+		case SPACE_HASH: return new SpatialHash(Vec3f::zero(), dimension, radius);
+		case SPACE_OCTREE: return new Octree(Vec3f::zero(), dimension, radius * 2.0f);
+	}
+	return NULL;
+}
+
+void setNeighbourRadius(Physics* physics, float radius)
+{
+	FixedRadiusNeighbourUpdate* neighbourUpdate = new FixedRadiusNeighbourUpdate();
+	neighbourUpdate->setRadius(radius);
+	physics->setNeighbourUpdate(neighbourUpdate);
+}
+
+void createRandomParticles(Physics* physics, int count)
+{
+	Vec3f min = physics->space->min;
+	Vec3f max = physics->space->max;
+
+	physics->reserve(count, 0, (int)NEIGHBOURS_PER_PARTICLE * 4);
+	for(int i=0; i<count; i++) {
+		Particle* p = physics->createParticle();
+		p->init(Vec3f(randFloat(min.x, max.x), randFloat(min.y, max.y), randFloat(min.z, max.z)));
+		p->lifeTime = Particle::LIFETIME_PERPETUAL;
+	}
+}
+
+
+// -- Scenarios ----------------------------------------------------------------
+
+//! static particles, measures building the space and querying neighbours only
+Physics* setupNeighbours(Space* space, int count, float radius)
+{
+	Physics* physics = new Physics(space);
+	setNeighbourRadius(physics, radius);
+	createRandomParticles(physics, count);
+	return physics;
+}
+
+//! classic boids with all three flocking rules
+Physics* setupFlocking(Space* space, int count, float radius)
+{
+	Physics* physics = new Physics(space);
+	createRandomParticles(physics, count);
+
+	setNeighbourRadius(physics, radius);
+
+	// flocking ranges are relative to the size of the space
+	float range = physics->space->toRelative(radius);
+
+	FlockAttract* attract = new FlockAttract(physics->space);
+	attract->setRange(range);
+	attract->setWeight(0.001f);
+	physics->addBehaviour(attract);
+
+	FlockAlign* align = new FlockAlign(physics->space);
+	align->setRange(range);
+	align->setWeight(0.001f);
+	physics->addBehaviour(align);
+
+	FlockRepel* repel = new FlockRepel(physics->space);
+	repel->setRange(range * 0.5f);
+	repel->setWeight(0.002f);
+	physics->addBehaviour(repel);
+
+	physics->addBehaviour(new BoxWrap(physics->space));
+	return physics;
+}
+
+//! square piece of cloth hanging from its top row, no neighbour queries
+Physics* setupCloth(Space* space, int count, float radius)
+{
+	Physics* physics = new Physics(space);
+	physics->setNeighbourUpdate(NULL);
+
+	int side = (int)sqrt((float)count);
+	float spacing = WORLD_SIZE / side;
+	physics->reserve(side * side, side * (side - 1) * 2, 0);
+
+	for(int y=0; y<side; y++) {
+		for(int x=0; x<side; x++) {
+			Particle* p = physics->createParticle();
+			p->init(Vec3f(x * spacing, WORLD_SIZE - y * spacing, WORLD_SIZE * 0.5f));
+			p->lifeTime = Particle::LIFETIME_PERPETUAL;
+			if(y == 0) p->lock();
+		}
+	}
+
+	for(int y=0; y<side; y++) {
+		for(int x=0; x<side; x++) {
+			Particle* p = physics->particles[y * side + x];
+			if(x > 0) {
+				Spring* s = physics->createSpring();
+				s->init(physics->particles[y * side + x - 1], p, spacing, 0.5f);
+			}
+			if(y > 0) {
+				Spring* s = physics->createSpring();
+				s->init(physics->particles[(y - 1) * side + x], p, spacing, 0.5f);
+			}
+		}
+	}
+
+	physics->addBehaviour(new Gravity(false));
+	return physics;
+}
+
+//! short lived particles are constantly emitted & retired, the whole pool is renewed every second
+Physics* setupEmitter(Space* space, int count, float radius)
+{
+	Physics* physics = new Physics(space);
+	setNeighbourRadius(physics, radius);
+
+	Emitter* emitter = new Emitter(physics);
+	emitter->setPosition(physics->space->getCenter());
+	emitter->setInterval(0.0f);
+	emitter->setRate(std::max(1, count / 60));
+	emitter->setMax(count);
+	emitter->addBehaviour(new BoxRandom(physics->space));
+	physics->reserve(count, 0, (int)NEIGHBOURS_PER_PARTICLE * 4);
+
+	Initializer* initializer = new Initializer();
+	initializer->setLifeTime(1.0f);
+	initializer->setLifeTimeVariance(0.25f);
+	emitter->addBehaviour(initializer);
+
+	physics->emitter = emitter;
+	physics->addBehaviour(new Gravity(false));
+	physics->addBehaviour(new BoxWrap(physics->space));
+	return physics;
+}
+
+
+// -- Runner -------------------------------------------------------------------
+Result run(Scenario const& scenario, int count, int numFrames)
+{
+	float dt = 1.0f / 60.0f;
+
+	Result result;
+	result.scenario = scenario.name;
+	result.space = getSpaceName(scenario.spaceType);
+	result.frames = numFrames;
+
+	Profiler::Ticks start = Profiler::getTicks();
+	float radius = getNeighbourRadius(scenario.spaceType, count);
+	Physics* physics = scenario.setup(createSpace(scenario.spaceType, count), count, radius);
+	result.setup = Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+	int numWarmupFrames = std::max(scenario.numWarmupFrames, numFrames / 3);
+	for(int i=0; i<numWarmupFrames; i++)
+		physics->update(dt);
+
+	std::vector<double> times(numFrames);
+	for(int i=0; i<numFrames; i++) {
+		start = Profiler::getTicks();
+		physics->update(dt);
+		times[i] = Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+	}
+
+	std::sort(times.begin(), times.end());
+	double sum = 0.0;
+	for(int i=0; i<numFrames; i++)
+		sum += times[i];
+
+	result.average = sum / numFrames;
+	result.min = times.front();
+	result.max = times.back();
+	result.p50 = times[numFrames / 2];
+	result.p99 = times[std::min(numFrames - 1, (int)(numFrames * 0.99f))];
+
+	// average neighbourhood size, shows when a space returns far more candidates than needed
+	double numNeighbours = 0.0;
+	int numAlive = 0;
+	for(int i=0; i<physics->particles.size(); i++) {
+		Particle* p = physics->particles[i];
+		if(!p->isAlive) continue;
+		numNeighbours += p->getNeighbours()->size();
+		numAlive++;
+	}
+	result.particles = numAlive;
+	result.springs = physics->getNumSprings();
+	result.neighbours = numAlive > 0 ? numNeighbours / numAlive : 0.0;
+
+	delete physics;
+	return result;
+}
+
+void printHeader(bool asJSON)
+{
+	if(asJSON)
+		std::cout << "[" << std::endl;
+	else
+		std::cout << "scenario,space,particles,springs,frames,setup_ms,avg_ms,min_ms,max_ms,p50_ms,p99_ms,neighbours" << std::endl;
+}
+
+void printResult(Result const& r, bool asJSON, bool isFirst)
+{
+	if(asJSON) {
+		if(!isFirst) std::cout << "," << std::endl;
+		std::cout << "  {\"scenario\":\""<< r.scenario <<"\",\"space\":\""<< r.space <<"\""
+			<< ",\"particles\":"<< r.particles <<",\"springs\":"<< r.springs <<",\"frames\":"<< r.frames
+			<< ",\"setup_ms\":"<< r.setup <<",\"avg_ms\":"<< r.average 
+			<< ",\"min_ms\":"<< r.min <<",\"max_ms\":"<< r.max
+			<< ",\"p50_ms\":"<< r.p50 <<",\"p99_ms\":"<< r.p99 
+			<< ",\"neighbours\":"<< r.neighbours <<"}";
+	} else {
+		std::cout << r.scenario <<","<< r.space <<","<< r.particles <<","<< r.springs <<","<< r.frames <<","
+			<< r.setup <<","<< r.average <<","<< r.min <<","<< r.max <<","<< r.p50 <<","<< r.p99 <<","
+			<< r.neighbours << std::endl;
+	}
+}
+
+void printFooter(bool asJSON)
+{
+	if(asJSON)
+		std::cout << std::endl << "]" << std::endl;
+}
+
+int main(int argc, char* argv[]) 
+{
+	bool asJSON = false;
+	int maxParticles = 1000 * 1000;
+	int numFrames = 60;
+	const char* filter = NULL;
+
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--json") == 0) {
+			asJSON = true;
+		} else if(strcmp(argv[i], "--max") == 0 && i+1 < argc) {
+			maxParticles = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--frames") == 0 && i+1 < argc) {
+			numFrames = std::max(1, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--filter") == 0 && i+1 < argc) {
+			filter = argv[++i];
+		} else {
+			std::cerr << "usage: "<< argv[0] <<" [--json] [--max particles] [--frames n] [--filter name]" << std::endl;
+			return 1;
+		}
+	}
+
+	Scenario scenarios[] = {
+		{ "neighbours", SPACE_BASIC, setupNeighbours, 1 },
+		{ "neighbours", SPACE_HASH, setupNeighbours, 1 },
+		{ "neighbours", SPACE_OCTREE, setupNeighbours, 1 },
+		{ "flocking", SPACE_HASH, setupFlocking, 10 },
+		{ "flocking", SPACE_OCTREE, setupFlocking, 10 },
+		{ "cloth", SPACE_OCTREE, setupCloth, 10 },
+		{ "emitter", SPACE_OCTREE, setupEmitter, 90 }
+	};
+	int numScenarios = sizeof(scenarios) / sizeof(Scenario);
+
+	printHeader(asJSON);
+
+	bool isFirst = true;
+	for(int i=0; i<numScenarios; i++) {
+		Scenario const& scenario = scenarios[i];
+		if(filter != NULL && strstr(scenario.name, filter) == NULL) continue;
+
+		for(int count = 1000; count <= maxParticles; count *= 10) {
+			if(scenario.spaceType == SPACE_BASIC && count > MAX_BASIC_SPACE_PARTICLES) break;
+
+			// always the same particle distribution for comparable runs
+			randSeed(12345);
+
+			// fewer frames for the really large counts to keep the total run time sane
+			int frames = std::max(5, std::min(numFrames, numFrames * 10000 / count));
+			Result result = run(scenario, count, frames);
+			printResult(result, asJSON, isFirst);
+			isFirst = false;
+		}
+	}
+
+	printFooter(asJSON);
+	return 0;
+}
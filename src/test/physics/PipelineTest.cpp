@@ -0,0 +1,154 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+/*
+ Runs a simulation through PhysicsPipeline and compares it to the same simulation 
+ updated serially, then measures the frame time of both modes with a simulated 
+ render step that copies the particles into an interleaved buffer. Both timed runs 
+ start from the same initial state and simulate the same steps.
+
+ Returns 0 when the pipelined simulation matches, 1 otherwise.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const int NUM_PARTICLES = 20000;
+const int FLOATS_PER_PARTICLE = 8;
+
+Physics* createPhysics()
+{
+	Vec3f dimension(1000.0f, 1000.0f, 1000.0f);
+
+	Physics* physics = new Physics(new SpatialHash(Vec3f::zero(), dimension, 20.0f));
+	physics->setDeterministic(true, 1234);
+
+	FixedRadiusNeighbourUpdate* neighbourUpdate = new FixedRadiusNeighbourUpdate();
+	neighbourUpdate->setRadius(20.0f);
+	physics->setNeighbourUpdate(neighbourUpdate);
+
+	Emitter* emitter = new Emitter(physics);
+	emitter->setPosition(dimension * 0.5f);
+	emitter->setMax(NUM_PARTICLES);
+	emitter->setRate(NUM_PARTICLES / 60);
+	emitter->setInterval(0.0f);
+	emitter->addBehaviour(new BoxRandom(physics->space));
+	physics->emitter = emitter;
+
+	FlockAttract* attract = new FlockAttract(physics->space);
+	attract->setRange(0.02f);
+	attract->setWeight(0.01f);
+	physics->addBehaviour(attract);
+	physics->addBehaviour(new BoxWrap(physics->space));
+
+	return physics;
+}
+
+//! stands in for mapping a PointCloud and filling it
+int render(PhysicsFrame const& frame, std::vector<float>& buffer)
+{
+	return frame.fill(&buffer[0], FLOATS_PER_PARTICLE, NUM_PARTICLES);
+}
+
+double getMilliseconds(Profiler::Ticks start)
+{
+	return Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+}
+
+int main(int argc, char* argv[]) 
+{
+	std::cout << "---- Physics Pipeline Test ----" << std::endl;
+
+	float dt = 1.0f / 60.0f;
+	int numFrames = 120;
+	std::vector<float> buffer(NUM_PARTICLES * FLOATS_PER_PARTICLE);
+
+	// serial
+	Physics* serial = createPhysics();
+	PhysicsFrame serialFrame;
+
+	Profiler::Ticks start = Profiler::getTicks();
+	for(int i=0; i<numFrames; i++) {
+		serial->update(dt);
+		serialFrame.capture(serial, i + 1);
+		render(serialFrame, buffer);
+	}
+	double serialTime = getMilliseconds(start) / numFrames;
+
+	// pipelined, waiting for every step so both run the same number of steps
+	Physics* pipelined = createPhysics();
+	PhysicsPipeline pipeline(pipelined);
+	pipeline.start();
+
+	bool isOK = true;
+	for(int i=0; i<numFrames; i++) {
+		pipeline.update(dt);
+		pipeline.wait();
+
+		PhysicsFrame const& frame = pipeline.acquire();
+		if(frame.index != (boost::uint32_t)i + 1) {
+			std::cout << "FAILED: expected frame "<< i + 1 <<" but got "<< frame.index << std::endl;
+			isOK = false;
+			break;
+		}
+	}
+	pipeline.stop();
+
+	if(serial->getStateHash() != pipelined->getStateHash()) {
+		std::cout << "FAILED: pipelined simulation differs from the serial one" << std::endl;
+		isOK = false;
+	} else {
+		std::cout << "pipelined simulation matches: OK" << std::endl;
+	}
+
+	// pipelined from the same initial state over the same steps as the timed serial run, 
+	// rendering the previous frame while the next one is simulated - waiting at the end 
+	// of the frame stands in for the vsync of a real app
+	Physics* timed = createPhysics();
+	PhysicsPipeline timedPipeline(timed);
+	timedPipeline.start();
+
+	boost::uint32_t lastIndex = 0;
+	start = Profiler::getTicks();
+	for(int i=0; i<numFrames; i++) {
+		timedPipeline.update(dt);
+
+		PhysicsFrame const& frame = timedPipeline.acquire();
+		if(frame.index < lastIndex) {
+			std::cout << "FAILED: frames went backwards" << std::endl;
+			isOK = false;
+		}
+		lastIndex = frame.index;
+		render(frame, buffer);
+		timedPipeline.wait();
+	}
+	double pipelinedTime = getMilliseconds(start) / numFrames;
+	timedPipeline.stop();
+
+	if(timedPipeline.getNumSkipped() > 0 || serial->getStateHash() != timed->getStateHash()) {
+		std::cout << "FAILED: timed runs didn't simulate the same steps" << std::endl;
+		isOK = false;
+	}
+
+	std::cout << "serial "<< serialTime <<" ms/frame, pipelined "<< pipelinedTime <<" ms/frame, "
+		<< timedPipeline.getNumSkipped() <<" steps skipped" << std::endl;
+
+	delete serial;
+	delete pipelined;
+	delete timed;
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ *      _____  __  _____  __     ____
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.
+ *   /_/        /____/ /____/ /_____/    http://www.field.io
+ */
+
+/*
+ Checks the Profiler statistics: events recorded from several threads, name lookups that
+ must not register anything and the per behaviour scopes Physics::update records when
+ FieldKit was built with ENABLE_PROFILER.
+
+ Returns 0 when all checks pass, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstring>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const int EVENTS_PER_WORKER = 1000;
+
+bool check(bool condition, const char* message)
+{
+	if(!condition)
+		std::cout << "FAILED: " << message << std::endl;
+	return condition;
+}
+
+struct Worker {
+	int id;
+	Worker(int id) : id(id) {}
+
+	void operator()()
+	{
+		for(int i=0; i<EVENTS_PER_WORKER; i++) {
+			Profiler::Ticks start = Profiler::getTicks();
+			Profiler::record(id, start, start + i);
+		}
+	}
+};
+
+//! keeps overwriting its ring buffer with events that all have the same duration
+struct Spinner {
+	int id;
+	boost::atomic<bool>* isRunning;
+	Spinner(int id, boost::atomic<bool>* isRunning) : id(id), isRunning(isRunning) {}
+
+	void operator()()
+	{
+		Profiler::Ticks start = 0;
+		while(isRunning->load()) {
+			Profiler::record(id, start, start + 7);
+			start += 1000;
+		}
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	std::cout << "---- Profiler Test ----" << std::endl;
+	bool isOK = true;
+
+	// events from all threads end up in the same statistics
+	int workerID = Profiler::registerName("test.worker");
+	boost::thread_group workers;
+	for(int i=0; i<4; i++)
+		workers.create_thread(Worker(workerID));
+	workers.join_all();
+
+	Profiler::Stats stats = Profiler::getStats("test.worker");
+	isOK &= check(stats.count == 4 * EVENTS_PER_WORKER, "events of all threads are counted");
+	isOK &= check(stats.min <= stats.p50 && stats.p50 <= stats.p99 && stats.p99 <= stats.max, "percentiles are ordered");
+
+	// reading and clearing while the ring buffer wraps around must only see intact events
+	int spinnerID = Profiler::registerName("test.spinner");
+	boost::atomic<bool> isRunning(true);
+	boost::thread spinner(Spinner(spinnerID, &isRunning));
+	bool isIntact = true;
+	for(int i=0; i<200; i++) {
+		stats = Profiler::getStats(spinnerID);
+		if(stats.count > 0 && stats.min != stats.max) 
+			isIntact = false;
+		if(i % 10 == 0) 
+			Profiler::clear();
+	}
+	isRunning.store(false);
+	spinner.join();
+	isOK &= check(isIntact, "events overwritten while reading are skipped");
+
+	// looking up a name must neither register it nor keep the callers pointer
+	char transient[32];
+	strcpy(transient, "test.unknown");
+	stats = Profiler::getStats(transient);
+	isOK &= check(stats.count == 0, "unknown names have no events");
+	strcpy(transient, "test.overwritten");
+
+	int first = Profiler::registerName("test.first");
+	int second = Profiler::registerName("test.second");
+	isOK &= check(second == first + 1, "looking up a name registers nothing");
+	isOK &= check(Profiler::registerName("test.first") == first, "names are only registered once");
+
+	// behaviours resolve their id once and share it with all instances of the same type
+	Gravity* gravity = new Gravity();
+	Wind* wind = new Wind();
+	Gravity other;
+	isOK &= check(gravity->getProfileID() == other.getProfileID(), "instances of a type share their id");
+	isOK &= check(gravity->getProfileID() != wind->getProfileID(), "types have their own ids");
+	isOK &= check(strcmp(Profiler::getStats(gravity->getProfileID()).name, "fieldkit::physics::Gravity") == 0, "ids are named after their type");
+
+	Physics* physics = new Physics(new BasicSpace());
+	physics->allocParticles(100);
+	for(int i=0; i<100; i++)
+		physics->createParticle()->init(Vec3f(i, i, i));
+	physics->addBehaviour(gravity);
+	physics->addBehaviour(wind);
+
+	const int numFrames = 10;
+	Profiler::clear();
+	for(int f=0; f<numFrames; f++)
+		physics->update(1.0f / 60.0f);
+
+	int expected = Profiler::isCompiledIn() ? numFrames : 0;
+	isOK &= check(Profiler::getStats(gravity->getProfileID()).count == expected, "every update times each behaviour");
+	isOK &= check(Profiler::getStats("physics.update").count == expected, "every update is timed");
+	Profiler::report(std::cout);
+	delete physics;
+
+	if(!isOK) return 1;
+
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
@@ -0,0 +1,170 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Casts batches of rays into a particle cloud through Space::raycastMany and compares the 
+ nearest hits of Octree, SpatialHash, AABBTree and the default Space::raycast against testing 
+ every particle in a BasicSpace. Also checks the slab test for rays parallel to the box sides.
+
+ Usage: RaycastTest [--particles n] [--rays n]
+
+ Returns 0 when all spaces find the same nearest hits, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+
+struct Scene {
+	const char* name;
+	Space* space;
+};
+
+//! uses the default Space::raycast instead of the BasicSpace loop
+class DefaultRaycastSpace : public BasicSpace {
+public:
+	DefaultRaycastSpace(Vec3f offset, Vec3f dimension) : BasicSpace(offset, dimension) {};
+
+	bool raycast(Ray3f const& ray, float maxDistance, RayHit& hit) {
+		return Space::raycast(ray, maxDistance, hit);
+	}
+};
+
+//! rays with zero direction components only hit when their origin lies within those slabs
+bool testAxisParallel()
+{
+	Vec3f min(0.0f, 0.0f, 0.0f);
+	Vec3f max(10.0f, 10.0f, 10.0f);
+
+	struct Case {
+		Vec3f origin;
+		Vec3f direction;
+		bool isHit;
+	} cases[] = {
+		{ Vec3f(-5.0f, 5.0f, 5.0f), Vec3f(1.0f, 0.0f, 0.0f), true },
+		{ Vec3f(-5.0f, 0.0f, 10.0f), Vec3f(1.0f, 0.0f, 0.0f), true },	// origin on the slab planes
+		{ Vec3f(-5.0f, 11.0f, 5.0f), Vec3f(1.0f, 0.0f, 0.0f), false },
+		{ Vec3f(5.0f, 5.0f, -1.0f), Vec3f(0.0f, 1.0f, 0.0f), false },
+		{ Vec3f(5.0f, -5.0f, 5.0f), Vec3f(0.0f, -1.0f, 0.0f), false },	// box lies behind
+		{ Vec3f(-5.0f, -5.0f, 5.0f), Vec3f(1.0f, 1.0f, 0.0f), true },
+		{ Vec3f(-5.0f, -5.0f, 11.0f), Vec3f(1.0f, 1.0f, 0.0f), false }
+	};
+	int numCases = sizeof(cases) / sizeof(Case);
+
+	bool isOK = true;
+	for(int i=0; i<numCases; i++) {
+		Ray3f ray(cases[i].origin, cases[i].direction);
+		float tNear = -1.0f;
+		bool isHit = ray.findIntersection(min, max, &tNear);
+		if(isHit != cases[i].isHit || (isHit && (tNear != tNear || tNear < 0.0f))) {
+			std::cout << "FAILED: axis parallel case "<< i <<" returned "<< isHit <<" at "<< tNear << std::endl;
+			isOK = false;
+		}
+	}
+	return isOK;
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 50000;
+	int numRays = 2000;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--rays") == 0 && i + 1 < argc)
+			numRays = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Raycast Test ----" << std::endl;
+
+	bool isOK = testAxisParallel();
+
+	randSeed(1);
+	std::vector<Particle*> particles;
+	for(int i=0; i<numParticles; i++) {
+		Particle* p = new Particle();
+		p->init(Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE)));
+		p->setSize(randFloat(1.0f, 5.0f));
+		particles.push_back(p);
+	}
+
+	// half of the rays start inside the cloud, the others outside of it, every tenth runs along an axis
+	std::vector<Ray3f> rays;
+	for(int i=0; i<numRays; i++) {
+		Vec3f origin = i % 2 == 0 ?
+			Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE)) :
+			Vec3f(randFloat(SIZE), randFloat(SIZE), -100.0f);
+		Vec3f direction = i % 10 == 1 ? 
+			Vec3f::zAxis() : 
+			Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE)) - origin;
+		rays.push_back(Ray3f(origin, direction));
+	}
+	float maxDistance = SIZE * 2.0f;
+
+	Vec3f dimension(SIZE, SIZE, SIZE);
+	Scene scenes[] = {
+		{ "BasicSpace", new BasicSpace(Vec3f::zero(), dimension) },
+		{ "Octree", new Octree(Vec3f::zero(), dimension, 20.0f) },
+		{ "SpatialHash", new SpatialHash(Vec3f::zero(), dimension, 20.0f) },
+		{ "AABBTree", new AABBTree(Vec3f::zero(), dimension, 1.0f) },
+		{ "Space", new DefaultRaycastSpace(Vec3f::zero(), dimension) }
+	};
+	int numScenes = sizeof(scenes) / sizeof(Scene);
+
+	std::vector<RayHit> expected(numRays);
+	std::vector<RayHit> hits(numRays);
+
+	for(int s=0; s<numScenes; s++) {
+		Space* space = scenes[s].space;
+		space->clear();
+		for(int i=0; i<numParticles; i++)
+			space->insert(particles[i]);
+
+		std::vector<RayHit>& result = s == 0 ? expected : hits;
+
+		Profiler::Ticks start = Profiler::getTicks();
+		int numHits = space->raycastMany(&rays[0], numRays, maxDistance, &result[0]);
+		double time = Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+
+		int numDifferent = 0;
+		for(int i=0; s > 0 && i<numRays; i++) {
+			// ties may pick another spatial at the same distance
+			bool isSame = hits[i].spatial == NULL ? 
+				expected[i].spatial == NULL : 
+				expected[i].spatial != NULL && fabsf(hits[i].distance - expected[i].distance) < 1e-3f;
+			if(!isSame) numDifferent++;
+		}
+
+		std::cout << scenes[s].name <<": "<< numHits <<" hits, "<< time <<" ms, "
+			<< (int)(numRays / time * 1000.0) <<" rays/s" << std::endl;
+
+		if(numDifferent > 0) {
+			std::cout << "FAILED: "<< numDifferent <<" rays differ from brute force" << std::endl;
+			isOK = false;
+		}
+	}
+
+	for(int s=0; s<numScenes; s++)
+		delete scenes[s].space;
+	for(int i=0; i<numParticles; i++)
+		delete particles[i];
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
@@ -0,0 +1,217 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+/*
+ Records a simulation with ParticleRecorder, plays it back sequentially and with 
+ random seeks and checks every frame against the original particle state.
+ Damaged copies of the recording have to be rejected when opening them.
+ 
+ Returns 0 when all frames match within the quantisation error, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <cmath>
+#include <algorithm>
+
+#include "fieldkit/physics/PhysicsKit.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+//! positions outside of the bounds are clamped to them when recording
+bool compare(ParticleFrame& expected, ParticleFrame& actual, AABB& bounds, float tolerance)
+{
+	if(expected.size() != actual.size()) 
+		return false;
+
+	for(int i=0; i<expected.size(); i++) {
+		if(expected.alive[i] != actual.alive[i]) 
+			return false;
+		if(!expected.alive[i]) 
+			continue;
+
+		Vec3f p = expected.positions[i];
+		p.x = std::min(std::max(p.x, bounds.min.x), bounds.max.x);
+		p.y = std::min(std::max(p.y, bounds.min.y), bounds.max.y);
+		p.z = std::min(std::max(p.z, bounds.min.z), bounds.max.z);
+
+		Vec3f delta = p - actual.positions[i];
+		if(fabs(delta.x) > tolerance || fabs(delta.y) > tolerance || fabs(delta.z) > tolerance)
+			return false;
+		if(fabs(expected.ages[i] - actual.ages[i]) > 0.001f)
+			return false;
+	}
+	return true;
+}
+
+//! writes a damaged copy of a recording and checks ParticlePlayback refuses to open it
+bool isRejected(std::string const& data)
+{
+	const char* path = "RecorderTestDamaged.fkr";
+	std::ofstream out(path, std::ios::binary);
+	out.write(data.data(), data.size());
+	out.close();
+
+	ParticlePlayback playback;
+	bool isRejected = false;
+	try {
+		playback.open(path);
+	} catch(const char* message) {
+		isRejected = playback.getNumFrames() == 0;
+	}
+	remove(path);
+	return isRejected;
+}
+
+//! damages the header, the frame index and a frame size of the recording at path
+bool testDamaged(const char* path)
+{
+	std::ifstream in(path, std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	boost::uint32_t numFrames;
+	memcpy(&numFrames, &data[data.size() - 8], sizeof(numFrames));
+	size_t indexOffset = data.size() - 8 - numFrames * sizeof(boost::uint64_t);
+	boost::uint64_t firstFrame;
+	memcpy(&firstFrame, &data[indexOffset], sizeof(firstFrame));
+
+	bool isOK = true;
+
+	std::string broken = data;
+	boost::int32_t keyframeInterval = 0;
+	memcpy(&broken[8], &keyframeInterval, sizeof(keyframeInterval));
+	isOK &= isRejected(broken);
+
+	broken = data;
+	boost::uint32_t hugeCount = 0xffffffff;
+	memcpy(&broken[data.size() - 8], &hugeCount, sizeof(hugeCount));
+	isOK &= isRejected(broken);
+
+	broken = data;
+	boost::uint64_t outside = data.size();
+	memcpy(&broken[indexOffset], &outside, sizeof(outside));
+	isOK &= isRejected(broken);
+
+	broken = data;
+	boost::uint32_t hugeSize = 0xfffffff0;
+	memcpy(&broken[firstFrame], &hugeSize, sizeof(hugeSize));
+	isOK &= isRejected(broken);
+
+	return isOK;
+}
+
+int main(int argc, char* argv[]) 
+{
+	std::cout << "---- Recorder Test ----" << std::endl;
+
+	int numParticles = 5000;
+	int numFrames = 300;
+	float dt = 1.0f / 60.0f;
+	const char* path = "RecorderTest.fkr";
+
+	Vec3f dimension(1000.0f, 1000.0f, 1000.0f);
+	Physics* physics = new Physics(new Octree(Vec3f::zero(), dimension, 50.0f));
+
+	FixedRadiusNeighbourUpdate* neighbourUpdate = new FixedRadiusNeighbourUpdate();
+	neighbourUpdate->setRadius(25.0f);
+	physics->setNeighbourUpdate(neighbourUpdate);
+
+	Emitter* emitter = new Emitter(physics);
+	emitter->setRate(50);
+	emitter->setInterval(0.0f);
+	emitter->setMax(numParticles);
+	emitter->addBehaviour(new BoxRandom(physics->space));
+
+	Initializer* initializer = new Initializer();
+	initializer->setLifeTime(2.0f);
+	initializer->setLifeTimeVariance(0.5f);
+	emitter->addBehaviour(initializer);
+	physics->emitter = emitter;
+
+	FlockRepel* repel = new FlockRepel(physics->space);
+	repel->setRange(0.025f);
+	physics->addBehaviour(repel);
+	physics->addBehaviour(new BoxWrap(physics->space));
+
+	// record and keep a copy of every frame to compare against
+	std::vector<ParticleFrame> expected(numFrames);
+
+	ParticleRecorder recorder;
+	recorder.open(path, *physics->space, 30);
+	for(int i=0; i<numFrames; i++) {
+		physics->update(dt);
+		recorder.record(physics);
+		expected[i].capture(physics);
+	}
+	recorder.close();
+
+	std::cout << "recorded "<< recorder.getNumFrames() <<" frames, "<< recorder.getNumStalls() <<" stalls" << std::endl;
+	delete physics;
+
+	// playback
+	float tolerance = dimension.x / 65535.0f;
+
+	ParticlePlayback playback;
+	playback.open(path);
+	AABB bounds = playback.getBounds();
+	if(playback.getNumFrames() != numFrames) {
+		std::cout << "FAILED: recording has "<< playback.getNumFrames() <<" frames" << std::endl;
+		return 1;
+	}
+
+	ParticleFrame frame;
+	for(int i=0; i<numFrames; i++) {
+		playback.read(i, frame);
+		if(!compare(expected[i], frame, bounds, tolerance)) {
+			std::cout << "FAILED: frame "<< i <<" doesn't match" << std::endl;
+			return 1;
+		}
+	}
+	std::cout << "sequential playback: OK" << std::endl;
+
+	for(int n=0; n<50; n++) {
+		int i = (int)randFloat(numFrames - 1);
+		playback.read(i, frame);
+		if(!compare(expected[i], frame, bounds, tolerance)) {
+			std::cout << "FAILED: seeking to frame "<< i <<" doesn't match" << std::endl;
+			return 1;
+		}
+	}
+	std::cout << "random seeks: OK" << std::endl;
+
+	if(!testDamaged(path)) {
+		std::cout << "FAILED: damaged recordings weren't rejected" << std::endl;
+		return 1;
+	}
+	std::cout << "damaged recordings rejected: OK" << std::endl;
+
+	// positions are never written past the given capacity
+	const int stride = 4;
+	std::vector<float> positions(numParticles * stride);
+	int numAlive = playback.readPositions(numFrames - 1, &positions[0], stride, numParticles);
+
+	int capacity = numAlive / 2;
+	const float guard = -1.0f;
+	std::vector<float> clamped(capacity * stride + stride, guard);
+	int numWritten = playback.readPositions(numFrames - 1, &clamped[0], stride, capacity);
+	if(numAlive == 0 || numWritten != capacity || clamped[capacity * stride] != guard) {
+		std::cout << "FAILED: readPositions wrote "<< numWritten <<" of "<< numAlive <<" positions into space for "<< capacity << std::endl;
+		return 1;
+	}
+	std::cout << "positions within capacity: OK" << std::endl;
+
+	playback.close();
+	remove(path);
+
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
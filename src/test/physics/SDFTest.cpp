@@ -0,0 +1,239 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Bakes a sphere mesh into a DistanceField, checks the distances against the 
+ analytic sphere, saves and loads the field, checks damaged files are rejected and 
+ lets particles fall onto the sphere with an SDFConstraint.
+
+ Usage: SDFTest [--particles n]
+
+ Returns 0 when all checks pass, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <iterator>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+const float RADIUS = 200.0f;
+const float CELL_SIZE = 5.0f;
+const float BAND = 20.0f;
+
+//! a closed uv sphere
+void createSphere(Vec3f const& center, float radius, int slices, int stacks, 
+				  std::vector<Vec3f>& vertices, std::vector<int>& indices)
+{
+	vertices.push_back(center + Vec3f(0, radius, 0));
+	for(int j=1; j<stacks; j++) {
+		float theta = (float)M_PI * j / stacks;
+		for(int i=0; i<slices; i++) {
+			float phi = 2.0f * (float)M_PI * i / slices;
+			vertices.push_back(center + Vec3f(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)) * radius);
+		}
+	}
+	vertices.push_back(center + Vec3f(0, -radius, 0));
+
+	int bottom = vertices.size() - 1;
+	for(int i=0; i<slices; i++) {
+		int next = (i + 1) % slices;
+		indices.push_back(0); indices.push_back(1 + next); indices.push_back(1 + i);
+
+		for(int j=0; j<stacks - 2; j++) {
+			int a = 1 + j * slices + i, b = 1 + j * slices + next;
+			int c = a + slices, d = b + slices;
+			indices.push_back(a); indices.push_back(b); indices.push_back(c);
+			indices.push_back(b); indices.push_back(d); indices.push_back(c);
+		}
+
+		int last = 1 + (stacks - 2) * slices;
+		indices.push_back(last + i); indices.push_back(last + next); indices.push_back(bottom);
+	}
+}
+
+double getMilliseconds(Profiler::Ticks start)
+{
+	return Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+}
+
+//! overwrites a single value in a copy of the saved field and checks loading it fails without changing the field
+template<typename T>
+bool isRejected(std::string const& data, size_t offset, T value, DistanceField& field)
+{
+	std::string broken = data;
+	memcpy(&broken[offset], &value, sizeof(T));
+
+	const char* path = "SDFTestDamaged.sdf";
+	std::ofstream out(path, std::ios::binary);
+	out.write(broken.data(), broken.size());
+	out.close();
+
+	Vec3f p(SIZE * 0.5f, SIZE * 0.5f + RADIUS, SIZE * 0.5f);
+	float expected = field.sample(p);
+	bool isRejected = false;
+	try {
+		field.load(path);
+	} catch(const char* message) {
+		isRejected = field.sample(p) == expected;
+	}
+	remove(path);
+	return isRejected;
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 20000;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+	}
+
+	std::cout << "---- SDF Test ----" << std::endl;
+	bool isOK = true;
+	randSeed(1);
+
+	Vec3f center(SIZE * 0.5f, SIZE * 0.5f, SIZE * 0.5f);
+	std::vector<Vec3f> vertices;
+	std::vector<int> indices;
+	createSphere(center, RADIUS, 128, 64, vertices, indices);
+
+	// bake
+	DistanceField field;
+	Profiler::Ticks start = Profiler::getTicks();
+	field.bake(vertices, indices, AABB(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE)), CELL_SIZE, BAND);
+	std::cout << indices.size() / 3 <<" triangles baked in "<< getMilliseconds(start) <<" ms, "
+		<< field.getNumStoredBricks() <<" of "<< field.getNumBricks() <<" bricks stored" << std::endl;
+
+	// distances within the band, the mesh itself is off by up to r * (1 - cos(pi / 64))
+	double maxError = 0.0;
+	int numSigns = 0;
+	for(int i=0; i<100000; i++) {
+		Vec3f direction(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f));
+		float expected = randFloat(-BAND + CELL_SIZE, BAND - CELL_SIZE);
+		Vec3f p = center + direction.normalized() * (RADIUS + expected);
+
+		float distance = field.sample(p);
+		maxError = std::max(maxError, (double)fabsf(distance - expected));
+		if((distance < 0.0f) != (expected < 0.0f) && fabsf(expected) > 1.0f)
+			numSigns++;
+	}
+
+	float inside = field.sample(center);
+	float outside = field.sample(Vec3f(10, 10, 10));
+	std::cout << "max distance error "<< maxError <<", "<< numSigns <<" wrong signs, "
+		<<"center "<< inside <<", corner "<< outside << std::endl;
+
+	if(maxError > 1.0 || numSigns > 0 || inside != -BAND || outside != BAND) {
+		std::cout << "FAILED: distances are off" << std::endl;
+		isOK = false;
+	}
+
+	// save and load
+	field.save("SDFTest.sdf");
+	DistanceField loaded;
+	loaded.load("SDFTest.sdf");
+
+	int numDifferent = 0;
+	for(int i=0; i<10000; i++) {
+		Vec3f p(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE));
+		if(field.sample(p) != loaded.sample(p))
+			numDifferent++;
+	}
+	if(numDifferent > 0) {
+		std::cout << "FAILED: loaded field differs in "<< numDifferent <<" samples" << std::endl;
+		isOK = false;
+	}
+
+	// damaged files: cell size, brick count, brick data length and the first brick index
+	std::ifstream in("SDFTest.sdf", std::ios::binary);
+	std::string saved((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	remove("SDFTest.sdf");
+
+	boost::int32_t dataSize;
+	memcpy(&dataSize, &saved[52], sizeof(dataSize));
+	bool isRejectedAll = isRejected(saved, 32, 0.0f, loaded) &&
+		isRejected(saved, 40, (boost::int32_t)-1, loaded) &&
+		isRejected(saved, 44, (boost::int32_t)(1 << 20), loaded) &&
+		isRejected(saved, 52, dataSize + 1, loaded) &&
+		isRejected(saved, 60, (boost::int32_t)(1 << 30), loaded);
+
+	std::vector<int> invalid(indices);
+	invalid[0] = vertices.size();
+	DistanceField unused;
+	try {
+		unused.bake(vertices, invalid, AABB(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE)), CELL_SIZE, BAND);
+		isRejectedAll = false;
+	} catch(const char* message) {}
+
+	if(!isRejectedAll) {
+		std::cout << "FAILED: damaged field or mesh wasn't rejected" << std::endl;
+		isOK = false;
+	}
+
+	// particles falling onto the sphere
+	Physics* physics = new Physics(new BasicSpace(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE)));
+	for(int i=0; i<numParticles; i++) {
+		float angle = randFloat(2.0f * (float)M_PI);
+		float r = randFloat(RADIUS * 0.9f);
+		physics->createParticle()->init(center + Vec3f(cosf(angle) * r, RADIUS + randFloat(10.0f, 300.0f), sinf(angle) * r));
+	}
+
+	Gravity* gravity = new Gravity(false);
+	gravity->setWeight(0.2f);
+	physics->addBehaviour(gravity);
+
+	const float thickness = 2.0f;
+	SDFConstraint* constraint = new SDFConstraint(&field, thickness);
+	physics->addConstraint(constraint);
+
+	start = Profiler::getTicks();
+	for(int f=0; f<200; f++)
+		physics->update(1.0f / 60.0f);
+	double simulationTime = getMilliseconds(start) / 200;
+
+	int numInside = 0;
+	for(int i=0; i<numParticles; i++) {
+		if((physics->particles[i]->position - center).length() < RADIUS - 0.5f)
+			numInside++;
+	}
+
+	start = Profiler::getTicks();
+	float sum = 0.0f;
+	for(int i=0; i<numParticles; i++) {
+		Vec3f gradient;
+		sum += field.sample(physics->particles[i]->position, &gradient);
+	}
+	double sampleTime = getMilliseconds(start);
+
+	std::cout << numParticles <<" particles: "<< simulationTime <<" ms/frame, "
+		<< sampleTime * 1000000.0 / numParticles <<" ns per lookup, "<< numInside <<" inside the sphere" << std::endl;
+
+	if(numInside > 0) {
+		std::cout << "FAILED: particles went through the surface" << std::endl;
+		isOK = false;
+	}
+
+	delete physics;
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
@@ -0,0 +1,119 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+/*
+ Publishes particles through SharedMemoryExport while a reader thread with its own 
+ mapping of the block checks that every frame it accepted was complete and consistent.
+
+ Returns 0 when no torn frame was accepted, 1 otherwise.
+ */
+
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include "fieldkit/physics/PhysicsKit.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const char* NAME = "/fieldkit_shared_memory_test";
+const int NUM_PARTICLES = 50000;
+const int NUM_FRAMES = 2000;
+
+boost::atomic<bool> isDone(false);
+int numRead = 0;
+int numDiscarded = 0;
+int numErrors = 0;
+
+void readerMain()
+{
+	SharedMemoryReader reader(NAME);
+	SharedParticleView view;
+	boost::uint32_t lastFrame = 0;
+
+	while(!isDone) {
+		if(!reader.acquire(view) || view.frame == lastFrame) 
+			continue;
+
+		// every particle of a frame carries the frame number
+		bool isConsistent = view.numParticles == NUM_PARTICLES;
+		for(int i=0; i<view.numParticles && isConsistent; i++) {
+			isConsistent = view.x[i] == (float)view.frame && view.y[i] == (float)i && view.ids[i] == i;
+		}
+
+		// only frames that stayed valid while reading count
+		if(!reader.isValid(view)) {
+			numDiscarded++;
+			continue;
+		}
+
+		if(!isConsistent || view.frame < lastFrame)
+			numErrors++;
+
+		lastFrame = view.frame;
+		numRead++;
+	}
+}
+
+int main(int argc, char* argv[]) 
+{
+	std::cout << "---- Shared Memory Test ----" << std::endl;
+
+	Physics* physics = new Physics(new BasicSpace());
+	physics->setParticleUpdate(NULL);
+	physics->setSpringUpdate(NULL);
+	physics->reserve(NUM_PARTICLES, 0, 0);
+	for(int i=0; i<NUM_PARTICLES; i++) {
+		Particle* p = physics->createParticle();
+		p->init(Vec3f::zero());
+		p->id = i;
+	}
+
+	// replaces a block an earlier crashed run may have left behind
+	SharedMemoryExport* exporter = new SharedMemoryExport(NAME, NUM_PARTICLES, true);
+	physics->setSharedMemoryExport(exporter);
+
+	// a second exporter must not take over the block while it's in use
+	bool isTakenOver = true;
+	try {
+		SharedMemoryExport other(NAME, NUM_PARTICLES);
+	} catch(const char* error) {
+		isTakenOver = false;
+	}
+
+	boost::thread reader(readerMain);
+
+	for(int frame=1; frame<=NUM_FRAMES; frame++) {
+		for(int i=0; i<NUM_PARTICLES; i++)
+			physics->particles[i]->position.set((float)frame, (float)i, 0.0f);
+		physics->update(1.0f / 60.0f);
+	}
+
+	isDone = true;
+	reader.join();
+
+	std::cout << "published "<< exporter->getFrame() <<" frames, read "<< numRead 
+		<<", discarded "<< numDiscarded <<" overwritten frames" << std::endl;
+
+	physics->setSharedMemoryExport(NULL);
+	delete exporter;
+	delete physics;
+
+	if(numErrors > 0 || numRead == 0) {
+		std::cout << "FAILED: "<< numErrors <<" inconsistent frames" << std::endl;
+		return 1;
+	}
+
+	if(isTakenOver) {
+		std::cout << "FAILED: a second exporter replaced the block" << std::endl;
+		return 1;
+	}
+
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
@@ -0,0 +1,286 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+/*
+ Checks that a restored Physics snapshot continues exactly like the original simulation,
+ reports the restored particles as born, that damaged snapshots are rejected without
+ changing the physics and measures how long saving and loading a large simulation takes.
+ 
+ Returns 0 when the restored simulation matches, 1 otherwise.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+Physics* createPhysics(int numParticles)
+{
+	Vec3f dimension(1000.0f, 1000.0f, 1000.0f);
+
+	Physics* physics = new Physics(new Octree(Vec3f::zero(), dimension, 50.0f));
+	physics->setDeterministic(true, 12345);
+
+	FixedRadiusNeighbourUpdate* neighbourUpdate = new FixedRadiusNeighbourUpdate();
+	neighbourUpdate->setRadius(25.0f);
+	physics->setNeighbourUpdate(neighbourUpdate);
+
+	Emitter* emitter = new Emitter(physics);
+	emitter->setPosition(dimension * 0.5f);
+	emitter->setRate(numParticles / 100);
+	emitter->setInterval(0.0f);
+	emitter->setMax(numParticles);
+	emitter->addBehaviour(new BoxRandom(physics->space));
+
+	Initializer* initializer = new Initializer();
+	initializer->setLifeTime(2.0f);
+	initializer->setLifeTimeVariance(0.5f);
+	emitter->addBehaviour(initializer);
+	physics->emitter = emitter;
+
+	FlockAttract* attract = new FlockAttract(physics->space);
+	attract->setRange(0.025f);
+	attract->setWeight(0.01f);
+	physics->addBehaviour(attract);
+
+	FlockRepel* repel = new FlockRepel(physics->space);
+	repel->setRange(0.0125f);
+	repel->setWeight(0.02f);
+	physics->addBehaviour(repel);
+
+	physics->addBehaviour(new BoxWrap(physics->space));
+	physics->addConstraint(new CollisionConstraint());
+
+	// a chain of springs
+	Particle* previous = NULL;
+	for(int i=0; i<100; i++) {
+		Particle* p = physics->createParticle();
+		p->init(Vec3f(i * 2.0f, 500.0f, 500.0f));
+		p->lifeTime = Particle::LIFETIME_PERPETUAL;
+		if(i == 0) p->lock();
+
+		if(previous != NULL) {
+			Spring* s = physics->createSpring();
+			s->init(previous, p, 2.0f, 0.5f);
+		}
+		previous = p;
+	}
+
+	return physics;
+}
+
+double getMilliseconds(Profiler::Ticks start)
+{
+	return Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+}
+
+//! saves the simulation half way and checks a restored copy continues the same way
+bool testRestore(bool compress)
+{
+	float dt = 1.0f / 60.0f;
+	int numSettleFrames = 120;
+	int numTestFrames = 60;
+
+	// run the original simulation and save it half way
+	Physics* original = createPhysics(5000);
+	for(int i=0; i<numSettleFrames; i++)
+		original->update(dt);
+
+	std::stringstream snapshot;
+	Snapshot::save(original, snapshot, compress);
+
+	randSeed(1);
+	for(int i=0; i<numTestFrames; i++)
+		original->update(dt);
+
+	// restore into a freshly set up simulation and continue from there
+	Physics* restored = createPhysics(5000);
+	Snapshot::load(restored, snapshot);
+
+	randSeed(1);
+	for(int i=0; i<numTestFrames; i++)
+		restored->update(dt);
+
+	bool isEqual = original->getStateHash() == restored->getStateHash();
+	delete original;
+	delete restored;
+	return isEqual;
+}
+
+//! loads into a smaller simulation and checks exactly the restored live particles are reported as born
+bool testLifecycle()
+{
+	float dt = 1.0f / 60.0f;
+
+	Physics* original = createPhysics(5000);
+	for(int i=0; i<120; i++)
+		original->update(dt);
+
+	std::stringstream snapshot;
+	Snapshot::save(original, snapshot, false);
+	delete original;
+
+	// the particle pool has to grow while loading
+	Physics* restored = createPhysics(1000);
+	restored->update(dt);
+	Snapshot::load(restored, snapshot);
+
+	std::vector<int> born, died, alive;
+	restored->lifecycle.drainBorn(born);
+	restored->lifecycle.drainDied(died);
+	for(int i=0; i<(int)restored->particles.size(); i++) {
+		if(restored->particles[i]->isAlive)
+			alive.push_back(i);
+	}
+	std::sort(born.begin(), born.end());
+
+	// nothing may be reported twice once the simulation continues
+	restored->update(dt);
+	std::vector<int> bornAgain;
+	restored->lifecycle.drainBorn(bornAgain);
+	bool isReportedTwice = false;
+	for(std::vector<int>::iterator it = bornAgain.begin(); it != bornAgain.end(); ++it)
+		isReportedTwice |= std::binary_search(born.begin(), born.end(), *it);
+
+	delete restored;
+	return born == alive && died.empty() && !isReportedTwice;
+}
+
+//! loads a damaged copy of the snapshot and returns true when it was rejected without changing the physics
+bool isRejected(Physics* physics, std::string data)
+{
+	boost::uint64_t hash = physics->getStateHash();
+	int numParticles = physics->getNumParticles();
+	try {
+		Snapshot::load(physics, data.data(), data.size());
+	} catch(const char* message) {
+		return physics->getStateHash() == hash && physics->getNumParticles() == numParticles;
+	}
+	return false;
+}
+
+//! offset of the first spring end in an uncompressed snapshot, counted back from the aligned arrays at its end
+size_t getSpringOffset(std::string const& data)
+{
+	boost::int32_t numSprings;
+	memcpy(&numSprings, data.data() + 12, sizeof(numSprings));
+	size_t aligned = (numSprings * sizeof(boost::int32_t) + 15) / 16 * 16;
+	size_t flagsOffset = data.size() - (numSprings + 15) / 16 * 16;
+	return flagsOffset - 5 * aligned;
+}
+
+//! damages single fields of a snapshot and checks every version is rejected before anything is restored
+bool testBroken()
+{
+	float dt = 1.0f / 60.0f;
+
+	Physics* original = createPhysics(5000);
+	for(int i=0; i<60; i++)
+		original->update(dt);
+
+	std::stringstream snapshot;
+	Snapshot::save(original, snapshot, false);
+	std::string data = snapshot.str();
+	delete original;
+
+	Physics* physics = createPhysics(5000);
+	for(int i=0; i<30; i++)
+		physics->update(dt);
+
+	boost::int32_t value;
+	bool isOK = true;
+
+	std::string broken = data;
+	value = -1;
+	memcpy(&broken[8], &value, sizeof(value));
+	isOK &= isRejected(physics, broken);
+
+	broken = data;
+	value = 1 << 30;
+	memcpy(&broken[20], &value, sizeof(value));
+	isOK &= isRejected(physics, broken);
+
+	broken = data;
+	value = -5;
+	memcpy(&broken[getSpringOffset(data)], &value, sizeof(value));
+	isOK &= isRejected(physics, broken);
+
+	isOK &= isRejected(physics, data.substr(0, data.size() / 2));
+
+	// the undamaged snapshot still loads
+	Snapshot::load(physics, data.data(), data.size());
+
+	delete physics;
+	return isOK;
+}
+
+int main(int argc, char* argv[]) 
+{
+	std::cout << "---- Snapshot Test ----" << std::endl;
+
+	if(!testLifecycle()) {
+		std::cout << "FAILED: born particles after loading dont match the restored live particles" << std::endl;
+		return 1;
+	}
+	std::cout << "lifecycle after loading: OK" << std::endl;
+
+	if(!testBroken()) {
+		std::cout << "FAILED: damaged snapshots changed the physics or weren't rejected" << std::endl;
+		return 1;
+	}
+	std::cout << "damaged snapshots rejected: OK" << std::endl;
+
+	for(int compress=0; compress<2; compress++) {
+		const char* name = compress ? "compressed" : "uncompressed";
+		if(!testRestore(compress != 0)) {
+			std::cout << "FAILED: restored "<< name <<" simulation diverged from the original" << std::endl;
+			return 1;
+		}
+		std::cout << "restored "<< name <<" simulation matches: OK" << std::endl;
+	}
+
+	// timing with a large simulation
+	int numParticles = 1000 * 1000;
+	Physics* large = new Physics(new BasicSpace());
+	large->reserve(numParticles, 0, 0);
+	for(int i=0; i<numParticles; i++)
+		large->createParticle()->init(randVec3f(1000.0f));
+
+	const char* path = "SnapshotTest.fks";
+
+	for(int compress=0; compress<2; compress++) {
+		Profiler::Ticks start = Profiler::getTicks();
+		Snapshot::save(large, path, compress != 0);
+		double saveTime = getMilliseconds(start);
+
+		FILE* file = fopen(path, "rb");
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fclose(file);
+
+		start = Profiler::getTicks();
+		Snapshot::load(large, path);
+		double loadTime = getMilliseconds(start);
+		remove(path);
+
+		std::cout << numParticles <<" particles"<< (compress ? " compressed" : "") <<": "<< size / (1024 * 1024) <<" MB"
+			<<", save "<< saveTime <<" ms, load "<< loadTime <<" ms" << std::endl;
+	}
+
+	delete large;
+
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
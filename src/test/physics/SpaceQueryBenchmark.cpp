@@ -0,0 +1,137 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Compares neighbour queries through the virtual Space::select against the SphereBound
+ overloads of the concrete space types, for every particle in a random cloud.
+ Also times FixedRadiusNeighbourUpdate, which picks those overloads internally.
+
+ Usage: SpaceQueryBenchmark [--particles n] [--radius r] [--repeat n]
+
+ Returns 0 when both return the same neighbours, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+
+//! selects the neighbours of all particles through the given pointer type
+template<typename SpaceType>
+double selectAll(SpaceType* space, std::vector<Particle*>& particles, float radius, int numRepeats)
+{
+	Profiler::Ticks start = Profiler::getTicks();
+	for(int r=0; r<numRepeats; r++) {
+		for(size_t i=0; i<particles.size(); i++) {
+			SphereBound query(particles[i]->position, radius);
+			space->select(&query, particles[i]->getNeighbours());
+		}
+	}
+	return Profiler::ticksToMilliseconds(Profiler::getTicks() - start) / numRepeats;
+}
+
+template<typename SpaceType>
+bool compare(const char* name, SpaceType* space, std::vector<Particle*>& particles, float radius, int numRepeats)
+{
+	space->clear();
+	for(size_t i=0; i<particles.size(); i++)
+		space->insert(particles[i]);
+
+	double virtualTime = selectAll<Space>(space, particles, radius, numRepeats);
+
+	std::vector<SpatialList> expected(particles.size());
+	size_t numNeighbours = 0;
+	for(size_t i=0; i<particles.size(); i++) {
+		expected[i] = *particles[i]->getNeighbours();
+		numNeighbours += expected[i].size();
+	}
+
+	double typedTime = selectAll<SpaceType>(space, particles, radius, numRepeats);
+
+	int numDifferent = 0;
+	for(size_t i=0; i<particles.size(); i++) {
+		if(*particles[i]->getNeighbours() != expected[i])
+			numDifferent++;
+	}
+
+	std::cout << name <<": "<< numNeighbours / (double)particles.size() <<" neighbours per particle, "
+		<<"virtual "<< virtualTime <<" ms, typed "<< typedTime <<" ms" << std::endl;
+
+	if(numDifferent > 0) {
+		std::cout << "FAILED: "<< numDifferent <<" neighbour lists differ" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 20000;
+	float radius = 30.0f;
+	int numRepeats = 5;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--radius") == 0 && i + 1 < argc)
+			radius = (float)atof(argv[++i]);
+		else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			numRepeats = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Space Query Benchmark ----" << std::endl;
+
+	randSeed(1);
+	std::vector<Particle*> particles;
+	for(int i=0; i<numParticles; i++) {
+		Particle* p = new Particle();
+		p->init(Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE)));
+		particles.push_back(p);
+	}
+
+	bool isOK = true;
+	Vec3f dimension(SIZE, SIZE, SIZE);
+
+	Octree octree(Vec3f::zero(), dimension, radius);
+	isOK &= compare("Octree", &octree, particles, radius, numRepeats);
+
+	SpatialHash hash(Vec3f::zero(), dimension, radius);
+	isOK &= compare("SpatialHash", &hash, particles, radius, numRepeats);
+
+	// brute force, keep it short
+	std::vector<Particle*> few(particles.begin(), particles.begin() + std::min(numParticles, 2000));
+	BasicSpace basic(Vec3f::zero(), dimension);
+	isOK &= compare("BasicSpace", &basic, few, radius * 4.0f, numRepeats);
+
+	// whole neighbour update step as used by Physics
+	Physics physics(new Octree(Vec3f::zero(), dimension, radius));
+	for(int i=0; i<numParticles; i++)
+		physics.particles.push_back(particles[i]);
+
+	FixedRadiusNeighbourUpdate update;
+	update.setRadius(radius);
+	Profiler::Ticks start = Profiler::getTicks();
+	for(int r=0; r<numRepeats; r++)
+		update.apply(&physics);
+	std::cout << "FixedRadiusNeighbourUpdate: "<< Profiler::ticksToMilliseconds(Profiler::getTicks() - start) / numRepeats <<" ms" << std::endl;
+	physics.particles.clear();
+
+	for(int i=0; i<numParticles; i++)
+		delete particles[i];
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}
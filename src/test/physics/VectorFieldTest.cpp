@@ -0,0 +1,162 @@
+/*                                                                           
+ *      _____  __  _____  __     ____                                   
+ *     / ___/ / / /____/ / /    /    \   FieldKit
+ *    / ___/ /_/ /____/ / /__  /  /  /   (c) 2011, FIELD. All rights reserved.              
+ *   /_/        /____/ /____/ /_____/    http://www.field.io           
+ */
+
+
+
+/*
+ Checks the trilinear interpolation of VectorField, compares sampling a baked 
+ curl noise field against evaluating the noise for every particle and runs the 
+ CurlNoiseBaker in the background of a simulation.
+
+ Usage: VectorFieldTest [--particles n]
+
+ Returns 0 when all checks pass, 1 otherwise.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <boost/thread.hpp>
+
+#include "cinder/Perlin.h"
+#include "fieldkit/physics/PhysicsKit.h"
+#include "fieldkit/Profiler.h"
+
+using namespace fieldkit;
+using namespace fieldkit::physics;
+
+const float SIZE = 1000.0f;
+
+//! trilinear interpolation reproduces linear functions exactly
+Vec3f linear(Vec3f const& p)
+{
+	return Vec3f(p.x * 0.5f + p.y * 0.1f, p.z * -0.2f + 3.0f, p.x * 0.05f + p.y * 0.05f + p.z * 0.05f);
+}
+
+double getMilliseconds(Profiler::Ticks start)
+{
+	return Profiler::ticksToMilliseconds(Profiler::getTicks() - start);
+}
+
+int main(int argc, char* argv[]) 
+{
+	int numParticles = 100000;
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			numParticles = atoi(argv[++i]);
+	}
+
+	std::cout << "---- Vector Field Test ----" << std::endl;
+	bool isOK = true;
+	randSeed(1);
+
+	// interpolation
+	AABB bounds(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE));
+	int resolutions[2][3] = { { 17, 9, 5 }, { 33, 33, 1 } };
+
+	for(int r=0; r<2; r++) {
+		VectorField field;
+		field.init(bounds, resolutions[r][0], resolutions[r][1], resolutions[r][2]);
+		for(int z=0; z<field.getResolution(2); z++)
+			for(int y=0; y<field.getResolution(1); y++)
+				for(int x=0; x<field.getResolution(0); x++)
+					field.set(x, y, z, linear(field.getPosition(x, y, z)));
+
+		double maxError = 0.0;
+		for(int i=0; i<10000; i++) {
+			Vec3f p(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE));
+			if(field.getResolution(2) == 1) p.z = 0.0f;
+			maxError = std::max(maxError, (double)(field.sample(p) - linear(p)).length());
+		}
+
+		// outside the bounds samples are clamped
+		Vec3f outside(-10.0f, SIZE + 10.0f, SIZE * 2.0f);
+		Vec3f clamped(0.0f, SIZE, field.getResolution(2) == 1 ? 0.0f : SIZE);
+		maxError = std::max(maxError, (double)(field.sample(outside) - linear(clamped)).length());
+
+		std::cout << resolutions[r][0] <<"x"<< resolutions[r][1] <<"x"<< resolutions[r][2] 
+			<<" field: max interpolation error "<< maxError << std::endl;
+
+		if(maxError > 1e-3) {
+			std::cout << "FAILED: trilinear interpolation is off" << std::endl;
+			isOK = false;
+		}
+	}
+
+	// noise per particle vs baked field
+	CurlNoiseBaker baker(bounds, 32, 32, 32);
+	VectorField baked;
+
+	Profiler::Ticks start = Profiler::getTicks();
+	baker.bake(baked, 0.0f);
+	double bakeTime = getMilliseconds(start);
+
+	std::vector<Vec3f> positions(numParticles);
+	for(int i=0; i<numParticles; i++)
+		positions[i] = Vec3f(randFloat(SIZE), randFloat(SIZE), randFloat(SIZE));
+
+	// curl noise needs three noise derivatives per particle, one is timed
+	ci::Perlin perlin(baker.getOctaves(), baker.getSeed());
+	Vec3f sum = Vec3f::zero();
+	start = Profiler::getTicks();
+	for(int i=0; i<numParticles; i++)
+		sum += perlin.dfBm(positions[i] * baker.getFrequency());
+	double noiseTime = getMilliseconds(start) * 3.0;
+
+	start = Profiler::getTicks();
+	for(int i=0; i<numParticles; i++)
+		sum += baked.sample(positions[i]);
+	double sampleTime = getMilliseconds(start);
+
+	std::cout << "noise per particle: "<< noiseTime <<" ms, 32^3 bake: "<< bakeTime <<" ms, "
+		<<"field sampling: "<< sampleTime <<" ms ("<< sum.x <<")" << std::endl;
+
+	// baking in the background of a running simulation
+	Physics* physics = new Physics(new BasicSpace(Vec3f::zero(), Vec3f(SIZE, SIZE, SIZE)));
+	for(int i=0; i<10000; i++)
+		physics->createParticle()->init(positions[i]);
+
+	baker.setInterval(0.05f);
+	baker.start();
+
+	VectorFieldForce* force = new VectorFieldForce(physics->space);
+	force->setBaker(&baker);
+	physics->addBehaviour(force);
+
+	int numChanges = 0;
+	VectorField const* last = NULL;
+	for(int f=0; f<60; f++) {
+		physics->update(1.0f / 60.0f);
+		if(force->getField() != last) {
+			numChanges++;
+			last = force->getField();
+		}
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	}
+	baker.stop();
+
+	int numMoved = 0;
+	for(int i=0; i<10000; i++) {
+		if(physics->particles[i]->position != positions[i])
+			numMoved++;
+	}
+
+	std::cout << baker.getNumBakes() <<" bakes, the force switched fields "<< numChanges <<" times, "
+		<< numMoved <<" particles moved" << std::endl;
+
+	if(numChanges < 2 || numMoved == 0) {
+		std::cout << "FAILED: the force didn't pick up the baked fields" << std::endl;
+		isOK = false;
+	}
+
+	delete physics;
+
+	if(!isOK) return 1;
+	std::cout << "---- Done ----" << std::endl;
+	return 0;
+}